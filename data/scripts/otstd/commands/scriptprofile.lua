@@ -0,0 +1,22 @@
+
+local ScriptProfile = Command:new("ScriptProfile")
+
+ScriptProfile.words = "/profile"
+ScriptProfile.groups = {"Server Administrator"}
+
+function ScriptProfile.handler(event)
+	local count = tonumber(event.param) or 10
+	local t = "Script Profile (microseconds):\n"
+	
+	for _, entry in ipairs(getScriptProfile(count)) do
+		t = t .. entry.source .. " " .. entry.event .. "\n" ..
+			"  calls: " .. entry.calls .. " total: " .. entry.totalTime ..
+			" avg: " .. entry.averageTime .. " p99: " .. entry.p99Time ..
+			" max: " .. entry.maxTime .. " alloc: " .. (entry.allocated or "not counted under LuaJIT") ..
+			" aborted: " .. entry.aborted .. "\n"
+	end
+	
+	event.player:sendNote(t)
+end
+
+ScriptProfile:register()
@@ -0,0 +1,117 @@
+-- Fast paths for the most called read-only functions when running on LuaJIT
+-- The JIT compiles FFI calls inline, while calls through the regular
+-- bindings stop the trace. Every fast path falls back to the regular
+-- binding when the object is not valid, so errors are reported as before.
+-- The declarations must match src/script_ffi.h
+
+if jit == nil then
+	return
+end
+
+local ffi = require("ffi")
+
+ffi.cdef[[
+	typedef struct {
+		int32_t x;
+		int32_t y;
+		int32_t z;
+	} otserv_position;
+
+	int otserv_thing_get_position(const void* object, otserv_position* position);
+	int otserv_creature_get_health(const void* object, int32_t* health);
+	int otserv_item_get_id(const void* object, int32_t* id);
+	int otserv_item_get_count(const void* object, int32_t* count);
+	int otserv_map_has_tile(int32_t x, int32_t y, int32_t z);
+	int otserv_creature_get_custom_value(const void* object,
+		const char* key, size_t key_length, const char** value, size_t* value_length);
+]]
+
+local C = ffi.C
+
+-- Out parameters are reused, results are copied out before returning
+local position = ffi.new("otserv_position")
+local number = ffi.new("int32_t[1]")
+local value = ffi.new("const char*[1]")
+local value_length = ffi.new("size_t[1]")
+
+local function isObject(self)
+	return type(self) == "userdata"
+end
+
+local getPosition = Thing.getPosition
+function Thing:getPosition()
+	if isObject(self) and C.otserv_thing_get_position(self, position) ~= 0 then
+		return {x = position.x, y = position.y, z = position.z}
+	end
+	return getPosition(self)
+end
+
+local getX = Thing.getX
+function Thing:getX()
+	if isObject(self) and C.otserv_thing_get_position(self, position) ~= 0 then
+		return position.x
+	end
+	return getX(self)
+end
+
+local getY = Thing.getY
+function Thing:getY()
+	if isObject(self) and C.otserv_thing_get_position(self, position) ~= 0 then
+		return position.y
+	end
+	return getY(self)
+end
+
+local getZ = Thing.getZ
+function Thing:getZ()
+	if isObject(self) and C.otserv_thing_get_position(self, position) ~= 0 then
+		return position.z
+	end
+	return getZ(self)
+end
+
+local getHealth = Creature.getHealth
+function Creature:getHealth()
+	if isObject(self) and C.otserv_creature_get_health(self, number) ~= 0 then
+		return number[0]
+	end
+	return getHealth(self)
+end
+
+local getItemID = Item.getItemID
+function Item:getItemID()
+	if isObject(self) and C.otserv_item_get_id(self, number) ~= 0 then
+		return number[0]
+	end
+	return getItemID(self)
+end
+
+local getCount = Item.getCount
+function Item:getCount()
+	if isObject(self) and C.otserv_item_get_count(self, number) ~= 0 then
+		return number[0]
+	end
+	return getCount(self)
+end
+
+local getRawCustomValue = Creature.getRawCustomValue
+function Creature:getRawCustomValue(key)
+	if isObject(self) and type(key) == "string" and
+		C.otserv_creature_get_custom_value(self, key, #key, value, value_length) ~= 0 then
+		if value[0] == nil then
+			return nil
+		end
+		return ffi.string(value[0], value_length[0])
+	end
+	return getRawCustomValue(self, key)
+end
+
+-- Only a tile that exists needs a tile object
+local getParentTile = __internal_getParentTile
+function __internal_getParentTile(x, y, z)
+	if type(x) == "number" and type(y) == "number" and type(z) == "number" and
+		C.otserv_map_has_tile(x, y, z) == 0 then
+		return nil
+	end
+	return getParentTile(x, y, z)
+end
@@ -10,6 +10,7 @@ include("functions")
 include("itemids")
 
 include("classes/classes")
+include("ffi_bindings")
 include("game")
 
 include("commands")
@@ -43,6 +43,8 @@ int32_t Actor::despawnRadius;
 uint32_t Actor::monsterCount = 0;
 #endif
 
+OBJECT_POOL_DEFINE(Actor)
+
 Actor* Actor::create()
 {
   CreatureType t;
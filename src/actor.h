@@ -24,6 +24,7 @@
 #include "classes.h"
 #include "creature.h"
 #include "creature_type.h"
+#include "object_pool.h"
 
 typedef std::list<Creature*> CreatureList;
 
@@ -46,6 +47,7 @@ public:
   static Actor* create();
   static Actor* create(CreatureType cType);
   static Actor* create(const std::string& name);
+  OBJECT_POOL_DECLARE();
   static int32_t despawnRange;
   static int32_t despawnRadius;
 
@@ -58,6 +58,8 @@ class ProtocolGame;
 class OutputMessage;
 class NetworkMessage;
 class SchedulerTask;
+class SaveRecord;
+class SaveSnapshot;
 class Connection;
 class ServiceBase;
 class ServicePort;
@@ -428,6 +428,8 @@ Position getCasterPosition(const Creature* creature, Direction dir)
 
 } // namespace Combat
 
+OBJECT_POOL_DEFINE(MagicField)
+
 MagicField::MagicField(uint16_t _type)
   : Item(_type)
 {
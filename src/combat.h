@@ -102,6 +102,7 @@ class MagicField : public Item {
 public:
   MagicField(uint16_t _type);
   ~MagicField();
+  OBJECT_POOL_DECLARE();
 
   virtual MagicField* getMagicField();
   virtual const MagicField* getMagicField() const;
@@ -108,6 +108,10 @@ bool ConfigManager::loadFile(const std::string& _filename)
   m_confString[URL] = getGlobalString(L, "url");
   m_confString[LOCATION] = getGlobalString(L, "location");
   m_confString[MAP_STORAGE_TYPE] = getGlobalString(L, "map_store_type", "relational");
+  m_confString[LOCAL_STORAGE_FILE] = getGlobalString(L, "local_storage_file");
+  m_confString[PLAYER_STORAGE_TYPE] = getGlobalString(L, "player_store_type", "relational");
+  m_confString[ITEM_CACHE_FILE] = getGlobalString(L, "item_cache_file", "items/items.cache");
+  m_confString[WORLD_IMAGE_FILE] = getGlobalString(L, "world_image_file", "world/map.image");
   m_confInteger[LOGIN_TRIES] = getGlobalNumber(L, "maximum_login_tries", 5);
   m_confInteger[RETRY_TIMEOUT] = getGlobalNumber(L, "login_retry_timeout", 30 * 1000);
   m_confInteger[LOGIN_TIMEOUT] = getGlobalNumber(L, "login_unlock_timeout", 5 * 1000);
@@ -159,6 +163,10 @@ bool ConfigManager::loadFile(const std::string& _filename)
   m_confInteger[REMOVE_WEAPON_CHARGES] = getGlobalBoolean(L, "remove_weapon_charges", true);
   m_confInteger[MAXIMUM_SCRIPT_RECURSION_DEPTH] = getGlobalNumber(L, "script_recursion_depth", 16);
   m_confInteger[DETAIL_SCRIPT_ERRORS] = getGlobalBoolean(L, "detailed_script_errors", false);
+  m_confInteger[SCRIPT_PROFILER] = getGlobalBoolean(L, "script_profiler", false);
+  m_confInteger[SCRIPT_PROFILER_LOG_INTERVAL] = getGlobalNumber(L, "script_profiler_log_interval", 0);
+  m_confInteger[SCRIPT_INSTRUCTION_BUDGET] = getGlobalNumber(L, "script_instruction_budget", 0);
+  m_confInteger[SCRIPT_GC_BUDGET] = getGlobalNumber(L, "script_gc_budget", 1000);
   m_confInteger[LOGIN_ATTACK_DELAY] = getGlobalNumber(L, "login_attack_delay", 10*1000);
   m_confInteger[SHOW_CRASH_WINDOW] = getGlobalBoolean(L, "show_crash_window", true);
   m_confInteger[IDLE_TIME] = getGlobalNumber(L, "maximum_idle_time", 16*60*1000);
@@ -183,6 +191,10 @@ bool ConfigManager::loadFile(const std::string& _filename)
   m_confInteger[RATES_FOR_PLAYER_KILLING] = getGlobalBoolean(L, "rates_for_player_killing", false);
   m_confInteger[RATE_EXPERIENCE_PVP] = getGlobalNumber(L, "rate_experience_pvp", 1);
   m_confInteger[ADDONS_ONLY_FOR_PREMIUM] = getGlobalBoolean(L, "addons_only_for_premium", true);
+  m_confInteger[BACKGROUND_SAVE] = getGlobalBoolean(L, "background_save", false);
+  m_confInteger[PLAYER_CACHE_SIZE] = getGlobalNumber(L, "player_cache_size", 10000);
+  m_confInteger[PLAYER_CACHE_LIFETIME] = getGlobalNumber(L, "player_cache_lifetime", 10 * 60);
+  m_confInteger[PLAYER_CACHE_WARM] = getGlobalBoolean(L, "player_cache_warm", false);
 
   m_confInteger[PASSWORD_TYPE] = PASSWORD_TYPE_PLAIN;
   m_confInteger[STATUSQUERY_TIMEOUT] = getGlobalNumber(L, "status_information_timeout", 30 * 1000);
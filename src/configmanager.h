@@ -55,6 +55,10 @@ public:
     SQL_DB,
     SQL_TYPE,
     MAP_STORAGE_TYPE,
+    LOCAL_STORAGE_FILE,
+    PLAYER_STORAGE_TYPE,
+    ITEM_CACHE_FILE,
+    WORLD_IMAGE_FILE,
     LAST_STRING_CONFIG /* this must be the last one */
   };
 
@@ -112,6 +116,10 @@ public:
     USE_ACCBALANCE,
     MAXIMUM_SCRIPT_RECURSION_DEPTH,
     DETAIL_SCRIPT_ERRORS,
+    SCRIPT_PROFILER,
+    SCRIPT_PROFILER_LOG_INTERVAL,
+    SCRIPT_INSTRUCTION_BUDGET,
+    SCRIPT_GC_BUDGET,
     LOGIN_ATTACK_DELAY,
     SHOW_CRASH_WINDOW,
     STAMINA_EXTRA_EXPERIENCE_DURATION,
@@ -139,6 +147,10 @@ public:
     RATES_FOR_PLAYER_KILLING,
     RATE_EXPERIENCE_PVP,
     ADDONS_ONLY_FOR_PREMIUM,
+    BACKGROUND_SAVE,
+    PLAYER_CACHE_SIZE,
+    PLAYER_CACHE_LIFETIME,
+    PLAYER_CACHE_WARM,
     LAST_INTEGER_CONFIG /* this must be the last one */
   };
 
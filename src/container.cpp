@@ -26,11 +26,14 @@
 
 extern Game g_game;
 
+OBJECT_POOL_DEFINE(Container)
+
 Container::Container(uint16_t _type) : Item(_type)
 {
   //std::cout << "Container constructor " << this << std::endl;
   maxSize = items[_type].maxItems;
   total_weight = 0.0;
+  content_worth = 0;
   serializationCount = 0;
 }
 
@@ -89,6 +92,7 @@ void Container::addItem(Item* item)
 {
   itemlist.push_back(item);
   item->setParent(this);
+  updateContentTotals(item, false);
 }
 
 Attr_ReadValue Container::readAttr(AttrTypes_t attr, PropStream& propStream)
@@ -164,6 +168,60 @@ double Container::getWeight() const
   return Item::getWeight() + total_weight;
 }
 
+void Container::updateContentTotals(const Item* item, bool removed)
+{
+  const Container* container = item->getContainer();
+  const uint32_t worth = item->getWorth() + (container? container->content_worth : 0);
+
+  for(Container* holder = this; holder; holder = holder->getParentContainer()){
+    holder->updateContentCount(item->getID(), item->getItemCount(), removed);
+    if(container){
+      for(ItemCountMap::const_iterator it = container->content_counts.begin(); it != container->content_counts.end(); ++it){
+        holder->updateContentCount(it->first, it->second, removed);
+      }
+    }
+
+    if(removed){
+      holder->content_worth -= std::min(worth, holder->content_worth);
+    }
+    else{
+      holder->content_worth += worth;
+    }
+  }
+}
+
+void Container::updateContentCount(uint16_t itemId, uint32_t count, bool removed)
+{
+  if(count == 0){
+    return;
+  }
+
+  if(!removed){
+    content_counts[itemId] += count;
+    return;
+  }
+
+  ItemCountMap::iterator it = content_counts.find(itemId);
+  if(it != content_counts.end()){
+    if(it->second <= count){
+      content_counts.erase(it);
+    }
+    else{
+      it->second -= count;
+    }
+  }
+}
+
+uint32_t Container::getContentItemCount(uint16_t itemId) const
+{
+  ItemCountMap::const_iterator it = content_counts.find(itemId);
+  if(it != content_counts.end()){
+    return it->second;
+  }
+
+  return 0;
+}
+
 Cylinder* Container::getParent()
 {
   return Thing::getParent();
@@ -615,6 +673,7 @@ void Container::__addThing(Creature* actor, int32_t index, Thing* thing)
   if(Container* parent_container = getParentContainer()) {
     parent_container->updateItemWeight(item->getWeight());
   }
+  updateContentTotals(item, false);
 
   //send change to client
   if(getParent() && (getParent() != VirtualCylinder::virtualCylinder)){
@@ -647,8 +706,10 @@ void Container::__updateThing(Creature* actor, Thing* thing, uint16_t itemId, ui
 
   const double old_weight = item->getWeight();
 
+  updateContentTotals(item, true);
   item->setID(itemId);
   item->setSubType(count);
+  updateContentTotals(item, false);
 
   const double diff_weight = -old_weight + item->getWeight();
   total_weight += diff_weight;
@@ -697,8 +758,10 @@ void Container::__replaceThing(Creature* actor, uint32_t index, Thing* thing)
     parent_container->updateItemWeight(-(*cit)->getWeight() + item->getWeight());
   }
 
+  updateContentTotals(*cit, true);
   itemlist.insert(cit, item);
   item->setParent(this);
+  updateContentTotals(item, false);
 
   //send change to client
   if(getParent()){
@@ -744,7 +807,9 @@ void Container::__removeThing(Creature* actor, Thing* thing, uint32_t count)
     uint8_t newCount = (uint8_t)std::max((int32_t)0, (int32_t)(item->getItemCount() - count));
 
     const double old_weight = -item->getWeight();
+    updateContentTotals(item, true);
     item->setItemCount(newCount);
+    updateContentTotals(item, false);
     const double diff_weight = old_weight + item->getWeight();
     total_weight += diff_weight;
 
@@ -767,6 +832,7 @@ void Container::__removeThing(Creature* actor, Thing* thing, uint32_t count)
     }
 
     total_weight -= item->getWeight();
+    updateContentTotals(item, true);
     item->setParent(NULL);
     itemlist.erase(cit);
   }
@@ -907,6 +973,7 @@ void Container::__internalAddThing(uint32_t index, Thing* thing)
   if(Container* parent_container = getParentContainer()) {
     parent_container->updateItemWeight(item->getWeight());
   }
+  updateContentTotals(item, false);
 }
 
 ContainerIterator Container::begin()
@@ -56,6 +56,7 @@ class Container : public Item, public Cylinder
 public:
   Container(uint16_t _type);
   virtual ~Container();
+  OBJECT_POOL_DECLARE();
   virtual Item* clone() const;
 
   virtual Container* getContainer();
@@ -88,6 +89,10 @@ public:
   uint32_t getItemHoldingCount() const;
   virtual double getWeight() const;
 
+  // Totals of everything inside, nested containers included
+  uint32_t getContentItemCount(uint16_t itemId) const;
+  uint32_t getContentWorth() const {return content_worth;}
+
   //cylinder implementations
   virtual Cylinder* getParent();
   virtual const Cylinder* getParent() const;
@@ -137,6 +142,8 @@ private:
 
   Container* getParentContainer();
   void updateItemWeight(double diff);
+  void updateContentTotals(const Item* item, bool removed);
+  void updateContentCount(uint16_t itemId, uint32_t count, bool removed);
 
 protected:
   std::ostringstream& getContentDescription(std::ostringstream& os) const;
@@ -144,10 +151,16 @@ protected:
   uint32_t maxSize;
   double total_weight;
   ItemList itemlist;
+
+  typedef std::map<uint16_t, uint32_t> ItemCountMap;
+  ItemCountMap content_counts;
+  uint32_t content_worth;
   uint32_t serializationCount;
 
   friend class ContainerIterator;
   friend class IOMapSerialize;
+  friend class IOMapImage;
+  friend class IOPlayer;
 };
 
 #endif
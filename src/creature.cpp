@@ -69,6 +69,7 @@ Creature::Creature() :
   forceUpdateFollowPath = false;
   isMapLoaded = false;
   isUpdatingPath = false;
+  storageChanged = false;
   memset(localMapCache, false, sizeof(localMapCache));
 
   attackedCreature = NULL;
@@ -1937,9 +1938,9 @@ int32_t Creature::getStepDuration() const
 
   int32_t duration = 0;
   const Tile* tile = getParentTile();
-  if(tile && tile->ground){
-    uint32_t groundId = tile->ground->getID();
-    uint16_t groundSpeed = Item::items[groundId].speed;
+  if(tile && tile->hasGround()){
+    uint32_t groundId = tile->getSharedGround()->getID();
+    uint16_t groundSpeed = Item::items.getHot(groundId).speed;
     uint32_t stepSpeed = getStepSpeed();
     if(stepSpeed != 0){
       duration = (1000 * groundSpeed) / stepSpeed;
@@ -2112,33 +2113,53 @@ bool FrozenPathingConditionCall::operator()(const Position& startPos, const Posi
 
 void Creature::addListener(Script::Listener_ptr listener)
 {
+  bool wasHearing = hasHearListeners();
+  Script::ListenerList_cptr& current = registered_listeners[listener->type().value()];
+
   // We clean up any old, deactivated listeners while adding new ones
-  for(Script::ListenerList::iterator i = registered_listeners.begin(); i != registered_listeners.end();) {
-    if((*i)->isActive() == false)
-      i = registered_listeners.erase(i);
-    else
-      ++i;
+  Script::ListenerList* list = new Script::ListenerList();
+  if(current){
+    list->reserve(current->size() + 1);
+    for(Script::ListenerList::const_iterator i = current->begin(); i != current->end(); ++i) {
+      if((*i)->isActive())
+        list->push_back(*i);
+    }
+  }
+  list->push_back(listener);
+  current.reset(list);
+
+  // A removed creature still knows its last tile, but is not on the map
+  Tile* tile = getParentTile();
+  if(tile && !isRemoved() && !wasHearing && hasHearListeners()){
+    tile->qt_node->addHearer(this);
   }
-  registered_listeners.push_back(listener);
 }
 
-Script::ListenerList Creature::getListeners(Script::ListenerType type)
+Script::ListenerList_cptr Creature::getListeners(Script::ListenerType type) const
 {
-  Script::ListenerList li;
-  for(Script::ListenerList::iterator i = registered_listeners.begin(), end = registered_listeners.end(); i != end; ++i) {
-    if((*i)->type() == type)
-      li.push_back(*i);
-  }
-  return li;
+  return registered_listeners[type.value()];
 }
 
 void Creature::clearListeners() {
-  registered_listeners.clear();
+  Tile* tile = getParentTile();
+  if(tile && hasHearListeners()){
+    tile->qt_node->removeHearer(this);
+  }
+
+  for(int i = 0; i < Script::ListenerType::size; ++i)
+    registered_listeners[i].reset();
+}
+
+bool Creature::hasHearListeners() const
+{
+  const Script::ListenerList_cptr& list = registered_listeners[Script::enums::ON_HEAR_LISTENER];
+  return list && !list->empty();
 }
 
 void Creature::setCustomValue(const std::string& key, const std::string& value)
 {
   storageMap[key] = value;
+  storageChanged = true;
 }
 
 void Creature::setCustomValue(const std::string& key, int32_t value)
@@ -2154,6 +2175,7 @@ bool Creature::eraseCustomValue(const std::string& key)
   it = storageMap.find(key);
   if(it != storageMap.end()){
     storageMap.erase(it);
+    storageChanged = true;
     return true;
   }
   return false;
@@ -2192,6 +2214,15 @@ bool Creature::getCustomValue(const std::string& key, int32_t& value) const
   return true;
 }
 
+const std::string* Creature::findCustomValue(const std::string& key) const
+{
+  StorageMap::const_iterator it = storageMap.find(key);
+  if(it != storageMap.end()){
+    return &it->second;
+  }
+  return NULL;
+}
+
 StorageMap::const_iterator Creature::getCustomValueIteratorBegin() const
 {
   return storageMap.begin();
@@ -93,6 +93,7 @@ namespace Script {
   typedef boost::shared_ptr<Listener> Listener_ptr;
   typedef boost::weak_ptr<Listener> Listener_wptr;
   typedef std::vector<Listener_ptr> ListenerList;
+  typedef boost::shared_ptr<const ListenerList> ListenerList_cptr;
 }
 
 class FrozenPathingConditionCall {
@@ -341,8 +342,11 @@ public:
   static bool canSee(const Position& myPos, const Position& pos, int32_t viewRangeX, int32_t viewRangeY);
 
   void addListener(Script::Listener_ptr listener);
-  Script::ListenerList getListeners(Script::ListenerType type);
+  // Returns NULL if there are no listeners of that type
+  Script::ListenerList_cptr getListeners(Script::ListenerType type) const;
   void clearListeners();
+  // Creatures that can hear are indexed by the map, see Map::getHearers
+  bool hasHearListeners() const;
 
   // Custom value interface
   void setCustomValue(const std::string& key, const std::string& value);
@@ -351,9 +355,14 @@ public:
   bool getCustomValue(const std::string& key, std::string& value) const;
   bool getCustomValue(const std::string& key, uint32_t& value) const;
   bool getCustomValue(const std::string& key, int32_t& value) const;
+  // Returns NULL if the key has no value, valid until the values change
+  const std::string* findCustomValue(const std::string& key) const;
 
   StorageMap::const_iterator getCustomValueIteratorBegin() const;
   StorageMap::const_iterator getCustomValueIteratorEnd() const;
+  // Set when a value changes, the saved copy has to be rewritten then
+  bool isStorageChanged() const {return storageChanged;}
+  void setStorageChanged(bool changed) {storageChanged = changed;}
 
 protected:
   static const int32_t mapWalkWidth = Map_maxViewportX * 2 + 1;
@@ -372,8 +381,11 @@ protected:
   int32_t checkCreatureVectorIndex;
   bool creatureCheck;
 
-  Script::ListenerList registered_listeners;
+  // Listeners by type, a list is replaced instead of changed so a dispatch
+  // that is running while scripts add listeners keeps its own
+  Script::ListenerList_cptr registered_listeners[Script::ListenerType::size];
   StorageMap storageMap;
+  bool storageChanged;
 
   int32_t health, healthMax;
   int32_t mana, manaMax;
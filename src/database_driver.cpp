@@ -115,12 +115,33 @@ DBQuery::~DBQuery()
 DBInsert::DBInsert(DatabaseDriver* db)
 {
   m_db = db;
+  m_statements = NULL;
   m_rows = 0;
 
   // checks if current database engine supports multi line INSERTs
   m_multiLine = m_db->getParam(DBPARAM_MULTIINSERT) != 0;
 }
 
+DBInsert::DBInsert(DatabaseDriver* db, std::vector<std::string>* statements)
+{
+  m_db = db;
+  m_statements = statements;
+  m_rows = 0;
+
+  // checks if current database engine supports multi line INSERTs
+  m_multiLine = m_db->getParam(DBPARAM_MULTIINSERT) != 0;
+}
+
+bool DBInsert::runQuery(const std::string& query)
+{
+  if(m_statements){
+    m_statements->push_back(query);
+    return true;
+  }
+
+  return m_db->executeQuery(query);
+}
+
 void DBInsert::setQuery(const std::string& query)
 {
   m_query = query;
@@ -152,7 +173,7 @@ bool DBInsert::addRow(const std::string& row)
   }
   else{
     // executes INSERT for current row
-    return m_db->executeQuery(m_query + "(" + row + ")" );
+    return runQuery(m_query + "(" + row + ")" );
   }
 }
 
@@ -171,7 +192,7 @@ bool DBInsert::execute()
       return true;
     }
     // executes buffer
-    bool res = m_db->executeQuery(m_query + m_buf.str());
+    bool res = runQuery(m_query + m_buf.str());
 
     // Reset counters
     m_rows = 0;
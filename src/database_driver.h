@@ -22,6 +22,8 @@
 #define __OTSERV_DATABASE_DRIVER_H__
 
 #include <iosfwd>
+#include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/thread/recursive_mutex.hpp>
@@ -239,6 +241,15 @@ public:
   * @param Database* database wrapper
   */
   DBInsert(DatabaseDriver* db);
+
+  /**
+  * Associates with given database handler, but instead of executing the
+  * INSERTs they are appended to the given statement list.
+  *
+  * @param Database* database wrapper
+  * @param std::vector<std::string>* list receiving the statements
+  */
+  DBInsert(DatabaseDriver* db, std::vector<std::string>* statements);
   ~DBInsert() {};
 
   /**
@@ -273,7 +284,10 @@ public:
   uint64_t getInsertID();
 
 protected:
+  bool runQuery(const std::string& query);
+
   DatabaseDriver* m_db;
+  std::vector<std::string>* m_statements;
   bool m_multiLine;
   uint32_t m_rows;
   std::string m_query;
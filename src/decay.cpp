@@ -0,0 +1,169 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Timing wheel holding the decaying items
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include <algorithm>
+#include "decay.h"
+
+// 40 kB of entries at a time
+static const size_t DECAY_ENTRY_BLOCK = 1024;
+
+DecayWheel::DecayWheel(uint32_t slotCount, uint32_t tickLength) :
+  slots(slotCount),
+  free_entries(NULL),
+  block_used(DECAY_ENTRY_BLOCK),
+  entry_count(0),
+  tick_length(tickLength),
+  next_tick(-1)
+{
+  for(std::vector<DecayEntry>::iterator it = slots.begin(); it != slots.end(); ++it){
+    it->item = NULL;
+    it->prev = it->next = &*it;
+  }
+}
+
+DecayWheel::~DecayWheel()
+{
+  for(std::vector<DecayEntry*>::iterator it = blocks.begin(); it != blocks.end(); ++it){
+    delete[] *it;
+  }
+}
+
+void DecayWheel::start(int64_t now)
+{
+  if(next_tick < 0)
+    next_tick = now / tick_length;
+}
+
+void DecayWheel::link(DecayEntry* entry)
+{
+  // At the end, items of one tick expire in the order they were put on it
+  DecayEntry& slot = getSlot(entry->tick);
+  entry->next = &slot;
+  entry->prev = slot.prev;
+  slot.prev->next = entry;
+  slot.prev = entry;
+}
+
+void DecayWheel::unlink(DecayEntry* entry)
+{
+  entry->prev->next = entry->next;
+  entry->next->prev = entry->prev;
+}
+
+DecayEntry* DecayWheel::allocateEntry()
+{
+  DecayEntry* entry = free_entries;
+  if(entry){
+    free_entries = entry->next;
+  }
+  else{
+    if(block_used == DECAY_ENTRY_BLOCK){
+      blocks.push_back(new DecayEntry[DECAY_ENTRY_BLOCK]);
+      block_used = 0;
+    }
+    entry = &blocks.back()[block_used++];
+  }
+
+  ++entry_count;
+  return entry;
+}
+
+void DecayWheel::releaseEntry(DecayEntry* entry)
+{
+  entry->item->decay_entry = NULL;
+  entry->next = free_entries;
+  free_entries = entry;
+  --entry_count;
+}
+
+bool DecayWheel::schedule(DecayHook* item, int64_t now, int32_t duration)
+{
+  start(now);
+
+  DecayEntry* entry = item->decay_entry;
+  bool added = (entry == NULL);
+  if(added){
+    entry = allocateEntry();
+    entry->item = item;
+    item->decay_entry = entry;
+  }
+  else{
+    unlink(entry);
+  }
+
+  entry->expires = now + std::max(duration, 0);
+  // Rounded up, an item never decays before its time
+  entry->tick = std::max((entry->expires + tick_length - 1) / tick_length, next_tick);
+  link(entry);
+  return added;
+}
+
+bool DecayWheel::cancel(DecayHook* item, int64_t now, int32_t& remaining)
+{
+  DecayEntry* entry = item->decay_entry;
+  if(!entry)
+    return false;
+
+  remaining = (int32_t)std::max(entry->expires - now, (int64_t)0);
+  unlink(entry);
+  releaseEntry(entry);
+  return true;
+}
+
+bool DecayWheel::getRemaining(const DecayHook* item, int64_t now, int32_t& remaining) const
+{
+  const DecayEntry* entry = item->decay_entry;
+  if(!entry)
+    return false;
+
+  remaining = (int32_t)std::max(entry->expires - now, (int64_t)0);
+  return true;
+}
+
+void DecayWheel::advance(int64_t now, std::vector<DecayHook*>& expired)
+{
+  start(now);
+
+  int64_t last_tick = now / tick_length;
+  for(; next_tick <= last_tick; ++next_tick){
+    DecayEntry& slot = getSlot(next_tick);
+    for(DecayEntry* entry = slot.next; entry != &slot;){
+      DecayEntry* next = entry->next;
+      // Those of later turns of the wheel stay
+      if(entry->tick <= next_tick){
+        expired.push_back(entry->item);
+        unlink(entry);
+        releaseEntry(entry);
+      }
+      entry = next;
+    }
+  }
+}
+
+void DecayWheel::getItems(std::vector<DecayHook*>& list) const
+{
+  list.reserve(list.size() + entry_count);
+  for(std::vector<DecayEntry>::const_iterator slot = slots.begin(); slot != slots.end(); ++slot){
+    for(const DecayEntry* entry = slot->next; entry != &*slot; entry = entry->next){
+      list.push_back(entry->item);
+    }
+  }
+}
@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Timing wheel holding the decaying items
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_DECAY_H__
+#define __OTSERV_DECAY_H__
+
+#include <stdint.h>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+struct DecayEntry;
+
+// Base of Item, a decaying item points to its entry on the wheel so it is
+// found without a lookup. An item can only be on one wheel.
+class DecayHook
+{
+public:
+  DecayHook() : decay_entry(NULL) {}
+  // A copy of a decaying item is not on the wheel
+  DecayHook(const DecayHook&) : decay_entry(NULL) {}
+  DecayHook& operator=(const DecayHook&) {return *this;}
+
+private:
+  friend class DecayWheel;
+  DecayEntry* decay_entry;
+};
+
+struct DecayEntry {
+  DecayHook* item;
+  DecayEntry* prev;
+  DecayEntry* next;
+  int64_t expires;
+  int64_t tick;
+};
+
+/*
+  Every item is put into the slot of the tick it expires in and is not
+  looked at before that, unless it expires more than one turn of the wheel
+  ahead. Such items stay in their slot and are passed over once per turn.
+  The wheel does not touch the items, their duration attribute is only
+  written by whoever takes them off it.
+*/
+
+class DecayWheel : boost::noncopyable
+{
+public:
+  DecayWheel(uint32_t slotCount, uint32_t tickLength);
+  ~DecayWheel();
+
+  // Puts the item on the wheel to expire duration ms after now, an item
+  // already on it is moved, returns false in that case
+  bool schedule(DecayHook* item, int64_t now, int32_t duration);
+  // Takes the item off the wheel, returns false if it was not on it
+  bool cancel(DecayHook* item, int64_t now, int32_t& remaining);
+  bool getRemaining(const DecayHook* item, int64_t now, int32_t& remaining) const;
+
+  // Takes all items expiring up to now off the wheel, tick by tick
+  void advance(int64_t now, std::vector<DecayHook*>& expired);
+
+  void getItems(std::vector<DecayHook*>& list) const;
+  size_t size() const {return entry_count;}
+
+protected:
+  // Slots are circular lists, the slot itself is the list head
+  DecayEntry& getSlot(int64_t tick) {return slots[tick % slots.size()];}
+  void start(int64_t now);
+  void link(DecayEntry* entry);
+  void unlink(DecayEntry* entry);
+
+  DecayEntry* allocateEntry();
+  void releaseEntry(DecayEntry* entry);
+
+  std::vector<DecayEntry> slots;
+  // Entries are taken from blocks that are kept until the wheel is gone,
+  // released ones are linked through next and used first
+  std::vector<DecayEntry*> blocks;
+  DecayEntry* free_entries;
+  // Entries handed out from the last block
+  size_t block_used;
+  size_t entry_count;
+  uint32_t tick_length;
+  // The first tick that has not been processed, -1 until the wheel is used
+  int64_t next_tick;
+};
+
+#endif
@@ -24,7 +24,7 @@
 
 #define OTSERV_VERSION "0.7.0"
 #define OTSERV_NAME "OTServ"
-#define CURRENT_SCHEMA_VERSION 25
+#define CURRENT_SCHEMA_VERSION 26
 
 #define CLIENT_VERSION_MIN 870
 #define CLIENT_VERSION_MAX 870
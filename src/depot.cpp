@@ -58,7 +58,7 @@ Attr_ReadValue Depot::readAttr(AttrTypes_t attr, PropStream& propStream)
     return ATTR_READ_CONTINUE;
   }
   else
-    return Item::readAttr(attr, propStream);
+    return Container::readAttr(attr, propStream);
 }
 
 uint32_t Depot::getDepotId() const
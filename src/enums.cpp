@@ -341,6 +341,7 @@ template<> void TileProp__Base::initialize()
   initAddValue(enums::TILEPROP_HOUSE_TILE, "TILEPROP_HOUSE_TILE", true);
   initAddValue(enums::TILEPROP_DYNAMIC_TILE, "TILEPROP_DYNAMIC_TILE", true);
   initAddValue(enums::TILEPROP_INDEXED_TILE, "TILEPROP_INDEXED_TILE", true);
+  initAddValue(enums::TILEPROP_SCRIPT_HOOK, "TILEPROP_SCRIPT_HOOK", true);
 }
 
 template<> bool ZoneType__Base::initialized = false;
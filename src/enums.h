@@ -440,12 +440,13 @@ namespace enums {
     TILEPROP_HOUSE_TILE = 2097152,
     TILEPROP_DYNAMIC_TILE = 4194304,
     TILEPROP_INDEXED_TILE = 8388608,
+    TILEPROP_SCRIPT_HOOK = 16777216,
   }; // end enum
 } // end namespace
 
-typedef BitEnum<enums::TileProp, 24> TileProp;
+typedef BitEnum<enums::TileProp, 25> TileProp;
 
-typedef Enum<enums::TileProp, 24> TileProp__Base;
+typedef Enum<enums::TileProp, 25> TileProp__Base;
 
 //begin enum definitions
   const TileProp TILEPROP_NONE(enums::TILEPROP_NONE);
@@ -473,6 +474,7 @@ typedef Enum<enums::TileProp, 24> TileProp__Base;
   const TileProp TILEPROP_HOUSE_TILE(enums::TILEPROP_HOUSE_TILE);
   const TileProp TILEPROP_DYNAMIC_TILE(enums::TILEPROP_DYNAMIC_TILE);
   const TileProp TILEPROP_INDEXED_TILE(enums::TILEPROP_INDEXED_TILE);
+  const TileProp TILEPROP_SCRIPT_HOOK(enums::TILEPROP_SCRIPT_HOOK);
 //end enum definitions
 
 namespace enums {
@@ -19,8 +19,27 @@
 //////////////////////////////////////////////////////////////////////
 #include "otpch.h"
 
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/thread/tss.hpp>
 #include "fileloader.h"
 
+struct FileLoader::MappedFile {
+  MappedFile(const char* filename) :
+    mapping(filename, boost::interprocess::read_only),
+    region(mapping, boost::interprocess::read_only)
+  {}
+
+  boost::interprocess::file_mapping mapping;
+  boost::interprocess::mapped_region region;
+};
+
+namespace {
+  // Unescaped props of mapped files, one per thread reading them
+  boost::thread_specific_ptr<std::vector<unsigned char> > mapped_props_buffer;
+}
+
 FileLoader::FileLoader()
 {
   m_file = NULL;
@@ -34,6 +53,11 @@ FileLoader::FileLoader()
   m_cache_index = NO_VALID_CACHE;
   m_cache_offset = NO_VALID_CACHE;
   memset(m_cached_data, 0, sizeof(m_cached_data));
+  //mapping
+  m_mapping = NULL;
+  m_map_data = NULL;
+  m_map_size = 0;
+  m_map_pos = 0;
 }
 
 
@@ -51,6 +75,8 @@ FileLoader::~FileLoader()
     if(m_cached_data[i].data)
       delete[] m_cached_data[i].data;
   }
+
+  delete m_mapping;
 }
 
 bool FileLoader::openFile(const char* filename, bool write, bool caching /*= false*/)
@@ -85,24 +111,7 @@ bool FileLoader::openFile(const char* filename, bool write, bool caching /*= fal
           m_cache_size = std::min(32768, std::max(file_size/20, 8192)) & ~0x1FFF;
         }
 
-        //parse nodes
-        if(safeSeek(4)){
-          delete m_root;
-          m_root = new NodeStruct();
-          m_root->start = 4;
-          int byte;
-          if(safeSeek(4) && readByte(byte) && byte == NODE_START){
-            bool ret = parseNode(m_root);
-            return ret;
-          }
-          else{
-            return false;
-          }
-        }
-        else{
-          m_lastError = ERROR_INVALID_FORMAT;
-          return false;
-        }
+        return parseRoot();
       }
     }
     else{
@@ -112,6 +121,56 @@ bool FileLoader::openFile(const char* filename, bool write, bool caching /*= fal
   }
 }
 
+bool FileLoader::openMappedFile(const char* filename)
+{
+  try{
+    m_mapping = new MappedFile(filename);
+  }
+  catch(boost::interprocess::interprocess_exception&){
+    m_lastError = ERROR_CAN_NOT_OPEN;
+    return false;
+  }
+
+  m_map_data = (const unsigned char*)m_mapping->region.get_address();
+  m_map_size = m_mapping->region.get_size();
+  m_map_pos = 0;
+
+  uint32_t version;
+  if(m_map_size < sizeof(version)){
+    m_lastError = ERROR_INVALID_FORMAT;
+    return false;
+  }
+
+  memcpy(&version, m_map_data, sizeof(version));
+  if(version > 0){
+    m_lastError = ERROR_INVALID_FILE_VERSION;
+    return false;
+  }
+
+  return parseRoot();
+}
+
+bool FileLoader::parseRoot()
+{
+  //parse nodes
+  if(safeSeek(4)){
+    delete m_root;
+    m_root = new NodeStruct();
+    m_root->start = 4;
+    int byte;
+    if(safeSeek(4) && readByte(byte) && byte == NODE_START){
+      return parseNode(m_root);
+    }
+    else{
+      return false;
+    }
+  }
+  else{
+    m_lastError = ERROR_INVALID_FORMAT;
+    return false;
+  }
+}
+
 bool FileLoader::parseNode(NodeStruct* node)
 {
   int byte;
@@ -201,8 +260,42 @@ bool FileLoader::parseNode(NodeStruct* node)
   }
 }
 
+const unsigned char* FileLoader::getMappedProps(const NodeStruct* node, unsigned long &size) const
+{
+  if(!node || node->start + 2 + node->propsSize > m_map_size){
+    return NULL;
+  }
+
+  const unsigned char* data = m_map_data + node->start + 2;
+  if(!memchr(data, ESCAPE_CHAR, node->propsSize)){
+    size = node->propsSize;
+    return data;
+  }
+
+  std::vector<unsigned char>* buffer = mapped_props_buffer.get();
+  if(!buffer){
+    buffer = new std::vector<unsigned char>();
+    mapped_props_buffer.reset(buffer);
+  }
+  buffer->resize(node->propsSize);
+
+  unsigned long j = 0;
+  for(unsigned long i = 0; i < node->propsSize; ++i, ++j){
+    if(data[i] == ESCAPE_CHAR && i + 1 < node->propsSize){
+      ++i;
+    }
+    (*buffer)[j] = data[i];
+  }
+  size = j;
+  return &(*buffer)[0];
+}
+
 const unsigned char* FileLoader::getProps(const NodeStruct* node, unsigned long &size)
 {
+  if(m_map_data){
+    return getMappedProps(node, size);
+  }
+
   if(node){
     while(node->propsSize >= m_buffer_size){
       delete[] m_buffer;
@@ -312,7 +405,16 @@ NodeStruct* FileLoader::getNextNode(const NodeStruct* prev, unsigned long &type)
 
 inline bool FileLoader::readByte(int &value)
 {
-  if(m_use_cache){
+  if(m_map_data){
+    // parseNode finds the end of the tree by reading past it, like with
+    // the cache this is not an error
+    if(m_map_pos >= m_map_size){
+      return false;
+    }
+    value = m_map_data[m_map_pos++];
+    return true;
+  }
+  else if(m_use_cache){
     if(m_cache_index == NO_VALID_CACHE){
       m_lastError = ERROR_CACHE_ERROR;
       return false;
@@ -346,7 +448,15 @@ inline bool FileLoader::readByte(int &value)
 
 inline bool FileLoader::readBytes(unsigned char* buffer, unsigned int size, long pos)
 {
-  if(m_use_cache){
+  if(m_map_data){
+    if((unsigned long)pos + size > m_map_size){
+      m_lastError = ERROR_EOF;
+      return false;
+    }
+    memcpy(buffer, m_map_data + pos, size);
+    return true;
+  }
+  else if(m_use_cache){
     //seek at pos
     unsigned long reading, remain = size, bufferPos = 0;
     do{
@@ -430,7 +540,14 @@ inline bool FileLoader::checks(const NodeStruct* node)
 
 inline bool FileLoader::safeSeek(unsigned long pos)
 {
-  if(m_use_cache){
+  if(m_map_data){
+    if(pos > m_map_size){
+      m_lastError = ERROR_SEEK_ERROR;
+      return false;
+    }
+    m_map_pos = pos;
+  }
+  else if(m_use_cache){
     unsigned long i = getCacheBlock(pos);
     if(i == NO_VALID_CACHE)
       return false;
@@ -451,7 +568,11 @@ inline bool FileLoader::safeSeek(unsigned long pos)
 
 inline bool FileLoader::safeTell(long &pos)
 {
-  if(m_use_cache){
+  if(m_map_data){
+    pos = m_map_pos - 1;
+    return true;
+  }
+  else if(m_use_cache){
     if(m_cache_index == NO_VALID_CACHE){
       m_lastError = ERROR_CACHE_ERROR;
       return false;
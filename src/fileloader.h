@@ -23,6 +23,7 @@
 
 #include <string>
 #include <cstdio>
+#include <algorithm>
 #include <stdint.h>
 #include "classes.h"
 
@@ -95,6 +96,12 @@ public:
   virtual ~FileLoader();
 
   bool openFile(const char* filename, bool write, bool caching = false);
+  // Maps the whole file for reading. Props without escaped bytes are then
+  // returned from the mapping without a copy, and getProps and the node
+  // functions may be used from several threads at once. They don't set the
+  // last error then, a NULL result is the only sign of a failure.
+  bool openMappedFile(const char* filename);
+  bool isMapped() const {return m_map_data != NULL;}
   const unsigned char* getProps(const NodeStruct* node, unsigned long &size);
   bool getProps(const NodeStruct*, PropStream& props);
   NodeStruct* getChildNode(const NodeStruct* parent, unsigned long &type);
@@ -114,7 +121,9 @@ protected:
     ESCAPE_CHAR = 0xFD
   };
 
+  bool parseRoot();
   bool parseNode(NodeStruct* node);
+  const unsigned char* getMappedProps(const NodeStruct* node, unsigned long &size) const;
 
   inline bool readByte(int &value);
   inline bool readBytes(unsigned char* buffer, unsigned int size, long pos);
@@ -165,6 +174,12 @@ protected:
   unsigned long m_cache_offset;
   inline unsigned long getCacheBlock(unsigned long pos);
   long loadCacheBlock(unsigned long pos);
+
+  struct MappedFile;
+  MappedFile* m_mapping;
+  const unsigned char* m_map_data;
+  unsigned long m_map_size;
+  unsigned long m_map_pos;
 };
 
 class PropStream{
@@ -292,10 +307,7 @@ public:
   //TODO: might need temp buffer and zero fill the memory chunk allocated by realloc
   template <typename T>
   inline void ADD_TYPE(T* add){
-    if((buffer_size - size) < sizeof(T)){
-      buffer_size = buffer_size + ((sizeof(T) + 0x1F) & 0xFFFFFFE0);
-      buffer = (char*)realloc(buffer, buffer_size);
-    }
+    reserve(sizeof(T));
 
     memcpy(&buffer[size], (char*)add, sizeof(T));
     size = size + sizeof(T);
@@ -303,10 +315,7 @@ public:
 
   template <typename T>
   inline void ADD_VALUE(T add){
-    if((buffer_size - size) < sizeof(T)){
-      buffer_size = buffer_size + ((sizeof(T) + 0x1F) & 0xFFFFFFE0);
-      buffer = (char*)realloc(buffer,buffer_size);
-    }
+    reserve(sizeof(T));
 
     memcpy(&buffer[size], &add, sizeof(T));
     size = size + sizeof(T);
@@ -329,10 +338,7 @@ public:
 
     ADD_USHORT(str_len);
 
-    if((buffer_size - size) < str_len){
-      buffer_size = buffer_size + ((str_len + 0x1F) & 0xFFFFFFE0);
-      buffer = (char*)realloc(buffer, buffer_size);
-    }
+    reserve(str_len);
 
     memcpy(&buffer[size], add.c_str(), str_len);
     size = size + str_len;
@@ -343,16 +349,21 @@ public:
 
     ADD_ULONG(str_len);
 
-    if((buffer_size - size) < str_len){
-      buffer_size = buffer_size + ((str_len + 0x1F) & 0xFFFFFFE0);
-      buffer = (char*)realloc(buffer, buffer_size);
-    }
+    reserve(str_len);
 
     memcpy(&buffer[size], add.c_str(), str_len);
     size = size + str_len;
   }
 
 protected:
+  // Doubles the buffer, so large streams are not copied on every add
+  inline void reserve(uint32_t n){
+    if((buffer_size - size) < n){
+      buffer_size = std::max(buffer_size * 2, size + ((n + 0x1F) & 0xFFFFFFE0));
+      buffer = (char*)realloc(buffer, buffer_size);
+    }
+  }
+
   char* buffer;
   uint32_t buffer_size;
   uint32_t size;
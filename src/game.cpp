@@ -20,6 +20,7 @@
 #include "otpch.h"
 
 #include <fstream>
+#include <boost/thread.hpp>
 #include "game.h"
 #include "scheduler.h"
 #include "tasks.h"
@@ -42,6 +43,9 @@
 #include "script_manager.h"
 #include "script_event.h"
 #include "configmanager.h"
+#include "iomapserialize.h"
+#include "save_writer.h"
+#include "local_storage.h"
 
 #if defined __EXCEPTION_TRACER__
 #include "exception.h"
@@ -55,7 +59,8 @@ extern CreatureManager g_creature_types;
 extern Chat g_chat;
 extern Game g_game;
 
-Game::Game()
+Game::Game() :
+  decayWheel(EVENT_DECAY_SLOTS, EVENT_DECAYINTERVAL)
 {
   gameState = GAME_STATE_NORMAL;
   map = NULL;
@@ -65,7 +70,6 @@ Game::Game()
   checkCreatureEvent = 0;
   checkDecayEvent = 0;
 
-  last_bucket = 0;
   int daycycle = 3600;
   //(1440 minutes/day)/(3600 seconds/day)*10 seconds event interval
   light_hour_delta = 1440*10/daycycle;
@@ -79,6 +83,9 @@ Game::Game()
   script_system = NULL;
   script_environment = NULL;
   waitingScriptEvent = 0;
+  scriptProfileEvent = 0;
+  scriptGeneration = 0;
+  scriptReloadPending = false;
 }
 
 void Game::start(ServiceManager* servicer)
@@ -152,6 +159,9 @@ void Game::setGameState(GameState newState)
 
         runShutdownScripts(true);
 
+        // Let background saves finish before the final save
+        g_saveWriter.flush();
+
         if (!saveGameState())
           std::cout << "Could not save global game state." << std::endl;
 
@@ -180,6 +190,26 @@ void Game::setGameState(GameState newState)
 
 bool Game::saveServer(ServerSaveType saveType)
 {
+  // Saved items hold the time they have left
+  updateDecayDurations();
+
+  uint64_t cacheHits, cacheMisses;
+  IOPlayer::instance()->getCacheStats(cacheHits, cacheMisses);
+  if(cacheHits + cacheMisses > 0){
+    std::cout << "Notice: Player lookup cache hit rate " << (100 * cacheHits / (cacheHits + cacheMisses)) << "% (" <<
+      cacheHits << " hits, " << cacheMisses << " misses)." << std::endl;
+  }
+
+  if(g_config.getNumber(ConfigManager::BACKGROUND_SAVE) && saveType != SERVER_SAVE_RELATIONAL &&
+    (saveType == SERVER_SAVE_SHALLOW || g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "binary" ||
+    g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "local"))
+  {
+    return saveServerSnapshot(saveType);
+  }
+
+  // A snapshot still being written must not overwrite what we store now
+  g_saveWriter.flush();
+
   std::string old_type = g_config.getString(ConfigManager::MAP_STORAGE_TYPE);
   if (saveType == SERVER_SAVE_RELATIONAL){
     g_config.setString(ConfigManager::MAP_STORAGE_TYPE, "relational");
@@ -216,13 +246,90 @@ bool Game::saveServer(ServerSaveType saveType)
   return ret;
 }
 
+bool Game::saveServerSnapshot(ServerSaveType saveType)
+{
+  uint64_t start = OTSYS_TIME();
+
+  // Everything persistent is rendered into the snapshot here, the database
+  // is only touched by the save writer thread
+  SaveSnapshot* snapshot = new SaveSnapshot();
+
+  if(!prepareSaveGameState(snapshot->addRecord()))
+    std::cout << "Could not save global game state." << std::endl;
+
+  for(AutoList<Player>::listiterator it = Player::listPlayer.list.begin();
+    it != Player::listPlayer.list.end();
+    ++it)
+  {
+    it->second->loginPosition = it->second->getPosition();
+    IOPlayer::instance()->prepareSavePlayer(it->second, saveType == SERVER_SAVE_SHALLOW, snapshot->addRecord());
+  }
+
+#ifdef __USE_LOCAL_STORAGE__
+  // Player records in the local storage reach the disk with a single flush
+  if(LocalStorage::instance()->isOpen() && !LocalStorage::instance()->sync())
+    std::cout << "Could not save the local player records." << std::endl;
+#endif
+
+  std::vector<uint32_t> houseIds;
+  if(saveType != SERVER_SAVE_SHALLOW){
+    if(saveType == SERVER_SAVE_FULL){
+      Houses::getInstance()->payHouses();
+    }
+
+    if(!IOMapSerialize::getInstance()->prepareSaveMap(map, snapshot->addRecord(), houseIds)){
+      delete snapshot;
+      return false;
+    }
+
+    // The houses are stored as far as the game is concerned, changes made
+    // while the writer works go into the next save
+    IOMapSerialize::getInstance()->setHousesSaved(houseIds, true);
+
+    // Owners and access lists are tiny compared to the house items
+    if(!IOMapSerialize::getInstance()->saveHouseInfo(map))
+      std::cout << "Could not save house information." << std::endl;
+  }
+
+  std::cout << "Notice: Server save snapshot taken. Process took " <<
+    (OTSYS_TIME() - start)/(1000.) << "s." << std::endl;
+
+  snapshot->callback = boost::bind(&Game::onServerSaveCommitted, this, houseIds, start, _1);
+  g_saveWriter.addSnapshot(snapshot);
+  return true;
+}
+
+void Game::onServerSaveCommitted(std::vector<uint32_t> houseIds, uint64_t start, bool success)
+{
+  if(!success){
+    std::cout << "Error: [Game::onServerSaveCommitted] Server save could not be written, changes are kept for the next save." << std::endl;
+    IOMapSerialize::getInstance()->setHousesSaved(houseIds, false);
+    return;
+  }
+
+  std::cout << "Notice: Server saved. Process took " <<
+    (OTSYS_TIME() - start)/(1000.) << "s." << std::endl;
+}
+
 void Game::loadGameState()
 {
+  globalStorage.clear();
+
+#ifdef __USE_LOCAL_STORAGE__
+  LocalStorage* storage = LocalStorage::instance();
+  if(storage->isOpen()){
+    std::vector<std::string> keys;
+    storage->getKeys("global/", keys);
+    for(std::vector<std::string>::iterator it = keys.begin(); it != keys.end(); ++it){
+      storage->get(*it, globalStorage[it->substr(7)]);
+    }
+    return;
+  }
+#endif
+
   DatabaseDriver* db = DatabaseDriver::instance();
   DBQuery query;
 
-  globalStorage.clear();
-
   for (DBResult_ptr result = db->storeQuery("SELECT `id`, `value` FROM `global_storage`"); result; result = result->advance()) {
     std::string key = result->getDataString("id");
     std::string value = result->getDataString("value");
@@ -232,16 +339,28 @@ void Game::loadGameState()
 
 bool Game::saveGameState()
 {
-  DatabaseDriver* db = DatabaseDriver::instance();
+  SaveRecord record;
+  if(!prepareSaveGameState(record))
+    return false;
 
-  DBQuery q;
-  DBTransaction transaction(db);
-  transaction.begin();
+  return record.commit(DatabaseDriver::instance());
+}
+
+bool Game::prepareSaveGameState(SaveRecord& record)
+{
+#ifdef __USE_LOCAL_STORAGE__
+  if(LocalStorage::instance()->isOpen()){
+    // Appending to the local storage is cheap, it is not left to the writer
+    return saveGameStateLocal();
+  }
+#endif
+
+  DatabaseDriver* db = DatabaseDriver::instance();
   DBQuery query;
 
-  db->executeQuery("DELETE FROM `global_storage`");
+  record.statements.push_back("DELETE FROM `global_storage`");
 
-  DBInsert global_stmt(db);
+  DBInsert global_stmt(db, &record.statements);
   global_stmt.setQuery("INSERT INTO `global_storage` (`id`, `value`) VALUES ");
 
   for(StorageMap::const_iterator giter = globalStorage.begin(); giter != globalStorage.end(); ++giter){
@@ -250,13 +369,37 @@ bool Game::saveGameState()
       return false;
     }
   }
-  if(!global_stmt.execute())
-    return false;
 
-  return transaction.commit();
+  return global_stmt.execute();
+}
+
+#ifdef __USE_LOCAL_STORAGE__
+bool Game::saveGameStateLocal()
+{
+  LocalStorage* storage = LocalStorage::instance();
+
+  std::vector<std::string> keys;
+  storage->getKeys("global/", keys);
+  for(std::vector<std::string>::iterator it = keys.begin(); it != keys.end(); ++it){
+    if(globalStorage.find(it->substr(7)) == globalStorage.end()){
+      storage->erase(*it);
+    }
+  }
+
+  std::string value;
+  for(StorageMap::const_iterator giter = globalStorage.begin(); giter != globalStorage.end(); ++giter){
+    // Unchanged values are not appended again
+    std::string key = "global/" + giter->first;
+    if(!storage->get(key, value) || value != giter->second){
+      storage->put(key, giter->second);
+    }
+  }
+
+  return storage->sync();
 }
+#endif
 
-int Game::loadMap(std::string filename)
+int Game::loadMap(std::string filename, bool rebuildImage /*= false*/)
 {
   if(!map){
     map = new Map;
@@ -273,7 +416,7 @@ int Game::loadMap(std::string filename)
   Actor::despawnRange = g_config.getNumber(ConfigManager::DEFAULT_DESPAWNRANGE);
   Actor::despawnRadius = g_config.getNumber(ConfigManager::DEFAULT_DESPAWNRADIUS);
 
-  return map->loadMap(filename);
+  return map->loadMap(filename, rebuildImage);
 }
 
 void Game::runWaitingScripts()
@@ -285,6 +428,23 @@ void Game::runWaitingScripts()
     boost::bind(&Game::runWaitingScripts, this)));
 }
 
+void Game::collectScriptGarbage()
+{
+  if(script_system){
+    script_system->collectGarbage();
+  }
+}
+
+void Game::logScriptProfile()
+{
+  if(script_system){
+    script_system->getProfiler().log(std::cout, 10);
+  }
+  scriptProfileEvent = g_scheduler.addEvent(createSchedulerTask(
+    g_config.getNumber(ConfigManager::SCRIPT_PROFILER_LOG_INTERVAL) * 1000,
+    boost::bind(&Game::logScriptProfile, this)));
+}
+
 bool Game::loadScripts()
 {
   //bool is_reload = false;
@@ -304,10 +464,13 @@ bool Game::loadScripts()
 
     g_scheduler.stopEvent(waitingScriptEvent);
     waitingScriptEvent = 0;
+    g_scheduler.stopEvent(scriptProfileEvent);
+    scriptProfileEvent = 0;
     //is_reload = true;
   }
 
   // Load fresh!
+  ++scriptGeneration;
   try {
     script_environment = new Script::Environment();
     script_system = new Script::Manager(*script_environment);
@@ -315,6 +478,14 @@ bool Game::loadScripts()
 
     waitingScriptEvent = g_scheduler.addEvent(createSchedulerTask(EVENT_SCRIPT_TIMER_INTERVAL,
       boost::bind(&Game::runWaitingScripts, this)));
+
+    if(script_system->getProfiler().isEnabled() &&
+      g_config.getNumber(ConfigManager::SCRIPT_PROFILER_LOG_INTERVAL) > 0)
+    {
+      scriptProfileEvent = g_scheduler.addEvent(createSchedulerTask(
+        g_config.getNumber(ConfigManager::SCRIPT_PROFILER_LOG_INTERVAL) * 1000,
+        boost::bind(&Game::logScriptProfile, this)));
+    }
   } catch(Script::Error& err) {
     // Clear any listeners that were tied before the exception was thrown
     for(AutoList<Creature>::listiterator it = Game::listCreature.list.begin();
@@ -696,12 +867,12 @@ Thing* Game::internalGetThing(Player* player, const Position& pos, int32_t index
           }
 
           if(thing == NULL){
-            thing = tile->ground;
+            thing = tile->getGround();
           }
         }
       }
       else{
-        thing = tile->__getThing(index);
+        thing = tile->getThing(index);
       }
 
       if(player){
@@ -1466,12 +1637,20 @@ void Game::onCreatureHear(Creature* listener, Creature* speaker, const SpeakClas
 {
   if(!script_system)
     return; // Not handled
-  if(listener != speaker){
+  if(listener != speaker && listener->hasHearListeners()){
     Script::OnHear::Event evt(listener, speaker, text, sclass);
     script_system->dispatchEvent(evt);
   }
 }
 
+void Game::onCreatureHear(const SpectatorVec& hearers, Creature* speaker, const SpeakClass& sclass, const std::string& text)
+{
+  if(!script_system || hearers.empty())
+    return; // Not handled
+  Script::OnHear::Event evt(hearers, speaker, text, sclass);
+  script_system->dispatchEvent(evt);
+}
+
 bool Game::onConditionEffectBegin(Creature* creature, ConditionEffect& effect)
 {
   if(!script_system)
@@ -1599,9 +1778,9 @@ ReturnValue Game::internalMoveCreature(Creature* actor, Creature* creature, Dire
     //try go up
     if(currentPos.z != 8 && creature->getParentTile()->hasHeight(3)){
       Tile* tmpTile = getParentTile(currentPos.x, currentPos.y, currentPos.z - 1);
-      if(tmpTile == NULL || (tmpTile->ground == NULL && !tmpTile->blockSolid())){
+      if(tmpTile == NULL || (!tmpTile->hasGround() && !tmpTile->blockSolid())){
         tmpTile = getParentTile(destPos.x, destPos.y, destPos.z - 1);
-        if(tmpTile && tmpTile->ground && !tmpTile->blockSolid()){
+        if(tmpTile && tmpTile->hasGround() && !tmpTile->blockSolid()){
           flags = flags | FLAG_IGNOREBLOCKITEM | FLAG_IGNOREBLOCKCREATURE;
           destPos.z -= 1;
         }
@@ -1610,7 +1789,7 @@ ReturnValue Game::internalMoveCreature(Creature* actor, Creature* creature, Dire
     else{
       //try go down
       Tile* tmpTile = getParentTile(destPos);
-      if(currentPos.z != 7 && (tmpTile == NULL || (tmpTile->ground == NULL && !tmpTile->blockSolid()))){
+      if(currentPos.z != 7 && (tmpTile == NULL || (!tmpTile->hasGround() && !tmpTile->blockSolid()))){
         tmpTile = getParentTile(destPos.x, destPos.y, destPos.z + 1);
 
         if(tmpTile && tmpTile->hasHeight(3)){
@@ -1959,6 +2138,7 @@ ReturnValue Game::internalMoveItem(Creature* actor, Cylinder* fromCylinder, Cyli
     }
 
     if(item->isRemoved()){
+      stopDecay(item);
       FreeThing(item);
     }
   }
@@ -2164,6 +2344,7 @@ ReturnValue Game::internalRemoveItem(Creature* actor, Item* item, int32_t count
 
     if(item->isRemoved()){
       isCompleteRemoval = true;
+      stopDecay(item);
       FreeThing(item);
     }
 
@@ -2191,12 +2372,15 @@ Item* Game::findItemOfType(Cylinder* cylinder, uint16_t itemId,
 
     if((thing = cylinder->__getThing(i)) && (item = thing->getItem())){
       if(item->getID() == itemId && (subType == -1 || subType == item->getSubType())){
+        // Only grounds are shared, the caller gets the tile's own one
+        if(item->isShared())
+          item = cylinder->getTile()->getOwnItem(item);
         return item;
       }
       else{
         ++i;
 
-        if(depthSearch && (tmpContainer = item->getContainer())){
+        if(depthSearch && (tmpContainer = item->getContainer()) && tmpContainer->getContentItemCount(itemId) != 0){
           listContainer.push_back(tmpContainer);
         }
       }
@@ -2218,7 +2402,7 @@ Item* Game::findItemOfType(Cylinder* cylinder, uint16_t itemId,
       else{
         ++i;
 
-        if((tmpContainer = item->getContainer())){
+        if((tmpContainer = item->getContainer()) && tmpContainer->getContentItemCount(itemId) != 0){
           listContainer.push_back(tmpContainer);
         }
       }
@@ -2247,6 +2431,9 @@ bool Game::removeItemOfType(Creature* actor, Cylinder* cylinder, uint16_t itemId
 
     if((thing = cylinder->__getThing(i)) && (item = thing->getItem())){
       if(item->getID() == itemId){
+        if(item->isShared())
+          item = cylinder->getTile()->getOwnItem(item);
+
         if(item->isStackable()){
           if(item->getItemCount() > count){
             internalRemoveItem(actor, item, count);
@@ -2267,7 +2454,7 @@ bool Game::removeItemOfType(Creature* actor, Cylinder* cylinder, uint16_t itemId
       else{
         ++i;
 
-        if((tmpContainer = item->getContainer())){
+        if((tmpContainer = item->getContainer()) && tmpContainer->getContentItemCount(itemId) != 0){
           listContainer.push_back(tmpContainer);
         }
       }
@@ -2304,7 +2491,7 @@ bool Game::removeItemOfType(Creature* actor, Cylinder* cylinder, uint16_t itemId
       else{
         ++i;
 
-        if((tmpContainer = item->getContainer())){
+        if((tmpContainer = item->getContainer()) && tmpContainer->getContentItemCount(itemId) != 0){
           listContainer.push_back(tmpContainer);
         }
       }
@@ -2320,10 +2507,6 @@ uint32_t Game::getMoney(const Cylinder* cylinder)
     return 0;
   }
 
-  std::list<Container*> listContainer;
-  ItemList::const_iterator it;
-  Container* tmpContainer = NULL;
-
   Thing* thing = NULL;
   Item* item = NULL;
 
@@ -2336,29 +2519,11 @@ uint32_t Game::getMoney(const Cylinder* cylinder)
     if(!(item = thing->getItem()))
       continue;
 
-    if((tmpContainer = item->getContainer())){
-      listContainer.push_back(tmpContainer);
+    if(const Container* container = item->getContainer()){
+      moneyCount += container->getContentWorth();
     }
     else{
-      if(item->getWorth() != 0){
-        moneyCount+= item->getWorth();
-      }
-    }
-  }
-
-  while(listContainer.size() > 0){
-    Container* container = listContainer.front();
-    listContainer.pop_front();
-
-    for(it = container->getItems(); it != container->getEnd(); ++it){
-      Item* item = *it;
-
-      if((tmpContainer = item->getContainer())){
-        listContainer.push_back(tmpContainer);
-      }
-      else if(item->getWorth() != 0){
-        moneyCount+= item->getWorth();
-      }
+      moneyCount += item->getWorth();
     }
   }
 
@@ -2374,6 +2539,10 @@ bool Game::removeMoney(Creature* actor, Cylinder* cylinder, uint32_t money, uint
     return true;
   }
 
+  if(getMoney(cylinder) < money){
+    return false;
+  }
+
   std::list<Container*> listContainer;
   Container* tmpContainer = NULL;
 
@@ -2393,7 +2562,9 @@ bool Game::removeMoney(Creature* actor, Cylinder* cylinder, uint32_t money, uint
       continue;
 
     if((tmpContainer = item->getContainer())){
-      listContainer.push_back(tmpContainer);
+      if(tmpContainer->getContentWorth() != 0){
+        listContainer.push_back(tmpContainer);
+      }
     }
     else{
       if(item->getWorth() != 0){
@@ -2411,7 +2582,9 @@ bool Game::removeMoney(Creature* actor, Cylinder* cylinder, uint32_t money, uint
       Item* item = container->getItem(i);
 
       if((tmpContainer = item->getContainer())){
-        listContainer.push_back(tmpContainer);
+        if(tmpContainer->getContentWorth() != 0){
+          listContainer.push_back(tmpContainer);
+        }
       }
       else if(item->getWorth() != 0){
         moneyCount += item->getWorth();
@@ -2563,6 +2736,9 @@ Item* Game::transformItem(Creature* actor, Item* item, uint16_t newId, int32_t n
       int32_t count = item->getSubType();
 
       if(curType.id != newType.id){
+        // The decay of the old type is over, the new one is started by the caller
+        cancelDecay(item);
+
         if(newType.group != curType.group){
           item->setDefaultSubtype();
         }
@@ -2598,6 +2774,8 @@ Item* Game::transformItem(Creature* actor, Item* item, uint16_t newId, int32_t n
     cylinder->__replaceThing(actor, itemIndex, newItem);
     cylinder->postAddNotification(actor, newItem, cylinder, itemIndex);
 
+    // The items of a replaced container go with it
+    stopDecay(item);
     item->setParent(NULL);
     cylinder->postRemoveNotification(actor, item, cylinder, itemIndex, true);
     FreeThing(item);
@@ -3313,6 +3491,8 @@ bool Game::playerWriteItem(uint32_t playerId, uint32_t windowTextId, const std::
     writeItem->clearWrittenDate();
   }
 
+  Houses::getInstance()->onItemChanged(writeItem);
+
   uint16_t newId = Item::items[writeItem->getID()].writeOnceItemId;
   if(newId != 0){
     transformItem(player, writeItem, newId);
@@ -3826,6 +4006,11 @@ bool Game::playerLookAt(uint32_t playerId, const Position& pos, uint16_t spriteI
       lookDistance = lookDistance + 9 + 6;
   }
 
+  // The duration of a decaying item is only written when it is needed
+  if(Item* item = thing->getItem()){
+    updateDecayDuration(item);
+  }
+
   std::string desc = thing->getDescription(lookDistance);
 
   if(script_system){
@@ -4158,10 +4343,26 @@ bool Game::checkReload(Player* player, const std::string& text)
     else if(param == " config" || param == "c"){
       std::cout << "================================================================================\n";
       g_config.reload();
+      // The cache size and lifetime may have changed
+      IOPlayer::instance()->clearCache();
       std::cout << ":: Reloaded config " << std::endl;
       if(player) player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Reloaded config.");
     }
-    else if(param == " scripts" || param == "s"){
+    else if(param == " players" || param == "p"){
+      // Picks up renames, deletions and namelocks done on the database
+      IOPlayer::instance()->clearCache();
+      std::cout << ":: Cleared player cache " << std::endl;
+      if(player) player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Cleared player cache.");
+    }
+    else if((param == " scripts" || param == "s") && script_system){
+      if(scriptReloadPending){
+        if(player) player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Scripts are already being reloaded.");
+      }
+      else{
+        reloadChangedScripts(player);
+      }
+    }
+    else if(param == " scripts" || param == "s" || param == " scripts full" || param == "sf"){
       std::cout << "================================================================================\n";
 
       runShutdownScripts(false);
@@ -4199,6 +4400,46 @@ bool Game::checkReload(Player* player, const std::string& text)
   return false;
 }
 
+void Game::reloadChangedScripts(Player* player)
+{
+  Script::ReloadJob_ptr job(new Script::ReloadJob());
+  script_system->getModules().getModules(job->modules);
+  job->generation = scriptGeneration;
+  job->player_id = (player? player->getID() : 0);
+  job->callback = boost::bind(&Game::finishScriptReload, this, _1);
+
+  scriptReloadPending = true;
+  boost::thread(boost::bind(&Script::ModuleTracker::compileChanged, job)).detach();
+}
+
+void Game::finishScriptReload(Script::ReloadJob_ptr job)
+{
+  scriptReloadPending = false;
+  Player* player = getPlayerByID(job->player_id);
+
+  if(!script_system || job->generation != scriptGeneration){
+    // The scripts were loaded from scratch while compiling
+    if(player) player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, "Reload of changed scripts was cancelled.");
+    return;
+  }
+
+  std::cout << "================================================================================\n";
+  uint64_t start = OTSYS_TIME();
+
+  std::ostringstream report;
+  int32_t reloaded = script_system->reloadModules(job->compiled, report);
+  std::cout << report.str();
+
+  std::cout << ":: Reloaded " << reloaded << " of " << job->compiled.size() << " changed script files ";
+  std::cout << "[ " << (OTSYS_TIME() - start)/(1000.) << "s. ]" << std::endl;
+
+  if(player){
+    std::ostringstream ss;
+    ss << "Reloaded " << reloaded << " of " << job->compiled.size() << " changed script files.";
+    player->sendTextMessage(MSG_STATUS_CONSOLE_BLUE, ss.str());
+  }
+}
+
 bool Game::playerSay(uint32_t playerId, uint16_t channelId, SpeakClass type,
   std::string receiver, std::string text)
 {
@@ -4286,9 +4527,10 @@ bool Game::playerWhisper(Player* player, const std::string& text)
   }
 
   //event method
-  for(it = list.begin(); it != list.end(); ++it) {
-    (*it)->onCreatureSay(player, SPEAK_WHISPER, text);
-  }
+  SpectatorVec hearers;
+  getHearers(hearers, player->getPosition(), false,
+    Map_maxClientViewportX, Map_maxClientViewportY);
+  onCreatureHear(hearers, player, SPEAK_WHISPER, text);
 
   return true;
 }
@@ -4428,10 +4670,16 @@ bool Game::internalCreatureSay(Creature* creature, SpeakClass type, const std::s
     }
   }
 
-  //event method
-  for(it = list.begin(); it != list.end(); ++it){
-    (*it)->onCreatureSay(creature, type, text);
+  //event method, only the creatures with hear listeners are told
+  SpectatorVec hearers;
+  if(type == SPEAK_YELL || type == SPEAK_MONSTER_YELL){
+    getHearers(hearers, creature->getPosition(), true, 18, 14);
+  }
+  else{
+    getHearers(hearers, creature->getPosition(), false,
+      Map_maxClientViewportX, Map_maxClientViewportY);
   }
+  onCreatureHear(hearers, creature, type, text);
 
   return true;
 }
@@ -4970,9 +5218,11 @@ void Game::startDecay(Item* item)
 
     int32_t dur = item->getDuration();
     if(dur > 0){
-      item->addRef();
+      // An item transformed while decaying is still on the wheel
+      if(decayWheel.schedule(item, OTSYS_TIME(), dur)){
+        item->addRef();
+      }
       item->setDecaying(DECAYING_TRUE);
-      toDecayItems.push_back(item);
     }
     else{
       internalDecayItem(item);
@@ -4980,6 +5230,55 @@ void Game::startDecay(Item* item)
   }
 }
 
+void Game::stopDecay(Item* item)
+{
+  Container* container = item->getContainer();
+  if(container){
+    for(ItemList::const_iterator it = container->getItems(); it != container->getEnd(); ++it){
+      stopDecay(const_cast<Item*>(*it));
+    }
+  }
+
+  cancelDecay(item);
+}
+
+void Game::cancelDecay(Item* item)
+{
+  int32_t remaining;
+  if(decayWheel.cancel(item, OTSYS_TIME(), remaining)){
+    item->setDuration(remaining);
+    item->setDecaying(DECAYING_FALSE);
+    FreeThing(item);
+  }
+}
+
+void Game::updateDecayDuration(Item* item)
+{
+  int32_t remaining;
+  if(decayWheel.getRemaining(item, OTSYS_TIME(), remaining)){
+    item->setDuration(remaining);
+  }
+}
+
+bool Game::getDecayRemaining(const Item* item, int32_t& remaining) const
+{
+  return decayWheel.getRemaining(item, OTSYS_TIME(), remaining);
+}
+
+void Game::updateDecayDurations()
+{
+  std::vector<DecayHook*> items;
+  decayWheel.getItems(items);
+
+  int64_t now = OTSYS_TIME();
+  int32_t remaining;
+  for(std::vector<DecayHook*>::iterator it = items.begin(); it != items.end(); ++it){
+    if(decayWheel.getRemaining(*it, now, remaining)){
+      static_cast<Item*>(*it)->setDuration(remaining);
+    }
+  }
+}
+
 void Game::internalDecayItem(Item* item)
 {
   const ItemType& it = Item::items[item->getID()];
@@ -5004,51 +5303,28 @@ void Game::checkDecay()
   g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL,
     boost::bind(&Game::checkDecay, this)));
 
-  size_t bucket = (last_bucket + 1) % EVENT_DECAY_BUCKETS;
+  std::vector<DecayHook*> expired;
+  decayWheel.advance(OTSYS_TIME(), expired);
 
-  for(DecayList::iterator it = decayItems[bucket].begin(); it != decayItems[bucket].end();){
-    Item* item = *it;
-    int32_t decreaseTime = EVENT_DECAYINTERVAL*EVENT_DECAY_BUCKETS;
-    if(item->getDuration() - decreaseTime < 0){
-      decreaseTime = item->getDuration();
-    }
-    item->decreaseDuration(decreaseTime);
+  for(std::vector<DecayHook*>::iterator it = expired.begin(); it != expired.end(); ++it){
+    Item* item = static_cast<Item*>(*it);
 #ifdef __DEBUG__
-    std::cout << "checkDecay: " << item << ", id:" << item->getID() << ", name: " << item->getName() << ", duration: " << item->getDuration() << std::endl;
+    std::cout << "checkDecay: " << item << ", id:" << item->getID() << ", name: " << item->getName() << std::endl;
 #endif
 
+    // Items a script stopped from decaying, or that were removed some way
+    // that does not call stopDecay, are only noticed here
     if(!item->canDecay()){
       item->setDecaying(DECAYING_FALSE);
       FreeThing(item);
-      it = decayItems[bucket].erase(it);
       continue;
     }
 
-    int32_t dur = item->getDuration();
-
-    if(dur <= 0) {
-      it = decayItems[bucket].erase(it);
-      internalDecayItem(item);
-      FreeThing(item);
-    }
-    else if(dur < EVENT_DECAYINTERVAL*EVENT_DECAY_BUCKETS)
-    {
-      it = decayItems[bucket].erase(it);
-      size_t new_bucket = (bucket + ((dur + EVENT_DECAYINTERVAL/2) / 1000)) % EVENT_DECAY_BUCKETS;
-      if(new_bucket == bucket) {
-        internalDecayItem(item);
-        FreeThing(item);
-      } else {
-        decayItems[new_bucket].push_back(item);
-      }
-    }
-    else{
-      ++it;
-    }
+    item->setDuration(0);
+    internalDecayItem(item);
+    FreeThing(item);
   }
 
-  last_bucket = bucket;
-
   cleanup();
 }
 
@@ -5161,17 +5437,6 @@ void Game::cleanup()
   for(std::vector<Position>::iterator it = toIndexTiles.begin(); it != toIndexTiles.end(); ++it){
     map->makeTileIndexed(*it);
   }
-
-  for(DecayList::iterator it = toDecayItems.begin(); it != toDecayItems.end(); ++it){
-    int32_t dur = (*it)->getDuration();
-    if(dur >= EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS) {
-      decayItems[last_bucket].push_back(*it);
-    } else {
-      decayItems[(last_bucket + 1 + (*it)->getDuration() / 1000) % EVENT_DECAY_BUCKETS].push_back(*it);
-    }
-  }
-
-  toDecayItems.clear();
 }
 
 void Game::makeTileIndexed(Tile* tile)
@@ -28,6 +28,7 @@
 #include "const.h"
 #include "combat.h"
 #include "account.h"
+#include "decay.h"
 
 enum stackPosType_t{
   STACKPOS_NORMAL,
@@ -50,11 +51,14 @@ typedef std::vector<Player*> PlayerVector;
 namespace Script {
   class Manager;
   class Environment;
+  struct ReloadJob;
+  typedef boost::shared_ptr<ReloadJob> ReloadJob_ptr;
 }
 
 #define EVENT_LIGHTINTERVAL  10000
 #define EVENT_DECAYINTERVAL  1000
-#define EVENT_DECAY_BUCKETS  16
+// One turn of the decay wheel is an hour, most items decay within it
+#define EVENT_DECAY_SLOTS  3600
 #define EVENT_SCRIPT_CLEANUP_INTERVAL  90000
 #define EVENT_SCRIPT_TIMER_INTERVAL 20
 
@@ -83,10 +87,10 @@ public:
   /**
     * Load a map.
     * \param filename Mapfile to load
-    * \param filekind Kind of the map, BIN SQL or TXT
+    * \param rebuildImage Read the map files even if the world image is valid
     * \return Int 0 built-in spawns, 1 needs xml spawns, 2 needs sql spawns, -1 if got error
     */
-  int loadMap(std::string filename);
+  int loadMap(std::string filename, bool rebuildImage = false);
 
   /**
   * Load all scripts
@@ -109,6 +113,23 @@ public:
    */
   void runWaitingScripts();
 
+  /**
+   * Prints the slowest script listeners, reschedules itself
+   */
+  void logScriptProfile();
+
+  /**
+   * Reloads only the script files that changed and the ones using them.
+   * They are compiled on another thread, the reload finishes in a later task.
+   * \param player Told when the reload is done, may be NULL
+   */
+  void reloadChangedScripts(Player* player);
+
+  /**
+   * Runs script garbage collection, called when the dispatcher is idle
+   */
+  void collectScriptGarbage();
+
   void runStartupScripts(bool real_startup);
   void runShutdownScripts(bool real_shutdown);
 
@@ -316,6 +337,11 @@ public:
     return map->getSpectators(centerPos);
   }
 
+  void getHearers(SpectatorVec& list, const Position& centerPos,
+    bool multifloor, int32_t rangeX, int32_t rangeY){
+    map->getHearers(list, centerPos, multifloor, rangeX, rangeY);
+  }
+
   void clearSpectatorCache(){
     if(map){
       map->clearSpectatorCache();
@@ -516,6 +542,7 @@ public:
   void onSpotCreature(Creature* creature, Creature* spotted);
   void onLoseCreature(Creature* creature, Creature* lost);
   void onCreatureHear(Creature* listener, Creature* speaker, const SpeakClass& sclass, const std::string& text);
+  void onCreatureHear(const SpectatorVec& hearers, Creature* speaker, const SpeakClass& sclass, const std::string& text);
   bool onConditionEffectBegin(Creature* creature, ConditionEffect& effect);
   bool onConditionEffectEnd(Creature* creature, ConditionEffect& effect, ConditionEnd reason);
   bool onConditionEffectTick(Creature* creature, ConditionEffect& effect, uint32_t ticks);
@@ -561,6 +588,7 @@ public:
   void setGameState(GameState newState);
   bool saveServer(ServerSaveType saveType);
   bool saveGameState();
+  bool prepareSaveGameState(SaveRecord& record);
   void loadGameState();
   void refreshMap(Map::TileMap::iterator* begin = NULL, int clean_max = 0);
   void proceduralRefresh(Map::TileMap::iterator* begin = NULL);
@@ -611,6 +639,13 @@ public:
   std::string getTradeErrorDescription(ReturnValue ret, Item* item);
 
   void startDecay(Item* item);
+  // Takes the item and the items inside it off the decay wheel, the time
+  // left is written to their duration
+  void stopDecay(Item* item);
+  // Writes the time left to the duration of a decaying item, it keeps decaying
+  void updateDecayDuration(Item* item);
+  // Returns false if the item is not decaying
+  bool getDecayRemaining(const Item* item, int32_t& remaining) const;
 
   Map* getMap() { return map;}
   const Map* getMap() const { return map;}
@@ -631,6 +666,13 @@ protected:
 
   bool checkReload(Player* player, const std::string& text);
 
+  // Background server save, see SaveWriter
+  bool saveServerSnapshot(ServerSaveType saveType);
+  void onServerSaveCommitted(std::vector<uint32_t> houseIds, uint64_t start, bool success);
+#ifdef __USE_LOCAL_STORAGE__
+  bool saveGameStateLocal();
+#endif
+
   std::vector<Thing*> toReleaseThings;
   std::vector<Position> toIndexTiles;
 
@@ -651,6 +693,12 @@ protected:
   Script::Environment* script_environment;
   Script::Manager* script_system;
   uint32_t waitingScriptEvent;
+  uint32_t scriptProfileEvent;
+  // Increased on every full load, so a reload started before is dropped
+  uint32_t scriptGeneration;
+  bool scriptReloadPending;
+
+  void finishScriptReload(Script::ReloadJob_ptr job);
 
 #ifdef __DEBUG_CRITICALSECTION__
   static OTSYS_THREAD_RETURN monitorThread(void *p);
@@ -666,10 +714,10 @@ protected:
   void checkDecay();
   void internalDecayItem(Item* item);
 
-  typedef std::list<Item*> DecayList;
-  DecayList decayItems[EVENT_DECAY_BUCKETS];
-  DecayList toDecayItems;
-  size_t last_bucket;
+  void cancelDecay(Item* item);
+  void updateDecayDurations();
+
+  DecayWheel decayWheel;
 
   static const int LIGHT_LEVEL_DAY = 250;
   static const int LIGHT_LEVEL_NIGHT = 40;
@@ -49,6 +49,7 @@ House::House(uint32_t _houseid)
   rent = 0;
   townid = 0;
   syncFlags = HOUSE_SYNC_TOWNID | HOUSE_SYNC_NAME | HOUSE_SYNC_RENT | HOUSE_SYNC_GUILDHALL;
+  dirtyFlags = HOUSE_DIRTY_ITEMS | HOUSE_DIRTY_INFO;
   guildHall = false;
   pendingDepotTransfer = false;
 }
@@ -70,6 +71,7 @@ void House::setHouseOwner(uint32_t guid)
     return;
 
   isLoaded = true;
+  setDirty(HOUSE_DIRTY_INFO);
 
   if(houseOwner){
     cleanHouse();
@@ -165,6 +167,8 @@ bool House::kickPlayer(Player* player, const std::string& name)
 
 void House::setAccessList(uint32_t listId, const std::string& textlist)
 {
+  setDirty(HOUSE_DIRTY_INFO);
+
   if(listId == GUEST_LIST){
     guestList.parseList(textlist);
   }
@@ -646,6 +650,10 @@ void Door::setAccessList(const std::string& textlist)
   }
 
   accessList->parseList(textlist);
+
+  if(house){
+    house->setDirty(House::HOUSE_DIRTY_INFO);
+  }
 }
 
 bool Door::getAccessList(std::string& list) const
@@ -881,6 +889,18 @@ bool Houses::payRent(Player* player, House* house, time_t time /*= 0*/)
   return hasEnoughMoney;
 }
 
+void Houses::onItemChanged(Item* item)
+{
+  Tile* tile = item->getParentTile();
+  if(!tile){
+    return;
+  }
+
+  if(HouseTile* houseTile = tile->getHouseTile()){
+    houseTile->getHouse()->setDirty(House::HOUSE_DIRTY_ITEMS);
+  }
+}
+
 bool Houses::payHouse(House* house, time_t time)
 {
   if(rentPeriod == RENTPERIOD_NEVER){
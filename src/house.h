@@ -71,8 +71,8 @@ public:
   virtual Attr_ReadValue readAttr(AttrTypes_t attr, PropStream& propStream);
   virtual bool serializeAttr(PropWriteStream& propWriteStream) const;
 
-  void setDoorId(uint32_t _doorId) {setAttribute("doorid", (int32_t)_doorId);}
-  uint32_t getDoorId() const {const int32_t* _doorId = getIntegerAttribute("doorid"); if(_doorId) return (uint32_t)*_doorId; return 0;}
+  void setDoorId(uint32_t _doorId) {setAttribute(ATTRKEY_DOOR_ID, (int32_t)_doorId);}
+  uint32_t getDoorId() const {const int32_t* _doorId = getIntegerAttribute(ATTRKEY_DOOR_ID); if(_doorId) return (uint32_t)*_doorId; return 0;}
 
   bool canUse(const Player* player);
 
@@ -119,6 +119,11 @@ public:
     HOUSE_SYNC_GUILDHALL  = 1 << 3
   };
 
+  enum dirtyflags_t{
+    HOUSE_DIRTY_ITEMS     = 1 << 0,
+    HOUSE_DIRTY_INFO      = 1 << 1
+  };
+
   House(uint32_t _houseid);
   ~House();
 
@@ -145,7 +150,7 @@ public:
   void setHouseOwner(uint32_t guid);
   uint32_t getHouseOwner() const {return houseOwner;}
 
-  void setPaidUntil(time_t paid){paidUntil = paid;}
+  void setPaidUntil(time_t paid){paidUntil = paid; setDirty(HOUSE_DIRTY_INFO);}
   time_t getPaidUntil() const {return paidUntil;}
 
   void setRent(uint32_t _rent){rent = _rent;}
@@ -154,10 +159,15 @@ public:
   bool hasSyncFlag(syncflags_t flag) const {return ((syncFlags & (uint32_t)flag) == (uint32_t)flag);}
   void resetSyncFlag(syncflags_t flag) {syncFlags &= ~(uint32_t)flag;}
 
-  void setLastWarning(time_t _lastWarning) {lastWarning = _lastWarning;}
+  // Dirty flags tell the map serializer which houses changed since the last save
+  bool isDirty(dirtyflags_t flag) const {return ((dirtyFlags & (uint32_t)flag) == (uint32_t)flag);}
+  void setDirty(dirtyflags_t flag) {dirtyFlags |= (uint32_t)flag;}
+  void resetDirty(dirtyflags_t flag) {dirtyFlags &= ~(uint32_t)flag;}
+
+  void setLastWarning(time_t _lastWarning) {lastWarning = _lastWarning; setDirty(HOUSE_DIRTY_INFO);}
   time_t getLastWarning() const {return lastWarning;}
 
-  void setPayRentWarnings(uint32_t warnings) {rentWarnings = warnings;}
+  void setPayRentWarnings(uint32_t warnings) {rentWarnings = warnings; setDirty(HOUSE_DIRTY_INFO);}
   uint32_t getPayRentWarnings() const {return rentWarnings;}
 
   void setTownId(uint32_t _town){townid = _town;}
@@ -217,6 +227,7 @@ private:
   uint32_t townid;
   bool guildHall;
   uint32_t syncFlags;
+  uint32_t dirtyFlags;
   bool pendingDepotTransfer;
 };
 
@@ -267,6 +278,9 @@ public:
 
   bool payHouse(House* house, time_t time);
 
+  // Marks the house owning the tile the item lies on (if any) as changed
+  void onItemChanged(Item* item);
+
 private:
   RentPeriod_t rentPeriod;
   HouseMap houseMap;
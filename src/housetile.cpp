@@ -56,6 +56,25 @@ void HouseTile::__internalAddThing(uint32_t index, Thing* thing)
   }
 }
 
+void HouseTile::postAddNotification(Creature* actor, Thing* thing, const Cylinder* oldParent, int32_t index, cylinderlink_t link /*= LINK_OWNER*/)
+{
+  //items moved onto the tile or into any container lying on it
+  if(thing->getItem()){
+    house->setDirty(House::HOUSE_DIRTY_ITEMS);
+  }
+
+  Tile::postAddNotification(actor, thing, oldParent, index, link);
+}
+
+void HouseTile::postRemoveNotification(Creature* actor, Thing* thing, const Cylinder* newParent, int32_t index, bool isCompleteRemoval, cylinderlink_t link /*= LINK_OWNER*/)
+{
+  if(thing->getItem()){
+    house->setDirty(House::HOUSE_DIRTY_ITEMS);
+  }
+
+  Tile::postRemoveNotification(actor, thing, newParent, index, isCompleteRemoval, link);
+}
+
 void HouseTile::updateHouse(Item* item)
 {
   if(item->getParentTile() == this){
@@ -40,7 +40,11 @@ public:
   virtual void __addThing(Creature* actor, int32_t index, Thing* thing);
   virtual void __internalAddThing(uint32_t index, Thing* thing);
 
+  virtual void postAddNotification(Creature* actor, Thing* thing, const Cylinder* oldParent, int32_t index, cylinderlink_t link = LINK_OWNER);
+  virtual void postRemoveNotification(Creature* actor, Thing* thing, const Cylinder* newParent, int32_t index, bool isCompleteRemoval, cylinderlink_t link = LINK_OWNER);
+
   House* getHouse() {return house;}
+  const House* getHouse() const {return house;}
 
 private:
   void updateHouse(Item* item);
@@ -47,7 +47,7 @@ public:
     * \param map pointer to the Map class
     * \return Returns true if the spawns were loaded successfully
   */
-  bool loadSpawns(Map* map)
+  virtual bool loadSpawns(Map* map)
   {
     if(map->spawnfile.empty()){
       return true;
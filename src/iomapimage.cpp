@@ -0,0 +1,789 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Prebuilt binary image of the static world
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include "iomapimage.h"
+#include "otsystem.h"
+#include "game.h"
+#include "map.h"
+#include "tile.h"
+#include "housetile.h"
+#include "town.h"
+#include "teleport.h"
+#include "depot.h"
+#include "configmanager.h"
+// After configmanager.h, sys/mman.h defines MAP_FILE
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+extern Game g_game;
+extern ConfigManager g_config;
+
+namespace {
+  const uint32_t WORLD_IMAGE_MAGIC = 0x4957544F; // "OTWI"
+  const uint32_t WORLD_IMAGE_VERSION = 2;
+
+  // Tiles in a block of the TILES section
+  const uint32_t TILES_PER_BLOCK = 4096;
+
+  enum WorldImageSection {
+    SECTION_SOURCES = 1,
+    SECTION_MAP = 2,
+    SECTION_TILE_INDEX = 3,
+    SECTION_TILES = 4,
+    SECTION_HOUSE_TILES = 5,
+    SECTION_SPAWNS = 6
+  };
+
+  enum WorldImageTileKind {
+    TILE_STATIC = 0,
+    TILE_DYNAMIC = 1
+  };
+
+  // Zone flags read from the map, the rest follow from the items
+  const uint32_t TILE_MAP_FLAGS = enums::TILEPROP_PROTECTIONZONE | enums::TILEPROP_NOPVPZONE |
+    enums::TILEPROP_PVPZONE | enums::TILEPROP_NOLOGOUT | enums::TILEPROP_REFRESH;
+
+  void writePosition(PropWriteStream& stream, const Position& pos)
+  {
+    stream.ADD_USHORT(pos.x);
+    stream.ADD_USHORT(pos.y);
+    stream.ADD_UCHAR(pos.z);
+  }
+
+  bool readPosition(PropStream& props, Position& pos)
+  {
+    uint16_t x, y;
+    uint8_t z;
+    if(!props.GET_USHORT(x) || !props.GET_USHORT(y) || !props.GET_UCHAR(z)){
+      return false;
+    }
+
+    pos.x = x;
+    pos.y = y;
+    pos.z = z;
+    return true;
+  }
+}
+
+struct IOMapImage::MappedImage {
+  boost::interprocess::file_mapping mapping;
+  boost::interprocess::mapped_region region;
+};
+
+IOMapImage::IOMapImage() :
+  image(NULL)
+{
+}
+
+IOMapImage::~IOMapImage()
+{
+  delete image;
+}
+
+bool IOMapImage::getSources(const Map* map, const std::string& mapFile, std::vector<std::string>& files)
+{
+  // Item ids and attributes in the image depend on the item database
+  files.push_back(mapFile);
+  if(!map->spawnfile.empty()){
+    files.push_back(map->spawnfile);
+  }
+  files.push_back(g_config.getString(ConfigManager::DATA_DIRECTORY) + "items/items.otb");
+  files.push_back(g_config.getString(ConfigManager::DATA_DIRECTORY) + "items/items.xml");
+  return true;
+}
+
+bool IOMapImage::open(const std::string& file, const std::string& mapFile)
+{
+  using namespace boost::interprocess;
+
+  delete image;
+  image = NULL;
+
+  MappedImage* mapped = new MappedImage();
+  try{
+    file_mapping mapping(file.c_str(), read_only);
+    mapped_region region(mapping, read_only);
+    mapped->mapping.swap(mapping);
+    mapped->region.swap(region);
+  }
+  catch(interprocess_exception&){
+    delete mapped;
+    return false;
+  }
+
+  PropStream props;
+  props.init((const char*)mapped->region.get_address(), mapped->region.get_size());
+
+  uint32_t magic, version, attributeLayout;
+  if(!props.GET_ULONG(magic) || magic != WORLD_IMAGE_MAGIC ||
+    !props.GET_ULONG(version) || version != WORLD_IMAGE_VERSION ||
+    !props.GET_ULONG(attributeLayout) || attributeLayout != ITEM_ATTRIBUTE_LAYOUT){
+    delete mapped;
+    return false;
+  }
+
+  image = mapped;
+
+  uint32_t count;
+  if(!getSection(SECTION_SOURCES, props) || !props.GET_ULONG(count) || count == 0){
+    delete image;
+    image = NULL;
+    return false;
+  }
+
+  for(uint32_t i = 0; i < count; ++i){
+    std::string source;
+    uint64_t hash, sourceHash = 0xCBF29CE484222325ULL;
+    if(!props.GET_STRING(source) || !props.GET_VALUE(hash) ||
+      (i == 0 && source != mapFile) ||
+      !hashFile(source, sourceHash) || sourceHash != hash){
+      delete image;
+      image = NULL;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool IOMapImage::getSection(uint32_t type, PropStream& props, const char** data /*= NULL*/) const
+{
+  if(!image){
+    return false;
+  }
+
+  const char* base = (const char*)image->region.get_address();
+  size_t size = image->region.get_size();
+
+  PropStream header;
+  header.init(base, size);
+
+  uint32_t magic, version, attributeLayout, count;
+  if(!header.GET_ULONG(magic) || !header.GET_ULONG(version) ||
+    !header.GET_ULONG(attributeLayout) || !header.GET_ULONG(count)){
+    return false;
+  }
+
+  for(uint32_t i = 0; i < count; ++i){
+    uint32_t sectionType, offset, sectionSize;
+    if(!header.GET_ULONG(sectionType) || !header.GET_ULONG(offset) || !header.GET_ULONG(sectionSize)){
+      return false;
+    }
+
+    if(sectionType == type){
+      if((uint64_t)offset + sectionSize > size){
+        return false;
+      }
+
+      props.init(base + offset, sectionSize);
+      if(data){
+        *data = base + offset;
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+Item* IOMapImage::loadItem(PropStream& props)
+{
+  uint16_t id;
+  if(!props.GET_USHORT(id)){
+    return NULL;
+  }
+
+  Item* item = Item::CreateItem(id);
+  if(!item){
+    return NULL;
+  }
+
+  if(!item->unserializeAttr(props)){
+    delete item;
+    return NULL;
+  }
+
+  // Decaying items are started again once they are on the map
+  if(item->getDecaying() == DECAYING_TRUE){
+    item->setDecaying(DECAYING_PENDING);
+  }
+
+  if(Container* container = item->getContainer()){
+    if(container->serializationCount > 0){
+      while(container->serializationCount > 0){
+        Item* child = loadItem(props);
+        if(!child){
+          delete item;
+          return NULL;
+        }
+
+        container->__internalAddThing(child);
+        container->serializationCount--;
+      }
+
+      uint8_t endAttr;
+      if(!props.GET_UCHAR(endAttr) || endAttr != 0x00){
+        delete item;
+        return NULL;
+      }
+    }
+  }
+
+  return item;
+}
+
+bool IOMapImage::loadTile(PropStream& props, House* house, TileBlock& block)
+{
+  Position pos;
+  uint8_t kind;
+  uint32_t flags;
+  uint16_t count;
+  if(!readPosition(props, pos) || !props.GET_UCHAR(kind) ||
+    !props.GET_ULONG(flags) || !props.GET_USHORT(count)){
+    block.error = "Could not read tile.";
+    return false;
+  }
+
+  Tile* tile = NULL;
+  if(house){
+    tile = new HouseTile(pos.x, pos.y, pos.z, house);
+    house->addTile(static_cast<HouseTile*>(tile));
+  }
+  else if(kind == TILE_DYNAMIC){
+    tile = new DynamicTile(pos.x, pos.y, pos.z);
+  }
+  else{
+    tile = new StaticTile(pos.x, pos.y, pos.z);
+  }
+
+  Item* ground = NULL;
+  for(uint16_t i = 0; i < count; ++i){
+    Item* item = loadItem(props);
+    if(!item){
+      std::stringstream ss;
+      ss << pos << "Failed to load item.";
+      block.error = ss.str();
+
+      // The caller frees the block, with what was read of this tile
+      TileBlock::LoadedTile loaded;
+      loaded.tile = tile;
+      loaded.ground = ground;
+      block.tiles.push_back(loaded);
+      return false;
+    }
+
+    // Grounds of house tiles are not shared, same as the otbm loader
+    if(i == 0 && !house && item->isGroundTile()){
+      ground = item;
+    }
+    else{
+      tile->__internalAddThing(item);
+      block.decaying.push_back(item);
+    }
+  }
+
+  tile->setFlag((TileProp)flags);
+
+  TileBlock::LoadedTile loaded;
+  loaded.tile = tile;
+  loaded.ground = ground;
+  block.tiles.push_back(loaded);
+  return true;
+}
+
+void IOMapImage::loadTileBlocks(std::vector<TileBlock>* blocks, size_t first, size_t step)
+{
+  for(size_t i = first; i < blocks->size(); i += step){
+    TileBlock& block = (*blocks)[i];
+
+    PropStream props;
+    props.init(block.data, block.size);
+    while(props.size() > 0){
+      if(!loadTile(props, NULL, block)){
+        break;
+      }
+    }
+  }
+}
+
+void IOMapImage::freeTileBlock(TileBlock& block)
+{
+  for(std::vector<TileBlock::LoadedTile>::iterator tit = block.tiles.begin(); tit != block.tiles.end(); ++tit){
+    Tile* tile = tit->tile;
+    if(tit->ground){
+      tit->ground->unRef();
+    }
+
+    if(tile->ground){
+      tile->ground->unRef();
+    }
+
+    for(TileItemIterator it = tile->items_begin(); it != tile->items_end(); ++it){
+      (*it)->unRef();
+    }
+    delete tile;
+  }
+
+  block.tiles.clear();
+  block.decaying.clear();
+}
+
+bool IOMapImage::loadMap(Map* map, const std::string& identifier)
+{
+  int64_t start = OTSYS_TIME();
+
+  // Everything is read before the map is changed, a broken image leaves
+  // it untouched so it can still be loaded from the otbm file
+  struct TownData {
+    uint32_t id;
+    std::string name;
+    Position pos;
+  };
+
+  struct HouseTileData {
+    uint32_t houseid;
+    const char* data;
+    uint32_t size;
+  };
+
+  PropStream props;
+  uint32_t count, mapWidth, mapHeight;
+  std::string spawnfile, housefile;
+  if(!getSection(SECTION_MAP, props) ||
+    !props.GET_ULONG(mapWidth) || !props.GET_ULONG(mapHeight) ||
+    !props.GET_STRING(spawnfile) || !props.GET_STRING(housefile) ||
+    !props.GET_ULONG(count)){
+    setLastErrorString("Could not read map data.");
+    return false;
+  }
+
+  std::vector<TownData> towns(count);
+  for(std::vector<TownData>::iterator it = towns.begin(); it != towns.end(); ++it){
+    if(!props.GET_ULONG(it->id) || !props.GET_STRING(it->name) || !readPosition(props, it->pos)){
+      setLastErrorString("Could not read town data.");
+      return false;
+    }
+  }
+
+  if(!props.GET_ULONG(count)){
+    setLastErrorString("Could not read waypoint data.");
+    return false;
+  }
+
+  std::vector<Waypoint_ptr> waypoints;
+  for(uint32_t i = 0; i < count; ++i){
+    std::string name;
+    Position pos;
+    if(!props.GET_STRING(name) || !readPosition(props, pos)){
+      setLastErrorString("Could not read waypoint data.");
+      return false;
+    }
+
+    waypoints.push_back(Waypoint_ptr(new Waypoint(name, pos)));
+  }
+
+  if(!spawnfile.empty() && !loadSpawnDefinitions()){
+    setLastErrorString("Could not read spawn data.");
+    return false;
+  }
+
+  PropStream tiles;
+  const char* tileData = NULL;
+  if(!getSection(SECTION_TILE_INDEX, props) || !getSection(SECTION_TILES, tiles, &tileData) || !props.GET_ULONG(count)){
+    setLastErrorString("Could not read tile index.");
+    return false;
+  }
+
+  std::vector<TileBlock> blocks(count);
+  for(uint32_t i = 0; i < count; ++i){
+    uint32_t offset, size;
+    if(!props.GET_ULONG(offset) || !props.GET_ULONG(size) || (int64_t)offset + size > tiles.size()){
+      setLastErrorString("Could not read tile index.");
+      return false;
+    }
+
+    blocks[i].data = tileData + offset;
+    blocks[i].size = size;
+  }
+
+  // House tiles are checked by reading them as plain tiles, they are read
+  // again into their houses once everything is known to be good
+  std::vector<HouseTileData> houseTiles;
+  TileBlock houseCheck;
+  const char* houseData = NULL;
+  if(!getSection(SECTION_HOUSE_TILES, props, &houseData)){
+    setLastErrorString("Could not read house tiles.");
+    return false;
+  }
+
+  const char* houseEnd = houseData + props.size();
+
+  while(props.size() > 0){
+    HouseTileData houseTile;
+    if(!props.GET_ULONG(houseTile.houseid)){
+      setLastErrorString("Could not read house id.");
+      return false;
+    }
+
+    houseTile.data = houseEnd - props.size();
+    if(!loadTile(props, NULL, houseCheck)){
+      setLastErrorString(houseCheck.error);
+      freeTileBlock(houseCheck);
+      return false;
+    }
+
+    houseTile.size = (houseEnd - props.size()) - houseTile.data;
+    houseTiles.push_back(houseTile);
+    freeTileBlock(houseCheck);
+  }
+
+  int64_t blocks_start = OTSYS_TIME();
+
+  size_t threads = std::max(1u, boost::thread::hardware_concurrency());
+  threads = std::min(threads, blocks.size());
+  if(threads > 1){
+    boost::thread_group workers;
+    for(size_t i = 0; i < threads; ++i){
+      workers.create_thread(boost::bind(&IOMapImage::loadTileBlocks, &blocks, i, threads));
+    }
+    workers.join_all();
+  }
+  else{
+    loadTileBlocks(&blocks, 0, 1);
+  }
+
+  for(std::vector<TileBlock>::iterator it = blocks.begin(); it != blocks.end(); ++it){
+    if(!it->error.empty()){
+      setLastErrorString(it->error);
+      for(std::vector<TileBlock>::iterator fit = blocks.begin(); fit != blocks.end(); ++fit){
+        freeTileBlock(*fit);
+      }
+      return false;
+    }
+  }
+
+  int64_t tiles_start = OTSYS_TIME();
+
+  // Nothing can fail from here on
+  map->mapWidth = mapWidth;
+  map->mapHeight = mapHeight;
+  map->spawnfile = spawnfile;
+  map->housefile = housefile;
+  std::cout << "Map size: " << map->mapWidth << "x" << map->mapHeight << std::endl;
+
+  for(std::vector<TownData>::iterator it = towns.begin(); it != towns.end(); ++it){
+    Town* town = Towns::getInstance()->getTown(it->id);
+    if(!town){
+      town = new Town(it->id);
+      Towns::getInstance()->addTown(it->id, town);
+    }
+
+    town->setName(it->name);
+    town->setTemplePos(it->pos);
+  }
+
+  for(std::vector<Waypoint_ptr>::iterator it = waypoints.begin(); it != waypoints.end(); ++it){
+    map->waypoints.addWaypoint(*it);
+  }
+
+  // House tiles go into a block of their own, houses are not thread safe
+  blocks.push_back(TileBlock());
+  TileBlock& houseBlock = blocks.back();
+  for(std::vector<HouseTileData>::iterator it = houseTiles.begin(); it != houseTiles.end(); ++it){
+    House* house = Houses::getInstance()->getHouse(it->houseid, true);
+    props.init(it->data, it->size);
+    loadTile(props, house, houseBlock);
+  }
+
+  size_t tileCount = 0;
+  for(std::vector<TileBlock>::iterator it = blocks.begin(); it != blocks.end(); ++it){
+    TileBlock& block = *it;
+    for(std::vector<TileBlock::LoadedTile>::iterator tit = block.tiles.begin(); tit != block.tiles.end(); ++tit){
+      Tile* tile = tit->tile;
+      if(Item* ground = tit->ground){
+        ground = Item::getSharedItem(ground);
+        tile->__internalAddThing(ground);
+        g_game.startDecay(ground);
+      }
+
+      map->setTile(tile->getPosition(), tile);
+    }
+    tileCount += block.tiles.size();
+
+    for(std::vector<Item*>::iterator iit = block.decaying.begin(); iit != block.decaying.end(); ++iit){
+      g_game.startDecay(*iit);
+    }
+  }
+
+  int64_t end = OTSYS_TIME();
+  std::cout << "Notice: [World image] " << tileCount << " tiles, " << (blocks.size() - 1) << " blocks read in "
+    << (tiles_start - blocks_start)/(1000.) << " s on " << threads << " threads, "
+    << "tiles added in " << (end - tiles_start)/(1000.) << " s" << std::endl;
+  std::cout << "Notice: [World image] Loading time : " << (end - start)/(1000.) << " s" << std::endl;
+  return true;
+}
+
+bool IOMapImage::loadSpawnDefinitions()
+{
+  PropStream props;
+  uint32_t count;
+  if(!getSection(SECTION_SPAWNS, props) || !props.GET_ULONG(count)){
+    return false;
+  }
+
+  spawns.clear();
+  spawns.resize(count);
+  for(SpawnDefinitionList::iterator it = spawns.begin(); it != spawns.end(); ++it){
+    uint32_t creatures;
+    if(!readPosition(props, it->centerPos) || !props.GET_VALUE(it->radius) || !props.GET_ULONG(creatures)){
+      return false;
+    }
+
+    it->creatures.resize(creatures);
+    for(std::vector<SpawnCreature>::iterator cit = it->creatures.begin(); cit != it->creatures.end(); ++cit){
+      uint8_t direction, npc;
+      if(!props.GET_STRING(cit->name) || !readPosition(props, cit->pos) || !props.GET_UCHAR(direction) ||
+        !props.GET_ULONG(cit->interval) || !props.GET_UCHAR(npc)){
+        return false;
+      }
+
+      cit->direction = (Direction)direction;
+      cit->npc = (npc != 0);
+    }
+  }
+
+  return true;
+}
+
+bool IOMapImage::loadSpawns(Map* map)
+{
+  if(map->spawnfile.empty()){
+    return true;
+  }
+
+  // Read by loadMap already
+  return Spawns::getInstance()->loadFromDefinitions(map->spawnfile, spawns);
+}
+
+void IOMapImage::saveItem(PropWriteStream& stream, const Item* item)
+{
+  stream.ADD_USHORT(item->getID());
+
+  // Doors and beds only write what the house storage needs, the map
+  // attributes are all in the common ones
+  if(item->getDoor() || item->getBed()){
+    item->Item::serializeAttr(stream);
+  }
+  else{
+    item->serializeAttr(stream);
+  }
+
+  if(const Container* container = item->getContainer()){
+    if(const Depot* depot = container->getDepot()){
+      stream.ADD_UCHAR(ATTR_DEPOT_ID);
+      stream.ADD_USHORT(depot->getDepotId());
+    }
+
+    // Empty containers end like any other item
+    if(container->size() != 0){
+      stream.ADD_UCHAR(ATTR_CONTAINER_ITEMS);
+      stream.ADD_ULONG(container->size());
+      for(ItemList::const_reverse_iterator it = container->getReversedItems(); it != container->getReversedEnd(); ++it){
+        saveItem(stream, *it);
+      }
+    }
+  }
+
+  stream.ADD_UCHAR(0x00); // attr end
+}
+
+void IOMapImage::saveTile(PropWriteStream& stream, const Tile* tile)
+{
+  uint32_t flags = 0;
+  for(uint32_t flag = 1; flag <= TILE_MAP_FLAGS; flag <<= 1){
+    if((flag & TILE_MAP_FLAGS) && tile->hasFlag((TileProp)flag)){
+      flags |= flag;
+    }
+  }
+
+  writePosition(stream, tile->getPosition());
+  stream.ADD_UCHAR(tile->is_dynamic()? TILE_DYNAMIC : TILE_STATIC);
+  stream.ADD_ULONG(flags);
+  stream.ADD_USHORT((tile->ground? 1 : 0) + tile->items_count());
+
+  if(tile->ground){
+    saveItem(stream, tile->ground);
+  }
+
+  // Top items keep their order when added again, down items are added
+  // in front of each other
+  for(TileItemConstIterator it = tile->items_topBegin(); it != tile->items_topEnd(); ++it){
+    saveItem(stream, *it);
+  }
+
+  for(uint32_t i = tile->items_downCount(); i > 0; --i){
+    saveItem(stream, tile->items_get(i - 1));
+  }
+}
+
+bool IOMapImage::saveImage(const Map* map, const std::string& file, const std::string& mapFile)
+{
+  std::vector<std::string> files;
+  getSources(map, mapFile, files);
+
+  PropWriteStream sources;
+  sources.ADD_ULONG(files.size());
+  for(std::vector<std::string>::iterator it = files.begin(); it != files.end(); ++it){
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    if(!hashFile(*it, hash)){
+      return false;
+    }
+
+    sources.ADD_STRING(*it);
+    sources.ADD_VALUE(hash);
+  }
+
+  PropWriteStream mapInfo;
+  mapInfo.ADD_ULONG(map->mapWidth);
+  mapInfo.ADD_ULONG(map->mapHeight);
+  mapInfo.ADD_STRING(map->spawnfile);
+  mapInfo.ADD_STRING(map->housefile);
+
+  Towns* towns = Towns::getInstance();
+  mapInfo.ADD_ULONG(std::distance(towns->getTownBegin(), towns->getTownEnd()));
+  for(TownMap::const_iterator it = towns->getTownBegin(); it != towns->getTownEnd(); ++it){
+    mapInfo.ADD_ULONG(it->second->getTownID());
+    mapInfo.ADD_STRING(it->second->getName());
+    writePosition(mapInfo, it->second->getTemplePosition());
+  }
+
+  std::vector<Waypoint_ptr> waypoints;
+  map->waypoints.getWaypoints(waypoints);
+  mapInfo.ADD_ULONG(waypoints.size());
+  for(std::vector<Waypoint_ptr>::iterator it = waypoints.begin(); it != waypoints.end(); ++it){
+    mapInfo.ADD_STRING((*it)->name);
+    writePosition(mapInfo, (*it)->pos);
+  }
+
+  std::vector<Tile*> tiles;
+  map->getTiles(tiles);
+
+  PropWriteStream tileIndex;
+  PropWriteStream tileData;
+  PropWriteStream houseTiles;
+  std::vector<uint32_t> blockStarts;
+  uint32_t blockTiles = 0;
+  for(std::vector<Tile*>::iterator it = tiles.begin(); it != tiles.end(); ++it){
+    const Tile* tile = *it;
+    if(const HouseTile* houseTile = tile->getHouseTile()){
+      houseTiles.ADD_ULONG(houseTile->getHouse()->getHouseId());
+      saveTile(houseTiles, tile);
+      continue;
+    }
+
+    uint32_t size;
+    tileData.getStream(size);
+    if(blockTiles == 0){
+      blockStarts.push_back(size);
+    }
+    saveTile(tileData, tile);
+
+    if(++blockTiles == TILES_PER_BLOCK){
+      blockTiles = 0;
+    }
+  }
+
+  uint32_t tileDataSize;
+  tileData.getStream(tileDataSize);
+  blockStarts.push_back(tileDataSize);
+
+  tileIndex.ADD_ULONG(blockStarts.size() - 1);
+  for(size_t i = 0; i + 1 < blockStarts.size(); ++i){
+    tileIndex.ADD_ULONG(blockStarts[i]);
+    tileIndex.ADD_ULONG(blockStarts[i + 1] - blockStarts[i]);
+  }
+
+  const SpawnDefinitionList& definitions = Spawns::getInstance()->getDefinitions();
+  PropWriteStream spawns;
+  spawns.ADD_ULONG(definitions.size());
+  for(SpawnDefinitionList::const_iterator it = definitions.begin(); it != definitions.end(); ++it){
+    writePosition(spawns, it->centerPos);
+    spawns.ADD_VALUE(it->radius);
+    spawns.ADD_ULONG(it->creatures.size());
+    for(std::vector<SpawnCreature>::const_iterator cit = it->creatures.begin(); cit != it->creatures.end(); ++cit){
+      spawns.ADD_STRING(cit->name);
+      writePosition(spawns, cit->pos);
+      spawns.ADD_UCHAR(cit->direction.value());
+      spawns.ADD_ULONG(cit->interval);
+      spawns.ADD_UCHAR(cit->npc? 1 : 0);
+    }
+  }
+
+  const uint32_t types[] = {SECTION_SOURCES, SECTION_MAP, SECTION_TILE_INDEX, SECTION_TILES, SECTION_HOUSE_TILES, SECTION_SPAWNS};
+  const PropWriteStream* sections[] = {&sources, &mapInfo, &tileIndex, &tileData, &houseTiles, &spawns};
+  const uint32_t sectionCount = sizeof(types) / sizeof(types[0]);
+
+  PropWriteStream header;
+  header.ADD_ULONG(WORLD_IMAGE_MAGIC);
+  header.ADD_ULONG(WORLD_IMAGE_VERSION);
+  header.ADD_ULONG(ITEM_ATTRIBUTE_LAYOUT);
+  header.ADD_ULONG(sectionCount);
+
+  uint32_t offset = 4 * 4 + sectionCount * 3 * 4;
+  for(uint32_t i = 0; i < sectionCount; ++i){
+    uint32_t size;
+    sections[i]->getStream(size);
+    header.ADD_ULONG(types[i]);
+    header.ADD_ULONG(offset);
+    header.ADD_ULONG(size);
+    offset += size;
+  }
+
+  // Written next to it first, so a server killed meanwhile leaves no broken image
+  std::string tmpFile = file + ".tmp";
+  std::ofstream out(tmpFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!out.is_open()){
+    return false;
+  }
+
+  uint32_t size;
+  const char* data = header.getStream(size);
+  out.write(data, size);
+  for(uint32_t i = 0; i < sectionCount; ++i){
+    data = sections[i]->getStream(size);
+    out.write(data, size);
+  }
+
+  out.close();
+  if(out.fail()){
+    return false;
+  }
+
+  try{
+    boost::filesystem::rename(tmpFile, file);
+  }
+  catch(boost::filesystem::filesystem_error&){
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,101 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Prebuilt binary image of the static world
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_IOMAPIMAGE_H__
+#define __OTSERV_IOMAPIMAGE_H__
+
+#include <string>
+#include <vector>
+#include "iomap.h"
+#include "fileloader.h"
+
+/*
+  The image holds the map as it is right after the otbm and spawn files
+  were read, before house items and other saved state are added to it.
+
+  header: magic, version, item attribute layout, section count, then for
+  every section its type, offset and size, offsets are from the start of
+  the file
+  SOURCES: the files the image was built from, with their hashes
+  MAP: size, spawn and house file, towns, waypoints
+  TILE_INDEX: offset and size of every block in TILES
+  TILES: blocks of tiles, each block is loaded by one thread
+  HOUSE_TILES: house tiles, loaded on the main thread
+  SPAWNS: the spawn file, as it was listed
+*/
+
+class IOMapImage : public IOMap{
+  struct MappedImage;
+
+  struct TileBlock {
+    TileBlock() : data(NULL), size(0) {}
+
+    struct LoadedTile {
+      Tile* tile;
+      Item* ground;
+    };
+
+    const char* data;
+    uint32_t size;
+    std::vector<LoadedTile> tiles;
+    std::vector<Item*> decaying;
+    std::string error;
+  };
+
+  bool getSection(uint32_t type, PropStream& props, const char** data = NULL) const;
+  static Item* loadItem(PropStream& props);
+  static bool loadTile(PropStream& props, House* house, TileBlock& block);
+  static void loadTileBlocks(std::vector<TileBlock>* blocks, size_t first, size_t step);
+  // Frees the tiles of a block that was read but not added to the map
+  static void freeTileBlock(TileBlock& block);
+  bool loadSpawnDefinitions();
+  static void saveItem(PropWriteStream& stream, const Item* item);
+  static void saveTile(PropWriteStream& stream, const Tile* tile);
+  static bool getSources(const Map* map, const std::string& mapFile, std::vector<std::string>& files);
+
+public:
+  IOMapImage();
+  ~IOMapImage();
+
+  virtual const char* getSourceDescription(){ return "world image";}
+
+  /** Open an image
+    * \param file the image to open
+    * \param mapFile the otbm file the image has to be built from
+    * \return false if the image is missing, broken or any of its source files changed
+  */
+  bool open(const std::string& file, const std::string& mapFile);
+
+  virtual bool loadMap(Map* map, const std::string& identifier);
+  virtual bool loadSpawns(Map* map);
+
+  /** Write the image of a map that was just loaded from its otbm file
+    * \param map the map, before house items are loaded into it
+    * \param file the image to write
+    * \param mapFile the otbm file the map was loaded from
+  */
+  static bool saveImage(const Map* map, const std::string& file, const std::string& mapFile);
+
+protected:
+  MappedImage* image;
+  SpawnDefinitionList spawns;
+};
+
+#endif
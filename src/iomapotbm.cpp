@@ -32,6 +32,9 @@ typedef uint32_t flags_t;
 
 extern Game g_game;
 
+// Tile areas each thread parses before they are added to the map
+static const size_t TILE_AREA_BATCH = 64;
+
 /*
   OTBM_ROOTV1
   |
@@ -53,28 +56,268 @@ extern Game g_game;
   |--- OTBM_ITEM_DEF (not implemented)
 */
 
-Tile* IOMapOTBM::createTile(Item*& ground, Item* item, const Position& p)
+Tile* IOMapOTBM::createTile(const Item* ground, const Item* item, const Position& p)
 {
-  Tile* tile;
   if(ground){
     if((item && item->blockSolid()) || ground->blockSolid()){
       // Tile is blocking with possibly some decoration, should be static
-      tile = new StaticTile(p.x, p.y, p.z);
+      return new StaticTile(p.x, p.y, p.z);
     }
-    else{
-      // Tile is not blocking with possibly multiple items, use dynamic
-      tile = new DynamicTile(p.x, p.y, p.z);
+
+    // Tile is not blocking with possibly multiple items, use dynamic
+    return new DynamicTile(p.x, p.y, p.z);
+  }
+
+  // No ground on this tile, so it will always block
+  return new StaticTile(p.x, p.y, p.z);
+}
+
+void IOMapOTBM::addTileItem(Tile*& tile, Item*& ground, Item* item, const Position& p, TileArea& area)
+{
+  if(tile){
+    if(ground && item->isGroundTile()){
+      // The tile keeps the first ground
+      delete item;
+      return;
     }
-    
-    tile->__internalAddThing(ground);
-    g_game.startDecay(ground);
-    ground = NULL;
+
+    tile->__internalAddThing(item);
+    area.decaying.push_back(item);
+  }
+  else if(item->isGroundTile()){
+    if(ground)
+      delete ground;
+    ground = item;
   }
   else{
-    // No ground on this tile, so it will always block
-    tile = new StaticTile(p.x, p.y, p.z);
+    tile = createTile(ground, item, p);
+    tile->__internalAddThing(item);
+    area.decaying.push_back(item);
+  }
+}
+
+bool IOMapOTBM::loadTile(FileLoader& f, NodeStruct* nodeTile, unsigned long type, TileArea& area)
+{
+  PropStream propStream;
+  if(!f.getProps(nodeTile, propStream)){
+    area.error = "Could not read node data.";
+    return false;
+  }
+
+  OTBM_Tile_coords* tile_coord;
+  if(!propStream.GET_STRUCT(tile_coord)){
+    area.error = "Could not read tile position.";
+    return false;
+  }
+
+  Position p;
+  p.x = area.base.x + tile_coord->_x;
+  p.y = area.base.y + tile_coord->_y;
+  p.z = area.base.z;
+
+  bool isHouseTile = false;
+  House* house = NULL;
+  Tile* tile = NULL;
+  Item* ground_item = NULL;
+  uint32_t tileflags = enums::TILEPROP_NONE;
+
+  if(type == OTBM_HOUSETILE){
+    uint32_t _houseid;
+    if(!propStream.GET_ULONG(_houseid)){
+      std::stringstream ss;
+      ss << p << "Could not read house id.";
+      area.error = ss.str();
+      return false;
+    }
+
+    house = Houses::getInstance()->getHouse(_houseid, true);
+    if(!house){
+      std::stringstream ss;
+      ss << p << "Could not create house id: " << _houseid;
+      area.error = ss.str();
+      return false;
+    }
+
+    tile = new HouseTile(p.x, p.y, p.z, house);
+    house->addTile(static_cast<HouseTile*>(tile));
+    isHouseTile = true;
+  }
+
+  //read tile attributes
+  unsigned char attribute;
+  while(propStream.GET_UCHAR(attribute)){
+    switch(attribute){
+    case OTBM_ATTR_TILE_FLAGS:
+    {
+      uint32_t flags;
+      if(!propStream.GET_ULONG(flags)){
+        std::stringstream ss;
+        ss << p << "Failed to read tile flags.";
+        area.error = ss.str();
+        return false;
+      }
+
+      if((flags & enums::TILEPROP_PROTECTIONZONE) == enums::TILEPROP_PROTECTIONZONE){
+        tileflags |= enums::TILEPROP_PROTECTIONZONE;
+      }
+      else if((flags & enums::TILEPROP_NOPVPZONE) == enums::TILEPROP_NOPVPZONE){
+        tileflags |= enums::TILEPROP_NOPVPZONE;
+      }
+      else if((flags & enums::TILEPROP_PVPZONE) == enums::TILEPROP_PVPZONE){
+        tileflags |= enums::TILEPROP_PVPZONE;
+      }
+
+      if((flags & enums::TILEPROP_NOLOGOUT) == enums::TILEPROP_NOLOGOUT){
+        tileflags |= enums::TILEPROP_NOLOGOUT;
+      }
+
+      if((flags & enums::TILEPROP_REFRESH) == enums::TILEPROP_REFRESH){
+        if(house){
+          std::stringstream ss;
+          ss << "Warning: " << p << " House tile flagged as refreshing!";
+          area.warnings.push_back(ss.str());
+        }
+        tileflags |= enums::TILEPROP_REFRESH;
+      }
+
+      break;
+    }
+
+    case OTBM_ATTR_ITEM:
+    {
+      Item* item = Item::CreateItem(propStream);
+      if(!item){
+        std::stringstream ss;
+        ss << p << "Failed to create item.";
+        area.error = ss.str();
+        return false;
+      }
+
+      if(isHouseTile && item->isMoveable()){
+        std::stringstream ss;
+        ss << "Warning: Moveable item at " << p << " in house id = " << house->getHouseId() << ", id = " << item->getID();
+        area.warnings.push_back(ss.str());
+        delete item;
+        item = NULL;
+      }
+      else{
+        addTileItem(tile, ground_item, item, p, area);
+      }
+
+      break;
+    }
+
+    default:
+      std::stringstream ss;
+      ss << p << "Unknown tile attribute.";
+      area.error = ss.str();
+      return false;
+      break;
+    }
+  }
+
+  NodeStruct* nodeItem = f.getChildNode(nodeTile, type);
+  while(nodeItem){
+    if(type == OTBM_ITEM){
+
+      PropStream propStream;
+      f.getProps(nodeItem, propStream);
+
+      Item* item = Item::CreateItem(propStream);
+      if(!item){
+        std::stringstream ss;
+        ss << p << "Failed to create item.";
+        area.error = ss.str();
+        return false;
+      }
+
+      if(item->unserializeItemNode(f, nodeItem, propStream)){
+        if(isHouseTile && item->isMoveable()){
+          std::stringstream ss;
+          ss << "Warning: Moveable item at " << p << " in house id = " << house->getHouseId() << ", id= " << item->getID();
+          area.warnings.push_back(ss.str());
+          delete item;
+        }
+        else{
+          addTileItem(tile, ground_item, item, p, area);
+        }
+      }
+      else{
+        std::stringstream ss;
+        ss << p << "Failed to load item " << item->getID() << ".";
+        area.error = ss.str();
+        delete item;
+        return false;
+      }
+    }
+    else{
+      std::stringstream ss;
+      ss << p << "Unknown node type.";
+      area.warnings.push_back(ss.str());
+    }
+
+    nodeItem = f.getNextNode(nodeItem, type);
+  }
+
+  if(!tile)
+    tile = createTile(ground_item, NULL, p);
+
+  tile->setFlag((TileProp)tileflags);
+
+  TileArea::LoadedTile loaded;
+  loaded.tile = tile;
+  loaded.ground = ground_item;
+  area.tiles.push_back(loaded);
+  return true;
+}
+
+bool IOMapOTBM::loadTileArea(FileLoader& f, TileArea& area)
+{
+  PropStream propStream;
+  if(!f.getProps(area.node, propStream)){
+    area.error = "Invalid map node.";
+    return false;
+  }
+
+  OTBM_Tile_area_coords* area_coord;
+  if(!propStream.GET_STRUCT(area_coord)){
+    area.error = "Invalid map node.";
+    return false;
+  }
+
+  area.base.x = area_coord->_x;
+  area.base.y = area_coord->_y;
+  area.base.z = area_coord->_z;
+
+  unsigned long type;
+  // The error of the loader is shared by all threads, the node functions
+  // of a mapped file only fail through what they return
+  NodeStruct* nodeTile = f.getChildNode(area.node, type);
+  while(nodeTile != NULL){
+    if(type == OTBM_HOUSETILE){
+      area.houseTiles.push_back(nodeTile);
+    }
+    else if(type == OTBM_TILE){
+      if(!loadTile(f, nodeTile, type, area)){
+        return false;
+      }
+    }
+    else{
+      area.error = "Unknown tile node.";
+      return false;
+    }
+
+    nodeTile = f.getNextNode(nodeTile, type);
+  }
+
+  return true;
+}
+
+void IOMapOTBM::loadTileAreas(FileLoader* f, TileArea* areas, size_t count, size_t first, size_t step)
+{
+  for(size_t i = first; i < count; i += step){
+    loadTileArea(*f, areas[i]);
   }
-  return tile;
 }
 
 bool IOMapOTBM::loadMap(Map* map, const std::string& identifier)
@@ -82,7 +325,7 @@ bool IOMapOTBM::loadMap(Map* map, const std::string& identifier)
   int64_t start = OTSYS_TIME();
 
   FileLoader f;
-  if(!f.openFile(identifier.c_str(), false, true)){
+  if(!f.openMappedFile(identifier.c_str())){
     std::stringstream ss;
     ss << "Could not open the file " << identifier << ".";
     setLastErrorString(ss.str());
@@ -197,6 +440,8 @@ bool IOMapOTBM::loadMap(Map* map, const std::string& identifier)
     }
   }
 
+  std::vector<TileArea> areas;
+
   NodeStruct* nodeMapData = f.getChildNode(nodeMap, type);
   while(nodeMapData != NULL){
     if(f.getError() != ERROR_NONE){
@@ -205,224 +450,8 @@ bool IOMapOTBM::loadMap(Map* map, const std::string& identifier)
     }
 
     if(type == OTBM_TILE_AREA){
-      if(!f.getProps(nodeMapData, propStream)){
-        setLastErrorString("Invalid map node.");
-        return false;
-      }
-
-      OTBM_Tile_area_coords* area_coord;
-      if(!propStream.GET_STRUCT(area_coord)){
-        setLastErrorString("Invalid map node.");
-        return false;
-      }
-
-      int base_x, base_y, base_z;
-      base_x = area_coord->_x;
-      base_y = area_coord->_y;
-      base_z = area_coord->_z;
-
-      NodeStruct* nodeTile = f.getChildNode(nodeMapData, type);
-      while(nodeTile != NULL){
-        if(f.getError() != ERROR_NONE){
-          setLastErrorString("Could not read node data.");
-          return false;
-        }
-
-        if(type == OTBM_TILE || type == OTBM_HOUSETILE){
-          if(!f.getProps(nodeTile, propStream)){
-            setLastErrorString("Could not read node data.");
-            return false;
-          }
-
-          OTBM_Tile_coords* tile_coord;
-          if(!propStream.GET_STRUCT(tile_coord)){
-            setLastErrorString("Could not read tile position.");
-            return false;
-          }
-
-          Position p;
-          p.x = base_x + tile_coord->_x;
-          p.y = base_y + tile_coord->_y;
-          p.z = base_z;
-
-          bool isHouseTile = false;
-          House* house = NULL;
-          Tile* tile = NULL;
-          Item* ground_item = NULL;
-          uint32_t tileflags = enums::TILEPROP_NONE;
-
-          if(type == OTBM_HOUSETILE){
-            uint32_t _houseid;
-            if(!propStream.GET_ULONG(_houseid)){
-              std::stringstream ss;
-              ss << p << "Could not read house id.";
-              setLastErrorString(ss.str());
-              return false;
-            }
-
-            house = Houses::getInstance()->getHouse(_houseid, true);
-            if(!house){
-              std::stringstream ss;
-              ss << p << "Could not create house id: " << _houseid;
-              setLastErrorString(ss.str());
-              return false;
-            }
-
-            tile = new HouseTile(p.x, p.y, p.z, house);
-            house->addTile(static_cast<HouseTile*>(tile));
-            isHouseTile = true;
-          }
-
-          //read tile attributes
-          unsigned char attribute;
-          while(propStream.GET_UCHAR(attribute)){
-            switch(attribute){
-            case OTBM_ATTR_TILE_FLAGS:
-            {
-              uint32_t flags;
-              if(!propStream.GET_ULONG(flags)){
-                std::stringstream ss;
-                ss << p << "Failed to read tile flags.";
-                setLastErrorString(ss.str());
-                return false;
-              }
-
-              if((flags & enums::TILEPROP_PROTECTIONZONE) == enums::TILEPROP_PROTECTIONZONE){
-                tileflags |= enums::TILEPROP_PROTECTIONZONE;
-              }
-              else if((flags & enums::TILEPROP_NOPVPZONE) == enums::TILEPROP_NOPVPZONE){
-                tileflags |= enums::TILEPROP_NOPVPZONE;
-              }
-              else if((flags & enums::TILEPROP_PVPZONE) == enums::TILEPROP_PVPZONE){
-                tileflags |= enums::TILEPROP_PVPZONE;
-              }
-
-              if((flags & enums::TILEPROP_NOLOGOUT) == enums::TILEPROP_NOLOGOUT){
-                tileflags |= enums::TILEPROP_NOLOGOUT;
-              }
-
-              if((flags & enums::TILEPROP_REFRESH) == enums::TILEPROP_REFRESH){
-                if(house){
-                  std::cout << "Warning: " << p << " House tile flagged as refreshing!";
-                }
-                tileflags |= enums::TILEPROP_REFRESH;
-              }
-
-              break;
-            }
-
-            case OTBM_ATTR_ITEM:
-            {
-              Item* item = Item::CreateItem(propStream);
-              if(!item){
-                std::stringstream ss;
-                ss << p << "Failed to create item.";
-                setLastErrorString(ss.str());
-                return false;
-              }
-
-              if(isHouseTile && item->isMoveable()){
-                std::cout << "Warning: Moveable item at " << p << " in house id = " << house->getHouseId() << ", id = " << item->getID() << std::endl;
-                delete item;
-                item = NULL;
-              }
-              else{
-                if(tile){
-                  tile->__internalAddThing(item);
-                  g_game.startDecay(item);
-                }
-                else if(item->isGroundTile()){
-                  if(ground_item)
-                    delete ground_item;
-                  ground_item = item;
-                }
-                else{ // !tile
-                  tile = createTile(ground_item, item, p);
-                  tile->__internalAddThing(item);
-                  g_game.startDecay(item);
-                }
-              }
-
-              break;
-            }
-
-            default:
-              std::stringstream ss;
-              ss << p << "Unknown tile attribute.";
-              setLastErrorString(ss.str());
-              return false;
-              break;
-            }
-          }
-
-          NodeStruct* nodeItem = f.getChildNode(nodeTile, type);
-          while(nodeItem){
-            if(type == OTBM_ITEM){
-
-              PropStream propStream;
-              f.getProps(nodeItem, propStream);
-
-              Item* item = Item::CreateItem(propStream);
-              if(!item){
-                std::stringstream ss;
-                ss << p << "Failed to create item.";
-                setLastErrorString(ss.str());
-                return false;
-              }
-
-              if(item->unserializeItemNode(f, nodeItem, propStream)){
-                if(isHouseTile && item->isMoveable()){
-                  std::cout << "Warning: Moveable item at " << p << " in house id = " << house->getHouseId() << ", id= " << item->getID() << std::endl;
-                  delete item;
-                }
-                else{
-                  if(tile){
-                    tile->__internalAddThing(item);
-                    g_game.startDecay(item);
-                  }
-                  else if(item->isGroundTile()){
-                    if(ground_item)
-                      delete ground_item;
-                    ground_item = item;
-                  }
-                  else{ // !tile
-                    tile = createTile(ground_item, item, p);
-                    tile->__internalAddThing(item);
-                    g_game.startDecay(item);
-                  }
-                }
-              }
-              else{
-                std::stringstream ss;
-                ss << p << "Failed to load item " << item->getID() << ".";
-                setLastErrorString(ss.str());
-                delete item;
-                return false;
-              }
-            }
-            else{
-              std::stringstream ss;
-              ss << p << "Unknown node type.";
-              setLastErrorString(ss.str());
-            }
-
-            nodeItem = f.getNextNode(nodeItem, type);
-          }
-
-          if(!tile)
-            tile = createTile(ground_item, NULL, p);
-
-          tile->setFlag((TileProp)tileflags);
-
-          map->setTile(p, tile);
-        }
-        else{
-          setLastErrorString("Unknown tile node.");
-          return false;
-        }
-
-        nodeTile = f.getNextNode(nodeTile, type);
-      }
+      areas.push_back(TileArea());
+      areas.back().node = nodeMapData;
     }
     else if(type == OTBM_TOWNS){
       NodeStruct* nodeTown = f.getChildNode(nodeMapData, type);
@@ -519,6 +548,88 @@ bool IOMapOTBM::loadMap(Map* map, const std::string& identifier)
     nodeMapData = f.getNextNode(nodeMapData, type);
   }
 
+  int64_t areas_start = OTSYS_TIME();
+  int64_t parse_time = 0;
+  int64_t add_time = 0;
+  uint32_t sharedGrounds = 0;
+
+  size_t threads = std::max(1u, boost::thread::hardware_concurrency());
+  threads = std::min(threads, areas.size());
+
+  // Areas are parsed and added in batches, the grounds given up for a
+  // shared one are freed before the next batch allocates its items
+  size_t batch = threads * TILE_AREA_BATCH;
+  for(size_t begin = 0; begin < areas.size(); begin += batch){
+    size_t count = std::min(batch, areas.size() - begin);
+    int64_t batch_start = OTSYS_TIME();
+    if(threads > 1){
+      boost::thread_group workers;
+      for(size_t i = 0; i < threads; ++i){
+        workers.create_thread(boost::bind(&IOMapOTBM::loadTileAreas, &f, &areas[begin], count, i, threads));
+      }
+      workers.join_all();
+    }
+    else{
+      loadTileAreas(&f, &areas[begin], count, 0, 1);
+    }
+
+    int64_t tiles_start = OTSYS_TIME();
+    parse_time += tiles_start - batch_start;
+
+    for(size_t a = begin; a < begin + count; ++a){
+      TileArea& area = areas[a];
+
+      // House tiles are loaded into the area they belong to
+      for(std::vector<NodeStruct*>::iterator hit = area.houseTiles.begin(); hit != area.houseTiles.end() && area.error.empty(); ++hit){
+        loadTile(f, *hit, OTBM_HOUSETILE, area);
+      }
+
+      for(std::vector<std::string>::iterator wit = area.warnings.begin(); wit != area.warnings.end(); ++wit){
+        std::cout << *wit << std::endl;
+      }
+
+      if(!area.error.empty()){
+        setLastErrorString(area.error);
+        return false;
+      }
+
+      for(std::vector<TileArea::LoadedTile>::iterator tit = area.tiles.begin(); tit != area.tiles.end(); ++tit){
+        Tile* tile = tit->tile;
+        if(Item* ground = tit->ground){
+          ground = Item::getSharedItem(ground);
+          tile->__internalAddThing(ground);
+          g_game.startDecay(ground);
+        }
+
+        if(tile->getSharedGround() && tile->getSharedGround()->isShared()){
+          ++sharedGrounds;
+        }
+
+        map->setTile(tile->getPosition(), tile);
+      }
+
+      for(std::vector<Item*>::iterator iit = area.decaying.begin(); iit != area.decaying.end(); ++iit){
+        g_game.startDecay(*iit);
+      }
+
+      // Everything is on the map now
+      std::vector<TileArea::LoadedTile>().swap(area.tiles);
+      std::vector<Item*>().swap(area.decaying);
+    }
+    add_time += OTSYS_TIME() - tiles_start;
+  }
+
+  int64_t end = OTSYS_TIME();
+  std::cout << "Notice: [OTBM Loader] Nodes read in " << (areas_start - start)/(1000.) << " s, "
+    << areas.size() << " tile areas in " << parse_time/(1000.) << " s on " << threads << " threads, "
+    << "tiles added in " << add_time/(1000.) << " s" << std::endl;
+
+  if(sharedGrounds > 0){
+    uint64_t saved = (uint64_t)(sharedGrounds - Item::getSharedItemCount()) * sizeof(Item);
+    std::cout << "Notice: [OTBM Loader] " << sharedGrounds << " tiles share " << Item::getSharedItemCount()
+      << " ground items, an estimated " << saved / 1024 << " kB less item memory" << std::endl;
+  }
+
   std::cout << "Notice: [OTBM Loader] Loading time : " << (OTSYS_TIME() - start)/(1000.) << " s" << std::endl;
   return true;
 }
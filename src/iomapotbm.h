@@ -21,7 +21,11 @@
 #ifndef __OTSERV_IOMAPOTBM_H__
 #define __OTSERV_IOMAPOTBM_H__
 
+#include <string>
+#include <vector>
 #include "iomap.h"
+#include "fileloader.h"
+#include "position.h"
 
 enum OTBM_Version {
   OTBM_1 = 0,
@@ -116,7 +120,33 @@ struct OTBM_HouseTile_coords{
 #pragma pack()
 
 class IOMapOTBM : public IOMap{
-  static Tile* createTile(Item*& ground, Item* item, const Position& p);
+  // The tiles of one OTBM_TILE_AREA node. Areas are read apart from the
+  // map, on several threads, and added to it in file order.
+  struct TileArea {
+    TileArea() : node(NULL) {}
+
+    struct LoadedTile {
+      Tile* tile;
+      // Added with the tile, so it can be shared with other tiles
+      Item* ground;
+    };
+
+    NodeStruct* node;
+    Position base;
+    std::vector<LoadedTile> tiles;
+    // Read when the area is added, houses and beds may only be used from
+    // the main thread
+    std::vector<NodeStruct*> houseTiles;
+    std::vector<Item*> decaying;
+    std::vector<std::string> warnings;
+    std::string error;
+  };
+
+  static Tile* createTile(const Item* ground, const Item* item, const Position& p);
+  static void addTileItem(Tile*& tile, Item*& ground, Item* item, const Position& p, TileArea& area);
+  static bool loadTile(FileLoader& f, NodeStruct* nodeTile, unsigned long type, TileArea& area);
+  static bool loadTileArea(FileLoader& f, TileArea& area);
+  static void loadTileAreas(FileLoader* f, TileArea* areas, size_t count, size_t first, size_t step);
 public:
   IOMapOTBM(){};
   ~IOMapOTBM(){};
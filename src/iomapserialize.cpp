@@ -29,6 +29,8 @@
 #include "depot.h"
 #include "housetile.h"
 #include "singleton.h"
+#include "save_writer.h"
+#include "local_storage.h"
 
 extern ConfigManager g_config;
 extern Game g_game;
@@ -48,6 +50,10 @@ bool IOMapSerialize::loadMap(Map* map)
     s = loadMapRelational(map);
   else if(g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "binary")
     s = loadMapBinary(map);
+#ifdef __USE_LOCAL_STORAGE__
+  else if(g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "local")
+    s = loadMapLocal(map);
+#endif
   else
     std::cout << "[IOMapSerialize::loadMap] Unknown map storage type" << std::endl;
 
@@ -65,6 +71,10 @@ bool IOMapSerialize::saveMap(Map* map)
     s = saveMapRelational(map);
   else if(g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "binary")
     s = saveMapBinary(map);
+#ifdef __USE_LOCAL_STORAGE__
+  else if(g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "local")
+    s = saveMapLocal(map);
+#endif
   else
     std::cout << "[IOMapSerialize::saveMap] Unknown map storage type" << std::endl;
 
@@ -423,50 +433,75 @@ bool IOMapSerialize::loadMapBinary(Map* map)
   for (result = db->storeQuery(query); result; result = result->advance()){
     int32_t houseid = result->getDataInt("house_id");
     House* house = Houses::getInstance()->getHouse(houseid);
+    if(!house){
+      // The house was removed from the map, drop its row on the next save
+      staleHouses.insert(houseid);
+    }
 
     unsigned long attrSize = 0;
     const char* attr = result->getDataStream("data", attrSize);
     PropStream propStream;
     propStream.init(attr, attrSize);
 
-    while(propStream.size()) {
-      uint32_t item_count = 0;
-      uint16_t x = 0, y = 0;
-      uint8_t z = 0;
+    loadHouseItems(map, house, propStream);
+  }
 
-      propStream.GET_USHORT(x);
-      propStream.GET_USHORT(y);
-      propStream.GET_UCHAR(z);
+  resetLoadedHouses();
+  return true;
+}
 
-      if(house && house->getPendingDepotTransfer()){
-        Player* player = g_game.getPlayerByGuidEx(house->getHouseOwner());
-        if(player){
-          Depot* depot = player->getDepot(player->getTown(), true);
+void IOMapSerialize::resetLoadedHouses()
+{
+  // Loading went through the regular cylinder notifications, so every house
+  // is marked as changed now. Only houses whose items were moved elsewhere
+  // differ from what is stored.
+  for(HouseMap::iterator it = Houses::getInstance()->getHouseBegin(); it != Houses::getInstance()->getHouseEnd(); ++it){
+    House* house = it->second;
+    if(!house->getPendingDepotTransfer()){
+      house->resetDirty(House::HOUSE_DIRTY_ITEMS);
+    }
+  }
+}
 
-          propStream.GET_ULONG(item_count);
-          while(item_count--){
-            loadItem(propStream, depot, true);
-          }
+bool IOMapSerialize::loadHouseItems(Map* map, House* house, PropStream& propStream)
+{
+  while(propStream.size()) {
+    uint32_t item_count = 0;
+    uint16_t x = 0, y = 0;
+    uint8_t z = 0;
 
-          if(player->isOffline()){
-            IOPlayer::instance()->savePlayer(player);
-            delete player;
-          }
-        }
-      }
-      else{
-        Tile* tile = map->getParentTile(x, y, z);
-        if(!tile){
-          std::cout << "ERROR: Unserialization of invalid tile in IOMapSerialize::loadTile()" << std::endl;
-          break;
-        }
+    propStream.GET_USHORT(x);
+    propStream.GET_USHORT(y);
+    propStream.GET_UCHAR(z);
+
+    if(house && house->getPendingDepotTransfer()){
+      Player* player = g_game.getPlayerByGuidEx(house->getHouseOwner());
+      if(player){
+        Depot* depot = player->getDepot(player->getTown(), true);
 
         propStream.GET_ULONG(item_count);
         while(item_count--){
-          loadItem(propStream, tile);
+          loadItem(propStream, depot, true);
+        }
+
+        if(player->isOffline()){
+          IOPlayer::instance()->savePlayer(player);
+          delete player;
         }
       }
     }
+    else{
+      Tile* tile = map->getParentTile(x, y, z);
+      if(!tile){
+        std::cout << "ERROR: Unserialization of invalid tile in IOMapSerialize::loadTile()" << std::endl;
+        break;
+      }
+
+      propStream.GET_ULONG(item_count);
+      while(item_count--){
+        loadItem(propStream, tile);
+      }
+    }
   }
 
   return true;
@@ -596,53 +631,206 @@ bool IOMapSerialize::loadItem(PropStream& propStream, Cylinder* parent, bool dep
 bool IOMapSerialize::saveMapBinary(Map* map)
 {
   DatabaseDriver* db = DatabaseDriver::instance();
-  DBQuery query;
-  DBTransaction transaction(db);
-  DBInsert stmt(db);
-  stmt.setQuery("INSERT INTO `map_store` (`world_id`, `house_id`, `data`) VALUES ");
 
-
-  //Start the transaction
-  if(!transaction.begin())
+  SaveRecord record;
+  std::vector<uint32_t> houseIds;
+  if(!prepareSaveMapBinary(record, houseIds))
     return false;
 
-  query << "DELETE FROM `map_store` WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID);
-  if(!db->executeQuery(query))
+  if(!record.commit(db))
     return false;
 
-  //clear old tile data
+  // Only forget the changes once they are safely stored
+  setHousesSaved(houseIds, true);
+  return true;
+}
+
+bool IOMapSerialize::prepareSaveMap(Map* map, SaveRecord& record, std::vector<uint32_t>& houseIds)
+{
+  if(g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "binary")
+    return prepareSaveMapBinary(record, houseIds);
+#ifdef __USE_LOCAL_STORAGE__
+  else if(g_config.getString(ConfigManager::MAP_STORAGE_TYPE) == "local")
+    // Appending to the local storage is cheap, it is not left to the writer
+    return saveMapLocal(map);
+#endif
+
+  return false;
+}
+
+bool IOMapSerialize::prepareSaveMapBinary(SaveRecord& record, std::vector<uint32_t>& houseIds)
+{
+  DatabaseDriver* db = DatabaseDriver::instance();
+  DBQuery query;
+  DBInsert stmt(db, &record.statements);
+  stmt.setQuery("INSERT INTO `map_store` (`world_id`, `house_id`, `data`) VALUES ");
+
+  //clear rows of houses that no longer exist
+  for(std::set<uint32_t>::iterator it = staleHouses.begin(); it != staleHouses.end(); ++it){
+    query.reset();
+    query << "DELETE FROM `map_store` WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `house_id` = " << *it;
+    record.statements.push_back(query.str());
+    houseIds.push_back(*it);
+  }
+
+  // Only houses that changed since the last save are written
   for(HouseMap::iterator it = Houses::getInstance()->getHouseBegin();
     it != Houses::getInstance()->getHouseEnd();
     ++it)
   {
-    //save house items
     House* house = it->second;
+    if(!house->isDirty(House::HOUSE_DIRTY_ITEMS))
+      continue;
+
+    //clear old tile data
+    query.reset();
+    query << "DELETE FROM `map_store` WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `house_id` = " << house->getHouseId();
+    record.statements.push_back(query.str());
+
+    //save house items
     PropWriteStream stream;
-    for(HouseTileList::iterator tile_iter = house->getTileBegin();
-      tile_iter != house->getTileEnd();
-      ++tile_iter)
-    {
-      if(!saveTile(stream, *tile_iter)){
-        return false;
-      }
+    if(!saveHouseItems(stream, house)){
+      return false;
     }
 
     uint32_t attributesSize;
     const char* attributes = stream.getStream(attributesSize);
 
     query.reset();
-    query << g_config.getNumber(ConfigManager::WORLD_ID) << ", " << it->second->getHouseId() << ", " << db->escapeBlob(attributes, attributesSize);
+    query << g_config.getNumber(ConfigManager::WORLD_ID) << ", " << house->getHouseId() << ", " << db->escapeBlob(attributes, attributesSize);
 
     if(!stmt.addRow(query.str()))
       return false;
+
+    houseIds.push_back(house->getHouseId());
   }
 
-  if(!stmt.execute())
+  return stmt.execute();
+}
+
+void IOMapSerialize::setHousesSaved(const std::vector<uint32_t>& houseIds, bool saved)
+{
+  for(std::vector<uint32_t>::const_iterator it = houseIds.begin(); it != houseIds.end(); ++it){
+    House* house = Houses::getInstance()->getHouse(*it);
+    if(saved){
+      if(house)
+        house->resetDirty(House::HOUSE_DIRTY_ITEMS);
+      else
+        staleHouses.erase(*it);
+    }
+    else{
+      if(house)
+        house->setDirty(House::HOUSE_DIRTY_ITEMS);
+      else
+        staleHouses.insert(*it);
+    }
+  }
+}
+
+bool IOMapSerialize::saveHouseItems(PropWriteStream& stream, House* house)
+{
+  for(HouseTileList::iterator tile_iter = house->getTileBegin();
+    tile_iter != house->getTileEnd();
+    ++tile_iter)
+  {
+    if(!saveTile(stream, *tile_iter)){
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#ifdef __USE_LOCAL_STORAGE__
+std::string IOMapSerialize::getLocalHouseKey(uint32_t houseId)
+{
+  std::ostringstream key;
+  key << getLocalHousePrefix() << houseId;
+  return key.str();
+}
+
+std::string IOMapSerialize::getLocalHousePrefix()
+{
+  std::ostringstream prefix;
+  prefix << "map/" << g_config.getNumber(ConfigManager::WORLD_ID) << "/";
+  return prefix.str();
+}
+
+bool IOMapSerialize::loadMapLocal(Map* map)
+{
+  LocalStorage* storage = LocalStorage::instance();
+  if(!storage->isOpen()){
+    std::cout << "[IOMapSerialize::loadMapLocal] Local storage is not open, set local_storage_file" << std::endl;
     return false;
+  }
 
-  //End the transaction
-  return transaction.commit();
+  std::string prefix = getLocalHousePrefix();
+  std::vector<std::string> keys;
+  storage->getKeys(prefix, keys);
+
+  std::string data;
+  for(std::vector<std::string>::iterator it = keys.begin(); it != keys.end(); ++it){
+    uint32_t houseid = atoi(it->c_str() + prefix.size());
+    House* house = Houses::getInstance()->getHouse(houseid);
+    if(!house){
+      // The house was removed from the map, drop it on the next save
+      staleHouses.insert(houseid);
+    }
+
+    if(!storage->get(*it, data))
+      return false;
+
+    PropStream propStream;
+    propStream.init(data.data(), data.size());
+    loadHouseItems(map, house, propStream);
+  }
+
+  resetLoadedHouses();
+  return true;
+}
+
+bool IOMapSerialize::saveMapLocal(Map* map)
+{
+  LocalStorage* storage = LocalStorage::instance();
+  if(!storage->isOpen()){
+    std::cout << "[IOMapSerialize::saveMapLocal] Local storage is not open, set local_storage_file" << std::endl;
+    return false;
+  }
+
+  std::vector<uint32_t> houseIds;
+  for(std::set<uint32_t>::iterator it = staleHouses.begin(); it != staleHouses.end(); ++it){
+    storage->erase(getLocalHouseKey(*it));
+    houseIds.push_back(*it);
+  }
+
+  for(HouseMap::iterator it = Houses::getInstance()->getHouseBegin();
+    it != Houses::getInstance()->getHouseEnd();
+    ++it)
+  {
+    House* house = it->second;
+    if(!house->isDirty(House::HOUSE_DIRTY_ITEMS))
+      continue;
+
+    PropWriteStream stream;
+    if(!saveHouseItems(stream, house)){
+      return false;
+    }
+
+    uint32_t size;
+    const char* data = stream.getStream(size);
+    storage->put(getLocalHouseKey(house->getHouseId()), data, size);
+    houseIds.push_back(house->getHouseId());
+  }
+
+  // All houses reach the disk with a single flush
+  if(!storage->sync())
+    return false;
+
+  setHousesSaved(houseIds, true);
+  storage->compact();
+  return true;
 }
+#endif
 
 bool IOMapSerialize::saveItem(PropWriteStream& stream, const Item* item)
 {
@@ -853,22 +1041,19 @@ bool IOMapSerialize::saveHouseInfo(Map* map)
   DBQuery query;
   DBTransaction transaction(db);
 
-  if(!transaction.begin())
-    return false;
+  // Only houses whose owner, rent state or access lists changed are written
+  std::vector<House*> savedHouses;
 
-  query.reset();
-  query <<
-    "DELETE FROM `house_lists` "
-    "WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID);
-  if(!db->executeQuery(query)) {
+  if(!transaction.begin())
     return false;
-  }
 
   DBInsert houselist_insert(db);
   houselist_insert.setQuery("INSERT INTO `house_lists` (`house_id`, `listid`, `list`) VALUES ");
 
   for(HouseMap::iterator it = Houses::getInstance()->getHouseBegin(); it != Houses::getInstance()->getHouseEnd(); ++it){
     House* house = it->second;
+    if(!house->isDirty(House::HOUSE_DIRTY_INFO))
+      continue;
 
     // Fetch house GUID
     DBResult_ptr fetch_guid;
@@ -896,6 +1081,14 @@ bool IOMapSerialize::saveHouseInfo(Map* map)
       return false;
     }
 
+    // Clear old house list
+    query.reset();
+    query << "DELETE FROM `house_lists` WHERE `house_id` = " << house_guid;
+    if(!db->executeQuery(query)){
+      return false;
+    }
+    query.reset();
+
     // Update house list
     std::string listText;
     if(house->getAccessList(GUEST_LIST, listText) && listText != ""){
@@ -923,12 +1116,21 @@ bool IOMapSerialize::saveHouseInfo(Map* map)
         }
       }
     }
+
+    savedHouses.push_back(house);
   }
 
   if(!houselist_insert.execute()){
     return false;
   }
 
-  return transaction.commit();
+  if(!transaction.commit())
+    return false;
+
+  for(std::vector<House*>::iterator it = savedHouses.begin(); it != savedHouses.end(); ++it){
+    (*it)->resetDirty(House::HOUSE_DIRTY_INFO);
+  }
+
+  return true;
 }
 
@@ -23,6 +23,8 @@
 
 #include "classes.h"
 #include "database_driver.h"
+#include <set>
+#include <vector>
 
 class IOMapSerialize{
 public:
@@ -34,12 +36,28 @@ public:
   */
   bool loadMap(Map* map);
 
-  /** Save the map to a data storage
+  /** Save the map to a data storage, only houses changed since the
+    * last save are written
     * \param map pointer to the Map class
     * \return Returns true if the map was saved successfully
   */
   bool saveMap(Map* map);
 
+  /** Render the houses changed since the last save into a save record,
+    * without touching the database (binary storage only, the local storage
+    * is written right away)
+    * \param map pointer to the Map class
+    * \param record receives the statements storing the houses
+    * \param houseIds receives the ids of the houses written by the record
+    * \return Returns true if the record was built successfully
+  */
+  bool prepareSaveMap(Map* map, SaveRecord& record, std::vector<uint32_t>& houseIds);
+
+  /** Mark the houses of a save record as stored, or as changed again
+    * if the record could not be committed
+  */
+  void setHousesSaved(const std::vector<uint32_t>& houseIds, bool saved);
+
   /** Synchronize the house information from the map
     * \return Returns true if all houses where updated correctly
   */
@@ -73,11 +91,27 @@ protected:
   // Binary storage uses a giant BLOB field for storing everything
   bool loadMapBinary(Map* map);
   bool saveMapBinary(Map* map);
+  bool prepareSaveMapBinary(SaveRecord& record, std::vector<uint32_t>& houseIds);
+
+  // Local storage keeps the binary house data in the local storage file
+#ifdef __USE_LOCAL_STORAGE__
+  bool loadMapLocal(Map* map);
+  bool saveMapLocal(Map* map);
+  std::string getLocalHouseKey(uint32_t houseId);
+  std::string getLocalHousePrefix();
+#endif
+
+  bool loadHouseItems(Map* map, House* house, PropStream& propStream);
+  bool saveHouseItems(PropWriteStream& stream, House* house);
+  void resetLoadedHouses();
 
   bool saveItem(PropWriteStream& stream, const Item* item);
   bool saveTile(PropWriteStream& stream, const Tile* tile);
   bool loadItem(PropStream& propStream, Cylinder* parent, bool depotTransfer = false);
   bool loadContainer(PropStream& propStream, Container* container);
+
+  // Stored house ids that are no longer part of the map
+  std::set<uint32_t> staleHouses;
 };
 
 #endif
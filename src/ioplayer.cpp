@@ -28,10 +28,15 @@
 #include "town.h"
 #include "configmanager.h"
 #include "singleton.h"
+#include "save_writer.h"
+#include "local_storage.h"
 
 extern ConfigManager g_config;
 extern Game g_game;
 
+// Bump when the layout of the binary player record changes
+static const uint16_t PLAYER_RECORD_VERSION = 1;
+
 IOPlayer* IOPlayer::instance()
 {
   static Singleton<IOPlayer> instance;
@@ -51,13 +56,15 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
     `healthmax`, `mana`, `manamax`, `manaspent`, `soul`, `direction`, `lookbody`, \
     `lookfeet`, `lookhead`, `looklegs`, `looktype`, `lookaddons`, `posx`, `posy`, `posz`, `cap`, \
     `lastlogin`, `lastlogout`, `lastip`, `conditions`, `skull_time`, `skull_type`, `stamina`, \
-    `loss_experience`, `loss_mana`, `loss_skills`, `loss_items`, `loss_containers` \
+    `loss_experience`, `loss_mana`, `loss_skills`, `loss_items`, `loss_containers`, `save`, `record` \
     FROM `players` \
     LEFT JOIN `accounts` ON `account_id` = `accounts`.`id`\
     LEFT JOIN `groups` ON `groups`.`id` = `players`.`group_id` \
     WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `players`.`name` = " + db->escapeString(name);
 
   if(!(result = db->storeQuery(query))){
+    // The player was renamed or deleted, lookups by the old name must not hit
+    invalidateCache(name);
     return false;
   }
 
@@ -72,6 +79,15 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
   player->maxVipLimit = result->getDataInt("maxviplist");
   player->setFlags(result->getDataLong("groupflags"));
 
+  // a login is a good moment to refresh the lookup cache, it catches renames
+  PlayerCacheEntry entry;
+  entry.guid = player->getGUID();
+  entry.name = result->getDataString("name");
+  entry.accountId = player->accountId;
+  entry.accountName = player->accountName;
+  entry.groupFlags = result->getDataLong("groupflags");
+  addCacheEntry(entry);
+
   if(preload){
     //only loading basic info
     return true;
@@ -172,6 +188,25 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
     player->loginPosition = player->masterPos;
   }
 
+  // once written, the binary record replaces the skill, storage and item rows
+  std::string record;
+#ifdef __USE_LOCAL_STORAGE__
+  if(result->getDataInt("save") == 0)
+    unsavedPlayers.insert(player->getGUID());
+  else
+    unsavedPlayers.erase(player->getGUID());
+
+  LocalStorage* storage = LocalStorage::instance();
+  if(!storage->isOpen() || !storage->get(getLocalRecordKey(player->getGUID()), record))
+#endif
+  {
+    unsigned long recordSize = 0;
+    const char* recordData = result->getDataStream("record", recordSize);
+    if(recordData){
+      record.assign(recordData, recordSize);
+    }
+  }
+
   query.reset();
   query <<
     "SELECT "
@@ -201,29 +236,27 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
   player->password = result->getDataString("password");
   player->premiumDays = IOAccount::getPremiumDaysLeft(result->getDataInt("premend"));
 
-  // we need to find out our skills
-  // so we query the skill table
-  query.reset();
-  query << "SELECT `skill_id`, `value`, `count` FROM `player_skills` WHERE `player_id` = " << player->getGUID();
-  for(result = db->storeQuery(query); result; result = result->advance()){
-    //now iterate over the skills
-    try {
-      SkillType skillid = SkillType::fromInteger(result->getDataInt("skill_id"));
-
-      uint32_t skillLevel = result->getDataInt("value");
-      uint32_t skillCount = result->getDataInt("count");
-
-      uint32_t nextSkillCount = player->vocation->getReqSkillTries(skillid, skillLevel + 1);
-      if(skillCount > nextSkillCount){
-        //make sure its not out of bound
-        skillCount = 0;
+  if(!record.empty()){
+    PropStream propStream;
+    propStream.init(record.data(), record.size());
+    if(!loadRecord(player, propStream)){
+      std::cout << "Error: [IOPlayer::loadPlayer] Could not read the record of player " << player->getGUID() << std::endl;
+      return false;
+    }
+  }
+  else{
+    // we need to find out our skills
+    // so we query the skill table
+    query.reset();
+    query << "SELECT `skill_id`, `value`, `count` FROM `player_skills` WHERE `player_id` = " << player->getGUID();
+    for(result = db->storeQuery(query); result; result = result->advance()){
+      //now iterate over the skills
+      try {
+        SkillType skillid = SkillType::fromInteger(result->getDataInt("skill_id"));
+        setSkill(player, skillid, result->getDataInt("value"), result->getDataInt("count"));
+      } catch(enum_conversion_error&) {
+        std::cout << "Unknown skill ID when loading player " << result->getDataInt("skillid") << std::endl;
       }
-
-      player->skills[skillid.value()][SKILL_LEVEL] = skillLevel;
-      player->skills[skillid.value()][SKILL_TRIES] = skillCount;
-      player->skills[skillid.value()][SKILL_PERCENT] = Player::getPercentLevel(skillCount, nextSkillCount);
-    } catch(enum_conversion_error&) {
-      std::cout << "Unknown skill ID when loading player " << result->getDataInt("skillid") << std::endl;
     }
   }
 
@@ -298,14 +331,19 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
   */
 
   //load storage map
-  query.str("");
-  query << "SELECT `id`, `value` FROM `player_storage` WHERE `player_id` = " << player->getGUID();
-  for(result = db->storeQuery(query); result; result = result->advance()){
-    std::string key = result->getDataString("id");
-    std::string value = result->getDataString("value");
-    player->setCustomValue(key, value);
+  if(record.empty()){
+    query.str("");
+    query << "SELECT `id`, `value` FROM `player_storage` WHERE `player_id` = " << player->getGUID();
+    for(result = db->storeQuery(query); result; result = result->advance()){
+      std::string key = result->getDataString("id");
+      std::string value = result->getDataString("value");
+      player->setCustomValue(key, value);
+    }
   }
 
+  //the storage rows are stale while the player has a binary record
+  player->setStorageChanged(!record.empty());
+
   //load vips
   query.str("");
   query << "SELECT `vip_id` FROM `player_viplist` WHERE `player_id` = " << player->getGUID();
@@ -323,6 +361,212 @@ bool IOPlayer::loadPlayer(Player* player, const std::string& name, bool preload
   return true;
 }
 
+void IOPlayer::setSkill(Player* player, SkillType skill, uint32_t skillLevel, uint32_t skillCount)
+{
+  uint32_t nextSkillCount = player->vocation->getReqSkillTries(skill, skillLevel + 1);
+  if(skillCount > nextSkillCount){
+    //make sure its not out of bound
+    skillCount = 0;
+  }
+
+  player->skills[skill.value()][SKILL_LEVEL] = skillLevel;
+  player->skills[skill.value()][SKILL_TRIES] = skillCount;
+  player->skills[skill.value()][SKILL_PERCENT] = Player::getPercentLevel(skillCount, nextSkillCount);
+}
+
+bool IOPlayer::loadRecord(Player* player, PropStream& propStream)
+{
+  uint16_t version = 0;
+  if(!propStream.GET_USHORT(version) || version != PLAYER_RECORD_VERSION){
+    std::cout << "Error: [IOPlayer::loadRecord] Unknown record version " << version << std::endl;
+    return false;
+  }
+
+  //skills
+  uint8_t skillCount = 0;
+  if(!propStream.GET_UCHAR(skillCount))
+    return false;
+
+  for(uint8_t i = 0; i < skillCount; ++i){
+    uint32_t skillLevel, skillTries;
+    if(!propStream.GET_ULONG(skillLevel) || !propStream.GET_ULONG(skillTries))
+      return false;
+
+    if(i < SkillType::size){
+      setSkill(player, SkillType::fromInteger(i), skillLevel, skillTries);
+    }
+  }
+
+  //storage
+  uint32_t storageCount = 0;
+  if(!propStream.GET_ULONG(storageCount))
+    return false;
+
+  while(storageCount--){
+    std::string key, value;
+    if(!propStream.GET_STRING(key) || !propStream.GET_LSTRING(value))
+      return false;
+
+    player->setCustomValue(key, value);
+  }
+
+  //inventory
+  uint8_t itemCount = 0;
+  if(!propStream.GET_UCHAR(itemCount))
+    return false;
+
+  while(itemCount--){
+    uint8_t slotId = 0;
+    if(!propStream.GET_UCHAR(slotId))
+      return false;
+
+    Item* item = loadItem(propStream);
+    if(!item)
+      return false;
+
+    if(slotId >= 1 && slotId <= 10 && !player->inventory[slotId]){
+      player->__internalAddThing(slotId, item);
+    }
+    else{
+      std::cout << "Error: [IOPlayer::loadRecord] Invalid slot " << (int32_t)slotId << " for player " << player->getGUID() << std::endl;
+      delete item;
+    }
+  }
+
+  //depots
+  uint32_t depotCount = 0;
+  if(!propStream.GET_ULONG(depotCount))
+    return false;
+
+  while(depotCount--){
+    uint32_t depotId = 0;
+    if(!propStream.GET_ULONG(depotId))
+      return false;
+
+    Item* item = loadItem(propStream);
+    if(!item)
+      return false;
+
+    Depot* depot = (item->getContainer() ? item->getContainer()->getDepot() : NULL);
+    if(!depot || !player->addDepot(depot, depotId)){
+      std::cout << "Error loading depot "<< depotId << " for player " << player->getGUID() << std::endl;
+      delete item;
+    }
+  }
+
+  return true;
+}
+
+void IOPlayer::saveRecord(Player* player, PropWriteStream& stream)
+{
+  stream.ADD_USHORT(PLAYER_RECORD_VERSION);
+
+  stream.ADD_UCHAR(SkillType::size);
+  for(int32_t i = 0; i < SkillType::size; ++i){
+    stream.ADD_ULONG(player->skills[i][SKILL_LEVEL]);
+    stream.ADD_ULONG(player->skills[i][SKILL_TRIES]);
+  }
+
+  uint32_t storageCount = 0;
+  for(StorageMap::const_iterator cit = player->getCustomValueIteratorBegin(); cit != player->getCustomValueIteratorEnd(); ++cit){
+    ++storageCount;
+  }
+
+  stream.ADD_ULONG(storageCount);
+  for(StorageMap::const_iterator cit = player->getCustomValueIteratorBegin(); cit != player->getCustomValueIteratorEnd(); ++cit){
+    stream.ADD_STRING(cit->first);
+    stream.ADD_LSTRING(cit->second);
+  }
+
+  uint8_t itemCount = 0;
+  for(int32_t slotId = 1; slotId <= 10; ++slotId){
+    if(player->inventory[slotId]){
+      ++itemCount;
+    }
+  }
+
+  stream.ADD_UCHAR(itemCount);
+  for(int32_t slotId = 1; slotId <= 10; ++slotId){
+    if(player->inventory[slotId]){
+      stream.ADD_UCHAR(slotId);
+      saveItem(stream, player->inventory[slotId]);
+    }
+  }
+
+  stream.ADD_ULONG(player->depots.size());
+  for(DepotMap::const_iterator it = player->depots.begin(); it != player->depots.end(); ++it){
+    stream.ADD_ULONG(it->first);
+    saveItem(stream, it->second);
+  }
+}
+
+Item* IOPlayer::loadItem(PropStream& propStream)
+{
+  uint16_t id = 0;
+  if(!propStream.GET_USHORT(id))
+    return NULL;
+
+  Item* item = Item::CreateItem(id);
+  if(!item){
+    std::cout << "Error: [IOPlayer::loadItem] Unknown item id " << id << std::endl;
+    return NULL;
+  }
+
+  if(!item->unserializeAttr(propStream)){
+    std::cout << "Error: [IOPlayer::loadItem] Unserialization error for item " << id << std::endl;
+    delete item;
+    return NULL;
+  }
+
+  if(Container* container = item->getContainer()){
+    while(container->serializationCount > 0){
+      Item* child = loadItem(propStream);
+      if(!child){
+        delete item;
+        return NULL;
+      }
+
+      container->__internalAddThing(child);
+      container->serializationCount--;
+    }
+
+    uint8_t endAttr = 0;
+    if(!propStream.GET_UCHAR(endAttr) || endAttr != 0x00){
+      std::cout << "Error: [IOPlayer::loadItem] Unserialization error for container " << id << std::endl;
+      delete item;
+      return NULL;
+    }
+  }
+
+  return item;
+}
+
+void IOPlayer::saveItem(PropWriteStream& stream, const Item* item)
+{
+  // Same layout as the binary map storage
+  stream.ADD_USHORT(item->getID());
+  item->serializeAttr(stream);
+
+  if(const Container* container = item->getContainer()){
+    stream.ADD_UCHAR(ATTR_CONTAINER_ITEMS);
+    stream.ADD_ULONG(container->size());
+    for(ItemList::const_reverse_iterator it = container->getReversedItems(); it != container->getReversedEnd(); ++it){
+      saveItem(stream, *it);
+    }
+  }
+
+  stream.ADD_UCHAR(0x00); // attr end
+}
+
+#ifdef __USE_LOCAL_STORAGE__
+std::string IOPlayer::getLocalRecordKey(uint32_t guid)
+{
+  std::ostringstream key;
+  key << "player/" << guid;
+  return key.str();
+}
+#endif
+
 bool IOPlayer::saveItems(Player* player, const ItemBlockList& itemList, DBInsert& query_insert)
 {
   /*
@@ -392,22 +636,39 @@ bool IOPlayer::saveItems(Player* player, const ItemBlockList& itemList, DBInsert
 
 bool IOPlayer::savePlayer(Player* player, bool shallow)
 {
-  player->preSave();
-
   DatabaseDriver* db = DatabaseDriver::instance();
+  //holding the database lock keeps the save writer from committing an older copy meanwhile
   DBQuery query;
-  DBResult_ptr result;
 
-  //check if the player has to be saved or not
-  query << "SELECT `save` FROM `players` WHERE `id` = " << player->getGUID();
-  if(!(result = db->storeQuery(query))){
+  SaveRecord record;
+  if(!prepareSavePlayer(player, shallow, record)){
     return false;
   }
 
-  const uint32_t save = result->getDataInt("save");
+  //whatever is still queued for this player is older than this save
+  g_saveWriter.discardPlayer(player->getGUID());
 
-  if(save == 0)
-    return true;
+#ifdef __USE_LOCAL_STORAGE__
+  if(LocalStorage::instance()->isOpen() && !LocalStorage::instance()->sync()){
+    return false;
+  }
+#endif
+
+  return record.commit(db);
+}
+
+bool IOPlayer::prepareSavePlayer(Player* player, bool shallow, SaveRecord& record)
+{
+  player->preSave();
+
+  DatabaseDriver* db = DatabaseDriver::instance();
+  DBQuery query;
+
+  record.playerGuid = player->getGUID();
+
+  //check if the player has to be saved or not
+  query << "SELECT `id` FROM `players` WHERE `id` = " << player->getGUID() << " AND `save` <> 0";
+  record.guard = query.str();
 
   //serialize conditions
   PropWriteStream propWriteStream;
@@ -424,6 +685,32 @@ bool IOPlayer::savePlayer(Player* player, bool shallow)
   uint32_t conditionsSize;
   const char* conditions = propWriteStream.getStream(conditionsSize);
 
+  //the binary record is always written whole, shallow saves included
+  bool binaryRecord = (g_config.getString(ConfigManager::PLAYER_STORAGE_TYPE) == "binary");
+  PropWriteStream recordStream;
+  if(binaryRecord){
+    saveRecord(player, recordStream);
+  }
+
+  uint32_t recordSize;
+  const char* recordData = recordStream.getStream(recordSize);
+  std::string recordValue = (binaryRecord ? db->escapeBlob(recordData, recordSize) : "NULL");
+
+#ifdef __USE_LOCAL_STORAGE__
+  LocalStorage* storage = LocalStorage::instance();
+  if(storage->isOpen()){
+    //the local storage has no guard query, it checks the flag read on login
+    if(unsavedPlayers.find(player->getGUID()) == unsavedPlayers.end()){
+      if(binaryRecord)
+        storage->put(getLocalRecordKey(player->getGUID()), recordData, recordSize);
+      else
+        storage->erase(getLocalRecordKey(player->getGUID()));
+    }
+
+    recordValue = "NULL";
+  }
+#endif
+
   //First, an UPDATE query to write the player itself
   query.reset();
   query << "UPDATE `players` SET `level` = " << player->level
@@ -450,6 +737,7 @@ bool IOPlayer::savePlayer(Player* player, bool shallow)
   << ", `cap` = " << player->getCapacity()
   << ", `sex` = " << player->sex.value()
   << ", `conditions` = " << db->escapeBlob(conditions, conditionsSize)
+  << ", `record` = " << recordValue
   << ", `loss_experience` = " << (int32_t)player->getLossPercent(LOSS_EXPERIENCE)
   << ", `loss_mana` = " << (int32_t)player->getLossPercent(LOSS_MANASPENT)
   << ", `loss_skills` = " << (int32_t)player->getLossPercent(LOSS_SKILLTRIES)
@@ -464,26 +752,42 @@ bool IOPlayer::savePlayer(Player* player, bool shallow)
 
   query << " WHERE `id` = " << player->getGUID();
 
-  DBTransaction transaction(db);
-  if(!transaction.begin())
-    return false;
-
-  if(!db->executeQuery(query)){
-    return false;
-  }
+  record.statements.push_back(query.str());
 
   //skills
-  for(int32_t i = 0; i <= 6; i++){
+  for(int32_t i = 0; !binaryRecord && i <= 6; i++){
     query.reset();
     query << "UPDATE `player_skills` SET `value` = " << player->skills[i][SKILL_LEVEL] << ", `count` = " << player->skills[i][SKILL_TRIES] << " WHERE `player_id` = " << player->getGUID() << " AND `skill_id` = " << i;
 
-    if(!db->executeQuery(query)){
+    record.statements.push_back(query.str());
+  }
+
+  //the storage rows are rewritten with the record column when they changed,
+  //even by shallow saves, or the rows from before a binary record come back
+  if(!binaryRecord && player->isStorageChanged()){
+    query.reset();
+    query << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID();
+    record.statements.push_back(query.str());
+
+    DBInsert storageInsert(db, &record.statements);
+    storageInsert.setQuery("INSERT INTO `player_storage` (`player_id` , `id` , `value` ) VALUES ");
+    for(StorageMap::const_iterator cit = player->getCustomValueIteratorBegin(); cit != player->getCustomValueIteratorEnd(); cit++){
+      query.reset();
+      query << player->getGUID() << ", " << db->escapeString(cit->first) << ", " << db->escapeString(cit->second);
+      if(!storageInsert.addRow(query.str())){
+        return false;
+      }
+    }
+
+    if(!storageInsert.execute()){
       return false;
     }
+
+    player->setStorageChanged(false);
   }
 
   if(shallow)
-    return transaction.commit();
+    return true;
 
   // deletes all player-related stuff
 
@@ -503,22 +807,11 @@ bool IOPlayer::savePlayer(Player* player, bool shallow)
   query.str("");
   */
 
-  query.reset();
-  query << "DELETE FROM `player_storage` WHERE `player_id` = " << player->getGUID();
-
-  if(!db->executeQuery(query)){
-    return false;
-  }
-
   query.reset();
   query << "DELETE FROM `player_viplist` WHERE `player_id` = " << player->getGUID();
-
-  if(!db->executeQuery(query.str())){
-    return false;
-  }
+  record.statements.push_back(query.str());
 
   // Starti inserting
-  DBInsert insert(db);
 
   /*
   ItemBlockList itemList;
@@ -547,19 +840,6 @@ bool IOPlayer::savePlayer(Player* player, bool shallow)
   }
   */
 
-  insert.setQuery("INSERT INTO `player_storage` (`player_id` , `id` , `value` ) VALUES ");
-  for(StorageMap::const_iterator cit = player->getCustomValueIteratorBegin(); cit != player->getCustomValueIteratorEnd();cit++){
-    query.reset();
-    query << player->getGUID() << ", " << db->escapeString(cit->first) << ", " << db->escapeString(cit->second);
-    if(!insert.addRow(query.str())){
-      return false;
-    }
-  }
-
-  if(!insert.execute()){
-    return false;
-  }
-
   //save vip list
   if(!player->VIPList.empty()){
     query.reset();
@@ -576,31 +856,15 @@ bool IOPlayer::savePlayer(Player* player, bool shallow)
       }
     }
 
-    if(!db->executeQuery(query)){
-      return false;
-    }
+    record.statements.push_back(query.str());
   }
 
-  //End the transaction
-  return transaction.commit();
+  return true;
 }
 
 bool IOPlayer::storeNameByGuid(DatabaseDriver &db, uint32_t guid)
 {
-  DBQuery query;
-  DBResult_ptr result;
-
-  NameCacheMap::iterator it = nameCacheMap.find(guid);
-  if(it != nameCacheMap.end())
-    return true;
-
-  query << "SELECT `name` FROM `players` WHERE `id` = " << guid;
-
-  if(!(result = db.storeQuery(query)))
-    return false;
-
-  nameCacheMap[guid] = result->getDataString("name");
-  return true;
+  return getCacheEntry(guid) != NULL;
 }
 
 bool IOPlayer::addPlayerDeath(Player* dying_player, const DeathList& dlist)
@@ -834,103 +1098,55 @@ bool IOPlayer::sendMail(Creature* actor, const std::string name, uint32_t depotI
 
 bool IOPlayer::getNameByGuid(uint32_t guid, std::string& name)
 {
-  NameCacheMap::iterator it = nameCacheMap.find(guid);
-  if(it != nameCacheMap.end()){
-    name = it->second;
-    return true;
-  }
-
-  DatabaseDriver* db = DatabaseDriver::instance();
-  DBQuery query;
-  DBResult_ptr result;
-
-  query << "SELECT `name` FROM `players` WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `id` = " << guid;
-
-  if(!(result = db->storeQuery(query)))
+  const PlayerCacheEntry* entry = getCacheEntry(guid);
+  if(!entry)
     return false;
 
-  name = result->getDataString("name");
-  nameCacheMap[guid] = name;
+  name = entry->name;
   return true;
 }
 
 bool IOPlayer::getGuidByName(uint32_t &guid, std::string& name)
 {
-  GuidCacheMap::iterator it = guidCacheMap.find(name);
-  if(it != guidCacheMap.end()){
-    name = it->first;
-    guid = it->second;
-    return true;
-  }
-
-  DatabaseDriver* db = DatabaseDriver::instance();
-  DBResult_ptr result;
-  DBQuery query;
-
-  query <<
-    "SELECT `name`, `id` "
-    "FROM `players` "
-    "WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `name` = " << db->escapeString(name);
-  if(!(result = db->storeQuery(query)))
+  const PlayerCacheEntry* entry = getCacheEntry(name);
+  if(!entry)
     return false;
 
-  name = result->getDataString("name");
-  guid = result->getDataInt("id");
-
-  guidCacheMap[name] = guid;
+  name = entry->name;
+  guid = entry->guid;
   return true;
 }
 
 bool IOPlayer::getAccountByName(uint32_t& account, const std::string& name)
 {
-  DatabaseDriver* db = DatabaseDriver::instance();
-  DBResult_ptr result;
-  DBQuery query;
-
-  query <<
-    "SELECT `account_id` "
-    "FROM `players` "
-    "WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `name` = " << db->escapeString(name);
-  if(!(result = db->storeQuery(query)))
+  const PlayerCacheEntry* entry = getCacheEntry(name);
+  if(!entry)
     return false;
 
-  account = result->getDataInt("account_id");
+  account = entry->accountId;
   return true;
 }
 
 
 bool IOPlayer::getAccountByName(std::string& account, const std::string& player_name)
 {
-  DatabaseDriver* db = DatabaseDriver::instance();
-  DBResult_ptr result;
-  DBQuery query;
-
-  query << "SELECT `a`.`name` FROM `players` p LEFT JOIN `accounts` a ON `p`.`account_id` = `a`.`id` "
-    "WHERE `p`.`world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `p`.`name` = " << db->escapeString(player_name);
-
-  if(!(result = db->storeQuery(query)))
+  const PlayerCacheEntry* entry = getCacheEntry(player_name);
+  if(!entry)
     return false;
 
-  account = result->getDataString("name");
+  account = entry->accountName;
   return true;
 }
 
 
 bool IOPlayer::getGuidByNameEx(uint32_t& guid, bool& specialVip, const std::string& player_name)
 {
-  DatabaseDriver* db = DatabaseDriver::instance();
-  DBResult_ptr result;
-  DBQuery query;
-
-  query <<
-    "SELECT `players`.`name`, `players`.`id`, `groups`.`flags` AS `flags` "
-    "FROM `players` LEFT JOIN `groups` ON `groups`.`id` = `players`.`group_id` "
-    "WHERE `players`.`world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `players`.`name`= " << db->escapeString(player_name);
-  if(!(result = db->storeQuery(query.str())))
+  const PlayerCacheEntry* entry = getCacheEntry(player_name);
+  if(!entry)
     return false;
 
-  guid = result->getDataInt("id");
-  specialVip = (result->getDataLong("flags") & (1ull << PlayerFlag_SpecialVIP)) != 0;
+  guid = entry->guid;
+  specialVip = (entry->groupFlags & (1ull << PlayerFlag_SpecialVIP)) != 0;
   return true;
 }
 
@@ -953,6 +1169,19 @@ bool IOPlayer::getDefaultTown(std::string& name, uint32_t& depotId)
 
 bool IOPlayer::getGuildIdByName(uint32_t& guildId, const std::string& guildName)
 {
+  GuildCacheMap::iterator it = guildCacheMap.find(guildName);
+  if(it != guildCacheMap.end()){
+    if(it->second.expireTime > OTSYS_TIME()){
+      ++cacheHits;
+      guildId = it->second.guildId;
+      return true;
+    }
+
+    guildCacheMap.erase(it);
+  }
+
+  ++cacheMisses;
+
   DatabaseDriver* db = DatabaseDriver::instance();
   DBResult_ptr result;
   DBQuery query;
@@ -966,24 +1195,20 @@ bool IOPlayer::getGuildIdByName(uint32_t& guildId, const std::string& guildName)
     return false;
 
   guildId = result->getDataInt("id");
+
+  // Guilds are few, they are only bounded by the lifetime
+  if(g_config.getNumber(ConfigManager::PLAYER_CACHE_SIZE) > 0){
+    GuildCacheEntry& entry = guildCacheMap[guildName];
+    entry.guildId = guildId;
+    entry.expireTime = OTSYS_TIME() + g_config.getNumber(ConfigManager::PLAYER_CACHE_LIFETIME) * 1000;
+  }
+
   return true;
 }
 
 bool IOPlayer::playerExists(std::string name)
 {
-  DatabaseDriver* db = DatabaseDriver::instance();
-  DBResult_ptr result;
-  DBQuery query;
-
-  query <<
-    "SELECT `id` "
-    "FROM `players` "
-    "WHERE `players`.`world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `name`= " << db->escapeString(name);
-  
-  if(!(result = db->storeQuery(query)))
-    return false;
-  
-  return true;
+  return getCacheEntry(name) != NULL;
 }
 
 bool IOPlayer::isPlayerOnlineByAccount(uint32_t acc)
@@ -1035,20 +1260,11 @@ void IOPlayer::loadItems(ItemMap& itemMap, DBResult* result)
 
 bool IOPlayer::hasFlag(PlayerFlags flag, uint32_t guid)
 {
-  DatabaseDriver* db = DatabaseDriver::instance();
-  DBResult_ptr result;
-
-  DBQuery query;
-  query <<
-    "SELECT `groups`.`flags` AS `flags` "
-    "FROM `players` "
-    "LEFT JOIN `groups` ON `groups`.`id` = `players`.`group_id` "
-    "WHERE `world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID) << " AND `players`.`id` = " << guid;
-  if(!(result = db->storeQuery(query)))
+  const PlayerCacheEntry* entry = getCacheEntry(guid);
+  if(!entry)
     return false;
 
-  uint64_t flags = result->getDataLong("flags");
-  return (flags & (1ull << flag)) != 0;
+  return (entry->groupFlags & (1ull << flag)) != 0;
 }
 
 bool IOPlayer::getLastIP(uint32_t& ip, uint32_t guid)
@@ -1102,3 +1318,158 @@ bool IOPlayer::cleanOnlineInfo()
   
   return true;
 }
+
+void IOPlayer::getCacheQuery(DBQuery& query)
+{
+  query <<
+    "SELECT `players`.`id` AS `id`, `players`.`name` AS `name`, `players`.`account_id` AS `account_id`, "
+    "`accounts`.`name` AS `accname`, `groups`.`flags` AS `flags` "
+    "FROM `players` "
+    "LEFT JOIN `accounts` ON `accounts`.`id` = `players`.`account_id` "
+    "LEFT JOIN `groups` ON `groups`.`id` = `players`.`group_id` "
+    "WHERE `players`.`world_id` = " << g_config.getNumber(ConfigManager::WORLD_ID);
+}
+
+const IOPlayer::PlayerCacheEntry* IOPlayer::getCacheEntry(uint32_t guid)
+{
+  NameCacheMap::iterator it = nameCacheMap.find(guid);
+  if(it != nameCacheMap.end()){
+    if(const PlayerCacheEntry* entry = useCacheEntry(it->second)){
+      return entry;
+    }
+  }
+
+  ++cacheMisses;
+
+  DBQuery query;
+  getCacheQuery(query);
+  query << " AND `players`.`id` = " << guid;
+  return loadCacheEntry(query);
+}
+
+const IOPlayer::PlayerCacheEntry* IOPlayer::getCacheEntry(const std::string& name)
+{
+  GuidCacheMap::iterator it = guidCacheMap.find(name);
+  if(it != guidCacheMap.end()){
+    if(const PlayerCacheEntry* entry = useCacheEntry(it->second)){
+      return entry;
+    }
+  }
+
+  ++cacheMisses;
+
+  DBQuery query;
+  getCacheQuery(query);
+  query << " AND `players`.`name` = " << DatabaseDriver::instance()->escapeString(name);
+  return loadCacheEntry(query);
+}
+
+const IOPlayer::PlayerCacheEntry* IOPlayer::useCacheEntry(PlayerCacheList::iterator it)
+{
+  if(it->expireTime <= OTSYS_TIME()){
+    eraseCacheEntry(it);
+    return NULL;
+  }
+
+  ++cacheHits;
+  playerCacheList.splice(playerCacheList.begin(), playerCacheList, it);
+  return &(*it);
+}
+
+const IOPlayer::PlayerCacheEntry* IOPlayer::loadCacheEntry(DBQuery& query)
+{
+  DBResult_ptr result;
+  if(!(result = DatabaseDriver::instance()->storeQuery(query)))
+    return NULL;
+
+  PlayerCacheEntry entry;
+  entry.guid = result->getDataInt("id");
+  entry.name = result->getDataString("name");
+  entry.accountId = result->getDataInt("account_id");
+  entry.accountName = result->getDataString("accname");
+  entry.groupFlags = result->getDataLong("flags");
+  addCacheEntry(entry);
+
+  return &playerCacheList.front();
+}
+
+void IOPlayer::addCacheEntry(PlayerCacheEntry& entry)
+{
+  // A disabled cache still hands out the entry, it just never hits
+  int64_t maxSize = g_config.getNumber(ConfigManager::PLAYER_CACHE_SIZE);
+  entry.expireTime = (maxSize > 0 ? OTSYS_TIME() + g_config.getNumber(ConfigManager::PLAYER_CACHE_LIFETIME) * 1000 : 0);
+
+  // The player was renamed, or the name now belongs to someone else
+  NameCacheMap::iterator nit = nameCacheMap.find(entry.guid);
+  if(nit != nameCacheMap.end()){
+    eraseCacheEntry(nit->second);
+  }
+
+  GuidCacheMap::iterator git = guidCacheMap.find(entry.name);
+  if(git != guidCacheMap.end()){
+    eraseCacheEntry(git->second);
+  }
+
+  playerCacheList.push_front(entry);
+  nameCacheMap[entry.guid] = playerCacheList.begin();
+  guidCacheMap[entry.name] = playerCacheList.begin();
+
+  while(playerCacheList.size() > 1 && (int64_t)playerCacheList.size() > maxSize){
+    eraseCacheEntry(--playerCacheList.end());
+  }
+}
+
+void IOPlayer::eraseCacheEntry(PlayerCacheList::iterator it)
+{
+  nameCacheMap.erase(it->guid);
+  guidCacheMap.erase(it->name);
+  playerCacheList.erase(it);
+}
+
+void IOPlayer::invalidateCache(const std::string& name)
+{
+  GuidCacheMap::iterator it = guidCacheMap.find(name);
+  if(it != guidCacheMap.end()){
+    eraseCacheEntry(it->second);
+  }
+}
+
+void IOPlayer::clearCache()
+{
+  playerCacheList.clear();
+  nameCacheMap.clear();
+  guidCacheMap.clear();
+  guildCacheMap.clear();
+}
+
+uint32_t IOPlayer::warmCache()
+{
+  int64_t maxSize = g_config.getNumber(ConfigManager::PLAYER_CACHE_SIZE);
+  if(maxSize <= 0)
+    return 0;
+
+  DatabaseDriver* db = DatabaseDriver::instance();
+  DBQuery query;
+  DBResult_ptr result;
+
+  getCacheQuery(query);
+  query << " ORDER BY `players`.`lastlogin` DESC LIMIT " << maxSize;
+
+  std::vector<PlayerCacheEntry> entries;
+  for(result = db->storeQuery(query); result; result = result->advance()){
+    PlayerCacheEntry entry;
+    entry.guid = result->getDataInt("id");
+    entry.name = result->getDataString("name");
+    entry.accountId = result->getDataInt("account_id");
+    entry.accountName = result->getDataString("accname");
+    entry.groupFlags = result->getDataLong("flags");
+    entries.push_back(entry);
+  }
+
+  // Added least recent first, so those are evicted first
+  for(std::vector<PlayerCacheEntry>::reverse_iterator it = entries.rbegin(); it != entries.rend(); ++it){
+    addCacheEntry(*it);
+  }
+
+  return entries.size();
+}
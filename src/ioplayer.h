@@ -24,6 +24,7 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <set>
 #include <string>
 #include <stdint.h>
 #include <boost/algorithm/string/predicate.hpp>
@@ -33,6 +34,9 @@
 class Item;
 class Player;
 class Creature;
+class SaveRecord;
+class PropStream;
+class PropWriteStream;
 struct DeathEntry;
 
 typedef std::vector<DeathEntry> DeathList;
@@ -49,6 +53,8 @@ typedef std::list<itemBlock> ItemBlockList;
 /** Class responsible for loading players from database. */
 class IOPlayer {
 public:
+  IOPlayer() : cacheHits(0), cacheMisses(0) {}
+
   static IOPlayer* instance();
 
   /** Load a player
@@ -65,6 +71,13 @@ public:
     */
   bool savePlayer(Player* player, bool shallow = false);
 
+  /** Render a player save without touching the database
+    * \param player the player to save
+    * \param record receives the statements storing the player
+    * \return true if the record was built successfully
+    */
+  bool prepareSavePlayer(Player* player, bool shallow, SaveRecord& record);
+
   bool addPlayerDeath(Player* dying_player, const DeathList& dl);
   int32_t getPlayerUnjustKillCount(const Player* player, UnjustKillPeriod_t period);
   bool sendMail(Creature* actor, const std::string name, uint32_t depotId, Item* item);
@@ -85,6 +98,18 @@ public:
   bool isPlayerOnlineByAccount(uint32_t acc);
   bool cleanOnlineInfo();
 
+  /** Fills the lookup cache with the most recently active players
+    * \return the number of cached players
+    */
+  uint32_t warmCache();
+
+  // Players are renamed, deleted and namelocked outside of the server, the
+  // cache only notices when a login by name fails or on /reload players
+  void invalidateCache(const std::string& name);
+  void clearCache();
+
+  void getCacheStats(uint64_t& hits, uint64_t& misses) const {hits = cacheHits; misses = cacheMisses;}
+
 protected:
   bool storeNameByGuid(DatabaseDriver &mysql, uint32_t guid);
 
@@ -101,8 +126,50 @@ protected:
   void loadItems(ItemMap& itemMap, DBResult* result);
   bool saveItems(Player* player, const ItemBlockList& itemList, DBInsert& query_insert);
 
-  typedef std::map<uint32_t, std::string> NameCacheMap;
-  typedef std::map<std::string, uint32_t, StringCompareCase> GuidCacheMap;
+  void setSkill(Player* player, SkillType skill, uint32_t skillLevel, uint32_t skillCount);
+
+  // Binary record holding the skills, storage, inventory and depots of a player
+  bool loadRecord(Player* player, PropStream& propStream);
+  void saveRecord(Player* player, PropWriteStream& stream);
+  Item* loadItem(PropStream& propStream);
+  void saveItem(PropWriteStream& stream, const Item* item);
+
+#ifdef __USE_LOCAL_STORAGE__
+  std::string getLocalRecordKey(uint32_t guid);
+
+  // Players whose `save` flag is off, the local storage has no guard query
+  std::set<uint32_t> unsavedPlayers;
+#endif
+
+  // Cached result of the name, guid and account lookups of a player.
+  // Misses are not cached, so newly created players are found right away.
+  struct PlayerCacheEntry{
+    uint32_t guid;
+    std::string name;
+    uint32_t accountId;
+    std::string accountName;
+    uint64_t groupFlags;
+    int64_t expireTime;
+  };
+
+  typedef std::list<PlayerCacheEntry> PlayerCacheList;
+  typedef std::map<uint32_t, PlayerCacheList::iterator> NameCacheMap;
+  typedef std::map<std::string, PlayerCacheList::iterator, StringCompareCase> GuidCacheMap;
+
+  struct GuildCacheEntry{
+    uint32_t guildId;
+    int64_t expireTime;
+  };
+
+  typedef std::map<std::string, GuildCacheEntry, StringCompareCase> GuildCacheMap;
+
+  const PlayerCacheEntry* getCacheEntry(uint32_t guid);
+  const PlayerCacheEntry* getCacheEntry(const std::string& name);
+  const PlayerCacheEntry* useCacheEntry(PlayerCacheList::iterator it);
+  const PlayerCacheEntry* loadCacheEntry(DBQuery& query);
+  void getCacheQuery(DBQuery& query);
+  void addCacheEntry(PlayerCacheEntry& entry);
+  void eraseCacheEntry(PlayerCacheList::iterator it);
 
   struct UnjustKillBlock{
     uint32_t dayUnjustCount;
@@ -135,8 +202,14 @@ protected:
 
   typedef std::map<uint32_t, UnjustKillBlock > UnjustCacheMap;
 
+  // Most recently used players come first
+  PlayerCacheList playerCacheList;
   NameCacheMap nameCacheMap;
   GuidCacheMap guidCacheMap;
+  GuildCacheMap guildCacheMap;
+
+  uint64_t cacheHits;
+  uint64_t cacheMisses;
   UnjustCacheMap unjustKillCacheMap;
 };
 
@@ -28,10 +28,21 @@
 #include "depot.h"
 #include "teleport.h"
 #include "trashholder.h"
+#include "game.h"
 #include <iomanip>
 
+extern Game g_game;
+
 Items Item::items;
 
+namespace {
+  // Indexed by item id, each shared item keeps a reference from the table
+  std::vector<Item*> shared_items;
+  uint32_t shared_item_count = 0;
+}
+
+OBJECT_POOL_DEFINE(Item)
+
 Item* Item::CreateItem(const uint16_t _type, uint16_t _count /*= 0*/)
 {
   Item* newItem = NULL;
@@ -150,6 +161,70 @@ bool Item::loadContainer(xmlNodePtr parentNode, Container* parent)
   return true;
 }
 
+Item* Item::getSharedItem(Item* item)
+{
+  const ItemType& it = items[item->getID()];
+
+  // Only plain items, anything with a subclass, a subtype or a decay may
+  // change without being taken from its tile first
+  if(!it.isGroundTile() || it.isDepot() || it.isContainer() || it.isTeleport() ||
+    it.isMagicField() || it.isDoor() || it.isTrashHolder() || it.isBed() ||
+    it.stackable || it.isFluidContainer() || it.isSplash() || it.charges != 0 ||
+    (it.decayTo != -1 && it.decayTime != 0)){
+    return item;
+  }
+
+  if(item->hasAttributes() || item->isMoveable() || item->getParent() != NULL){
+    return item;
+  }
+
+  if(shared_items.size() <= item->getID()){
+    shared_items.resize(item->getID() + 1, NULL);
+  }
+
+  Item*& shared = shared_items[item->getID()];
+  if(shared == NULL){
+    // The first one loaded becomes the shared item
+    shared = item;
+    shared->addRef();
+    ++shared_item_count;
+    return item;
+  }
+
+  shared->addRef();
+  item->unRef();
+  return shared;
+}
+
+void Item::releaseSharedItem(Item* item)
+{
+  // The table keeps its own reference until the last tile lets go, so the
+  // slot can never point at a freed item
+  if(item->getRefCount() <= 2){
+    shared_items[item->getID()] = NULL;
+    --shared_item_count;
+    item->unRef();
+  }
+  item->unRef();
+}
+
+uint32_t Item::getSharedItemCount()
+{
+  return shared_item_count;
+}
+
+bool Item::isShared() const
+{
+  return id < shared_items.size() && shared_items[id] == this;
+}
+
+void Item::setParent(Cylinder* cylinder)
+{
+  if(!isShared()){
+    Thing::setParent(cylinder);
+  }
+}
+
 Item::Item(const uint16_t _type, uint16_t _count /*= 0*/) :
   ItemAttributes()
 {
@@ -190,9 +265,13 @@ Item::Item(const Item &i) :
 Item* Item::clone() const
 {
   Item* _item = Item::CreateItem(id, count);
-  if(attributes){
-    _item->attributes = new AttributeMap();
-    *_item->attributes = *attributes;
+  if(hasAttributes()){
+    ItemAttributes& copy = *_item;
+    copy = *this;
+
+    if(getDecaying() == DECAYING_TRUE){
+      _item->setDuration(getDuration());
+    }
   }
 
   return _item;
@@ -200,19 +279,31 @@ Item* Item::clone() const
 
 void Item::copyAttributes(Item* item)
 {
-  if(item->attributes){
-    attributes = new AttributeMap();
-    *attributes = *item->attributes;
+  if(item->hasAttributes()){
+    ItemAttributes::operator=(*item);
   }
 
-  eraseAttribute("decaying");
-  eraseAttribute("duration");
+  eraseAttribute(ATTRKEY_DECAYING);
+  eraseAttribute(ATTRKEY_DURATION);
 }
 
 Item::~Item()
 {
 }
 
+int32_t Item::getDuration() const
+{
+  // The attribute of a decaying item is only written when it stops decaying
+  int32_t remaining;
+  if(g_game.getDecayRemaining(this, remaining))
+    return remaining;
+
+  const int32_t* duration = getIntegerAttribute(ATTRKEY_DURATION);
+  if(duration)
+    return *duration;
+  return 0;
+}
+
 void Item::setDefaultSubtype()
 {
   const ItemType& it = items[id];
@@ -241,13 +332,13 @@ void Item::setID(uint16_t newid)
   uint32_t newDuration = it.decayTime * 1000;
 
   if(newDuration == 0 && !it.stopTime && it.decayTo == -1){
-    eraseAttribute("decaying");
-    eraseAttribute("duration");
+    eraseAttribute(ATTRKEY_DECAYING);
+    eraseAttribute(ATTRKEY_DURATION);
   }
 
   eraseAttribute("corpseowner");
 
-  if(newDuration > 0 && (!prevIt.stopTime || getIntegerAttribute("duration") == NULL) ){
+  if(newDuration > 0 && (!prevIt.stopTime || getIntegerAttribute(ATTRKEY_DURATION) == NULL) ){
     setDecaying(DECAYING_FALSE);
     setDuration(newDuration);
   }
@@ -261,7 +352,7 @@ void Item::setID(uint16_t newid)
 
 void Item::setActionId(int32_t n)
 {
-  setAttribute("aid", n);
+  setAttribute(ATTRKEY_ACTION_ID, n);
 
   if(getParent()){
     if(Tile* tile = getParent()->getTile()){
@@ -360,7 +451,7 @@ Attr_ReadValue Item::readAttr(AttrTypes_t attr, PropStream& propStream)
         return ATTR_READ_ERROR;
       }
 
-      setAttribute("uid", (int32_t)_uniqueid);
+      setAttribute(ATTRKEY_UNIQUE_ID, (int32_t)_uniqueid);
       break;
     }
 
@@ -572,7 +663,7 @@ bool Item::serializeAttr(PropWriteStream& propWriteStream) const
     propWriteStream.ADD_UCHAR(_count);
   }
 
-  if(attributes && attributes->size()){
+  if(hasAttributes()){
     propWriteStream.ADD_UCHAR(ATTR_ATTRIBUTE_MAP);
     serializeAttributeMap(propWriteStream);
   }
@@ -582,97 +673,7 @@ bool Item::serializeAttr(PropWriteStream& propWriteStream) const
 
 bool Item::hasProperty(uint32_t props) const
 {
-  const ItemType& it = items[id];
-
-  if(hasBitSet(ITEMPROP_BLOCKSOLID, props) && !it.blockSolid){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_BLOCKPATHFIND, props) && !it.blockPathFind){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_BLOCKPROJECTILE, props) && !it.blockProjectile){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_ALLOWPICKUPABLE, props) && !it.allowPickupable){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_HASHEIGHT, props) && !it.hasHeight){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_ISVERTICAL, props) && !it.isVertical){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_ISHORIZONTAL, props) && !it.isHorizontal){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_LOOKTHROUGH, props) && !it.lookThrough){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_PICKUPABLE, props) && !it.pickupable){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_ROTATEABLE, props) && !it.rotateable){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_STACKABLE, props) && !it.stackable){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_USEABLE, props) && !it.useable){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_MOVEABLE, props) && !it.moveable){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_ALWAYSONTOP, props) && !it.alwaysOnTop){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_CANREADTEXT, props) && !it.canReadText){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_CANWRITETEXT, props) && !it.canWriteText){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_FLOORCHANGEDOWN, props) && !it.floorChangeDown){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_FLOORCHANGENORTH, props) && !it.floorChangeNorth){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_FLOORCHANGESOUTH, props) && !it.floorChangeSouth){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_FLOORCHANGEEAST, props) && !it.floorChangeEast){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_FLOORCHANGEWEST, props) && !it.floorChangeWest){
-    return false;
-  }
-
-  if(hasBitSet(ITEMPROP_ALLOWDISTREAD, props) && !it.allowDistRead){
-    return false;
-  }
-
-  return true;
+  return items.getHot(id).hasProperty(props);
 }
 
 double Item::getWeight() const
@@ -888,7 +889,7 @@ std::string Item::getDescription(const ItemType& it, int32_t lookDistance,
     }
   }
   else if(it.showDuration){
-    if(item && item->hasIntegerAttribute("duration")){
+    if(item && item->getIntegerAttribute(ATTRKEY_DURATION)){
       int32_t duration = item->getDuration() / 1000;
       s << " that has energy for ";
 
@@ -1009,7 +1010,7 @@ bool Item::canDecay()
     return false;
   }
 
-  const bool* candecay = getBooleanAttribute("canDecay");
+  const bool* candecay = getBooleanAttribute(ATTRKEY_CAN_DECAY);
 
   if(candecay && *candecay == false){
     return false;
@@ -23,6 +23,8 @@
 #include "thing.h"
 #include "items.h"
 #include "item_attributes.h"
+#include "object_pool.h"
+#include "decay.h"
 
 enum ItemDecayState_t{
   DECAYING_FALSE = 0,
@@ -30,33 +32,6 @@ enum ItemDecayState_t{
   DECAYING_PENDING
 };
 
-enum ItemProp{
-  ITEMPROP_BLOCKSOLID      = 1 << 0,
-  ITEMPROP_BLOCKPATHFIND    = 1 << 1,
-  ITEMPROP_BLOCKPROJECTILE  = 1 << 2,
-  ITEMPROP_ALLOWPICKUPABLE  = 1 << 3,
-  ITEMPROP_HASHEIGHT      = 1 << 4,
-  ITEMPROP_ISVERTICAL      = 1 << 5,
-  ITEMPROP_ISHORIZONTAL    = 1 << 6,
-  ITEMPROP_ISHANGEABLE    = 1 << 7,
-  ITEMPROP_CLIENTCHARGES    = 1 << 8,
-  ITEMPROP_LOOKTHROUGH    = 1 << 9,
-  ITEMPROP_PICKUPABLE      = 1 << 10,
-  ITEMPROP_ROTATEABLE      = 1 << 11,
-  ITEMPROP_STACKABLE      = 1 << 12,
-  ITEMPROP_USEABLE      = 1 << 13,
-  ITEMPROP_MOVEABLE      = 1 << 14,
-  ITEMPROP_ALWAYSONTOP    = 1 << 15,
-  ITEMPROP_CANREADTEXT    = 1 << 16,
-  ITEMPROP_CANWRITETEXT    = 1 << 17,
-  ITEMPROP_FLOORCHANGEDOWN  = 1 << 18,
-  ITEMPROP_FLOORCHANGENORTH  = 1 << 19,
-  ITEMPROP_FLOORCHANGESOUTH  = 1 << 20,
-  ITEMPROP_FLOORCHANGEEAST  = 1 << 21,
-  ITEMPROP_FLOORCHANGEWEST  = 1 << 22,
-  ITEMPROP_ALLOWDISTREAD    = 1 << 23
-};
-
 /*from iomapotbm.h*/
 #pragma pack(1)
 struct TeleportDest{
@@ -98,13 +73,17 @@ enum AttrTypes_t{
   ATTR_ATTRIBUTE_MAP = 128
 };
 
+// Version of what serializeAttr writes, files that keep serialized items
+// without their sources (the world image) are rebuilt when it changes
+const uint32_t ITEM_ATTRIBUTE_LAYOUT = 1;
+
 enum Attr_ReadValue{
   ATTR_READ_CONTINUE,
   ATTR_READ_ERROR,
   ATTR_READ_END
 };
 
-class Item : virtual public Thing, public ItemAttributes
+class Item : virtual public Thing, public ItemAttributes, public DecayHook
 {
 public:
   //Factory member to create item of right type based on type
@@ -113,9 +92,23 @@ public:
     return CreateItem(_type, (_fluid == FLUID_NONE? -1 : _fluid.value()));
   }
   static Item* CreateItem(PropStream& propStream);
+
+  // Items, containers and magic fields come from slab pools, the other
+  // item classes are rare enough for the global allocator
+  OBJECT_POOL_DECLARE();
   static bool loadItem(xmlNodePtr node, Container* parent);
   static bool loadContainer(xmlNodePtr node, Container* parent);
 
+  // Ground items that never change on their own are shared by all the tiles
+  // with the same ground. Returns the shared item, releasing the given one,
+  // or the given item if it can't be shared. Tile::getGround gives a tile an
+  // item of its own before anything else gets hold of it.
+  static Item* getSharedItem(Item* item);
+  // Drops the reference of a tile that no longer uses the shared item
+  static void releaseSharedItem(Item* item);
+  static uint32_t getSharedItemCount();
+  bool isShared() const;
+
   static Items items;
 
   // Constructor for items
@@ -126,6 +119,9 @@ public:
 
   virtual ~Item();
 
+  // A shared item has no parent, it is on many tiles at once
+  virtual void setParent(Cylinder* cylinder);
+
   virtual Item* getItem() {return this;}
   virtual const Item* getItem() const {return this;}
   virtual Container* getContainer() {return NULL;}
@@ -249,34 +245,34 @@ public:
   bool hasProperty(uint32_t props) const;
 
   // "const" properties
-  ItemTypes_t getType() const {return items[id].type;}
-  bool blockSolid() const {return items[id].blockSolid;}
-  bool blockPathFind() const {return items[id].blockPathFind;}
-  bool blockProjectile() const {return items[id].blockProjectile;}
-  bool isStackable() const {return items[id].stackable;}
-  bool isRune() const {return items[id].isRune();}
-  bool isFluidContainer() const {return (items[id].isFluidContainer());}
-  bool isAlwaysOnTop() const {return items[id].alwaysOnTop;}
-  bool isGroundTile() const {return items[id].isGroundTile();}
-  bool isSplash() const {return items[id].isSplash();}
-  bool isMagicField() const {return items[id].isMagicField();}
+  ItemTypes_t getType() const {return (ItemTypes_t)items.getHot(id).type;}
+  bool blockSolid() const {return items.getHot(id).hasProperty(ITEMPROP_BLOCKSOLID);}
+  bool blockPathFind() const {return items.getHot(id).hasProperty(ITEMPROP_BLOCKPATHFIND);}
+  bool blockProjectile() const {return items.getHot(id).hasProperty(ITEMPROP_BLOCKPROJECTILE);}
+  bool isStackable() const {return items.getHot(id).hasProperty(ITEMPROP_STACKABLE);}
+  bool isRune() const {return items.getHot(id).type == ITEM_TYPE_RUNE;}
+  bool isFluidContainer() const {return items.getHot(id).group == ITEM_GROUP_FLUID;}
+  bool isAlwaysOnTop() const {return items.getHot(id).hasProperty(ITEMPROP_ALWAYSONTOP);}
+  bool isGroundTile() const {return items.getHot(id).group == ITEM_GROUP_GROUND;}
+  bool isSplash() const {return items.getHot(id).group == ITEM_GROUP_SPLASH;}
+  bool isMagicField() const {return items.getHot(id).type == ITEM_TYPE_MAGICFIELD;}
   bool isMoveable() const;
-  bool isPickupable() const {return items[id].pickupable;}
+  bool isPickupable() const {return items.getHot(id).hasProperty(ITEMPROP_PICKUPABLE);}
   bool isWeapon() const {return (items[id].weaponType != WEAPON_NONE);}
-  bool isUseable() const {return items[id].useable;}
-  bool isHangable() const {return items[id].isHangable;}
+  bool isUseable() const {return items.getHot(id).hasProperty(ITEMPROP_USEABLE);}
+  bool isHangable() const {return items.getHot(id).hasProperty(ITEMPROP_ISHANGEABLE);}
   bool isRotateable() const {const ItemType& it = items[id]; return it.rotateable && it.rotateTo;}
-  bool isDoor() const {return items[id].isDoor();}
-  bool isBed() const {return items[id].isBed();}
+  bool isDoor() const {return items.getHot(id).type == ITEM_TYPE_DOOR;}
+  bool isBed() const {return items.getHot(id).type == ITEM_TYPE_BED;}
   bool hasCharges() const {return getCharges() > 0;}
-  bool hasHeight() const {return items[id].hasHeight;}
-  bool floorChangeDown() const {return items[id].floorChangeDown;}
-  bool floorChangeNorth() const {return items[id].floorChangeNorth;}
-  bool floorChangeSouth() const {return items[id].floorChangeSouth;}
-  bool floorChangeEast() const {return items[id].floorChangeEast;}
-  bool floorChangeWest() const {return items[id].floorChangeWest;}
-
-  int32_t getTopOrder() const {return items[id].alwaysOnTopOrder;}
+  bool hasHeight() const {return items.getHot(id).hasProperty(ITEMPROP_HASHEIGHT);}
+  bool floorChangeDown() const {return items.getHot(id).hasProperty(ITEMPROP_FLOORCHANGEDOWN);}
+  bool floorChangeNorth() const {return items.getHot(id).hasProperty(ITEMPROP_FLOORCHANGENORTH);}
+  bool floorChangeSouth() const {return items.getHot(id).hasProperty(ITEMPROP_FLOORCHANGESOUTH);}
+  bool floorChangeEast() const {return items.getHot(id).hasProperty(ITEMPROP_FLOORCHANGEEAST);}
+  bool floorChangeWest() const {return items.getHot(id).hasProperty(ITEMPROP_FLOORCHANGEWEST);}
+
+  int32_t getTopOrder() const {return items.getHot(id).alwaysOnTopOrder;}
   SlotPosition getSlotPosition() const {return items[id].slotPosition;}
   SlotType getWieldPosition() const {return items[id].wieldPosition;}
   bool isReadable() const {return items[id].canReadText;}
@@ -312,205 +308,198 @@ inline uint32_t Item::countByType(const Item* i, int32_t subType){
 }
 
 inline int Item::getAttack() const {
-  const int32_t* attack = getIntegerAttribute("attack");
+  const int32_t* attack = getIntegerAttribute(ATTRKEY_ATTACK);
   if(attack)
     return (int)(*attack);
   return items[id].attack;
 }
 
 inline int Item::getArmor() const {
-  const int32_t* armor = getIntegerAttribute("armor");
+  const int32_t* armor = getIntegerAttribute(ATTRKEY_ARMOR);
   if(armor)
     return (int)(*armor);
   return items[id].armor;
 }
 
 inline int Item::getDefense() const {
-  const int32_t* defense = getIntegerAttribute("defense");
+  const int32_t* defense = getIntegerAttribute(ATTRKEY_DEFENSE);
   if(defense)
     return (int)(*defense);
   return items[id].defense;
 }
 
 inline int Item::getExtraDef() const {
-  const int32_t* extraDefense = getIntegerAttribute("extraDefense");
+  const int32_t* extraDefense = getIntegerAttribute(ATTRKEY_EXTRA_DEFENSE);
   if(extraDefense)
     return (int)(*extraDefense);
   return items[id].extraDefense;
 }
 
 inline int Item::getHitChance() const {
-  const int32_t* hitChance = getIntegerAttribute("hitChance");
+  const int32_t* hitChance = getIntegerAttribute(ATTRKEY_HIT_CHANCE);
   if(hitChance)
     return (int)(*hitChance);
   return items[id].hitChance;
 }
 
 inline const std::string& Item::getName() const {
-  const std::string* name = getStringAttribute("name");
+  const std::string* name = getStringAttribute(ATTRKEY_NAME);
   if(name)
     return *name;
   return items[id].name;
 }
 
 inline const std::string& Item::getPluralName() const {
-  const std::string* pluralname = getStringAttribute("pluralName");
+  const std::string* pluralname = getStringAttribute(ATTRKEY_PLURAL_NAME);
   if(pluralname)
     return *pluralname;
   return items[id].pluralName;
 }
 
 inline const std::string& Item::getArticle() const {
-  const std::string* article = getStringAttribute("article");
+  const std::string* article = getStringAttribute(ATTRKEY_ARTICLE);
   if(article)
     return *article;
   return items[id].article;
 }
 
 inline void Item::setSpecialDescription(const std::string& desc) {
-  setAttribute("desc", desc);
+  setAttribute(ATTRKEY_DESCRIPTION, desc);
 }
 
 inline void Item::clearSpecialDescription() {
-  eraseAttribute("desc");
+  eraseAttribute(ATTRKEY_DESCRIPTION);
 }
 
 inline std::string Item::getSpecialDescription() const {
-  const std::string* desc = getStringAttribute("desc");
+  const std::string* desc = getStringAttribute(ATTRKEY_DESCRIPTION);
   if(desc)
     return *desc;
   return "";
 }
 
 inline void Item::setText(const std::string& text) {
-  setAttribute("text", text);
+  setAttribute(ATTRKEY_TEXT, text);
 }
 
 inline void Item::clearText() {
-  eraseAttribute("text");
+  eraseAttribute(ATTRKEY_TEXT);
 }
 
 inline std::string Item::getText() const {
-  const std::string* text = getStringAttribute("text");
+  const std::string* text = getStringAttribute(ATTRKEY_TEXT);
   if(text)
     return *text;
   return "";
 }
 
 inline void Item::setWrittenDate(time_t n) {
-  setAttribute("writtenDate", (int32_t)n);
+  setAttribute(ATTRKEY_WRITTEN_DATE, (int32_t)n);
 }
 
 inline void Item::clearWrittenDate() {
-  eraseAttribute("writtenDate");
+  eraseAttribute(ATTRKEY_WRITTEN_DATE);
 }
 
 inline time_t Item::getWrittenDate() const {
-  const int32_t* date = getIntegerAttribute("writtenDate");
+  const int32_t* date = getIntegerAttribute(ATTRKEY_WRITTEN_DATE);
   if(date)
     return (time_t)*date;
   return 0;
 }
 
 inline void Item::setWriter(std::string _writer) {
-  setAttribute("writer", _writer);
+  setAttribute(ATTRKEY_WRITER, _writer);
 }
 
 inline void Item::clearWriter() {
-  eraseAttribute("writer");
+  eraseAttribute(ATTRKEY_WRITER);
 }
 
 inline std::string Item::getWriter() const {
-  const std::string* writer = getStringAttribute("writer");
+  const std::string* writer = getStringAttribute(ATTRKEY_WRITER);
   if(writer)
     return *writer;
   return "";
 }
 
 inline int32_t Item::getActionId() const {
-  const int32_t* aid = getIntegerAttribute("aid");
+  const int32_t* aid = getIntegerAttribute(ATTRKEY_ACTION_ID);
   if(aid)
     return *aid;
   return 0;
 }
 
 inline bool Item::isMoveable() const {
-  if (!items[id].moveable)
+  if (!items.getHot(id).hasProperty(ITEMPROP_MOVEABLE))
     return false;
-  const bool* m = getBooleanAttribute("moveable");
+  const bool* m = getBooleanAttribute(ATTRKEY_MOVEABLE);
   if (m != NULL)
     return *m;
   return true;
 }
 
 inline void Item::setCharges(uint16_t n) {
-  setAttribute("charges", (int32_t)n);
+  setAttribute(ATTRKEY_CHARGES, (int32_t)n);
 }
 
 inline uint16_t Item::getCharges() const {
-  const int32_t* charges = getIntegerAttribute("charges");
+  const int32_t* charges = getIntegerAttribute(ATTRKEY_CHARGES);
   if(charges && *charges >= 0)
     return (uint16_t)*charges;
   return 0;
 }
 
 inline void Item::setFluidType(uint16_t n) {
-  setAttribute("fluidType", (int32_t)n);
+  setAttribute(ATTRKEY_FLUID_TYPE, (int32_t)n);
 }
 
 inline uint16_t Item::getFluidType() const {
-  const int32_t* fluidtype = getIntegerAttribute("fluidType");
+  const int32_t* fluidtype = getIntegerAttribute(ATTRKEY_FLUID_TYPE);
   if(fluidtype && *fluidtype >= 0)
     return (uint16_t)*fluidtype;
   return 0;
 }
 
 inline void Item::setOwner(uint32_t _owner) {
-  setAttribute("owner", (int32_t)_owner);
+  setAttribute(ATTRKEY_OWNER, (int32_t)_owner);
 }
 
 inline uint32_t Item::getOwner() const {
-  const int32_t* owner = getIntegerAttribute("owner");
+  const int32_t* owner = getIntegerAttribute(ATTRKEY_OWNER);
   if(owner)
     return (uint32_t)*owner;
   return 0;
 }
 
 inline void Item::setCorpseOwner(uint32_t _corpseOwner) {
-  setAttribute("corpseOwner", (int32_t)_corpseOwner);
+  setAttribute(ATTRKEY_CORPSE_OWNER, (int32_t)_corpseOwner);
 }
 
 inline uint32_t Item::getCorpseOwner() const {
-  const int32_t* owner = getIntegerAttribute("corpseOwner");
+  const int32_t* owner = getIntegerAttribute(ATTRKEY_CORPSE_OWNER);
   if(owner)
     return (uint32_t)*owner;
   return 0;
 }
 
 inline void Item::setDuration(int32_t time) {
-  setAttribute("duration", time);
+  setAttribute(ATTRKEY_DURATION, time);
 }
 
 inline void Item::decreaseDuration(int32_t time) {
-  const int32_t* duration = getIntegerAttribute("duration");
+  const int32_t* duration = getIntegerAttribute(ATTRKEY_DURATION);
   if(duration)
-    setAttribute("duration", *duration - time);
-}
-
-inline int32_t Item::getDuration() const {
-  const int32_t* duration = getIntegerAttribute("duration");
-  if(duration)
-    return *duration;
-  return 0;
+    setAttribute(ATTRKEY_DURATION, *duration - time);
 }
 
 
 inline void Item::setDecaying(ItemDecayState_t decayState) {
-  setAttribute("decayState", (int32_t)decayState);
+  setAttribute(ATTRKEY_DECAY_STATE, (int32_t)decayState);
 }
 
 inline ItemDecayState_t Item::getDecaying() const {
-  const int32_t* state = getIntegerAttribute("decayState");
+  const int32_t* state = getIntegerAttribute(ATTRKEY_DECAY_STATE);
   if(state)
     return (ItemDecayState_t)(*state);
   return DECAYING_FALSE;
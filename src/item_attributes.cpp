@@ -18,118 +18,429 @@
 
 #include "otpch.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
 #include "item_attributes.h"
 #include "fileloader.h"
 
+namespace {
+  // Same order as the ATTRKEY_ enum
+  const char* const known_keys[ATTRKEY_LAST] = {
+    "",
+    "aid",
+    "uid",
+    "charges",
+    "duration",
+    "decayState",
+    "decaying",
+    "text",
+    "writer",
+    "writtenDate",
+    "desc",
+    "name",
+    "pluralName",
+    "article",
+    "attack",
+    "armor",
+    "defense",
+    "extraDefense",
+    "hitChance",
+    "moveable",
+    "fluidType",
+    "owner",
+    "corpseOwner",
+    "doorid",
+    "canDecay"
+  };
+
+  // Names are only ever added. The lookups don't take the lock: a name is
+  // written before its ID is published, and published IDs never change.
+  struct KeyTable {
+    enum {
+      // Key IDs are 16 bits, ATTRKEY_NONE is not a name
+      MAX_NAMES = 0x10000,
+      CHUNK_SIZE = 0x100,
+      // Twice the number of names, so probing stays short
+      HASH_SIZE = MAX_NAMES * 2
+    };
+
+    KeyTable() : full(false), count(0) {
+      for(int i = 0; i < MAX_NAMES / CHUNK_SIZE; ++i)
+        chunks[i] = NULL;
+      for(int i = 0; i < HASH_SIZE; ++i)
+        slots[i].store(ATTRKEY_NONE, boost::memory_order_relaxed);
+
+      for(int i = 0; i < ATTRKEY_LAST; ++i)
+        add(known_keys[i]);
+    }
+
+    static uint32_t hash(const std::string& name) {
+      // FNV-1a
+      uint32_t h = 2166136261u;
+      for(std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+        h = (h ^ (uint8_t)*it) * 16777619u;
+      return h;
+    }
+
+    const std::string& getName(ItemAttributeKey key) const {
+      return chunks[key / CHUNK_SIZE][key % CHUNK_SIZE];
+    }
+
+    uint32_t size() const {
+      return count.load(boost::memory_order_acquire);
+    }
+
+    ItemAttributeKey find(const std::string& name) const {
+      for(uint32_t i = hash(name) % HASH_SIZE; ; i = (i + 1) % HASH_SIZE){
+        ItemAttributeKey key = slots[i].load(boost::memory_order_acquire);
+        if(key == ATTRKEY_NONE)
+          return ATTRKEY_NONE;
+        if(getName(key) == name)
+          return key;
+      }
+    }
+
+    // Called with the lock held, returns ATTRKEY_NONE when all IDs are used
+    ItemAttributeKey add(const std::string& name) {
+      uint32_t key = count.load(boost::memory_order_relaxed);
+      if(key >= MAX_NAMES)
+        return ATTRKEY_NONE;
+
+      std::string*& chunk = chunks[key / CHUNK_SIZE];
+      if(!chunk)
+        chunk = new std::string[CHUNK_SIZE];
+      chunk[key % CHUNK_SIZE] = name;
+      count.store(key + 1, boost::memory_order_release);
+
+      if(key != ATTRKEY_NONE){
+        uint32_t i = hash(name) % HASH_SIZE;
+        while(slots[i].load(boost::memory_order_relaxed) != ATTRKEY_NONE)
+          i = (i + 1) % HASH_SIZE;
+        slots[i].store((ItemAttributeKey)key, boost::memory_order_release);
+      }
+      return (ItemAttributeKey)key;
+    }
+
+    // Items may be loaded on several threads, this only guards adding names
+    boost::mutex lock;
+    bool full;
+    boost::atomic<uint32_t> count;
+    // Allocated as needed and kept, so names never move
+    std::string* chunks[MAX_NAMES / CHUNK_SIZE];
+    boost::atomic<ItemAttributeKey> slots[HASH_SIZE];
+  };
+
+  KeyTable& getKeyTable()
+  {
+    static KeyTable table;
+    return table;
+  }
+
+  // Items of different map areas are loaded at the same time
+  boost::atomic<uint64_t> allocated_bytes(0);
+  boost::atomic<uint32_t> block_count(0);
+
+  std::string* newString(const std::string& v)
+  {
+    std::string* str = new std::string(v);
+    allocated_bytes += sizeof(std::string) + str->capacity();
+    return str;
+  }
+
+  void deleteString(std::string* str)
+  {
+    allocated_bytes -= sizeof(std::string) + str->capacity();
+    delete str;
+  }
+}
+
+ItemAttributeKey ItemAttributeKeys::intern(const std::string& name)
+{
+  KeyTable& table = getKeyTable();
+  ItemAttributeKey key = table.find(name);
+  if(key != ATTRKEY_NONE)
+    return key;
+
+  boost::mutex::scoped_lock lock(table.lock);
+
+  // Someone else may have added it meanwhile
+  key = table.find(name);
+  if(key != ATTRKEY_NONE)
+    return key;
+
+  key = table.add(name);
+  if(key == ATTRKEY_NONE && !table.full){
+    table.full = true;
+    std::cout << "Warning: [ItemAttributeKeys::intern] No attribute IDs left for '" << name << "'" << std::endl;
+  }
+  return key;
+}
+
+ItemAttributeKey ItemAttributeKeys::find(const std::string& name)
+{
+  return getKeyTable().find(name);
+}
+
+const std::string& ItemAttributeKeys::getName(ItemAttributeKey key)
+{
+  const KeyTable& table = getKeyTable();
+  if(key >= table.size())
+    return table.getName(ATTRKEY_NONE);
+  return table.getName(key);
+}
+
 ItemAttributes::ItemAttributes() :
   attributes(NULL)
 {
 }
 
-ItemAttributes::ItemAttributes(const ItemAttributes& o)
+ItemAttributes::ItemAttributes(const ItemAttributes& o) :
+  attributes(NULL)
 {
-  if(o.attributes)
-    attributes = new AttributeMap(*o.attributes);
+  *this = o;
+}
+
+ItemAttributes& ItemAttributes::operator=(const ItemAttributes& o)
+{
+  if(&o == this)
+    return *this;
+
+  clearAttributes();
+  if(o.hasAttributes()){
+    uint32_t capacity = o.attributes->size;
+    attributes = (AttributeBlock*)malloc(sizeof(AttributeBlock) + capacity * sizeof(ItemAttribute));
+    if(!attributes)
+      throw std::bad_alloc();
+    attributes->size = 0;
+    attributes->capacity = capacity;
+
+    for(const ItemAttribute* attribute = o.attributes->begin(); attribute != o.attributes->end(); ++attribute){
+      new (attributes->end()) ItemAttribute(*attribute);
+      ++attributes->size;
+    }
+
+    allocated_bytes += sizeof(AttributeBlock) + capacity * sizeof(ItemAttribute);
+    ++block_count;
+  }
+  return *this;
 }
 
 ItemAttributes::~ItemAttributes()
 {
-  delete attributes;
+  clearAttributes();
+}
+
+uint64_t ItemAttributes::getAllocatedBytes()
+{
+  return allocated_bytes;
 }
 
-void ItemAttributes::createAttributes()
+uint32_t ItemAttributes::getBlockCount()
+{
+  return block_count;
+}
+
+void ItemAttributes::clearAttributes()
 {
   if(!attributes)
-    attributes = new AttributeMap;
+    return;
+
+  for(ItemAttribute* attribute = attributes->begin(); attribute != attributes->end(); ++attribute)
+    attribute->~ItemAttribute();
+
+  allocated_bytes -= sizeof(AttributeBlock) + attributes->capacity * sizeof(ItemAttribute);
+  --block_count;
+  free(attributes);
+  attributes = NULL;
 }
 
-void ItemAttributes::setAttribute(const std::string& key, const std::string& value)
+const ItemAttribute* ItemAttributes::findAttribute(ItemAttributeKey key) const
 {
-  createAttributes();
-  (*attributes)[key].set(value);
+  if(!attributes || key == ATTRKEY_NONE)
+    return NULL;
+
+  for(const ItemAttribute* attribute = attributes->begin(); attribute != attributes->end(); ++attribute){
+    if(attribute->getKey() == key)
+      return attribute;
+  }
+  return NULL;
 }
 
-void ItemAttributes::setAttribute(const std::string& key, int32_t value)
+ItemAttribute* ItemAttributes::getOrAddAttribute(ItemAttributeKey key)
 {
-  createAttributes();
-  (*attributes)[key].set(value);
+  if(key == ATTRKEY_NONE)
+    return NULL;
+
+  ItemAttribute* attribute = const_cast<ItemAttribute*>(findAttribute(key));
+  if(attribute)
+    return attribute;
+
+  uint32_t size = (attributes? attributes->size : 0);
+  if(!attributes || size == attributes->capacity){
+    // Most items only ever get one or two attributes
+    uint32_t capacity = std::max((uint32_t)1, size * 2);
+    AttributeBlock* block = (AttributeBlock*)malloc(sizeof(AttributeBlock) + capacity * sizeof(ItemAttribute));
+    if(!block)
+      throw std::bad_alloc();
+    block->size = size;
+    block->capacity = capacity;
+
+    if(attributes){
+      // An attribute only owns its string, so it can be moved bytewise
+      memcpy((void*)block->begin(), (const void*)attributes->begin(), size * sizeof(ItemAttribute));
+      allocated_bytes -= sizeof(AttributeBlock) + attributes->capacity * sizeof(ItemAttribute);
+      free(attributes);
+    }
+    else{
+      ++block_count;
+    }
+    allocated_bytes += sizeof(AttributeBlock) + capacity * sizeof(ItemAttribute);
+    attributes = block;
+  }
+
+  attribute = new (attributes->end()) ItemAttribute();
+  attribute->setKey(key);
+  ++attributes->size;
+  return attribute;
 }
 
-void ItemAttributes::setAttribute(const std::string& key, float value)
+bool ItemAttributes::setAttribute(const std::string& key, const std::string& value)
 {
-  createAttributes();
-  (*attributes)[key].set(value);
+  ItemAttributeKey attrKey = ItemAttributeKeys::intern(key);
+  if(attrKey == ATTRKEY_NONE)
+    return false;
+
+  setAttribute(attrKey, value);
+  return true;
 }
 
-void ItemAttributes::setAttribute(const std::string& key, bool value)
+bool ItemAttributes::setAttribute(const std::string& key, int32_t value)
 {
-  createAttributes();
-  (*attributes)[key].set(value);
+  ItemAttributeKey attrKey = ItemAttributeKeys::intern(key);
+  if(attrKey == ATTRKEY_NONE)
+    return false;
+
+  setAttribute(attrKey, value);
+  return true;
+}
+
+bool ItemAttributes::setAttribute(const std::string& key, float value)
+{
+  ItemAttribute* attribute = getOrAddAttribute(ItemAttributeKeys::intern(key));
+  if(!attribute)
+    return false;
+
+  attribute->set(value);
+  return true;
+}
+
+bool ItemAttributes::setAttribute(const std::string& key, bool value)
+{
+  ItemAttributeKey attrKey = ItemAttributeKeys::intern(key);
+  if(attrKey == ATTRKEY_NONE)
+    return false;
+
+  setAttribute(attrKey, value);
+  return true;
+}
+
+void ItemAttributes::setAttribute(ItemAttributeKey key, const std::string& value)
+{
+  ItemAttribute* attribute = getOrAddAttribute(key);
+  if(attribute)
+    attribute->set(value);
+}
+
+void ItemAttributes::setAttribute(ItemAttributeKey key, int32_t value)
+{
+  ItemAttribute* attribute = getOrAddAttribute(key);
+  if(attribute)
+    attribute->set(value);
+}
+
+void ItemAttributes::setAttribute(ItemAttributeKey key, bool value)
+{
+  ItemAttribute* attribute = getOrAddAttribute(key);
+  if(attribute)
+    attribute->set(value);
 }
 
 void ItemAttributes::eraseAttribute(const std::string& key)
 {
-  if(!attributes)
+  eraseAttribute(ItemAttributeKeys::find(key));
+}
+
+void ItemAttributes::eraseAttribute(ItemAttributeKey key)
+{
+  ItemAttribute* attribute = const_cast<ItemAttribute*>(findAttribute(key));
+  if(!attribute)
     return;
 
-  AttributeMap::iterator iter = attributes->find(key);
+  attribute->~ItemAttribute();
+  // Keep the order the attributes were set in
+  memmove((void*)attribute, (const void*)(attribute + 1), (attributes->end() - (attribute + 1)) * sizeof(ItemAttribute));
+  --attributes->size;
 
-  if(iter != attributes->end())
-    attributes->erase(iter);
+  if(attributes->size == 0)
+    clearAttributes();
 }
 
 const std::string* ItemAttributes::getStringAttribute(const std::string& key) const
 {
-  if(!attributes)
-    return NULL;
-
-  AttributeMap::iterator iter = attributes->find(key);
-  if(iter != attributes->end())
-    return iter->second.getString();
-  return NULL;
+  return getStringAttribute(ItemAttributeKeys::find(key));
 }
 
 const int32_t* ItemAttributes::getIntegerAttribute(const std::string& key) const
 {
-  if(!attributes)
-    return NULL;
+  return getIntegerAttribute(ItemAttributeKeys::find(key));
+}
 
-  AttributeMap::iterator iter = attributes->find(key);
-  if(iter != attributes->end())
-    return iter->second.getInteger();
+const float* ItemAttributes::getFloatAttribute(const std::string& key) const
+{
+  const ItemAttribute* attribute = findAttribute(ItemAttributeKeys::find(key));
+  if(attribute)
+    return attribute->getFloat();
   return NULL;
 }
 
-const float* ItemAttributes::getFloatAttribute(const std::string& key) const
+const bool* ItemAttributes::getBooleanAttribute(const std::string& key) const
 {
-  if(!attributes)
-    return NULL;
+  return getBooleanAttribute(ItemAttributeKeys::find(key));
+}
 
-  AttributeMap::iterator iter = attributes->find(key);
-  if(iter != attributes->end())
-    return iter->second.getFloat();
+const std::string* ItemAttributes::getStringAttribute(ItemAttributeKey key) const
+{
+  const ItemAttribute* attribute = findAttribute(key);
+  if(attribute)
+    return attribute->getString();
   return NULL;
 }
 
-const bool* ItemAttributes::getBooleanAttribute(const std::string& key) const
+const int32_t* ItemAttributes::getIntegerAttribute(ItemAttributeKey key) const
 {
-  if(!attributes)
-    return NULL;
+  const ItemAttribute* attribute = findAttribute(key);
+  if(attribute)
+    return attribute->getInteger();
+  return NULL;
+}
 
-  AttributeMap::iterator iter = attributes->find(key);
-  if(iter != attributes->end())
-    return iter->second.getBoolean();
+const bool* ItemAttributes::getBooleanAttribute(ItemAttributeKey key) const
+{
+  const ItemAttribute* attribute = findAttribute(key);
+  if(attribute)
+    return attribute->getBoolean();
   return NULL;
 }
 
 boost::any ItemAttributes::getAttribute(const std::string& key) const
 {
-  if(!attributes)
-    return boost::any();
-
-  AttributeMap::iterator iter = attributes->find(key);
-  if(iter != attributes->end())
-    return iter->second.get();
+  const ItemAttribute* attribute = findAttribute(ItemAttributeKeys::find(key));
+  if(attribute)
+    return attribute->get();
   return boost::any();
 }
 
@@ -157,32 +468,16 @@ bool ItemAttributes::hasBooleanAttribute(const std::string& key) const
 // can hold either int, bool or std::string
 // without using new to allocate them
 
-ItemAttribute::ItemAttribute() : m_type(ItemAttribute::NONE)
-{
-
-}
-
-ItemAttribute::ItemAttribute(const std::string& v) : m_type(ItemAttribute::STRING)
-{
-  m_var.string = new std::string(v);
-}
-
-ItemAttribute::ItemAttribute(int32_t v) : m_type(ItemAttribute::INTEGER)
+ItemAttribute::ItemAttribute() :
+  m_key(ATTRKEY_NONE),
+  m_type(ItemAttribute::NONE)
 {
-  m_var.signedInteger = v;
-}
 
-ItemAttribute::ItemAttribute(float v) : m_type(ItemAttribute::FLOAT)
-{
-  m_var.signedFloat = v;
-}
-
-ItemAttribute::ItemAttribute(bool v) : m_type(ItemAttribute::BOOLEAN)
-{
-  m_var.boolean = v;
 }
 
-ItemAttribute::ItemAttribute(const ItemAttribute& o) : m_type(ItemAttribute::NONE)
+ItemAttribute::ItemAttribute(const ItemAttribute& o) :
+  m_key(ATTRKEY_NONE),
+  m_type(ItemAttribute::NONE)
 {
   *this = o;
 }
@@ -192,8 +487,13 @@ ItemAttribute& ItemAttribute::operator=(const ItemAttribute& o)
   if(&o == this)
     return *this;
 
+  dealloc();
+  m_key = o.m_key;
   m_type = o.m_type;
-  m_var = o.m_var;
+  if(m_type == STRING)
+    m_var.string = newString(*o.m_var.string);
+  else
+    m_var = o.m_var;
 
   return *this;
 }
@@ -205,7 +505,8 @@ ItemAttribute::~ItemAttribute()
 
 void ItemAttribute::dealloc(){
   if(m_type == ItemAttribute::STRING)
-    delete m_var.string;
+    deleteString(m_var.string);
+  m_type = NONE;
 }
 
 void ItemAttribute::set(const std::string& v)
@@ -213,9 +514,8 @@ void ItemAttribute::set(const std::string& v)
   dealloc();
   
   m_type = STRING;
-  m_var.string = new std::string(v);
+  m_var.string = newString(v);
 }
-
 void ItemAttribute::set(int32_t v)
 {
   dealloc();
@@ -291,17 +591,27 @@ bool ItemAttributes::unserializeAttributeMap(PropStream& stream)
 
   uint16_t n;
   if(stream.GET_USHORT(n)){
-    createAttributes();
-
     std::string key;
-    ItemAttribute attrib;
 
     while(n--){
       if(!stream.GET_STRING(key))
         return false;
-      if(!attrib.unserialize(stream))
-        return false;
-      (*attributes)[key] = attrib;
+
+      ItemAttributeKey attrKey = ItemAttributeKeys::intern(key);
+      ItemAttribute* attribute = getOrAddAttribute(attrKey);
+      if(attribute){
+        if(!attribute->unserialize(stream)){
+          // Don't leave an attribute without a value behind
+          eraseAttribute(attrKey);
+          return false;
+        }
+      }
+      else{
+        // Out of key IDs, the value still has to be read
+        ItemAttribute skipped;
+        if(!skipped.unserialize(stream))
+          return false;
+      }
     }
   }
   return true;
@@ -310,19 +620,12 @@ bool ItemAttributes::unserializeAttributeMap(PropStream& stream)
 void ItemAttributes::serializeAttributeMap(PropWriteStream& stream) const
 {
   // maximum of 65535 attributes per item
-  stream.ADD_USHORT(std::min((size_t)0xFFFF, attributes->size()));
-
-  AttributeMap::const_iterator attribute = attributes->begin();
-  int i = 0;
-  while(attribute != attributes->end() && i <= 0xFFFF){
-    const std::string& key = attribute->first;
-    if(key.size() > 0xFFFF)
-      stream.ADD_STRING(key.substr(0, 65535));
-    else
-      stream.ADD_STRING(key);
-
-    attribute->second.serialize(stream);
-    ++attribute, ++i;
+  uint32_t count = (attributes? std::min((uint32_t)0xFFFF, attributes->size) : 0);
+  stream.ADD_USHORT(count);
+
+  for(const ItemAttribute* attribute = (count? attributes->begin() : NULL); count > 0; ++attribute, --count){
+    stream.ADD_STRING(ItemAttributeKeys::getName(attribute->getKey()));
+    attribute->serialize(stream);
   }
 }
 
@@ -332,17 +635,20 @@ bool ItemAttribute::unserialize(PropStream& stream)
   dealloc();
   
   // read type
-  stream.GET_UCHAR(reinterpret_cast<uint8_t&>(m_type));
+  stream.GET_UCHAR(m_type);
   
   // do not call here set(...) or any other function depending on m_type which may result in deallocating phantom string !
 
   // read contents
   switch(m_type){
     case STRING: {
-      m_var.string = new std::string;   
-      if(!stream.GET_LSTRING(*m_var.string))
+      std::string value;
+      if(!stream.GET_LSTRING(value)){
+        m_type = NONE;
         return false;
-      
+      }
+
+      m_var.string = newString(value);
       break;
     }
     
@@ -373,7 +679,7 @@ bool ItemAttribute::unserialize(PropStream& stream)
 void ItemAttribute::serialize(PropWriteStream& stream) const
 {
   // write type
-  stream.ADD_UCHAR(static_cast<uint8_t>(m_type));
+  stream.ADD_UCHAR(m_type);
 
   // write contents
   switch(m_type){
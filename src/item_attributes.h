@@ -22,29 +22,73 @@
 
 #include "definitions.h"
 #include <string>
-#include <map>
 #include <boost/any.hpp>
 
 class PropWriteStream;
 class PropStream;
 
+// Attribute names are interned, items only store the ID of the name
+typedef uint16_t ItemAttributeKey;
+
+// Names used by the server itself, they have fixed IDs so the accessors
+// don't look up the name
+enum {
+  ATTRKEY_NONE = 0,
+  ATTRKEY_ACTION_ID,
+  ATTRKEY_UNIQUE_ID,
+  ATTRKEY_CHARGES,
+  ATTRKEY_DURATION,
+  ATTRKEY_DECAY_STATE,
+  ATTRKEY_DECAYING,
+  ATTRKEY_TEXT,
+  ATTRKEY_WRITER,
+  ATTRKEY_WRITTEN_DATE,
+  ATTRKEY_DESCRIPTION,
+  ATTRKEY_NAME,
+  ATTRKEY_PLURAL_NAME,
+  ATTRKEY_ARTICLE,
+  ATTRKEY_ATTACK,
+  ATTRKEY_ARMOR,
+  ATTRKEY_DEFENSE,
+  ATTRKEY_EXTRA_DEFENSE,
+  ATTRKEY_HIT_CHANCE,
+  ATTRKEY_MOVEABLE,
+  ATTRKEY_FLUID_TYPE,
+  ATTRKEY_OWNER,
+  ATTRKEY_CORPSE_OWNER,
+  ATTRKEY_DOOR_ID,
+  ATTRKEY_CAN_DECAY,
+  ATTRKEY_LAST
+};
+
+class ItemAttributeKeys
+{
+public:
+  // Returns the ID of the name, it is added if it is new.
+  // ATTRKEY_NONE if there are no IDs left.
+  static ItemAttributeKey intern(const std::string& name);
+  // ATTRKEY_NONE if no attribute ever had that name
+  static ItemAttributeKey find(const std::string& name);
+  static const std::string& getName(ItemAttributeKey key);
+};
+
+// A name and a value of one of the types below, strings are allocated
 class ItemAttribute
 {
 public:
   ItemAttribute();
-  ItemAttribute(const std::string& v);
-  ItemAttribute(int32_t v);
-  ItemAttribute(float v);
-  ItemAttribute(bool v);
   ItemAttribute(const ItemAttribute& o);
   ItemAttribute& operator=(const ItemAttribute& o);
   ~ItemAttribute();
 
   void serialize(PropWriteStream& stream) const;
   bool unserialize(PropStream& stream);
-  
+
   void dealloc();
 
+  ItemAttributeKey getKey() const {return m_key;}
+  void setKey(ItemAttributeKey key) {m_key = key;}
+
   void set(const std::string& v);
   void set(int32_t v);
   void set(float v);
@@ -63,8 +107,8 @@ private:
     FLOAT = 3,
     BOOLEAN = 4,
     NONE = 0
-  } m_type;
-  
+  };
+
   union {
     std::string *string;
     uint8_t unsignedChar;
@@ -73,13 +117,20 @@ private:
     float signedFloat;
     bool boolean;
   } m_var;
+  ItemAttributeKey m_key;
+  uint8_t m_type;
 };
 
+/**
+ * Attributes are kept in one block, a header and then the attributes in the
+ * order they were set. Items without attributes only pay for the pointer.
+ */
 class ItemAttributes
 {
 public:
   ItemAttributes();
   ItemAttributes(const ItemAttributes &i);
+  ItemAttributes& operator=(const ItemAttributes& i);
   virtual ~ItemAttributes();
 
   // Save / load
@@ -87,15 +138,22 @@ public:
   bool unserializeAttributeMap(PropStream& stream);
 
 public:
-  void setAttribute(const std::string& key, const std::string& value);
-  void setAttribute(const std::string& key, int32_t value);
-  void setAttribute(const std::string& key, float value);
-  void setAttribute(const std::string& key, bool set);
+  // Return false when the name is new and all 65535 key IDs are taken
+  bool setAttribute(const std::string& key, const std::string& value);
+  bool setAttribute(const std::string& key, int32_t value);
+  bool setAttribute(const std::string& key, float value);
+  bool setAttribute(const std::string& key, bool set);
+  void setAttribute(ItemAttributeKey key, const std::string& value);
+  void setAttribute(ItemAttributeKey key, int32_t value);
+  void setAttribute(ItemAttributeKey key, bool set);
   // returns NULL if the attribute is not set
   const std::string* getStringAttribute(const std::string& key) const;
   const int32_t* getIntegerAttribute(const std::string& key) const;
   const float* getFloatAttribute(const std::string& key) const;
   const bool* getBooleanAttribute(const std::string& key) const;
+  const std::string* getStringAttribute(ItemAttributeKey key) const;
+  const int32_t* getIntegerAttribute(ItemAttributeKey key) const;
+  const bool* getBooleanAttribute(ItemAttributeKey key) const;
   boost::any getAttribute(const std::string& key) const;
   // Returns true if the attribute (of that type) exists
   bool hasStringAttribute(const std::string& key) const;
@@ -103,15 +161,31 @@ public:
   bool hasFloatAttribute(const std::string& key) const;
   bool hasBooleanAttribute(const std::string& key) const;
 
+  bool hasAttributes() const {return attributes && attributes->size > 0;}
 
   void eraseAttribute(const std::string& key);
+  void eraseAttribute(ItemAttributeKey key);
 
-protected:
-
-  typedef std::map<std::string, ItemAttribute> AttributeMap;
-  AttributeMap* attributes;
+  // Bytes held by the attribute blocks and their strings, of all items
+  static uint64_t getAllocatedBytes();
+  static uint32_t getBlockCount();
 
-  void createAttributes();
+protected:
+  struct AttributeBlock {
+    uint32_t size;
+    uint32_t capacity;
+
+    ItemAttribute* begin() {return reinterpret_cast<ItemAttribute*>(this + 1);}
+    ItemAttribute* end() {return begin() + size;}
+    const ItemAttribute* begin() const {return reinterpret_cast<const ItemAttribute*>(this + 1);}
+    const ItemAttribute* end() const {return begin() + size;}
+  };
+  AttributeBlock* attributes;
+
+  const ItemAttribute* findAttribute(ItemAttributeKey key) const;
+  // Adds the attribute if it is not set
+  ItemAttribute* getOrAddAttribute(ItemAttributeKey key);
+  void clearAttributes();
 };
 
 #endif
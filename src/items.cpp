@@ -20,10 +20,15 @@
 #include "otpch.h"
 
 #include <iostream>
+#include <fstream>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <libxml/xmlschemas.h>
 #include "items.h"
 #include "condition.h"
+#include "tools.h"
 
 uint32_t Items::dwMajorVersion = 0;
 uint32_t Items::dwMinorVersion = 0;
@@ -140,6 +145,9 @@ Items::~Items()
 void Items::clear()
 {
   currencyMap.clear();
+  nameIndex.clear();
+  pluralNameIndex.clear();
+  hotTable.clear();
 }
 
 bool Items::reload()
@@ -1232,6 +1240,8 @@ bool Items::loadFromXml(const std::string& datadir)
 #endif
   }
 
+  buildNameIndex();
+  buildHotTable();
   return true;
 }
 
@@ -1347,20 +1357,310 @@ bool Abilities::Absorb::reduce(CombatType ctype, int32_t& dmg) const
   return r;
 }
 
-int32_t Items::getItemIdByName(const std::string& name)
+void Items::buildNameIndex()
 {
-  if(!name.empty()){
-    uint32_t i = 100;
-    ItemType* iType;
-    do{
-      iType = items.getElement(i);
-      if(iType){
-        if(boost::algorithm::iequals(name, iType->name)){
-          return i;
-        }
+  nameIndex.clear();
+  pluralNameIndex.clear();
+
+  // Ids below 100 are not real items
+  for(uint32_t i = 100; i < items.size(); ++i){
+    ItemType* iType = items.getElement(i);
+    if(!iType){
+      continue;
+    }
+
+    if(!iType->name.empty()){
+      nameIndex[asLowerCaseString(iType->name)].push_back(i);
+    }
+    if(!iType->pluralName.empty()){
+      pluralNameIndex[asLowerCaseString(iType->pluralName)].push_back(i);
+    }
+  }
+}
+
+void Items::buildHotTable()
+{
+  std::vector<ItemTypeHot>(items.size()).swap(hotTable);
+
+  for(uint32_t i = 0; i < items.size(); ++i){
+    const ItemType* iType = items.getElement(i);
+    if(!iType){
+      continue;
+    }
+
+    ItemTypeHot& hot = hotTable[i];
+    hot.group = iType->group;
+    hot.type = iType->type;
+    hot.alwaysOnTopOrder = iType->alwaysOnTopOrder;
+    hot.speed = iType->speed;
+
+    if(iType->blockSolid) hot.props |= ITEMPROP_BLOCKSOLID;
+    if(iType->blockPathFind) hot.props |= ITEMPROP_BLOCKPATHFIND;
+    if(iType->blockProjectile) hot.props |= ITEMPROP_BLOCKPROJECTILE;
+    if(iType->allowPickupable) hot.props |= ITEMPROP_ALLOWPICKUPABLE;
+    if(iType->hasHeight) hot.props |= ITEMPROP_HASHEIGHT;
+    if(iType->isVertical) hot.props |= ITEMPROP_ISVERTICAL;
+    if(iType->isHorizontal) hot.props |= ITEMPROP_ISHORIZONTAL;
+    if(iType->isHangable) hot.props |= ITEMPROP_ISHANGEABLE;
+    if(iType->lookThrough) hot.props |= ITEMPROP_LOOKTHROUGH;
+    if(iType->pickupable) hot.props |= ITEMPROP_PICKUPABLE;
+    if(iType->rotateable) hot.props |= ITEMPROP_ROTATEABLE;
+    if(iType->stackable) hot.props |= ITEMPROP_STACKABLE;
+    if(iType->useable) hot.props |= ITEMPROP_USEABLE;
+    if(iType->moveable) hot.props |= ITEMPROP_MOVEABLE;
+    if(iType->alwaysOnTop) hot.props |= ITEMPROP_ALWAYSONTOP;
+    if(iType->canReadText) hot.props |= ITEMPROP_CANREADTEXT;
+    if(iType->canWriteText) hot.props |= ITEMPROP_CANWRITETEXT;
+    if(iType->floorChangeDown) hot.props |= ITEMPROP_FLOORCHANGEDOWN;
+    if(iType->floorChangeNorth) hot.props |= ITEMPROP_FLOORCHANGENORTH;
+    if(iType->floorChangeSouth) hot.props |= ITEMPROP_FLOORCHANGESOUTH;
+    if(iType->floorChangeEast) hot.props |= ITEMPROP_FLOORCHANGEEAST;
+    if(iType->floorChangeWest) hot.props |= ITEMPROP_FLOORCHANGEWEST;
+    if(iType->allowDistRead) hot.props |= ITEMPROP_ALLOWDISTREAD;
+  }
+}
+
+int32_t Items::getItemIdByName(const std::string& name) const
+{
+  const std::vector<int32_t>& ids = getItemIdsByName(name);
+  if(ids.empty()){
+    return -1;
+  }
+  return ids.front();
+}
+
+const std::vector<int32_t>& Items::getItemIdsByName(const std::string& name) const
+{
+  if(name.empty()){
+    return noItemIds;
+  }
+
+  std::string lowerName = asLowerCaseString(name);
+
+  NameIndex::const_iterator iter = nameIndex.find(lowerName);
+  if(iter != nameIndex.end()){
+    return iter->second;
+  }
+
+  iter = pluralNameIndex.find(lowerName);
+  if(iter != pluralNameIndex.end()){
+    return iter->second;
+  }
+
+  return noItemIds;
+}
+
+// Every ItemType field that is not a string, these are copied as they are
+// in memory so the cache is only valid for the build that wrote it
+#define ITEM_CACHE_FIELDS(X) \
+  X(group) X(type) X(id) X(clientId) X(maxItems) X(weight) X(showCount) \
+  X(weaponType) X(ammoType) X(shootType) X(magicEffect) X(attack) X(defense) \
+  X(extraDefense) X(armor) X(slotPosition) X(wieldPosition) X(speed) \
+  X(decayTo) X(decayTime) X(stopTime) X(corpseType) X(maxTextLen) \
+  X(writeOnceItemId) X(alwaysOnTopOrder) X(rotateTo) X(runeMagicLevel) \
+  X(runeLevel) X(wieldInfo) X(minRequiredLevel) X(minRequiredMagicLevel) \
+  X(lightLevel) X(lightColor) X(bedPartnerDirection) X(maleSleeperID) \
+  X(femaleSleeperID) X(noSleeperID) X(blockSolid) X(blockProjectile) \
+  X(blockPathFind) X(allowPickupable) X(hasHeight) X(isVertical) \
+  X(isHorizontal) X(isHangable) X(lookThrough) X(pickupable) X(rotateable) \
+  X(stackable) X(useable) X(moveable) X(alwaysOnTop) X(canReadText) \
+  X(canWriteText) X(floorChangeDown) X(floorChangeNorth) X(floorChangeSouth) \
+  X(floorChangeEast) X(floorChangeWest) X(allowDistRead) X(transformEquipTo) \
+  X(transformDeEquipTo) X(showDuration) X(showCharges) X(charges) \
+  X(breakChance) X(hitChance) X(maxHitChance) X(shootRange) X(ammoAction) \
+  X(fluidSource) X(currency) X(abilities) X(combatType) X(replaceable)
+
+#define ITEM_CACHE_STRINGS(X) \
+  X(name) X(article) X(pluralName) X(description) X(runeSpellName) \
+  X(vocationString)
+
+namespace {
+  const uint32_t ITEM_CACHE_MAGIC = 0x4349544F; // "OTIC"
+  const uint32_t ITEM_CACHE_VERSION = 1;
+
+  // Changes when a cached field changes size or ItemType gets a new member
+  uint32_t getCacheLayout()
+  {
+    uint32_t layout = sizeof(ItemType) * 31 + sizeof(Abilities);
+#define ITEM_CACHE_SIZE(field) layout = layout * 31 + sizeof(((ItemType*)NULL)->field);
+    ITEM_CACHE_FIELDS(ITEM_CACHE_SIZE)
+#undef ITEM_CACHE_SIZE
+    return layout;
+  }
+
+  void deleteItemTypes(std::vector<ItemType*>& types)
+  {
+    for(std::vector<ItemType*>::iterator it = types.begin(); it != types.end(); ++it){
+      delete *it;
+    }
+    types.clear();
+  }
+}
+
+bool Items::hashSourceFiles(const std::string& otbFile, const std::string& xmlFile, uint64_t& sourceHash)
+{
+  sourceHash = 0xCBF29CE484222325ULL;
+  return hashFile(otbFile, sourceHash) && hashFile(xmlFile, sourceHash);
+}
+
+bool Items::saveToCache(const std::string& file, uint64_t sourceHash) const
+{
+  PropWriteStream stream;
+  stream.ADD_ULONG(ITEM_CACHE_MAGIC);
+  stream.ADD_ULONG(ITEM_CACHE_VERSION);
+  stream.ADD_ULONG(getCacheLayout());
+  stream.ADD_VALUE(sourceHash);
+  stream.ADD_ULONG(dwMajorVersion);
+  stream.ADD_ULONG(dwMinorVersion);
+  stream.ADD_ULONG(dwBuildNumber);
+
+  uint32_t count = 0;
+  for(uint32_t i = 0; i < items.size(); ++i){
+    if(items.getElement(i)){
+      ++count;
+    }
+  }
+  stream.ADD_ULONG(count);
+
+  for(uint32_t i = 0; i < items.size(); ++i){
+    const ItemType* iType = items.getElement(i);
+    if(!iType){
+      continue;
+    }
+
+#define ITEM_CACHE_WRITE(field) stream.ADD_VALUE(iType->field);
+    ITEM_CACHE_FIELDS(ITEM_CACHE_WRITE)
+#undef ITEM_CACHE_WRITE
+#define ITEM_CACHE_WRITE_STRING(field) stream.ADD_STRING(iType->field);
+    ITEM_CACHE_STRINGS(ITEM_CACHE_WRITE_STRING)
+#undef ITEM_CACHE_WRITE_STRING
+
+    // Types added by items.xml have no client id of their own
+    ReverseItemMap::const_iterator reverse = reverseItemMap.find(iType->clientId);
+    stream.ADD_UCHAR(reverse != reverseItemMap.end() && reverse->second == (int32_t)iType->id);
+  }
+
+  stream.ADD_ULONG((uint32_t)currencyMap.size());
+  for(std::map<uint32_t, ItemType*>::const_iterator it = currencyMap.begin(); it != currencyMap.end(); ++it){
+    stream.ADD_ULONG(it->first);
+    stream.ADD_USHORT(it->second->id);
+  }
+
+  uint32_t size;
+  const char* data = stream.getStream(size);
+
+  // Written next to it first, so a server killed meanwhile leaves no broken cache
+  std::string tmpFile = file + ".tmp";
+  std::ofstream out(tmpFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if(!out.is_open()){
+    return false;
+  }
+  out.write(data, size);
+  out.close();
+  if(out.fail()){
+    return false;
+  }
+
+  try{
+    boost::filesystem::rename(tmpFile, file);
+  }
+  catch(boost::filesystem::filesystem_error&){
+    return false;
+  }
+  return true;
+}
+
+bool Items::loadFromCache(const std::string& file, uint64_t sourceHash)
+{
+  using namespace boost::interprocess;
+
+  std::vector<ItemType*> types;
+  std::vector<bool> reverse;
+  std::map<uint32_t, uint16_t> currencies;
+  uint32_t majorVersion, minorVersion, buildNumber;
+
+  try{
+    file_mapping mapping(file.c_str(), read_only);
+    mapped_region region(mapping, read_only);
+
+    PropStream props;
+    props.init((const char*)region.get_address(), region.get_size());
+
+    uint32_t magic, version, layout, count;
+    uint64_t hash;
+    if(!props.GET_ULONG(magic) || magic != ITEM_CACHE_MAGIC ||
+      !props.GET_ULONG(version) || version != ITEM_CACHE_VERSION ||
+      !props.GET_ULONG(layout) || layout != getCacheLayout() ||
+      !props.GET_VALUE(hash) || hash != sourceHash){
+      return false;
+    }
+
+    if(!props.GET_ULONG(majorVersion) || !props.GET_ULONG(minorVersion) ||
+      !props.GET_ULONG(buildNumber) || !props.GET_ULONG(count)){
+      return false;
+    }
+
+    types.reserve(count);
+    for(uint32_t i = 0; i < count; ++i){
+      ItemType* iType = new ItemType();
+      types.push_back(iType);
+
+      bool ok = true;
+#define ITEM_CACHE_READ(field) ok = ok && props.GET_VALUE(iType->field);
+      ITEM_CACHE_FIELDS(ITEM_CACHE_READ)
+#undef ITEM_CACHE_READ
+#define ITEM_CACHE_READ_STRING(field) ok = ok && props.GET_STRING(iType->field);
+      ITEM_CACHE_STRINGS(ITEM_CACHE_READ_STRING)
+#undef ITEM_CACHE_READ_STRING
+
+      uint8_t mapped;
+      if(!ok || !props.GET_UCHAR(mapped)){
+        deleteItemTypes(types);
+        return false;
       }
-      i++;
-    }while(iType);
+      reverse.push_back(mapped != 0);
+    }
+
+    uint32_t currencyCount;
+    if(!props.GET_ULONG(currencyCount)){
+      deleteItemTypes(types);
+      return false;
+    }
+    for(uint32_t i = 0; i < currencyCount; ++i){
+      uint32_t currency;
+      uint16_t id;
+      if(!props.GET_ULONG(currency) || !props.GET_USHORT(id)){
+        deleteItemTypes(types);
+        return false;
+      }
+      currencies[currency] = id;
+    }
   }
-  return -1;
+  catch(interprocess_exception&){
+    deleteItemTypes(types);
+    return false;
+  }
+
+  dwMajorVersion = majorVersion;
+  dwMinorVersion = minorVersion;
+  dwBuildNumber = buildNumber;
+
+  for(size_t i = 0; i < types.size(); ++i){
+    ItemType* iType = types[i];
+    if(reverse[i]){
+      reverseItemMap[iType->clientId] = iType->id;
+    }
+    items.addElement(iType, iType->id);
+  }
+
+  for(std::map<uint32_t, uint16_t>::const_iterator it = currencies.begin(); it != currencies.end(); ++it){
+    ItemType* iType = items.getElement(it->second);
+    if(iType){
+      currencyMap[it->first] = iType;
+    }
+  }
+
+  buildNameIndex();
+  buildHotTable();
+  return true;
 }
@@ -21,6 +21,7 @@
 #ifndef __OTSERV_ITEMS_H__
 #define __OTSERV_ITEMS_H__
 
+#include <unordered_map>
 #include "classes.h"
 #include "const.h"
 #include "enums.h"
@@ -42,6 +43,33 @@ enum ItemTypes_t {
   ITEM_TYPE_LAST
 };
 
+enum ItemProp{
+  ITEMPROP_BLOCKSOLID      = 1 << 0,
+  ITEMPROP_BLOCKPATHFIND    = 1 << 1,
+  ITEMPROP_BLOCKPROJECTILE  = 1 << 2,
+  ITEMPROP_ALLOWPICKUPABLE  = 1 << 3,
+  ITEMPROP_HASHEIGHT      = 1 << 4,
+  ITEMPROP_ISVERTICAL      = 1 << 5,
+  ITEMPROP_ISHORIZONTAL    = 1 << 6,
+  ITEMPROP_ISHANGEABLE    = 1 << 7,
+  ITEMPROP_CLIENTCHARGES    = 1 << 8,
+  ITEMPROP_LOOKTHROUGH    = 1 << 9,
+  ITEMPROP_PICKUPABLE      = 1 << 10,
+  ITEMPROP_ROTATEABLE      = 1 << 11,
+  ITEMPROP_STACKABLE      = 1 << 12,
+  ITEMPROP_USEABLE      = 1 << 13,
+  ITEMPROP_MOVEABLE      = 1 << 14,
+  ITEMPROP_ALWAYSONTOP    = 1 << 15,
+  ITEMPROP_CANREADTEXT    = 1 << 16,
+  ITEMPROP_CANWRITETEXT    = 1 << 17,
+  ITEMPROP_FLOORCHANGEDOWN  = 1 << 18,
+  ITEMPROP_FLOORCHANGENORTH  = 1 << 19,
+  ITEMPROP_FLOORCHANGESOUTH  = 1 << 20,
+  ITEMPROP_FLOORCHANGEEAST  = 1 << 21,
+  ITEMPROP_FLOORCHANGEWEST  = 1 << 22,
+  ITEMPROP_ALLOWDISTREAD    = 1 << 23
+};
+
 struct Abilities{
   Abilities();
 
@@ -84,6 +112,7 @@ struct Abilities{
   bool preventSkillLoss;
 };
 
+// New fields have to be added to the cache in items.cpp too
 class ItemType {
 private:
   //It is private because calling it can cause unexpected results
@@ -202,6 +231,22 @@ public:
   bool replaceable;
 };
 
+// The fields tile and map code reads on every check, packed by id so those
+// checks don't pull the rest of the ItemType into the cache
+struct ItemTypeHot {
+  ItemTypeHot() : props(0), group(ITEM_GROUP_NONE), type(ITEM_TYPE_NONE),
+    alwaysOnTopOrder(0), speed(0) {}
+
+  bool hasProperty(uint32_t p) const {return (props & p) == p;}
+
+  // ItemProp bits
+  uint32_t props;
+  uint8_t group;
+  uint8_t type;
+  uint8_t alwaysOnTopOrder;
+  uint16_t speed;
+};
+
 template<typename A>
 class Array{
 public:
@@ -235,8 +280,17 @@ public:
   const ItemType& getItemType(int32_t id) const;
   ItemType& getItemType(int32_t id);
   const ItemType& getItemIdByClientId(int32_t spriteId) const;
+  const ItemTypeHot& getHot(int32_t id) const {
+    if(id >= 0 && (size_t)id < hotTable.size()){
+      return hotTable[id];
+    }
+    return hotDefault;
+  }
 
-  int32_t getItemIdByName(const std::string& name);
+  // Case insensitive, names are matched before plural names
+  int32_t getItemIdByName(const std::string& name) const;
+  // All the ids with the name, or the plural name if no name matches
+  const std::vector<int32_t>& getItemIdsByName(const std::string& name) const;
 
   static uint32_t dwMajorVersion;
   static uint32_t dwMinorVersion;
@@ -244,6 +298,12 @@ public:
 
   bool loadFromXml(const std::string& datadir);
 
+  // Item types as resolved from items.otb and items.xml, sourceHash is the
+  // hash of both files and a cache made from other files is not loaded
+  static bool hashSourceFiles(const std::string& otbFile, const std::string& xmlFile, uint64_t& sourceHash);
+  bool loadFromCache(const std::string& file, uint64_t sourceHash);
+  bool saveToCache(const std::string& file, uint64_t sourceHash) const;
+
   void addItemType(ItemType* iType);
 
   const ItemType* getElement(uint32_t id) const {return items.getElement(id);}
@@ -253,10 +313,22 @@ public:
   std::map<uint32_t, ItemType*> currencyMap;
 
 protected:
+  void buildNameIndex();
+  void buildHotTable();
+
   typedef std::map<int32_t, int32_t> ReverseItemMap;
   ReverseItemMap reverseItemMap;
 
+  // Lower case names to item ids, in id order
+  typedef std::unordered_map<std::string, std::vector<int32_t> > NameIndex;
+  NameIndex nameIndex;
+  NameIndex pluralNameIndex;
+  // Returned for names that match nothing
+  std::vector<int32_t> noItemIds;
+
   Array<ItemType*> items;
+  std::vector<ItemTypeHot> hotTable;
+  ItemTypeHot hotDefault;
   std::string m_datadir;
 };
 
@@ -0,0 +1,448 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Embedded append-only key/value storage
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#ifdef __USE_LOCAL_STORAGE__
+
+#include "local_storage.h"
+#include "singleton.h"
+#include "tools.h"
+#include "otsystem.h"
+
+#include <string.h>
+#include <iostream>
+
+#ifdef __WINDOWS__
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/*
+  File layout:
+  "OTLS" <version:4>
+  records: <key size:4> <value size:4> <checksum:4> <key> <value>
+
+  A value size of STORAGE_TOMBSTONE erases the key, it has no value bytes.
+  The checksum covers the key and the value, a record failing it (or cut
+  short by a crash while writing) ends the log.
+*/
+
+namespace {
+  const char STORAGE_MAGIC[4] = {'O', 'T', 'L', 'S'};
+  const uint32_t STORAGE_VERSION = 1;
+  const uint32_t STORAGE_TOMBSTONE = 0xFFFFFFFF;
+  const uint32_t HEADER_SIZE = 8;
+  const uint32_t RECORD_HEADER_SIZE = 12;
+
+  // Records are written once this much is buffered, even before a sync
+  const uint32_t MAX_BUFFER_SIZE = 4*1024*1024;
+  // Smaller files are never compacted
+  const uint64_t MIN_COMPACT_SIZE = 16*1024*1024;
+
+  uint32_t recordChecksum(const std::string& key, const char* data, uint32_t size)
+  {
+    std::string buffer = key;
+    buffer.append(data, size);
+    return adlerChecksum((uint8_t*)buffer.data(), buffer.size());
+  }
+
+  bool flushFile(FILE* file)
+  {
+    if(fflush(file) != 0)
+      return false;
+
+#ifdef __WINDOWS__
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+  }
+}
+
+LocalStorage* LocalStorage::instance()
+{
+  static Singleton<LocalStorage> instance;
+  return instance.get();
+}
+
+LocalStorage::LocalStorage()
+{
+  m_file = NULL;
+  m_fileSize = 0;
+  m_liveSize = 0;
+  m_mapping = NULL;
+  m_mappingSize = 0;
+}
+
+LocalStorage::~LocalStorage()
+{
+  close();
+}
+
+bool LocalStorage::open(const std::string& filename)
+{
+  close();
+
+  m_filename = filename;
+  m_file = fopen(filename.c_str(), "r+b");
+  if(!m_file){
+    m_file = fopen(filename.c_str(), "w+b");
+    if(!m_file){
+      std::cout << "Error: [LocalStorage::open] Could not open " << filename << "." << std::endl;
+      return false;
+    }
+
+    fwrite(STORAGE_MAGIC, 1, 4, m_file);
+    fwrite(&STORAGE_VERSION, 4, 1, m_file);
+    if(!flushFile(m_file)){
+      std::cout << "Error: [LocalStorage::open] Could not write " << filename << "." << std::endl;
+      close();
+      return false;
+    }
+  }
+
+  if(!scan()){
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+void LocalStorage::close()
+{
+  if(m_file){
+    sync();
+    unmap();
+    fclose(m_file);
+    m_file = NULL;
+  }
+
+  m_fileSize = 0;
+  m_liveSize = 0;
+  m_buffer.clear();
+  m_records.clear();
+}
+
+bool LocalStorage::scan()
+{
+  fseek(m_file, 0, SEEK_END);
+  m_fileSize = ftell(m_file);
+
+  if(!map()){
+    std::cout << "Error: [LocalStorage::scan] Could not read " << m_filename << "." << std::endl;
+    return false;
+  }
+
+  std::string record;
+  uint32_t version = 0;
+  if(m_fileSize >= HEADER_SIZE && readData(0, HEADER_SIZE, record)){
+    memcpy(&version, record.data() + 4, 4);
+  }
+
+  if(version != STORAGE_VERSION || memcmp(record.data(), STORAGE_MAGIC, 4) != 0){
+    std::cout << "Error: [LocalStorage::scan] " << m_filename << " is not a storage file." << std::endl;
+    return false;
+  }
+
+  uint64_t offset = HEADER_SIZE;
+  while(offset + RECORD_HEADER_SIZE <= m_fileSize){
+    uint32_t keySize, valueSize, checksum;
+    readData(offset, RECORD_HEADER_SIZE, record);
+    memcpy(&keySize, record.data(), 4);
+    memcpy(&valueSize, record.data() + 4, 4);
+    memcpy(&checksum, record.data() + 8, 4);
+
+    bool tombstone = (valueSize == STORAGE_TOMBSTONE);
+    uint64_t dataSize = (uint64_t)keySize + (tombstone ? 0 : valueSize);
+    if(offset + RECORD_HEADER_SIZE + dataSize > m_fileSize)
+      break;
+
+    readData(offset + RECORD_HEADER_SIZE, (uint32_t)dataSize, record);
+    std::string key = record.substr(0, keySize);
+    if(recordChecksum(key, record.data() + keySize, dataSize - keySize) != checksum)
+      break;
+
+    RecordMap::iterator it = m_records.find(key);
+    if(it != m_records.end()){
+      m_liveSize -= RECORD_HEADER_SIZE + key.size() + it->second.size;
+      m_records.erase(it);
+    }
+
+    if(!tombstone){
+      RecordPos& pos = m_records[key];
+      pos.offset = offset + RECORD_HEADER_SIZE + keySize;
+      pos.size = valueSize;
+      m_liveSize += RECORD_HEADER_SIZE + dataSize;
+    }
+
+    offset += RECORD_HEADER_SIZE + dataSize;
+  }
+
+  if(offset != m_fileSize){
+    // Whatever follows the last good record was never completely written
+    std::cout << "Warning: [LocalStorage::scan] Dropping " << (m_fileSize - offset) <<
+      " bytes of incomplete records from " << m_filename << "." << std::endl;
+
+    unmap();
+#ifdef __WINDOWS__
+    bool truncated = _chsize(_fileno(m_file), offset) == 0;
+#else
+    bool truncated = ftruncate(fileno(m_file), offset) == 0;
+#endif
+    if(!truncated){
+      std::cout << "Error: [LocalStorage::scan] Could not truncate " << m_filename << "." << std::endl;
+      return false;
+    }
+
+    m_fileSize = offset;
+    fseek(m_file, 0, SEEK_END);
+  }
+
+  return true;
+}
+
+bool LocalStorage::map()
+{
+#ifndef __WINDOWS__
+  unmap();
+
+  if(m_fileSize == 0)
+    return true;
+
+  void* mapping = mmap(NULL, m_fileSize, PROT_READ, MAP_SHARED, fileno(m_file), 0);
+  if(mapping == MAP_FAILED)
+    return false;
+
+  m_mapping = (const char*)mapping;
+  m_mappingSize = m_fileSize;
+#endif
+  return true;
+}
+
+void LocalStorage::unmap()
+{
+#ifndef __WINDOWS__
+  if(m_mapping){
+    munmap((void*)m_mapping, m_mappingSize);
+  }
+#endif
+  m_mapping = NULL;
+  m_mappingSize = 0;
+}
+
+bool LocalStorage::readData(uint64_t offset, uint32_t size, std::string& data)
+{
+  if(offset >= m_fileSize){
+    // Still in the write buffer
+    data.assign(m_buffer.data() + (offset - m_fileSize), size);
+    return true;
+  }
+
+#ifdef __WINDOWS__
+  data.resize(size);
+  fseek(m_file, offset, SEEK_SET);
+  bool ret = (size == 0 || fread(&data[0], 1, size, m_file) == size);
+  fseek(m_file, 0, SEEK_END);
+  return ret;
+#else
+  // The file grew since it was mapped
+  if(offset + size > m_mappingSize && !map())
+    return false;
+
+  data.assign(m_mapping + offset, size);
+  return true;
+#endif
+}
+
+bool LocalStorage::get(const std::string& key, std::string& value)
+{
+  RecordMap::const_iterator it = m_records.find(key);
+  if(it == m_records.end())
+    return false;
+
+  return readData(it->second.offset, it->second.size, value);
+}
+
+void LocalStorage::append(const std::string& key, const char* data, uint32_t size, bool tombstone)
+{
+  uint32_t keySize = key.size();
+  uint32_t valueSize = (tombstone ? STORAGE_TOMBSTONE : size);
+  uint32_t checksum = recordChecksum(key, data, size);
+
+  RecordMap::iterator it = m_records.find(key);
+  if(it != m_records.end()){
+    m_liveSize -= RECORD_HEADER_SIZE + key.size() + it->second.size;
+    m_records.erase(it);
+  }
+
+  m_buffer.append((const char*)&keySize, 4);
+  m_buffer.append((const char*)&valueSize, 4);
+  m_buffer.append((const char*)&checksum, 4);
+  m_buffer.append(key);
+
+  if(!tombstone){
+    RecordPos& pos = m_records[key];
+    pos.offset = m_fileSize + m_buffer.size();
+    pos.size = size;
+    m_liveSize += RECORD_HEADER_SIZE + keySize + size;
+
+    m_buffer.append(data, size);
+  }
+
+  if(m_buffer.size() >= MAX_BUFFER_SIZE){
+    // Written now, but only synced to disk by the next sync
+    writeBuffer();
+  }
+}
+
+bool LocalStorage::writeBuffer()
+{
+  // The records are read through the mapping once they count as written,
+  // so they must have left the stdio buffer first. A failed write is
+  // overwritten by the next attempt.
+  if(fseek(m_file, m_fileSize, SEEK_SET) != 0 ||
+    fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size() || fflush(m_file) != 0)
+    return false;
+
+  m_fileSize += m_buffer.size();
+  m_buffer.clear();
+  return true;
+}
+
+void LocalStorage::put(const std::string& key, const char* data, uint32_t size)
+{
+  append(key, data, size, false);
+}
+
+void LocalStorage::erase(const std::string& key)
+{
+  if(m_records.find(key) != m_records.end()){
+    append(key, NULL, 0, true);
+  }
+}
+
+void LocalStorage::getKeys(const std::string& prefix, std::vector<std::string>& keys) const
+{
+  for(RecordMap::const_iterator it = m_records.lower_bound(prefix); it != m_records.end(); ++it){
+    if(it->first.compare(0, prefix.size(), prefix) != 0)
+      break;
+
+    keys.push_back(it->first);
+  }
+}
+
+bool LocalStorage::sync()
+{
+  if(!m_file)
+    return false;
+
+  if(!m_buffer.empty() && !writeBuffer()){
+    std::cout << "Error: [LocalStorage::sync] Could not write " << m_filename << "." << std::endl;
+    return false;
+  }
+
+  if(!flushFile(m_file)){
+    std::cout << "Error: [LocalStorage::sync] Could not flush " << m_filename << "." << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+bool LocalStorage::compact(bool force /*= false*/)
+{
+  if(!m_file)
+    return false;
+
+  uint64_t totalSize = m_fileSize + m_buffer.size();
+  if(!force && (totalSize < MIN_COMPACT_SIZE || m_liveSize * 2 > totalSize))
+    return true;
+
+  int64_t start = OTSYS_TIME();
+
+  // The old file has to hold every record until the new one replaces it
+  if(!m_buffer.empty() && !writeBuffer()){
+    std::cout << "Error: [LocalStorage::compact] Could not write " << m_filename << "." << std::endl;
+    return false;
+  }
+
+  std::string tmpname = m_filename + ".tmp";
+  FILE* tmp = fopen(tmpname.c_str(), "wb");
+  if(!tmp){
+    std::cout << "Error: [LocalStorage::compact] Could not open " << tmpname << "." << std::endl;
+    return false;
+  }
+
+  bool ret = (fwrite(STORAGE_MAGIC, 1, 4, tmp) == 4 && fwrite(&STORAGE_VERSION, 4, 1, tmp) == 1);
+
+  std::string value;
+  for(RecordMap::const_iterator it = m_records.begin(); ret && it != m_records.end(); ++it){
+    if(!readData(it->second.offset, it->second.size, value)){
+      ret = false;
+      break;
+    }
+
+    uint32_t keySize = it->first.size();
+    uint32_t valueSize = value.size();
+    uint32_t checksum = recordChecksum(it->first, value.data(), valueSize);
+
+    ret = (fwrite(&keySize, 4, 1, tmp) == 1 &&
+      fwrite(&valueSize, 4, 1, tmp) == 1 &&
+      fwrite(&checksum, 4, 1, tmp) == 1 &&
+      fwrite(it->first.data(), 1, keySize, tmp) == keySize &&
+      (valueSize == 0 || fwrite(value.data(), 1, valueSize, tmp) == valueSize));
+  }
+
+  ret = ret && flushFile(tmp);
+  fclose(tmp);
+
+  if(!ret){
+    std::cout << "Error: [LocalStorage::compact] Could not write " << tmpname << "." << std::endl;
+    remove(tmpname.c_str());
+    return false;
+  }
+
+  unmap();
+  fclose(m_file);
+  m_file = NULL;
+
+  // Replaces the old file in one step, it stays complete if that fails
+#ifdef __WINDOWS__
+  bool replaced = (MoveFileExA(tmpname.c_str(), m_filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+#else
+  bool replaced = (rename(tmpname.c_str(), m_filename.c_str()) == 0);
+#endif
+  if(!replaced){
+    std::cout << "Error: [LocalStorage::compact] Could not replace " << m_filename << "." << std::endl;
+    remove(tmpname.c_str());
+  }
+
+  if(!open(m_filename) || !replaced)
+    return false;
+
+  std::cout << "Notice: Local storage compacted from " << totalSize << " to " << m_fileSize <<
+    " bytes in " << (OTSYS_TIME() - start)/(1000.) << " s" << std::endl;
+  return true;
+}
+
+#endif
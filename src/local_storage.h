@@ -0,0 +1,107 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Embedded append-only key/value storage
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifdef __USE_LOCAL_STORAGE__
+
+#ifndef __OTSERV_LOCAL_STORAGE_H__
+#define __OTSERV_LOCAL_STORAGE_H__
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Key/value store kept in a single log file, meant for single server
+ * setups where an SQL round trip for every blob is wasted time.
+ *
+ * Every put or erase appends a record to the log, the newest record of a key
+ * wins. Records are buffered until sync(), which writes them and flushes the
+ * file to disk once (group commit). When most of the log is made of old
+ * records it is rewritten with only the live ones.
+ *
+ * Only used from the dispatcher thread.
+ */
+class LocalStorage
+{
+public:
+  static LocalStorage* instance();
+
+  LocalStorage();
+  ~LocalStorage();
+
+  /** Opens or creates the storage file and indexes its records
+    * \return Returns true if the file could be opened
+  */
+  bool open(const std::string& filename);
+  void close();
+  bool isOpen() const {return m_file != NULL;}
+
+  bool get(const std::string& key, std::string& value);
+  void put(const std::string& key, const char* data, uint32_t size);
+  void put(const std::string& key, const std::string& value) {put(key, value.data(), value.size());}
+  void erase(const std::string& key);
+
+  // Appends every stored key starting with prefix
+  void getKeys(const std::string& prefix, std::vector<std::string>& keys) const;
+
+  /** Writes the buffered records and flushes the file to disk
+    * \return Returns true if the records are safely stored
+  */
+  bool sync();
+
+  /** Rewrites the file with the live records only, if it is mostly garbage
+    * \return Returns false if the rewrite failed
+  */
+  bool compact(bool force = false);
+
+protected:
+  struct RecordPos{
+    uint64_t offset; // of the value
+    uint32_t size;
+  };
+  typedef std::map<std::string, RecordPos> RecordMap;
+
+  bool scan();
+  bool readData(uint64_t offset, uint32_t size, std::string& data);
+  void append(const std::string& key, const char* data, uint32_t size, bool tombstone);
+  bool writeBuffer();
+
+  bool map();
+  void unmap();
+
+  std::string m_filename;
+  FILE* m_file;
+
+  // Size of the file already written, buffered records come after it
+  uint64_t m_fileSize;
+  std::string m_buffer;
+
+  // Bytes taken by records that are still read
+  uint64_t m_liveSize;
+  RecordMap m_records;
+
+  const char* m_mapping;
+  uint64_t m_mappingSize;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,135 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Memory allocator for the lua state
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "lua_allocator.h"
+
+LuaAllocator::LuaAllocator() :
+  m_pagePos(NULL),
+  m_pageEnd(NULL),
+  m_allocatedBytes(0),
+  m_pageBytes(0),
+  m_largeBytes(0)
+{
+  std::fill(m_freeBlocks, m_freeBlocks + SIZE_CLASS_COUNT, (FreeBlock*)NULL);
+}
+
+LuaAllocator::~LuaAllocator()
+{
+  // Large blocks were all freed when the lua state was closed
+  for(std::vector<char*>::iterator it = m_pages.begin(); it != m_pages.end(); ++it){
+    free(*it);
+  }
+}
+
+void* LuaAllocator::allocate(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+  return ((LuaAllocator*)ud)->reallocate(ptr, osize, nsize);
+}
+
+void* LuaAllocator::reallocate(void* ptr, size_t osize, size_t nsize)
+{
+  if(nsize == 0){
+    if(ptr){
+      release(ptr, osize);
+    }
+    return NULL;
+  }
+
+  if(ptr == NULL){
+    m_allocatedBytes += nsize;
+    return acquire(nsize);
+  }
+
+  if(nsize > osize){
+    m_allocatedBytes += nsize - osize;
+  }
+
+  if(!isSmall(osize) && !isSmall(nsize)){
+    void* p = realloc(ptr, nsize);
+    if(p){
+      m_largeBytes += nsize;
+      m_largeBytes -= osize;
+    }
+    return p;
+  }
+
+  if(isSmall(osize) && isSmall(nsize) && sizeClass(osize) == sizeClass(nsize)){
+    return ptr;
+  }
+
+  void* p = acquire(nsize);
+  if(p){
+    memcpy(p, ptr, std::min(osize, nsize));
+    release(ptr, osize);
+  }
+  return p;
+}
+
+void* LuaAllocator::acquire(size_t size)
+{
+  if(!isSmall(size)){
+    void* p = malloc(size);
+    if(p){
+      m_largeBytes += size;
+    }
+    return p;
+  }
+
+  size_t sc = sizeClass(size);
+  if(FreeBlock* block = m_freeBlocks[sc]){
+    m_freeBlocks[sc] = block->next;
+    return block;
+  }
+
+  size_t blockSize = (sc + 1) * SIZE_CLASS_STEP;
+  if(m_pagePos == NULL || m_pagePos + blockSize > m_pageEnd){
+    // The rest of the old page is lost, at most one block of each class
+    char* page = (char*)malloc(PAGE_SIZE);
+    if(!page){
+      return NULL;
+    }
+    m_pages.push_back(page);
+    m_pageBytes += PAGE_SIZE;
+    m_pagePos = page;
+    m_pageEnd = page + PAGE_SIZE;
+  }
+
+  void* p = m_pagePos;
+  m_pagePos += blockSize;
+  return p;
+}
+
+void LuaAllocator::release(void* ptr, size_t size)
+{
+  if(!isSmall(size)){
+    free(ptr);
+    m_largeBytes -= size;
+    return;
+  }
+
+  FreeBlock* block = (FreeBlock*)ptr;
+  size_t sc = sizeClass(size);
+  block->next = m_freeBlocks[sc];
+  m_freeBlocks[sc] = block;
+}
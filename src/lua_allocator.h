@@ -0,0 +1,82 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Memory allocator for the lua state
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_LUA_ALLOCATOR_H__
+#define __OTSERV_LUA_ALLOCATOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * Hands out the small blocks lua uses for strings, tables and closures from
+ * pages split into size classes, larger blocks go to malloc.
+ *
+ * Freed small blocks are kept on a free list of their class and pages are
+ * only returned when the allocator is destroyed, so memory reserved stays
+ * at the peak small block usage of the lua state.
+ *
+ * Relies on lua passing the real old size of a block, which is true for
+ * lua 5.1 and LuaJIT.
+ */
+class LuaAllocator
+{
+public:
+  LuaAllocator();
+  ~LuaAllocator();
+
+  // lua_Alloc, ud is the LuaAllocator
+  static void* allocate(void* ud, void* ptr, size_t osize, size_t nsize);
+
+  // Bytes requested since the allocator was created
+  uint64_t getAllocatedBytes() const {return m_allocatedBytes;}
+  // Bytes of the pages and large blocks currently held
+  uint64_t getReservedBytes() const {return m_pageBytes + m_largeBytes;}
+
+protected:
+  enum {
+    SIZE_CLASS_STEP = 16,
+    SIZE_CLASS_COUNT = 16, // blocks up to 256 bytes are pooled
+    PAGE_SIZE = 64 * 1024
+  };
+
+  struct FreeBlock{
+    FreeBlock* next;
+  };
+
+  void* reallocate(void* ptr, size_t osize, size_t nsize);
+  void* acquire(size_t size);
+  void release(void* ptr, size_t size);
+
+  static bool isSmall(size_t size) {return size <= SIZE_CLASS_STEP * SIZE_CLASS_COUNT;}
+  static size_t sizeClass(size_t size) {return (size - 1) / SIZE_CLASS_STEP;}
+
+  FreeBlock* m_freeBlocks[SIZE_CLASS_COUNT];
+
+  std::vector<char*> m_pages;
+  char* m_pagePos;
+  char* m_pageEnd;
+
+  uint64_t m_allocatedBytes;
+  uint64_t m_pageBytes;
+  uint64_t m_largeBytes;
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include <winsock2.h>
 #endif
 
+#include <algorithm>
 #include <boost/filesystem.hpp>
 
 #include "configmanager.h"
@@ -30,6 +31,7 @@
 #include "script_environment.h"
 #include "script_listener.h"
 #include "script_event.h"
+#include "script_profiler.h"
 
 #include "game.h"
 #include "tile.h"
@@ -809,12 +811,29 @@ Vocation* LuaState::popVocation(Script::ErrorMode mode /* = Script::ERROR_THROW
 ///////////////////////////////////////////////////////////////////////////////
 // Lua State Thread
 
-LuaStateManager::LuaStateManager(Script::Manager* man) : LuaState(man)
-{
+LuaStateManager::LuaStateManager(Script::Manager* man) :
+  LuaState(man),
+  schedule_tick(OTSYS_TIME() / SCHEDULE_WHEEL_RESOLUTION),
+  instruction_budget((int32_t)g_config.getNumber(ConfigManager::SCRIPT_INSTRUCTION_BUDGET)),
+  gc_budget(g_config.getNumber(ConfigManager::SCRIPT_GC_BUDGET)),
+  gc_tick(0),
+  gc_tick_spent(0),
+  gc_in_cycle(false),
+  gc_cycle_heap(0),
+  gc_total_time(0),
+  gc_max_pause(0),
+  gc_cycles(0)
+{
+#ifdef __USE_LUAJIT__
+  // 64 bit LuaJIT only works with its own allocator
   state = luaL_newstate();
+#else
+  state = lua_newstate(LuaAllocator::allocate, &allocator);
+#endif
   if(!state){
     throw std::runtime_error("Could not create lua context, fatal error");
   }
+  lua_atpanic(state, luaPanic);
 
   // Load all standard libraries
   luaL_openlibs(state);
@@ -825,10 +844,76 @@ LuaStateManager::LuaStateManager(Script::Manager* man) : LuaState(man)
 LuaStateManager::~LuaStateManager() {
   for(ThreadMap::iterator t = threads.begin(); t != threads.end(); ++t)
     t->second->reset();
+  free_threads.clear();
+  for(int32_t i = 0; i < SCHEDULE_WHEEL_SIZE; ++i)
+    schedule_wheel[i].clear();
   threads.clear();
   lua_close(state);
 }
 
+uint64_t LuaStateManager::getAllocatedBytes() const
+{
+  return allocator.getAllocatedBytes();
+}
+
+uint64_t LuaStateManager::getHeapSize()
+{
+  return (uint64_t)lua_gc(state, LUA_GCCOUNT, 0) * 1024 + lua_gc(state, LUA_GCCOUNTB, 0);
+}
+
+uint64_t LuaStateManager::getReservedHeapSize() const
+{
+#ifdef __USE_LUAJIT__
+  return 0;
+#else
+  return allocator.getReservedBytes();
+#endif
+}
+
+void LuaStateManager::collectGarbage()
+{
+  if(gc_budget <= 0)
+    return;
+
+  int64_t start_time = OTSYS_TIME_MICRO();
+  int64_t tick = start_time / (SCHEDULE_WHEEL_RESOLUTION * 1000);
+  if(tick != gc_tick){
+    gc_tick = tick;
+    gc_tick_spent = 0;
+  }
+
+  if(gc_tick_spent >= gc_budget)
+    return;
+
+  // Leave the heap alone for a while after a cycle, like lua does
+  if(!gc_in_cycle && getHeapSize() * 100 < gc_cycle_heap * GC_IDLE_PAUSE)
+    return;
+
+  gc_in_cycle = true;
+  int64_t time = start_time;
+  while(time - start_time + gc_tick_spent < gc_budget){
+    bool finished = lua_gc(state, LUA_GCSTEP, GC_STEP_SIZE) == 1;
+    time = OTSYS_TIME_MICRO();
+    if(finished){
+      gc_in_cycle = false;
+      gc_cycle_heap = getHeapSize();
+      ++gc_cycles;
+      break;
+    }
+  }
+
+  int64_t pause = time - start_time;
+  gc_tick_spent += pause;
+  gc_total_time += pause;
+  gc_max_pause = std::max(gc_max_pause, pause);
+}
+
+int LuaStateManager::luaPanic(lua_State* L)
+{
+  std::cout << "Lua Error: Unprotected error in call to Lua API (" << lua_tostring(L, -1) << ")" << std::endl;
+  return 0;
+}
+
 void LuaStateManager::setupLuaStandardLibrary() {
 
   // Set a package.path = the script path
@@ -857,17 +942,35 @@ void LuaStateManager::setupLuaStandardLibrary() {
 
   // Set a register item to this table
   lua_setfield(state, LUA_REGISTRYINDEX, "stacktraceplus");
+
+  // Wrap require, so modules are tracked for reloads
+  lua_pushlightuserdata(state, this);
+  lua_getfield(state, LUA_GLOBALSINDEX, "require");
+  lua_pushcclosure(state, luaRequire, 2);
+  lua_setfield(state, LUA_GLOBALSINDEX, "require");
 }
 
-bool LuaStateManager::loadFile(std::string file)
+bool LuaStateManager::pushErrorHandler()
 {
-  // Get the error handler
   bool use_error_handler = g_config.getNumber(ConfigManager::DETAIL_SCRIPT_ERRORS) != 0;
   if (use_error_handler) {
     lua_getfield(state, LUA_REGISTRYINDEX, "stacktraceplus");
     lua_getfield(state, -1, "stacktrace");
     lua_replace(state, -2);
   }
+  return use_error_handler;
+}
+
+bool LuaStateManager::loadFile(std::string file)
+{
+  if(modules.isReloading() && modules.isLoaded(file)){
+    // The changed modules are run by the reload itself
+    modules.addInclude(file);
+    return true;
+  }
+
+  // Get the error handler
+  bool use_error_handler = pushErrorHandler();
 
   //loads file as a chunk at stack top
   int32_t ret = luaL_loadfile(state, file.c_str());
@@ -875,24 +978,157 @@ bool LuaStateManager::loadFile(std::string file)
   if(ret != 0) {
     std::ostringstream error;
     error << popString();
-    if (use_error_handler)
+    if (use_error_handler) {
       error << "\n";
-    pop(); // pop error handler
+      pop(); // pop error handler
+    }
 
     throw Script::Error(error.str());
   }
 
   //execute it
+  runModule(file, "", use_error_handler);
+  modules.addInclude(file);
+  return true;
+}
+
+void LuaStateManager::runModule(const std::string& path, const std::string& name, bool use_error_handler)
+{
+  size_t depth = modules.loadDepth();
+  modules.beginLoad(path, name);
+
+  // Required modules get their name as argument, like require does
+  int32_t nargs = 0;
+  if(!name.empty()){
+    lua_pushstring(state, name.c_str());
+    nargs = 1;
+  }
+
   // REVSCRIPT TODO a better error handler here
-  ret = lua_pcall(state, 0, 0, (use_error_handler ? -2 : 0));
+  int32_t ret = lua_pcall(state, nargs, 1, (use_error_handler ? -(nargs + 2) : 0));
   if(ret != 0) {
     std::ostringstream error;
     error << popString();
-    if (use_error_handler)
+    if (use_error_handler) {
       error << "\n";
+      pop(); // pop error handler
+    }
+
+    // The error went through the loads of the modules it required
+    while(modules.loadDepth() > depth)
+      modules.endLoad(false);
     throw Script::Error(error.str());
   }
-  return true;
+
+  if(!name.empty()){
+    // Same as require, package.loaded[name] is the result or true
+    lua_getfield(state, LUA_REGISTRYINDEX, "_LOADED");
+    if(!lua_isnil(state, -2)){
+      lua_pushvalue(state, -2);
+      lua_setfield(state, -2, name.c_str());
+    }
+    lua_getfield(state, -1, name.c_str());
+    if(lua_isnil(state, -1)){
+      lua_pushboolean(state, 1);
+      lua_setfield(state, -3, name.c_str());
+    }
+    lua_pop(state, 2);
+  }
+  pop(); // pop result
+  if (use_error_handler)
+    pop(); // pop error handler
+
+  // Loads left by a require that failed inside a coroutine
+  while(modules.loadDepth() > depth + 1)
+    modules.endLoad(false);
+  modules.endLoad(true);
+}
+
+std::string LuaStateManager::findModulePath(lua_State* L, const std::string& name)
+{
+  lua_getfield(L, LUA_GLOBALSINDEX, "package");
+  lua_getfield(L, -1, "path");
+  std::string templates = (lua_isstring(L, -1)? lua_tostring(L, -1) : "");
+  lua_pop(L, 2);
+
+  std::string file = name;
+  std::replace(file.begin(), file.end(), '.', '/');
+
+  // The same lookup as the lua file loader of require
+  std::string::size_type start = 0;
+  while(start < templates.size()){
+    std::string::size_type end = templates.find(';', start);
+    if(end == std::string::npos)
+      end = templates.size();
+
+    std::string path = templates.substr(start, end - start);
+    std::string::size_type mark;
+    while((mark = path.find('?')) != std::string::npos)
+      path.replace(mark, 1, file);
+
+    try {
+      if(!path.empty() && boost::filesystem::exists(path))
+        return path;
+    } catch(boost::filesystem::filesystem_error&) {
+    }
+    start = end + 1;
+  }
+  return "";
+}
+
+int LuaStateManager::luaRequire(lua_State* L)
+{
+  LuaStateManager* manager = (LuaStateManager*)lua_touserdata(L, lua_upvalueindex(1));
+
+  // Only requires run by a module are tracked, runModule cleans up after
+  // them. Nothing may be left to destroy when lua_error is raised.
+  size_t depth = manager->modules.loadDepth();
+  bool tracked = false;
+  if(depth > 0 && lua_isstring(L, 1)){
+    std::string name = lua_tostring(L, 1);
+    std::string path = findModulePath(L, name);
+    if(!path.empty()){
+      lua_getfield(L, LUA_REGISTRYINDEX, "_LOADED");
+      lua_getfield(L, -1, name.c_str());
+      bool loaded = lua_toboolean(L, -1) != 0;
+      bool returned = !lua_isboolean(L, -1);
+      lua_pop(L, 2);
+
+      if(!loaded){
+        manager->modules.beginLoad(path, name);
+        tracked = true;
+      }
+      else if(returned){
+        manager->modules.addDependency(path);
+      }
+      else{
+        manager->modules.addInclude(path);
+      }
+    }
+  }
+
+  // Call the original require
+  lua_pushvalue(L, lua_upvalueindex(2));
+  lua_pushvalue(L, 1);
+  if(lua_pcall(L, 1, 1, 0) != 0){
+    // The script may catch the error, the module that failed must not stay
+    // the current one
+    while(manager->modules.loadDepth() > depth)
+      manager->modules.endLoad(false);
+    return lua_error(L);
+  }
+
+  if(tracked){
+    std::string path = manager->modules.getCurrent()->path;
+    manager->modules.endLoad(true);
+
+    // Modules without a return value are only run for their side effects
+    if(lua_isboolean(L, -1))
+      manager->modules.addInclude(path);
+    else
+      manager->modules.addDependency(path);
+  }
+  return 1;
 }
 
 bool LuaStateManager::loadDirectory(std::string dir_path)
@@ -926,6 +1162,16 @@ bool LuaStateManager::loadDirectory(std::string dir_path)
 
 LuaThread_ptr LuaStateManager::newThread(const std::string& name)
 {
+  if(!free_threads.empty()){
+    // Reuse a finished coroutine, it is still in the thread map
+    LuaThread_ptr p = free_threads.back();
+    free_threads.pop_back();
+    p->name = name;
+    p->thread_state = 0;
+    p->profile_entry = NULL;
+    return p;
+  }
+
   LuaThread_ptr p(new LuaThread(manager, name));
   threads[p->state] = p;
   return p;
@@ -933,47 +1179,71 @@ LuaThread_ptr LuaStateManager::newThread(const std::string& name)
 
 void LuaStateManager::scheduleThread(int32_t schedule, LuaThread_ptr thread)
 {
+  // Round up, a thread must never be woken before its time
+  int64_t scheduled_time = OTSYS_TIME() + schedule;
   ThreadSchedule s;
-  s.scheduled_time = OTSYS_TIME() + schedule;
+  s.scheduled_tick = (scheduled_time + SCHEDULE_WHEEL_RESOLUTION - 1) / SCHEDULE_WHEEL_RESOLUTION;
   s.thread = thread;
-  queued_threads.push(s);
+
+  // Never put it in a slot that has already been run
+  s.scheduled_tick = std::max(s.scheduled_tick, schedule_tick + 1);
+  schedule_wheel[s.scheduled_tick % SCHEDULE_WHEEL_SIZE].push_back(s);
 }
 
 void LuaStateManager::runScheduledThreads()
 {
-  int64_t current_time = OTSYS_TIME();
-  while(queued_threads.empty() == false) {
-    //std::cout << "Running waiting threads... (" << queued_threads.size() << ")";
-    const ThreadSchedule& scheduled = queued_threads.top();
-    //std::cout << " next " << (scheduled.scheduled_time - current_time) << " ";
-    if(scheduled.scheduled_time < current_time) {
-      //std::cout << "RUN";
-      int32_t t = scheduled.thread->run(0);
-      if(t > 0) {
-        //std::cout << "Rescheudule " << t;
-        scheduleThread(t, scheduled.thread);
-      } else {
-        ThreadMap::iterator iter = threads.find(scheduled.thread->state);
-        threads.erase(iter);
-      }
-      queued_threads.pop();
-      //std::cout << "[Done]" << std::endl;
-    } else {
-      //std::cout << "[Done]" << std::endl;
-      break;
+  int64_t current_tick = OTSYS_TIME() / SCHEDULE_WHEEL_RESOLUTION;
+
+  // Each slot only has to be visited once, even if we fell far behind
+  int64_t tick = std::max(schedule_tick + 1, current_tick - SCHEDULE_WHEEL_SIZE + 1);
+  for(; tick <= current_tick; ++tick){
+    std::vector<ThreadSchedule>& slot = schedule_wheel[tick % SCHEDULE_WHEEL_SIZE];
+    if(slot.empty())
+      continue;
+
+    // Threads waiting longer than a turn of the wheel stay in the slot,
+    // the others are due since their tick has been reached
+    running_threads.clear();
+    std::vector<ThreadSchedule>::iterator keep = slot.begin();
+    for(std::vector<ThreadSchedule>::iterator iter = slot.begin(); iter != slot.end(); ++iter){
+      if(iter->scheduled_tick <= current_tick)
+        running_threads.push_back(*iter);
+      else
+        *keep++ = *iter;
+    }
+    slot.erase(keep, slot.end());
+
+    // Rescheduled threads always end up in a later tick
+    schedule_tick = tick;
+    for(std::vector<ThreadSchedule>::iterator iter = running_threads.begin(); iter != running_threads.end(); ++iter){
+      int32_t t = iter->thread->run(0);
+      if(t > 0)
+        scheduleThread(t, iter->thread);
+      else
+        freeThread(iter->thread);
     }
   }
+  running_threads.clear();
+  schedule_tick = std::max(schedule_tick, current_tick);
 }
 
 int32_t LuaStateManager::countThreads() const
 {
-  return threads.size();
+  return threads.size() - free_threads.size();
 }
 
 void LuaStateManager::freeThread(LuaThread_ptr thread)
 {
+  // A coroutine can only be started again if it returned normally
+  if(thread->state && lua_status(thread->state) == 0 && free_threads.size() < MAX_FREE_THREADS){
+    lua_settop(thread->state, 0);
+    free_threads.push_back(thread);
+    return;
+  }
+
   ThreadMap::iterator iter = threads.find(thread->state);
-  threads.erase(iter);
+  if(iter != threads.end())
+    threads.erase(iter);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -982,17 +1252,21 @@ void LuaStateManager::freeThread(LuaThread_ptr thread)
 LuaThread::LuaThread(Script::Manager* manager, const std::string& name) :
   LuaState(manager),
   name(name),
-  thread_state(0)
+  thread_state(0),
+  profile_entry(NULL),
+  budget_exceeded(false)
 {
   state = lua_newthread(manager->state);
-  lua_pushvalue(manager->state, -1);
+  // Keep the coroutine from being GC-ed, this also pops it
   reference = luaL_ref(manager->state, LUA_REGISTRYINDEX);
 }
 
 LuaThread::LuaThread(Script::Manager* manager, lua_State* L) :
   LuaState(manager),
   name("Lua generated coroutine"),
-  thread_state(0)
+  thread_state(0),
+  profile_entry(NULL),
+  budget_exceeded(false)
 {
   state = L;
   lua_pushthread(state);
@@ -1074,14 +1348,71 @@ std::string LuaThread::report(const std::string& extramessage)
   return os.str();
 }
 
+void LuaThread::luaBudgetHook(lua_State* L, lua_Debug* ar)
+{
+  // run() keeps the running LuaThread in the registry, keyed by its state.
+  // Coroutines the script created itself inherit the hook but have no entry
+  lua_pushlightuserdata(L, L);
+  lua_rawget(L, LUA_REGISTRYINDEX);
+  LuaThread* thread = (LuaThread*)lua_touserdata(L, -1);
+  lua_pop(L, 1);
+  if(thread)
+    thread->budget_exceeded = true;
+
+  // Fire on every instruction from now on, so a pcall in the script can not
+  // keep it running
+  lua_sethook(L, luaBudgetHook, LUA_MASKCOUNT, 1);
+  luaL_error(L, "Script exceeded the instruction budget.");
+}
+
+std::string LuaThread::getFunctionSource()
+{
+  lua_Debug ar;
+  duplicate();
+  if(lua_getinfo(state, ">S", &ar) == 0)
+    return "<unknown>";
+
+  std::ostringstream os;
+  os << ar.short_src << ":" << ar.linedefined;
+  return os.str();
+}
+
 int32_t LuaThread::run(int32_t args)
 {
   // Keep track of stats!
   ++manager->event_handlers_called;
 
+  int32_t budget = manager->instruction_budget;
+  if(budget > 0){
+    budget_exceeded = false;
+    lua_pushlightuserdata(manager->state, state);
+    lua_pushlightuserdata(manager->state, this);
+    lua_rawset(manager->state, LUA_REGISTRYINDEX);
+    lua_sethook(state, luaBudgetHook, LUA_MASKCOUNT, budget);
+  }
+
+  int64_t start_time = 0;
+  uint64_t start_allocated = 0;
+  if(profile_entry){
+    start_time = OTSYS_TIME_MICRO();
+    start_allocated = manager->getAllocatedBytes();
+  }
+
   // Run the lua code
   int32_t ret = lua_resume(state, args);
 
+  if(profile_entry)
+    profile_entry->record(OTSYS_TIME_MICRO() - start_time, manager->getAllocatedBytes() - start_allocated);
+
+  if(budget > 0){
+    lua_sethook(state, NULL, 0, 0);
+    lua_pushlightuserdata(manager->state, state);
+    lua_pushnil(manager->state);
+    lua_rawset(manager->state, LUA_REGISTRYINDEX);
+    if(budget_exceeded && profile_entry)
+      ++profile_entry->aborted;
+  }
+
   //
   thread_state = ret;
   if(ret == LUA_YIELD) {
@@ -19,11 +19,13 @@
 #ifndef __OTSERV_LUA_MANAGER_H__
 #define __OTSERV_LUA_MANAGER_H__
 
-#include <queue>
+#include <vector>
 #include <stdexcept>
 #include <boost/shared_ptr.hpp>
 
 #include "lua.hpp"
+#include "lua_allocator.h"
+#include "script_module.h"
 #include "classes.h"
 #include "enums.h"
 #include "outfit.h"
@@ -33,6 +35,7 @@ typedef boost::shared_ptr<Waypoint> Waypoint_ptr;
 namespace Script {
   typedef uint64_t ObjectID;
   class Environment;
+  class ProfileEntry;
   class Manager;
   class Listener;
   typedef boost::shared_ptr<Listener> Listener_ptr;
@@ -251,6 +254,7 @@ public:
   int lua_get_thread_id();
   int lua_stacktrace();
   int lua_statistics();
+  int lua_getScriptProfile();
 
   int lua_getConfigValue();
   // - Register Events
@@ -321,14 +325,8 @@ public:
 
 
   // - Thing
-  int lua_Thing_getPosition();
-  int lua_Thing_getX();
-  int lua_Thing_getY();
-  int lua_Thing_getZ();
   int lua_Thing_getParent();
-  int lua_Thing_getParentTile();
 
-  int lua_Thing_isMoveable();
   int lua_Thing_getName();
   int lua_Thing_getDescription();
 
@@ -379,11 +377,8 @@ public:
   int lua_Vocation_getArmorDefense();
 
   // - - Creature
-  int lua_Creature_getID();
   int lua_Creature_getOrientation();
-  int lua_Creature_getHealth();
   int lua_Creature_getMaster();
-  int lua_Creature_getHealthMax();
   int lua_Creature_setHealth();
   int lua_Creature_getName();
   int lua_Creature_getNameDescription();
@@ -394,13 +389,7 @@ public:
   int lua_Creature_walk();
   int lua_Creature_addSummon();
   int lua_Creature_getSummons();
-  int lua_Creature_getSpeed();
-  int lua_Creature_getArmor();
-  int lua_Creature_getDefense();
-  int lua_Creature_getBaseSpeed();
   int lua_Creature_isSummon();
-  int lua_Creature_isPushable();
-  int lua_Creature_getTarget();
   int lua_Creature_getMasterPos();
   int lua_Creature_isImmuneToCombat();
   int lua_Creature_getDamageImmunities();
@@ -474,17 +463,13 @@ public:
   int lua_Actor_closeShop();
 
   // - - - Player
-  int lua_Player_getFood();
   int lua_Player_getMana();
-  int lua_Player_getManaMax();
   int lua_Player_setMana();
   int lua_Player_addManaSpent();
   int lua_Player_getSoulPoints();
   int lua_Player_setSoulPoints();
   int lua_Player_getFreeCap();
   int lua_Player_getMaximumCap();
-  int lua_Player_getLevel();
-  int lua_Player_getMagicLevel();
   int lua_Player_getSkill();
   int lua_Player_advanceSkill();
   int lua_Player_getAttackFactor();
@@ -499,7 +484,6 @@ public:
   int lua_Player_getGroup();
   int lua_Player_getVocation();
   int lua_Player_getTownID();
-  int lua_Player_getGUID();
   int lua_Player_getPremiumDays();
   int lua_Player_getSkullType();
   int lua_Player_getLastLogin();
@@ -542,15 +526,13 @@ public:
   // - - Item
   int lua_createItem();
   int lua_getItemIDByName();
+  int lua_getItemIDsByName();
   int lua_getItemType();
   int lua_getMaxItemType();
   int lua_isValidItemID();
 
-  int lua_Item_getItemID();
   int lua_Item_getLongName();
   int lua_Item_getCount();
-  int lua_Item_getWeight();
-  int lua_Item_isPickupable();
   int lua_Item_getSubtype();
 
   int lua_Item_setItemID();
@@ -713,10 +695,23 @@ public:
 
   // Returns a sweetly formatted stack trace
   std::string report(const std::string& extramessage = "");
+
+  // Returns "file:line" of the function ontop of the stack
+  std::string getFunctionSource();
+
+  // Runs are recorded in the entry until the thread is freed
+  void setProfileEntry(Script::ProfileEntry* entry) {profile_entry = entry;}
 protected:
+  static void luaBudgetHook(lua_State* L, lua_Debug* ar);
+
   int reference;
   std::string name;
   int32_t thread_state;
+  Script::ProfileEntry* profile_entry;
+  // Set by the budget hook when it aborts this thread
+  bool budget_exceeded;
+
+  friend class LuaStateManager;
 };
 
 typedef boost::shared_ptr<LuaThread> LuaThread_ptr;
@@ -731,25 +726,89 @@ public:
   bool loadDirectory(std::string dir);
   void setupLuaStandardLibrary();
 
+  // Files run by loadFile and require
+  Script::ModuleTracker& getModules() {return modules;}
+
+  // Threads that ran to their end are kept and handed out again
   LuaThread_ptr newThread(const std::string& name);
   void scheduleThread(int32_t schedule, LuaThread_ptr thread);
   int32_t countThreads() const;
   void runScheduledThreads();
   void freeThread(LuaThread_ptr thread);
 
+  // Runs incremental collection steps until the budget of this tick is spent
+  void collectGarbage();
+  // Bytes in use by the lua state
+  uint64_t getHeapSize();
+  uint64_t getReservedHeapSize() const;
+  // Microseconds spent in collectGarbage
+  int64_t getGCTime() const {return gc_total_time;}
+  int64_t getGCMaxPause() const {return gc_max_pause;}
+  uint32_t getGCCycles() const {return gc_cycles;}
+
   struct ThreadSchedule {
-    int64_t scheduled_time;
+    int64_t scheduled_tick;
     LuaThread_ptr thread;
-
-    bool operator<(const LuaStateManager::ThreadSchedule& rhs) const {
-      return scheduled_time > rhs.scheduled_time;
-    }
   };
 protected:
+  enum {
+    MAX_FREE_THREADS = 128,
+    // Waiting threads are put in a slot of the wheel by their wake up
+    // time, a slot covers one run of runScheduledThreads
+    SCHEDULE_WHEEL_SIZE = 256,
+    SCHEDULE_WHEEL_RESOLUTION = 20
+  };
 
   typedef std::map<lua_State*, LuaThread_ptr> ThreadMap;
   ThreadMap threads;
-  std::priority_queue<ThreadSchedule> queued_threads;
+  std::vector<LuaThread_ptr> free_threads;
+
+  std::vector<ThreadSchedule> schedule_wheel[SCHEDULE_WHEEL_SIZE];
+  std::vector<ThreadSchedule> running_threads;
+  int64_t schedule_tick; // last tick that was run
+
+  // Lua instructions a thread may run before it is aborted, 0 for no limit
+  int32_t instruction_budget;
+  // Bytes requested by the lua state since it was created, always 0 under
+  // LuaJIT, which keeps its own allocator
+  uint64_t getAllocatedBytes() const;
+
+  // Must outlive the lua state
+  LuaAllocator allocator;
+
+  enum {
+    GC_STEP_SIZE = 16, // kilobytes of work per step
+    // A new cycle is started once the heap grew to this percent of what was
+    // left after the last one
+    GC_IDLE_PAUSE = 150
+  };
+
+  int64_t gc_budget; // microseconds per tick
+  int64_t gc_tick;
+  int64_t gc_tick_spent;
+  bool gc_in_cycle;
+  uint64_t gc_cycle_heap;
+
+  // Statistics of the collection done by collectGarbage
+  int64_t gc_total_time;
+  int64_t gc_max_pause;
+  uint32_t gc_cycles;
+
+  static int luaPanic(lua_State* L);
+
+  Script::ModuleTracker modules;
+
+  // Pushes the stacktrace handler if detailed errors are enabled
+  bool pushErrorHandler();
+  // Runs the chunk ontop of the stack, which is above the error handler if
+  // there is one, as the module. Throws on errors.
+  void runModule(const std::string& path, const std::string& name, bool use_error_handler);
+  // The file package.path finds for the name, empty if there is none
+  static std::string findModulePath(lua_State* L, const std::string& name);
+  // Replaces require, to know which module uses which
+  static int luaRequire(lua_State* L);
+
+  friend class LuaThread;
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include "map.h"
 #include "iomapserialize.h"
 #include "iomapotbm.h"
+#include "iomapimage.h"
 #include "creature.h"
 #include "combat.h"
 #include "housetile.h"
@@ -40,23 +41,70 @@ Map::~Map()
   //
 }
 
-bool Map::loadMap(const std::string& identifier)
+bool Map::loadMap(const std::string& identifier, bool rebuildImage /*= false*/)
 {
-  IOMap* loader = new IOMapOTBM();
+  std::string imageFile;
+  if(!g_config.getString(ConfigManager::WORLD_IMAGE_FILE).empty()){
+    imageFile = g_config.getString(ConfigManager::DATA_DIRECTORY) + g_config.getString(ConfigManager::WORLD_IMAGE_FILE);
+  }
+
+  IOMap* loader = NULL;
+  if(!imageFile.empty() && !rebuildImage){
+    IOMapImage* image = new IOMapImage();
+    if(image->open(imageFile, identifier)){
+      loader = image;
+    }
+    else{
+      delete image;
+    }
+  }
+
+  bool fromImage = (loader != NULL);
+  if(!loader){
+    loader = new IOMapOTBM();
+  }
 
   if(loader){
 
-    std::cout << ":: Loading map from: " << identifier << " " << loader->getSourceDescription() << std::endl;
+    std::cout << ":: Loading map from: " << (fromImage? imageFile : identifier) << " " << loader->getSourceDescription() << std::endl;
+
+    bool loaded = loader->loadMap(this, identifier);
+    if(!loaded && fromImage){
+      // The image is read completely before the map is changed
+      std::cout << "WARNING: [" << loader->getSourceDescription() << " loader] " << loader->getLastErrorString()
+        << " Loading the map from: " << identifier << std::endl;
+      delete loader;
+      loader = new IOMapOTBM();
+      fromImage = false;
+      loaded = loader->loadMap(this, identifier);
+    }
 
-    if(!loader->loadMap(this, identifier)){
-      std::cout << "FATAL: [OTBM loader] " << loader->getLastErrorString() << std::endl;
+    if(!loaded){
+      std::cout << "FATAL: [" << loader->getSourceDescription() << " loader] " << loader->getLastErrorString() << std::endl;
+      delete loader;
       return false;
     }
 
-    if(!loader->loadSpawns(this)){
+    bool spawnsLoaded = loader->loadSpawns(this);
+    if(!spawnsLoaded){
       std::cout << "WARNING: could not load spawn data." << std::endl;
     }
 
+    // Before any house items or other saved state are added, an image
+    // with a partial spawn list would be used on every later start
+    if(!fromImage && !imageFile.empty() && spawnsLoaded){
+      std::cout << ":: Writing world image " << imageFile << "... " << std::flush;
+      if(IOMapImage::saveImage(this, imageFile, identifier)){
+        std::cout << "[done]" << std::endl;
+      }
+      else{
+        std::cout << "[failed]" << std::endl;
+      }
+    }
+    else if(!fromImage && !imageFile.empty()){
+      std::cout << "WARNING: not writing world image " << imageFile << " without the spawn data." << std::endl;
+    }
+
     if(!loader->loadHouses(this)){
       std::cout << "WARNING: could not load house data." << std::endl;
     }
@@ -68,6 +116,9 @@ bool Map::loadMap(const std::string& identifier)
     IOMapSerialize->processHouseAuctions();
     IOMapSerialize->loadHouseInfo(this);
     IOMapSerialize->loadMap(this);
+
+    std::cout << ":: Item attributes: " << ItemAttributes::getBlockCount() << " blocks, "
+      << ItemAttributes::getAllocatedBytes() << " bytes" << std::endl;
     return true;
   }
 
@@ -342,7 +393,8 @@ bool Map::removeCreature(Creature* creature)
 void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, bool checkforduplicate,
   int32_t minRangeX, int32_t maxRangeX,
   int32_t minRangeY, int32_t maxRangeY,
-  int32_t minRangeZ, int32_t maxRangeZ)
+  int32_t minRangeZ, int32_t maxRangeZ,
+  bool onlyHearers /*= false*/)
 {
   int32_t minoffset = centerPos.z - maxRangeZ;
   int32_t x1 = std::min((int32_t)0xFFFF, std::max((int32_t)0, (centerPos.x + minRangeX + minoffset  )));
@@ -369,7 +421,7 @@ void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, b
     for(int32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE){
       if(leafE){
 
-        CreatureVector& node_list = leafE->creature_list;
+        CreatureVector& node_list = (onlyHearers ? leafE->hearer_list : leafE->creature_list);
         CreatureVector::const_iterator node_iter = node_list.begin();
         CreatureVector::const_iterator node_end = node_list.end();
         if(node_iter != node_end){
@@ -442,33 +494,7 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos,
 
       int32_t minRangeZ;
       int32_t maxRangeZ;
-
-      if(multifloor){
-        if(centerPos.z > 7){
-          //underground
-
-          //8->15
-          minRangeZ = std::max(centerPos.z - 2, (int32_t)0);
-          maxRangeZ = std::min(centerPos.z + 2, (int32_t)MAP_MAX_LAYERS - 1);
-        }
-        //above ground
-        else if(centerPos.z == 6){
-          minRangeZ = 0;
-          maxRangeZ = 8;
-        }
-        else if(centerPos.z == 7){
-          minRangeZ = 0;
-          maxRangeZ = 9;
-        }
-        else{
-          minRangeZ = 0;
-          maxRangeZ = 7;
-        }
-      }
-      else{
-        minRangeZ = centerPos.z;
-        maxRangeZ = centerPos.z;
-      }
+      getFloorRange(centerPos, multifloor, minRangeZ, maxRangeZ);
 
       getSpectatorsInternal(list, centerPos, true,
         minRangeX, maxRangeX,
@@ -482,6 +508,54 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos,
   }
 }
 
+void Map::getFloorRange(const Position& centerPos, bool multifloor,
+  int32_t& minRangeZ, int32_t& maxRangeZ)
+{
+  if(multifloor){
+    if(centerPos.z > 7){
+      //underground
+
+      //8->15
+      minRangeZ = std::max(centerPos.z - 2, (int32_t)0);
+      maxRangeZ = std::min(centerPos.z + 2, (int32_t)MAP_MAX_LAYERS - 1);
+    }
+    //above ground
+    else if(centerPos.z == 6){
+      minRangeZ = 0;
+      maxRangeZ = 8;
+    }
+    else if(centerPos.z == 7){
+      minRangeZ = 0;
+      maxRangeZ = 9;
+    }
+    else{
+      minRangeZ = 0;
+      maxRangeZ = 7;
+    }
+  }
+  else{
+    minRangeZ = centerPos.z;
+    maxRangeZ = centerPos.z;
+  }
+}
+
+void Map::getHearers(SpectatorVec& list, const Position& centerPos,
+  bool multifloor, int32_t rangeX, int32_t rangeY)
+{
+  if(centerPos.z >= MAP_MAX_LAYERS){
+    return;
+  }
+
+  int32_t minRangeZ;
+  int32_t maxRangeZ;
+  getFloorRange(centerPos, multifloor, minRangeZ, maxRangeZ);
+
+  getSpectatorsInternal(list, centerPos, false,
+    -rangeX, rangeX,
+    -rangeY, rangeY,
+    minRangeZ, maxRangeZ, true);
+}
+
 const SpectatorVec& Map::getSpectators(const Position& centerPos)
 {
   if(centerPos.z < MAP_MAX_LAYERS){
@@ -1263,6 +1337,31 @@ QTreeLeafNode* QTreeNode::getLeafStatic(QTreeNode* root, uint32_t x, uint32_t y)
   return NULL;
 }
 
+void QTreeNode::getTiles(std::vector<Tile*>& list) const
+{
+  if(isLeaf()){
+    const QTreeLeafNode* leaf = static_cast<const QTreeLeafNode*>(this);
+    for(uint32_t z = 0; z < MAP_MAX_LAYERS; ++z){
+      if(Floor* floor = leaf->m_array[z]){
+        for(uint32_t x = 0; x < FLOOR_SIZE; ++x){
+          for(uint32_t y = 0; y < FLOOR_SIZE; ++y){
+            if(floor->tiles[x][y]){
+              list.push_back(floor->tiles[x][y]);
+            }
+          }
+        }
+      }
+    }
+    return;
+  }
+
+  for(uint32_t i = 0; i < 4; ++i){
+    if(m_child[i]){
+      m_child[i]->getTiles(list);
+    }
+  }
+}
+
 QTreeLeafNode* QTreeNode::createLeaf(uint32_t x, uint32_t y, uint32_t level)
 {
   if(!isLeaf()){
@@ -1310,3 +1409,40 @@ Floor* QTreeLeafNode::createFloor(uint32_t z)
   }
   return m_array[z];
 }
+
+void QTreeLeafNode::addCreature(Creature* c)
+{
+  creature_list.push_back(c);
+  if(c->hasHearListeners()){
+    addHearer(c);
+  }
+}
+
+void QTreeLeafNode::removeCreature(Creature* c)
+{
+  CreatureVector::iterator iter = std::find(creature_list.begin(), creature_list.end(), c);
+  assert(iter != creature_list.end());
+  std::swap(*iter, creature_list.back());
+  creature_list.pop_back();
+
+  if(c->hasHearListeners()){
+    removeHearer(c);
+  }
+}
+
+void QTreeLeafNode::addHearer(Creature* c)
+{
+  // A creature may gain listeners between being put on a tile and on the node
+  if(std::find(hearer_list.begin(), hearer_list.end(), c) == hearer_list.end()){
+    hearer_list.push_back(c);
+  }
+}
+
+void QTreeLeafNode::removeHearer(Creature* c)
+{
+  CreatureVector::iterator iter = std::find(hearer_list.begin(), hearer_list.end(), c);
+  if(iter != hearer_list.end()){
+    std::swap(*iter, hearer_list.back());
+    hearer_list.pop_back();
+  }
+}
@@ -98,6 +98,8 @@ public:
   QTreeLeafNode* getLeaf(uint32_t x, uint32_t y);
   static QTreeLeafNode* getLeafStatic(QTreeNode* root, uint32_t x, uint32_t y);
   QTreeLeafNode* createLeaf(uint32_t x, uint32_t y, uint32_t level);
+  // Appends every tile below this node
+  void getTiles(std::vector<Tile*>& list) const;
 
 protected:
   bool m_isLeaf;
@@ -121,12 +123,17 @@ public:
   void addCreature(Creature* c);
   void removeCreature(Creature* c);
 
+  // Creatures with hear listeners are also kept apart, so says only visit them
+  void addHearer(Creature* c);
+  void removeHearer(Creature* c);
+
 protected:
   static bool newLeaf;
   QTreeLeafNode* m_leafS;
   QTreeLeafNode* m_leafE;
   Floor* m_array[MAP_MAX_LAYERS];
   CreatureVector creature_list;
+  CreatureVector hearer_list;
 
   friend class Map;
   friend class QTreeNode;
@@ -148,10 +155,10 @@ public:
   /**
   * Load a map.
   * \param identifier file/database to load
-  * \param type map type "OTBM", "XML"
+  * \param rebuildImage read the otbm file even if the world image is valid
   * \return true if the map was loaded successfully
   */
-  bool loadMap(const std::string& identifier);
+  bool loadMap(const std::string& identifier, bool rebuildImage = false);
 
   /**
   * Save a map.
@@ -169,6 +176,11 @@ public:
 
   QTreeLeafNode* getLeaf(uint16_t x, uint16_t y){ return root.getLeaf(x, y);}
 
+  /**
+  * Get every tile of the map, in no particular order.
+  */
+  void getTiles(std::vector<Tile*>& list) const {root.getTiles(list);}
+
   /**
   * Set a single tile.
   * \param a tile to set for the position
@@ -243,11 +255,15 @@ protected:
   std::string housefile;
   SpectatorCache spectatorCache;
 
-  // Actually scans the map for spectators
+  // Actually scans the map for spectators, or only for the hearers
   void getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, bool checkforduplicate,
     int32_t minRangeX, int32_t maxRangeX,
     int32_t minRangeY, int32_t maxRangeY,
-    int32_t minRangeZ, int32_t maxRangeZ);
+    int32_t minRangeZ, int32_t maxRangeZ,
+    bool onlyHearers = false);
+
+  static void getFloorRange(const Position& centerPos, bool multifloor,
+    int32_t& minRangeZ, int32_t& maxRangeZ);
 
   // Use this when a custom spectator vector is needed, this support many
   // more parameters than the heavily cached version below.
@@ -260,6 +276,11 @@ protected:
   // that calls clearSpectatorCache is called.
   const SpectatorVec& getSpectators(const Position& centerPos);
 
+  // The creatures with hear listeners within range of centerPos,
+  // ranges are the same as for getSpectators
+  void getHearers(SpectatorVec& list, const Position& centerPos,
+    bool multifloor, int32_t rangeX, int32_t rangeY);
+
   void clearSpectatorCache();
 
   // Root node of the quad tree
@@ -276,19 +297,9 @@ protected:
   friend class Game;
 
   friend class IOMapOTBM;
+  friend class IOMapImage;
   friend class IOMap;
   friend class IOMapSerialize;
 };
 
-inline void QTreeLeafNode::addCreature(Creature* c) {
-  creature_list.push_back(c);
-}
-
-inline void QTreeLeafNode::removeCreature(Creature* c) {
-  CreatureVector::iterator iter = std::find(creature_list.begin(), creature_list.end(), c);
-  assert(iter != creature_list.end());
-  std::swap(*iter, creature_list.back());
-  creature_list.pop_back();
-}
-
 #endif
@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Slab pools for the game objects created and freed all the time
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "object_pool.h"
+
+namespace {
+  enum {
+    BLOCK_ALIGNMENT = 16,
+    MIN_OBJECTS_PER_SLAB = 8
+  };
+
+  boost::mutex& getPoolsLock()
+  {
+    static boost::mutex lock;
+    return lock;
+  }
+
+  std::vector<ObjectPool*>& getPoolList()
+  {
+    static std::vector<ObjectPool*> pools;
+    return pools;
+  }
+}
+
+ObjectPool::ObjectPool(const char* name, size_t objectSize) :
+  m_name(name),
+  m_objectSize(objectSize),
+  m_lock(false),
+  m_freeBlocks(NULL),
+  m_objectCount(0),
+  m_peakObjectCount(0),
+  m_allocationCount(0)
+{
+  m_blockSize = (std::max(objectSize, sizeof(FreeBlock)) + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+  m_slabSize = std::max((size_t)SLAB_SIZE / m_blockSize, (size_t)MIN_OBJECTS_PER_SLAB) * m_blockSize;
+
+  boost::mutex::scoped_lock lockClass(getPoolsLock());
+  getPoolList().push_back(this);
+}
+
+void ObjectPool::getPools(std::vector<ObjectPool*>& list)
+{
+  boost::mutex::scoped_lock lockClass(getPoolsLock());
+  list = getPoolList();
+}
+
+void ObjectPool::lock()
+{
+  // Whoever holds it may have been preempted, let it run instead of spinning
+  while(m_lock.exchange(true, boost::memory_order_acquire)){
+    boost::this_thread::yield();
+  }
+}
+
+void ObjectPool::unlock()
+{
+  m_lock.store(false, boost::memory_order_release);
+}
+
+bool ObjectPool::addSlab()
+{
+  char* slab = (char*)malloc(m_slabSize);
+  if(!slab){
+    return false;
+  }
+  try{
+    m_slabs.push_back(slab);
+  }
+  catch(std::bad_alloc&){
+    free(slab);
+    return false;
+  }
+
+  // Blocks are handed out in address order
+  for(size_t pos = m_slabSize; pos >= m_blockSize; pos -= m_blockSize){
+    FreeBlock* block = (FreeBlock*)(slab + pos - m_blockSize);
+    block->next = m_freeBlocks;
+    m_freeBlocks = block;
+  }
+  return true;
+}
+
+void* ObjectPool::allocate(size_t size)
+{
+  if(size != m_objectSize){
+    return ::operator new(size);
+  }
+
+  lock();
+  if(!m_freeBlocks && !addSlab()){
+    unlock();
+    throw std::bad_alloc();
+  }
+
+  FreeBlock* block = m_freeBlocks;
+  m_freeBlocks = block->next;
+
+  ++m_allocationCount;
+  if(++m_objectCount > m_peakObjectCount){
+    m_peakObjectCount = m_objectCount;
+  }
+  unlock();
+  return block;
+}
+
+void ObjectPool::release(void* p, size_t size)
+{
+  if(!p){
+    return;
+  }
+
+  if(size != m_objectSize){
+    ::operator delete(p);
+    return;
+  }
+
+  lock();
+  FreeBlock* block = (FreeBlock*)p;
+  block->next = m_freeBlocks;
+  m_freeBlocks = block;
+  --m_objectCount;
+  unlock();
+}
@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Slab pools for the game objects created and freed all the time
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_OBJECT_POOL_H__
+#define __OTSERV_OBJECT_POOL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <boost/atomic.hpp>
+
+/**
+ * Hands out the memory of one class from slabs holding a number of objects
+ * of its size, freed objects go on a free list and are reused first.
+ *
+ * A class uses it through its own operator new and delete. Derived classes
+ * that don't declare them get blocks of another size, those are passed on
+ * to the global operator new.
+ *
+ * Slabs are never returned, objects may still be deleted while the server
+ * shuts down, so the pools themselves are never destroyed either.
+ */
+class ObjectPool
+{
+public:
+  ObjectPool(const char* name, size_t objectSize);
+
+  void* allocate(size_t size);
+  void release(void* p, size_t size);
+
+  const char* getName() const {return m_name;}
+  // Objects currently in use
+  uint32_t getObjectCount() const {return m_objectCount;}
+  uint32_t getPeakObjectCount() const {return m_peakObjectCount;}
+  // Objects allocated since the server started
+  uint64_t getAllocationCount() const {return m_allocationCount;}
+  // Bytes of the slabs held
+  uint64_t getReservedBytes() const {return (uint64_t)m_slabs.size() * m_slabSize;}
+
+  // The pools of the classes allocated so far
+  static void getPools(std::vector<ObjectPool*>& list);
+
+protected:
+  enum {
+    SLAB_SIZE = 64 * 1024
+  };
+
+  struct FreeBlock{
+    FreeBlock* next;
+  };
+
+  bool addSlab();
+  void lock();
+  void unlock();
+
+  const char* m_name;
+  size_t m_objectSize;
+  // Object size rounded up to the alignment malloc gives
+  size_t m_blockSize;
+  size_t m_slabSize;
+
+  // Held for a few instructions only, cheaper than a mutex for that, see
+  // tools/bench/object_pool_bench.cpp
+  boost::atomic<bool> m_lock;
+  FreeBlock* m_freeBlocks;
+  std::vector<char*> m_slabs;
+
+  uint32_t m_objectCount;
+  uint32_t m_peakObjectCount;
+  uint64_t m_allocationCount;
+};
+
+// Declares operator new and delete for a class, the pool is defined by
+// OBJECT_POOL_DEFINE in the source file of the class
+#define OBJECT_POOL_DECLARE() \
+  static void* operator new(size_t size); \
+  static void operator delete(void* p, size_t size); \
+  static ObjectPool& getObjectPool()
+
+#define OBJECT_POOL_DEFINE(Class) \
+  ObjectPool& Class::getObjectPool() \
+  { \
+    static ObjectPool* pool = new ObjectPool(#Class, sizeof(Class)); \
+    return *pool; \
+  } \
+  void* Class::operator new(size_t size) \
+  { \
+    return getObjectPool().allocate(size); \
+  } \
+  void Class::operator delete(void* p, size_t size) \
+  { \
+    getObjectPool().release(p, size); \
+  }
+
+#endif
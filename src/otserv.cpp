@@ -23,8 +23,10 @@
 #include "otsystem.h"
 #include "tasks.h"
 #include "scheduler.h"
+#include "save_writer.h"
 #include "server.h"
 #include "database_driver.h"
+#include "local_storage.h"
 #include "ioplayer.h"
 #include "game.h"
 #include "http_request.h"
@@ -68,6 +70,7 @@
 Game g_game;
 Dispatcher g_dispatcher;
 Scheduler g_scheduler;
+SaveWriter g_saveWriter;
 RSA g_RSA;
 ConfigManager g_config;
 CreatureManager g_creature_types;
@@ -105,6 +108,7 @@ void ErrorMessage(std::string m){
 struct CommandLineOptions{
   std::string configfile;
   bool truncate_log;
+  bool build_world_image;
   std::string logfile;
   std::string errfile;
 #if !defined(__WINDOWS__)
@@ -246,6 +250,7 @@ int main(int argc, char *argv[])
   // Start scheduler and dispatcher threads
   g_dispatcher.start();
   g_scheduler.start();
+  g_saveWriter.start();
 
   // Add load task
   g_dispatcher.addTask(createTask(boost::bind(mainLoader, g_command_opts, &servicer)));
@@ -266,6 +271,10 @@ int main(int argc, char *argv[])
 #endif
   g_scheduler.shutdownAndWait();
   g_dispatcher.shutdownAndWait();
+  g_saveWriter.shutdownAndWait();
+#ifdef __USE_LOCAL_STORAGE__
+  LocalStorage::instance()->close();
+#endif
   // Don't run destructors, may hang!
   exit(EXIT_SUCCESS);
 
@@ -277,6 +286,7 @@ CommandLineOptions parseCommandLine(std::vector<std::string> args)
   CommandLineOptions opts;
   std::vector<std::string>::iterator argi = args.begin();
   opts.truncate_log = false;
+  opts.build_world_image = false;
 
   if(argi != args.end()){
     ++argi;
@@ -330,6 +340,9 @@ CommandLineOptions parseCommandLine(std::vector<std::string> args)
     else if(arg == "--truncate-log"){
       opts.truncate_log = true;
     }
+    else if(arg == "--build-world-image"){
+      opts.build_world_image = true;
+    }
     else if(arg == "-l" || arg == "--log-file"){
       if(++argi == args.end()){
         std::cout << "Missing parameter 1 for '" << arg << "'" << std::endl;
@@ -358,7 +371,9 @@ CommandLineOptions parseCommandLine(std::vector<std::string> args)
       "\t\t\t\tof the server process as long as it is running \n\t\t\t\t(UNIX).\n"
       #endif
       "\t--truncate-log\t\tReset log file each time the server is \n"
-      "\t\t\t\tstarted.\n";
+      "\t\t\t\tstarted.\n"
+      "\t--build-world-image\tWrite the world image from the map files\n"
+      "\t\t\t\tand exit.\n";
       exit(EXIT_SUCCESS);
     }
     else if(arg == "--version"){
@@ -384,11 +399,71 @@ void badAllocationHandler()
   exit(EXIT_FAILURE);
 }
 
+// Time since a loading phase started, printed after its [done]
+class PhaseTimer {
+public:
+  PhaseTimer() : start(OTSYS_TIME()) {}
+  void restart() {start = OTSYS_TIME();}
+  double seconds() const {return (OTSYS_TIME() - start) / 1000.;}
+
+protected:
+  int64_t start;
+};
+
+std::ostream& operator<<(std::ostream& os, const PhaseTimer& timer)
+{
+  return os << "(" << timer.seconds() << " s)";
+}
+
+// Brings a database of an older schema version up to date, one version at a
+// time. Returns the version the database is at afterwards, 0 on errors.
+int32_t upgradeSchema(DatabaseDriver* db)
+{
+  DBResult_ptr result = db->storeQuery("SELECT `value` FROM `schema_info` WHERE `name` = 'version'");
+  if(!result){
+    return 0;
+  }
+
+  int32_t oldVersion = result->getDataInt("value");
+  int32_t version = oldVersion;
+  const std::string& sqlType = g_config.getString(ConfigManager::SQL_TYPE);
+
+  if(version == 25){
+    // The binary player record
+    DBQuery query;
+    query << "ALTER TABLE `players` ADD `record` ";
+    if(sqlType == "mysql")
+      query << "MEDIUMBLOB";
+    else if(sqlType == "pgsql")
+      query << "BYTEA";
+    else
+      query << "BLOB";
+    query << " NULL";
+
+    if(!db->executeQuery(query)){
+      return 0;
+    }
+    version = 26;
+  }
+
+  if(version != oldVersion){
+    DBQuery query;
+    query << "UPDATE `schema_info` SET `value` = '" << version << "' WHERE `name` = 'version'";
+    if(!db->executeQuery(query)){
+      return 0;
+    }
+  }
+  return version;
+}
+
 void mainLoader(const CommandLineOptions& command_opts, ServiceManager* service_manager)
 {
   //dispatcher thread
   g_game.setGameState(GAME_STATE_STARTUP);
 
+  PhaseTimer startup;
+  PhaseTimer phase;
+
   // random numbers generator
   std::cout << ":: Initializing the random numbers... " << std::flush;
   std::srand((unsigned int)OTSYS_TIME());
@@ -477,13 +552,36 @@ void mainLoader(const CommandLineOptions& command_opts, ServiceManager* service_
   std::cout << "[done]" << std::endl;
 
   std::cout << ":: Checking Connection to Database " << g_config.getString(ConfigManager::SQL_DB) << "... ";
+  phase.restart();
   DatabaseDriver* db = DatabaseDriver::instance();
   if(db == NULL || !db->isConnected())
   {
     ErrorMessage("Database Connection Failed!");
     exit(EXIT_FAILURE);
   }
-  std::cout << "[done]" << std::endl;
+  std::cout << "[done] " << phase << std::endl;
+
+  if(!g_config.getString(ConfigManager::LOCAL_STORAGE_FILE).empty()){
+#ifdef __USE_LOCAL_STORAGE__
+    std::cout << ":: Opening local storage " << g_config.getString(ConfigManager::LOCAL_STORAGE_FILE) << "... " << std::flush;
+    if(!LocalStorage::instance()->open(g_config.getString(ConfigManager::LOCAL_STORAGE_FILE))){
+      ErrorMessage("Could not open the local storage!");
+      exit(EXIT_FAILURE);
+    }
+    std::cout << "[done]" << std::endl;
+#else
+    ErrorMessage("Local storage is not supported by this build, rebuild with USE_LOCAL_STORAGE.");
+    exit(EXIT_FAILURE);
+#endif
+  }
+
+  std::cout << ":: Upgrading database schema... " << std::flush;
+  int32_t schemaVersion = upgradeSchema(db);
+  if(schemaVersion == 0){
+    ErrorMessage("Could not upgrade the database schema! Does `schema_info` exist?");
+    exit(EXIT_FAILURE);
+  }
+  std::cout << "[done] version " << schemaVersion << std::endl;
 
   std::cout << ":: NO DATABASE VERSION CHECK, TURN ON AGAIN WHEN SCHEMA IS STABLE!" << std::endl;
   /*
@@ -513,6 +611,13 @@ void mainLoader(const CommandLineOptions& command_opts, ServiceManager* service_
   }
   std::cout << "[done]" << std::endl;
 
+  if(g_config.getNumber(ConfigManager::PLAYER_CACHE_WARM)){
+    std::cout << ":: Warming player cache... " << std::flush;
+    phase.restart();
+    uint32_t count = IOPlayer::instance()->warmCache();
+    std::cout << "[done] " << count << " players " << phase << std::endl;
+  }
+
 
   //load RSA key
   std::cout << ":: Loading RSA key... " << std::flush;
@@ -528,59 +633,96 @@ void mainLoader(const CommandLineOptions& command_opts, ServiceManager* service_
   filename.str("");
   filename << g_config.getString(ConfigManager::DATA_DIRECTORY) << "vocations.xml";
   std::cout << ":: Loading " << filename.str() << "... " << std::flush;
+  phase.restart();
   if(!g_vocations.loadFromXml(g_config.getString(ConfigManager::DATA_DIRECTORY))){
     ErrorMessage("Unable to load vocations!");
     exit(EXIT_FAILURE);
   }
-  std::cout << "[done]" << std::endl;
+  std::cout << "[done] " << phase << std::endl;
 
   // load item data
-  filename.str("");
-  filename << g_config.getString(ConfigManager::DATA_DIRECTORY) << "items/items.otb";
-  std::cout << ":: Loading " << filename.str() << "... " << std::flush;
-  if(Item::items.loadFromOtb(filename.str())){
-    std::stringstream errormsg;
-    errormsg << "Unable to load " << filename.str() << "!";
-    ErrorMessage(errormsg.str().c_str());
-    exit(EXIT_FAILURE);
+  std::string itemsOtb = g_config.getString(ConfigManager::DATA_DIRECTORY) + "items/items.otb";
+  std::string itemsXml = g_config.getString(ConfigManager::DATA_DIRECTORY) + "items/items.xml";
+  std::string itemsCache;
+  uint64_t itemsHash = 0;
+  bool itemsCached = false;
+
+  if(!g_config.getString(ConfigManager::ITEM_CACHE_FILE).empty()){
+    itemsCache = g_config.getString(ConfigManager::DATA_DIRECTORY) + g_config.getString(ConfigManager::ITEM_CACHE_FILE);
+    std::cout << ":: Loading " << itemsCache << "... " << std::flush;
+    phase.restart();
+    if(!Items::hashSourceFiles(itemsOtb, itemsXml, itemsHash)){
+      std::cout << "[skipped]" << std::endl;
+      itemsCache.clear();
+    }
+    else if(Item::items.loadFromCache(itemsCache, itemsHash)){
+      std::cout << "[done] " << phase << std::endl;
+      itemsCached = true;
+    }
+    else{
+      std::cout << "[outdated]" << std::endl;
+    }
   }
-  std::cout << "[done]" << std::endl;
 
-  filename.str("");
-  filename << g_config.getString(ConfigManager::DATA_DIRECTORY) << "items/items.xml";
-  std::cout << ":: Loading " << filename.str() << "... " << std::flush;
-  if(!Item::items.loadFromXml(g_config.getString(ConfigManager::DATA_DIRECTORY))){
-    std::stringstream errormsg;
-    errormsg << "Unable to load " << filename.str() << "!";
-    ErrorMessage(errormsg.str().c_str());
-    exit(EXIT_FAILURE);
+  if(!itemsCached){
+    std::cout << ":: Loading " << itemsOtb << "... " << std::flush;
+    phase.restart();
+    if(Item::items.loadFromOtb(itemsOtb)){
+      std::stringstream errormsg;
+      errormsg << "Unable to load " << itemsOtb << "!";
+      ErrorMessage(errormsg.str().c_str());
+      exit(EXIT_FAILURE);
+    }
+    std::cout << "[done] " << phase << std::endl;
+
+    std::cout << ":: Loading " << itemsXml << "... " << std::flush;
+    phase.restart();
+    if(!Item::items.loadFromXml(g_config.getString(ConfigManager::DATA_DIRECTORY))){
+      std::stringstream errormsg;
+      errormsg << "Unable to load " << itemsXml << "!";
+      ErrorMessage(errormsg.str().c_str());
+      exit(EXIT_FAILURE);
+    }
+    std::cout << "[done] " << phase << std::endl;
+
+    if(!itemsCache.empty()){
+      std::cout << ":: Writing " << itemsCache << "... " << std::flush;
+      phase.restart();
+      if(Item::items.saveToCache(itemsCache, itemsHash)){
+        std::cout << "[done] " << phase << std::endl;
+      }
+      else{
+        std::cout << "[failed]" << std::endl;
+      }
+    }
   }
-  std::cout << "[done]" << std::endl;
 
   // load monster data
   filename.str("");
   filename << g_config.getString(ConfigManager::DATA_DIRECTORY) << "monster/monsters.xml";
   std::cout << ":: Loading " << filename.str() << "... " << std::flush;
+  phase.restart();
   if(!g_creature_types.loadFromXml(g_config.getString(ConfigManager::DATA_DIRECTORY))){
     std::stringstream errormsg;
     errormsg << "Unable to load " << filename.str() << "!";
     ErrorMessage(errormsg.str().c_str());
     exit(EXIT_FAILURE);
   }
-  std::cout << "[done]" << std::endl;
+  std::cout << "[done] " << phase << std::endl;
 
   //load admin protocol configuration
   filename.str("");
   filename << g_config.getString(ConfigManager::DATA_DIRECTORY) << "admin.xml";
   g_adminConfig = new AdminProtocolConfig();
   std::cout << ":: Loading admin protocol config... " << std::flush;
+  phase.restart();
   if(!g_adminConfig->loadXMLConfig(g_config.getString(ConfigManager::DATA_DIRECTORY))){
     std::stringstream errormsg;
     errormsg << "Unable to load " << filename.str() << "!";
     ErrorMessage(errormsg.str().c_str());
     exit(EXIT_FAILURE);
   }
-  std::cout << "[done]" << std::endl;
+  std::cout << "[done] " << phase << std::endl;
 
   //set world type
   std::string worldType = g_config.getString(ConfigManager::WORLD_TYPE);
@@ -621,18 +763,29 @@ void mainLoader(const CommandLineOptions& command_opts, ServiceManager* service_
   if(g_config.getString(ConfigManager::PASSWORD_SALT) != "")
     std::cout << " [salted]";
   std::cout << std::endl;
-  if(!g_game.loadMap(g_config.getString(ConfigManager::MAP_FILE))){
+  if(command_opts.build_world_image && g_config.getString(ConfigManager::WORLD_IMAGE_FILE).empty()){
+    ErrorMessage("No world_image_file is set!");
+    exit(EXIT_FAILURE);
+  }
+
+  phase.restart();
+  if(!g_game.loadMap(g_config.getString(ConfigManager::MAP_FILE), command_opts.build_world_image)){
     // ok ... so we didn't succeed in loading the map.
     // perhaps the path to map didn't include path to data directory?
     // let's try to prepend path to datadir before bailing out miserably.
     filename.str("");
     filename << g_config.getString(ConfigManager::DATA_DIRECTORY) << g_config.getString(ConfigManager::MAP_FILE);
 
-    if(!g_game.loadMap(filename.str())){
+    if(!g_game.loadMap(filename.str(), command_opts.build_world_image)){
       ErrorMessage("Couldn't load map");
       exit(EXIT_FAILURE);
     }
   }
+  std::cout << ":: Map loaded " << phase << std::endl;
+
+  if(command_opts.build_world_image){
+    exit(EXIT_SUCCESS);
+  }
 
   // Load world
   DBResult_ptr world_result;
@@ -661,8 +814,10 @@ void mainLoader(const CommandLineOptions& command_opts, ServiceManager* service_
   // Setup scripts
   std::cout << "::" << std::endl;
   std::cout << ":: Loading Scripts ..." << std::endl;
+  phase.restart();
   try {
     g_game.loadScripts();
+    std::cout << ":: Scripts loaded " << phase << std::endl;
     std::cout << "::" << std::endl;
   } catch(Script::Error& err){
     std::cout << std::endl << err.what() << std::endl;
@@ -808,6 +963,7 @@ void mainLoader(const CommandLineOptions& command_opts, ServiceManager* service_
 
   //
   std::cout << "::" << std::endl;
+  std::cout << ":: Loaded " << startup << std::endl;
   std::cout << ":: Starting Server " << world_name << "... ";
 
   Status* status = Status::instance();
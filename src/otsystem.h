@@ -40,6 +40,15 @@ inline int64_t OTSYS_TIME()
   return ((int64_t)t.millitm) + ((int64_t)t.time) * 1000;
 }
 
+// Monotonic, only meant for measuring durations
+inline int64_t OTSYS_TIME_MICRO()
+{
+  LARGE_INTEGER counter, frequency;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  return (int64_t)(counter.QuadPart * 1000000 / frequency.QuadPart);
+}
+
 typedef int socklen_t;
 
 #else  // #if defined __WINDOWS__
@@ -61,6 +70,14 @@ inline int64_t OTSYS_TIME()
   return ((int64_t)t.millitm) + ((int64_t)t.time) * 1000;
 }
 
+// Monotonic, only meant for measuring durations
+inline int64_t OTSYS_TIME_MICRO()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((int64_t)t.tv_nsec) / 1000 + ((int64_t)t.tv_sec) * 1000000;
+}
+
 #ifndef SOCKET
 #define SOCKET int
 #endif
@@ -50,6 +50,8 @@ uint32_t Player::channelStatementGuid = 0;
 uint32_t Player::playerCount = 0;
 #endif
 
+OBJECT_POOL_DEFINE(Player)
+
 Player::Player(const std::string& _name, ProtocolGame* p) :
 Creature()
 {
@@ -931,7 +933,7 @@ bool Player::canWalkthrough(const Creature* creature) const
   }
 
   if(g_game.getWorldType().value() == enums::WORLD_TYPE_NOPVP){
-    return getTile()->ground->getID() != ITEM_GLOWING_SWITCH;
+    return getTile()->getSharedGround()->getID() != ITEM_GLOWING_SWITCH;
   }
 
   return false;
@@ -1564,6 +1566,14 @@ void Player::onCreatureDisappear(const Creature* creature, bool isLogout)
     g_game.onPlayerShopClose(this);
     g_chat.removeUserFromAllChannels(this);
 
+    // Items stop decaying while the player is away, the time they have
+    // left is saved with them
+    for(SlotType::iterator slot = SLOT_FIRST; slot < SLOT_LAST; ++slot){
+      if(Item* item = getInventoryItem(*slot)){
+        g_game.stopDecay(item);
+      }
+    }
+
     lastLogout = time(NULL);
     IOPlayer::instance()->updateLogoutInfo(this);
 
@@ -3111,9 +3121,14 @@ uint32_t Player::__getItemTypeCount(uint16_t itemId, int32_t subType /*= -1*/) c
         count += Item::countByType(item, subType);
       }
       else if(Container* container = item->getContainer()){
-        for(ContainerIterator it = container->begin(), end = container->end(); it != end; ++it){
-          if((*it)->getID() == itemId){
-            count += Item::countByType(*it, subType);
+        if(subType == -1){
+          count += container->getContentItemCount(itemId);
+        }
+        else if(container->getContentItemCount(itemId) != 0){
+          for(ContainerIterator it = container->begin(), end = container->end(); it != end; ++it){
+            if((*it)->getID() == itemId){
+              count += Item::countByType(*it, subType);
+            }
           }
         }
       }
@@ -27,6 +27,7 @@
 #include "cylinder.h"
 #include "vocation.h"
 #include "protocolgame.h"
+#include "object_pool.h"
 
 enum skillsid_t {
   SKILL_LEVEL=0,
@@ -82,6 +83,7 @@ public:
 
   Player(const std::string& name, ProtocolGame* p);
   virtual ~Player();
+  OBJECT_POOL_DECLARE();
 
   virtual Player* getPlayer() {return this;}
   virtual const Player* getPlayer() const {return this;}
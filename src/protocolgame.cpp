@@ -691,8 +691,8 @@ void ProtocolGame::GetTileDescription(const Tile* tile, NetworkMessage_ptr msg)
 {
   if(tile){
     int count = 0;
-    if(tile->ground){
-      msg->AddItem(tile->ground);
+    if(const Item* ground = tile->getSharedGround()){
+      msg->AddItem(ground);
       count++;
     }
 
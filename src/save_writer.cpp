@@ -0,0 +1,194 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Background writer for game state snapshots
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include "save_writer.h"
+#include "database_driver.h"
+#include "tasks.h"
+
+#if defined __EXCEPTION_TRACER__
+#include "exception.h"
+#endif
+
+bool SaveRecord::commit(DatabaseDriver* db) const
+{
+  // Holds the database lock for the whole record
+  DBQuery query;
+
+  if(statements.empty()){
+    return true;
+  }
+
+  if(!guard.empty()){
+    query << guard;
+    if(!db->storeQuery(query)){
+      return true;
+    }
+  }
+
+  DBTransaction transaction(db);
+  if(!transaction.begin())
+    return false;
+
+  for(std::vector<std::string>::const_iterator it = statements.begin(); it != statements.end(); ++it){
+    if(!db->executeQuery(*it)){
+      return false;
+    }
+  }
+
+  return transaction.commit();
+}
+
+SaveRecord& SaveSnapshot::addRecord()
+{
+  records.push_back(SaveRecord());
+  return records.back();
+}
+
+SaveWriter::SaveWriter()
+{
+  m_threadState = STATE_TERMINATED;
+}
+
+void SaveWriter::start()
+{
+  assert(m_threadState == STATE_TERMINATED);
+  m_threadState = STATE_RUNNING;
+  m_thread = boost::thread(boost::bind(&SaveWriter::writerThread, (void*)this));
+}
+
+void SaveWriter::shutdownAndWait()
+{
+  m_snapshotLock.lock();
+  m_threadState = STATE_CLOSING;
+  m_snapshotLock.unlock();
+  m_snapshotSignal.notify_one();
+
+  // Pending snapshots are still written before the thread exits
+  m_thread.join();
+}
+
+void SaveWriter::writerThread(void* p)
+{
+  SaveWriter* writer = (SaveWriter*)p;
+  #if defined __EXCEPTION_TRACER__
+  ExceptionHandler writerExceptionHandler;
+  writerExceptionHandler.InstallHandler();
+  #endif
+
+  boost::unique_lock<boost::mutex> snapshotLockUnique(writer->m_snapshotLock, boost::defer_lock);
+
+  while(true){
+    snapshotLockUnique.lock();
+
+    while(writer->m_snapshotList.empty() && writer->m_threadState == STATE_RUNNING){
+      writer->m_snapshotSignal.wait(snapshotLockUnique);
+    }
+
+    if(writer->m_snapshotList.empty()){
+      // closing and nothing left to write
+      writer->m_threadState = STATE_TERMINATED;
+      snapshotLockUnique.unlock();
+      break;
+    }
+
+    // The snapshot stays queued until it is written, so flush() waits for it
+    SaveSnapshot* snapshot = writer->m_snapshotList.front();
+    snapshotLockUnique.unlock();
+
+    // Snapshots are only taken once the server is loaded, so is the database
+    DatabaseDriver* db = DatabaseDriver::instance();
+
+    bool success = true;
+    for(std::list<SaveRecord>::const_iterator it = snapshot->records.begin(); it != snapshot->records.end(); ++it){
+      if(!it->commit(db)){
+        success = false;
+      }
+    }
+
+    if(snapshot->callback){
+      g_dispatcher.addTask(createTask(boost::bind(snapshot->callback, success)));
+    }
+
+    snapshotLockUnique.lock();
+    writer->m_snapshotList.pop_front();
+    bool idle = writer->m_snapshotList.empty();
+    snapshotLockUnique.unlock();
+
+    delete snapshot;
+
+    if(idle){
+      writer->m_idleSignal.notify_all();
+    }
+  }
+
+  writer->m_idleSignal.notify_all();
+
+#if defined __EXCEPTION_TRACER__
+  writerExceptionHandler.RemoveHandler();
+#endif
+}
+
+void SaveWriter::addSnapshot(SaveSnapshot* snapshot)
+{
+  bool do_signal = false;
+  m_snapshotLock.lock();
+  if(m_threadState == STATE_RUNNING){
+    do_signal = m_snapshotList.empty();
+    m_snapshotList.push_back(snapshot);
+  }
+  else{
+    std::cout << "Error: [SaveWriter::addSnapshot] Writer thread is not running." << std::endl;
+    delete snapshot;
+  }
+  m_snapshotLock.unlock();
+
+  if(do_signal){
+    m_snapshotSignal.notify_one();
+  }
+}
+
+void SaveWriter::flush()
+{
+  boost::unique_lock<boost::mutex> snapshotLockUnique(m_snapshotLock);
+  while(!m_snapshotList.empty() && m_threadState != STATE_TERMINATED){
+    m_idleSignal.wait(snapshotLockUnique);
+  }
+}
+
+void SaveWriter::discardPlayer(uint32_t guid)
+{
+  // Records are only read by the writer while it holds the database lock,
+  // which our caller holds now
+  boost::mutex::scoped_lock snapshotLock(m_snapshotLock);
+  for(std::list<SaveSnapshot*>::iterator it = m_snapshotList.begin(); it != m_snapshotList.end(); ++it){
+    for(std::list<SaveRecord>::iterator rit = (*it)->records.begin(); rit != (*it)->records.end(); ++rit){
+      if(rit->playerGuid == guid){
+        rit->clear();
+      }
+    }
+  }
+}
+
+bool SaveWriter::isBusy()
+{
+  boost::mutex::scoped_lock snapshotLock(m_snapshotLock);
+  return !m_snapshotList.empty();
+}
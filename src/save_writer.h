@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Background writer for game state snapshots
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_SAVE_WRITER_H__
+#define __OTSERV_SAVE_WRITER_H__
+
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <list>
+#include <string>
+#include <vector>
+
+class DatabaseDriver;
+
+/**
+ * A single unit of persistent state (a player, the house items, the global
+ * storage) rendered into the statements that store it. Once built it does
+ * not reference any game object, so it can be written from any thread.
+ */
+class SaveRecord
+{
+public:
+  SaveRecord() : playerGuid(0) {}
+
+  /**
+   * Executes the statements inside one transaction.
+   * The record is skipped if the guard query returns no rows.
+   *
+   * @return true on success, false on error
+   */
+  bool commit(DatabaseDriver* db) const;
+
+  void clear() {guard.clear(); statements.clear();}
+
+  // Player the record belongs to, 0 for non-player state
+  uint32_t playerGuid;
+  std::string guard;
+  std::vector<std::string> statements;
+};
+
+/**
+ * Copy of the persistent game state taken on the dispatcher.
+ * The save is only complete when the writer committed every record,
+ * after that the callback is run on the dispatcher with the result.
+ */
+class SaveSnapshot
+{
+public:
+  SaveSnapshot() {}
+
+  SaveRecord& addRecord();
+
+  std::list<SaveRecord> records;
+  boost::function<void (bool)> callback;
+};
+
+class SaveWriter
+{
+public:
+  SaveWriter();
+  ~SaveWriter() {}
+
+  void start();
+  void shutdownAndWait();
+
+  // Takes ownership of the snapshot and queues it for writing
+  void addSnapshot(SaveSnapshot* snapshot);
+
+  // Blocks until every queued snapshot has been written
+  void flush();
+
+  // Drops queued records of a player that was saved synchronously since.
+  // The caller must hold the database lock (a DBQuery).
+  void discardPlayer(uint32_t guid);
+
+  bool isBusy();
+
+  enum WriterState{
+    STATE_RUNNING,
+    STATE_CLOSING,
+    STATE_TERMINATED
+  };
+
+protected:
+  static void writerThread(void* p);
+
+  boost::thread m_thread;
+  boost::mutex m_snapshotLock;
+  boost::condition_variable m_snapshotSignal;
+  boost::condition_variable m_idleSignal;
+
+  std::list<SaveSnapshot*> m_snapshotList;
+  WriterState m_threadState;
+};
+
+extern SaveWriter g_saveWriter;
+
+#endif
@@ -0,0 +1,311 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Lua bindings generated from C++ function signatures
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_SCRIPT_BINDING_H__
+#define __OTSERV_SCRIPT_BINDING_H__
+
+#include <string>
+#include <sstream>
+#include <boost/type_traits/remove_cv.hpp>
+#include <boost/type_traits/remove_reference.hpp>
+#include "lua_manager.h"
+
+namespace Script {
+
+  ///////////////////////////////////////////////////////////////////////////////
+  // Argument and return value conversion
+  //
+  // Only types with a specialization can be bound, anything else fails to
+  // compile. Arguments are popped from the top of the stack, so last first.
+
+  template<class T> struct LuaArgument;
+
+  template<> struct LuaArgument<bool> {
+    static const char* typeName() {return "boolean";}
+    static bool check(LuaState& state) {return state.isBoolean(-1);}
+    static bool pop(LuaState& state) {return state.popBoolean();}
+  };
+
+  template<> struct LuaArgument<int32_t> {
+    static const char* typeName() {return "number";}
+    static bool check(LuaState& state) {return state.isNumber(-1);}
+    static int32_t pop(LuaState& state) {return state.popInteger();}
+  };
+
+  template<> struct LuaArgument<uint32_t> {
+    static const char* typeName() {return "number";}
+    static bool check(LuaState& state) {return state.isNumber(-1);}
+    static uint32_t pop(LuaState& state) {return state.popUnsignedInteger();}
+  };
+
+  template<> struct LuaArgument<double> {
+    static const char* typeName() {return "number";}
+    static bool check(LuaState& state) {return state.isNumber(-1);}
+    static double pop(LuaState& state) {return state.popFloat();}
+  };
+
+  template<> struct LuaArgument<std::string> {
+    static const char* typeName() {return "string";}
+    static bool check(LuaState& state) {return state.isString(-1);}
+    static std::string pop(LuaState& state) {return state.popString();}
+  };
+
+  // Class instances are checked by the pop functions, which throw
+  template<> struct LuaArgument<Thing*> {
+    static const char* typeName() {return "Thing";}
+    static bool check(LuaState&) {return true;}
+    static Thing* pop(LuaState& state) {return state.popThing();}
+  };
+
+  template<> struct LuaArgument<Creature*> {
+    static const char* typeName() {return "Creature";}
+    static bool check(LuaState&) {return true;}
+    static Creature* pop(LuaState& state) {return state.popCreature();}
+  };
+
+  template<> struct LuaArgument<Player*> {
+    static const char* typeName() {return "Player";}
+    static bool check(LuaState&) {return true;}
+    static Player* pop(LuaState& state) {return state.popPlayer();}
+  };
+
+  template<> struct LuaArgument<Item*> {
+    static const char* typeName() {return "Item";}
+    static bool check(LuaState&) {return true;}
+    static Item* pop(LuaState& state) {return state.popItem();}
+  };
+
+  template<> struct LuaArgument<Tile*> {
+    static const char* typeName() {return "Tile";}
+    static bool check(LuaState&) {return true;}
+    static Tile* pop(LuaState& state) {return state.popTile();}
+  };
+
+  template<class T> struct LuaResult;
+
+  template<> struct LuaResult<bool> {
+    static void push(LuaState& state, bool b) {state.pushBoolean(b);}
+  };
+
+  template<> struct LuaResult<int32_t> {
+    static void push(LuaState& state, int32_t i) {state.pushInteger(i);}
+  };
+
+  template<> struct LuaResult<uint32_t> {
+    static void push(LuaState& state, uint32_t ui) {state.pushUnsignedInteger(ui);}
+  };
+
+  template<> struct LuaResult<uint16_t> {
+    static void push(LuaState& state, uint16_t i) {state.pushInteger(i);}
+  };
+
+  template<> struct LuaResult<double> {
+    static void push(LuaState& state, double d) {state.pushFloat(d);}
+  };
+
+  template<> struct LuaResult<std::string> {
+    static void push(LuaState& state, const std::string& str) {state.pushString(str);}
+  };
+
+  template<> struct LuaResult<Position> {
+    static void push(LuaState& state, const Position& pos) {state.pushPosition(pos);}
+  };
+
+  template<> struct LuaResult<Tile*> {
+    static void push(LuaState& state, Tile* tile) {state.pushTile(tile);}
+  };
+
+  // Any other pointer is a Thing, NULL is pushed as nil
+  template<class T> struct LuaResult<T*> {
+    static void push(LuaState& state, T* thing) {state.pushThing(thing);}
+  };
+
+  template<class T> struct BindingType {
+    typedef typename boost::remove_cv<typename boost::remove_reference<T>::type>::type type;
+  };
+
+  template<class T>
+  inline typename BindingType<T>::type popArgument(LuaState& state, const std::string& function_name, int32_t n)
+  {
+    typedef LuaArgument<typename BindingType<T>::type> Argument;
+    if(!Argument::check(state)) {
+      std::ostringstream os;
+      os <<
+        "When calling function " <<
+        "'" << function_name << "'" <<
+        " - Expected '" << Argument::typeName() << "' for argument " <<
+        n <<
+        " type was " <<
+        "'" << state.typeName() << "'";
+      throw Error(os.str());
+    }
+    return Argument::pop(state);
+  }
+
+  template<class R>
+  inline int pushResult(LuaState& state, const typename BindingType<R>::type& value)
+  {
+    LuaResult<typename BindingType<R>::type>::push(state, value);
+    return 1;
+  }
+
+  ///////////////////////////////////////////////////////////////////////////////
+  // Bound functions
+  //
+  // The argument count is known when the function is bound, and the type
+  // checks are chosen at compile time, nothing is looked up by name on calls.
+
+  class TypedCallback {
+  public:
+    TypedCallback(const std::string& name, int32_t argument_count) :
+      name(name), argument_count(argument_count) {}
+    virtual ~TypedCallback() {}
+
+    // Arguments are on the stack, returns the number of return values
+    virtual int call(LuaState& state) = 0;
+
+    std::string name;
+    int32_t argument_count;
+  };
+
+  template<class R, class C>
+  class ConstMemberCallback : public TypedCallback {
+  public:
+    typedef R (C::*Function)() const;
+    ConstMemberCallback(const std::string& name, Function func) : TypedCallback(name, 1), func(func) {}
+
+    virtual int call(LuaState& state) {
+      C* self = popArgument<C*>(state, name, 1);
+      return pushResult<R>(state, (self->*func)());
+    }
+  protected:
+    Function func;
+  };
+
+  template<class R, class C>
+  class MemberCallback : public TypedCallback {
+  public:
+    typedef R (C::*Function)();
+    MemberCallback(const std::string& name, Function func) : TypedCallback(name, 1), func(func) {}
+
+    virtual int call(LuaState& state) {
+      C* self = popArgument<C*>(state, name, 1);
+      return pushResult<R>(state, (self->*func)());
+    }
+  protected:
+    Function func;
+  };
+
+  template<class R>
+  class FunctionCallback0 : public TypedCallback {
+  public:
+    typedef R (*Function)();
+    FunctionCallback0(const std::string& name, Function func) : TypedCallback(name, 0), func(func) {}
+
+    virtual int call(LuaState& state) {
+      return pushResult<R>(state, func());
+    }
+  protected:
+    Function func;
+  };
+
+  template<class R, class A1>
+  class FunctionCallback1 : public TypedCallback {
+  public:
+    typedef R (*Function)(A1);
+    FunctionCallback1(const std::string& name, Function func) : TypedCallback(name, 1), func(func) {}
+
+    virtual int call(LuaState& state) {
+      typename BindingType<A1>::type a1 = popArgument<A1>(state, name, 1);
+      return pushResult<R>(state, func(a1));
+    }
+  protected:
+    Function func;
+  };
+
+  template<class R, class A1, class A2>
+  class FunctionCallback2 : public TypedCallback {
+  public:
+    typedef R (*Function)(A1, A2);
+    FunctionCallback2(const std::string& name, Function func) : TypedCallback(name, 2), func(func) {}
+
+    virtual int call(LuaState& state) {
+      typename BindingType<A2>::type a2 = popArgument<A2>(state, name, 2);
+      typename BindingType<A1>::type a1 = popArgument<A1>(state, name, 1);
+      return pushResult<R>(state, func(a1, a2));
+    }
+  protected:
+    Function func;
+  };
+
+  template<class R, class A1, class A2, class A3>
+  class FunctionCallback3 : public TypedCallback {
+  public:
+    typedef R (*Function)(A1, A2, A3);
+    FunctionCallback3(const std::string& name, Function func) : TypedCallback(name, 3), func(func) {}
+
+    virtual int call(LuaState& state) {
+      typename BindingType<A3>::type a3 = popArgument<A3>(state, name, 3);
+      typename BindingType<A2>::type a2 = popArgument<A2>(state, name, 2);
+      typename BindingType<A1>::type a1 = popArgument<A1>(state, name, 1);
+      return pushResult<R>(state, func(a1, a2, a3));
+    }
+  protected:
+    Function func;
+  };
+
+  template<class R, class C>
+  inline TypedCallback* makeCallback(const std::string& name, R (C::*func)() const)
+  {
+    return new ConstMemberCallback<R, C>(name, func);
+  }
+
+  template<class R, class C>
+  inline TypedCallback* makeCallback(const std::string& name, R (C::*func)())
+  {
+    return new MemberCallback<R, C>(name, func);
+  }
+
+  template<class R>
+  inline TypedCallback* makeCallback(const std::string& name, R (*func)())
+  {
+    return new FunctionCallback0<R>(name, func);
+  }
+
+  template<class R, class A1>
+  inline TypedCallback* makeCallback(const std::string& name, R (*func)(A1))
+  {
+    return new FunctionCallback1<R, A1>(name, func);
+  }
+
+  template<class R, class A1, class A2>
+  inline TypedCallback* makeCallback(const std::string& name, R (*func)(A1, A2))
+  {
+    return new FunctionCallback2<R, A1, A2>(name, func);
+  }
+
+  template<class R, class A1, class A2, class A3>
+  inline TypedCallback* makeCallback(const std::string& name, R (*func)(A1, A2, A3))
+  {
+    return new FunctionCallback3<R, A1, A2, A3>(name, func);
+  }
+}
+
+#endif
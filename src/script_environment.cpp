@@ -24,7 +24,8 @@ using namespace Script;
 
 Environment::Environment()
 {
-  objectID_counter = 0;
+  object_free = 0;
+  object_count = 0;
 }
 
 Environment::~Environment()
@@ -33,14 +34,49 @@ Environment::~Environment()
 
 void Environment::cleanup()
 {
-  object_map.clear();
-  objectID_counter = 0;
+  // Things still point at their old slots, addThing checks for that
+  object_slots.clear();
+  object_index.clear();
+  object_free = 0;
+  object_count = 0;
   Generic.OnSay.clear();
 }
 
 int32_t Environment::countObjects() const
 {
-  return object_map.size();
+  return object_count;
+}
+
+ObjectID Environment::insertObject(void* obj, uint32_t& slot)
+{
+  if(object_free != 0) {
+    slot = object_free - 1;
+    object_free = object_slots[slot].next_free;
+  }
+  else {
+    slot = object_slots.size();
+    ObjectSlot new_slot;
+    new_slot.generation = 1;
+    object_slots.push_back(new_slot);
+  }
+
+  ObjectSlot& entry = object_slots[slot];
+  entry.object = obj;
+  entry.next_free = 0;
+  ++object_count;
+  return makeID(slot, entry.generation);
+}
+
+void Environment::eraseObject(uint32_t slot)
+{
+  ObjectSlot& entry = object_slots[slot];
+  entry.object = NULL;
+  if(++entry.generation > MAX_GENERATION) {
+    entry.generation = 1;
+  }
+  entry.next_free = object_free;
+  object_free = slot + 1;
+  --object_count;
 }
 
 int32_t Environment::countSpecificListeners() const
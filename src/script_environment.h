@@ -20,7 +20,7 @@
 #define __OTSERV_SCRIPT_ENVIRONMENT__
 
 #include "classes.h"
-#include <boost/bimap.hpp>
+#include "thing.h"
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
 #include "enums.h"
@@ -54,8 +54,6 @@ namespace Script {
     int32_t countListeners() const;
     int32_t countSpecificListeners() const;
 
-    typedef boost::bimap<ObjectID, void*> ObjectMap;
-
     // Make sure to use a pointer to the superclass of the object
     ObjectID addThing(Thing* thing);
     ObjectID addObject(void* obj);
@@ -139,84 +137,112 @@ namespace Script {
 
     void debugOutput() const; // noop unless passed preprocessor directive
 
-    ObjectID objectID_counter;
-    ObjectMap object_map;
-
-    ObjectID getFreeID() {
-      return ++objectID_counter;
+    // Objects are kept in a slot table, an ObjectID is the slot + 1 in the
+    // low 32 bits and the generation of the slot above them. A slot gets a
+    // new generation when it is freed so old IDs can't reach the next object.
+    // Lua sees IDs as numbers, so they must fit in the 53 bits of a double.
+    struct ObjectSlot {
+      void* object;
+      uint32_t generation;
+      uint32_t next_free;
+    };
+    enum {MAX_GENERATION = (1 << 21) - 1};
+
+    std::vector<ObjectSlot> object_slots;
+    uint32_t object_free; // slot + 1 of the first free slot, 0 if none
+    uint32_t object_count;
+    // Things point back at their slot, other objects are found here
+    std::map<void*, uint32_t> object_index;
+
+    ObjectID insertObject(void* obj, uint32_t& slot);
+    void eraseObject(uint32_t slot);
+    ObjectSlot* findSlot(ObjectID id);
+    static ObjectID makeID(uint32_t slot, uint32_t generation) {
+      return ((ObjectID)generation << 32) | (ObjectID)(slot + 1);
     }
   };
 
+  inline Environment::ObjectSlot* Environment::findSlot(ObjectID id) {
+    uint32_t slot = (uint32_t)(id & 0xFFFFFFFF) - 1;
+    if(slot >= object_slots.size() || object_slots[slot].generation != (uint32_t)(id >> 32)) {
+      return NULL;
+    }
+    return &object_slots[slot];
+  }
+
   inline ObjectID Environment::addObject(void* obj) {
-    ObjectMap::right_iterator thing_iter = object_map.right.find(obj);
-    if(thing_iter == object_map.right.end()) {
-      ObjectID id = getFreeID();
-      object_map.left.insert(std::make_pair(id, obj));
+    std::map<void*, uint32_t>::iterator obj_iter = object_index.find(obj);
+    if(obj_iter == object_index.end()) {
+      uint32_t slot;
+      ObjectID id = insertObject(obj, slot);
+      object_index.insert(std::make_pair(obj, slot));
 #ifdef __DEBUG_SCRIPT_ENVIRONMENT_OBJECTMAP__
       std::cout << "Added object " << obj << " with id " << id << std::endl;
       debugOutput();
 #endif
       return id;
     }
-    return thing_iter->second;
+    return makeID(obj_iter->second, object_slots[obj_iter->second].generation);
   }
 
   inline ObjectID Environment::addThing(Thing* thing) {
-    ObjectMap::right_iterator thing_iter = object_map.right.find(thing);
-    if(thing_iter == object_map.right.end()) {
-      ObjectID id = getFreeID();
-      object_map.left.insert(std::make_pair(id, reinterpret_cast<void*>(thing)));
+    // The back pointer may be left from before a cleanup, so check the slot
+    uint32_t slot = thing->m_scriptSlot - 1;
+    if(thing->m_scriptSlot == 0 || slot >= object_slots.size() ||
+        object_slots[slot].object != reinterpret_cast<void*>(thing)) {
+      ObjectID id = insertObject(reinterpret_cast<void*>(thing), slot);
+      thing->m_scriptSlot = slot + 1;
 #ifdef __DEBUG_SCRIPT_ENVIRONMENT_OBJECTMAP__
       std::cout << "Added thing " << thing << " with id " << id << std::endl;
       debugOutput();
 #endif
       return id;
     }
-    return thing_iter->second;
+    return makeID(slot, object_slots[slot].generation);
   }
 
   inline bool Environment::reassignThing(Thing* oldthing, Thing* newthing) {
-    ObjectMap::right_iterator obj_iter = object_map.right.find(reinterpret_cast<void*>(oldthing));
-    if(obj_iter == object_map.right.end()) {
+    uint32_t slot = oldthing->m_scriptSlot - 1;
+    if(oldthing->m_scriptSlot == 0 || slot >= object_slots.size() ||
+        object_slots[slot].object != reinterpret_cast<void*>(oldthing)) {
       return false;
     }
-    // Store the ID
-    ObjectID id = obj_iter->second;
-
-    // Remove old
-    object_map.right.erase(obj_iter);
 
-    // Add the new one back in
-    object_map.left.insert(std::make_pair(id, reinterpret_cast<void*>(newthing)));
+    // The new thing takes over the slot, and so the ID
+    object_slots[slot].object = reinterpret_cast<void*>(newthing);
+    newthing->m_scriptSlot = slot + 1;
+    oldthing->m_scriptSlot = 0;
 #ifdef __DEBUG_SCRIPT_ENVIRONMENT_OBJECTMAP__
-    std::cout << "Reassigned thing " << oldthing << " with new ref " << newthing << " using id " << id << std::endl;
+    std::cout << "Reassigned thing " << oldthing << " with new ref " << newthing << " using id " << makeID(slot, object_slots[slot].generation) << std::endl;
     debugOutput();
 #endif
     return true;
   }
 
   inline void* Environment::getObject(ObjectID id) {
-    ObjectMap::left_iterator id_iter = object_map.left.find(id);
-    if(id_iter == object_map.left.end()) {
+    ObjectSlot* slot = findSlot(id);
+    if(slot == NULL) {
       return NULL;
     }
-    return id_iter->second;
+    return slot->object;
   }
 
   inline Thing* Environment::getThing(ObjectID id) {
-    ObjectMap::left_iterator id_iter = object_map.left.find(id);
-    if(id_iter == object_map.left.end()) {
+    ObjectSlot* slot = findSlot(id);
+    if(slot == NULL) {
       return NULL;
     }
-    return reinterpret_cast<Thing*>(id_iter->second);
+    return reinterpret_cast<Thing*>(slot->object);
   }
 
   inline bool Environment::removeObject(ObjectID id) {
-    ObjectMap::left_iterator id_iter = object_map.left.find(id);
-    if(id_iter == object_map.left.end()) {
+    ObjectSlot* slot = findSlot(id);
+    if(slot == NULL) {
       return false;
     }
-    object_map.left.erase(id_iter);
+    // Either a thing, whose back pointer is checked on use, or an indexed object
+    object_index.erase(slot->object);
+    eraseObject((uint32_t)(slot - &object_slots[0]));
 #ifdef __DEBUG_SCRIPT_ENVIRONMENT_OBJECTMAP__
     std::cout << "Removed object with ID " << id << std::endl;
     debugOutput();
@@ -225,11 +251,12 @@ namespace Script {
   }
 
   inline bool Environment::removeObject(void* obj) {
-    ObjectMap::right_iterator obj_iter = object_map.right.find(obj);
-    if(obj_iter == object_map.right.end()) {
+    std::map<void*, uint32_t>::iterator obj_iter = object_index.find(obj);
+    if(obj_iter == object_index.end()) {
       return false;
     }
-    object_map.right.erase(obj_iter);
+    eraseObject(obj_iter->second);
+    object_index.erase(obj_iter);
 #ifdef __DEBUG_SCRIPT_ENVIRONMENT_OBJECTMAP__
     std::cout << "Removed Object " << obj << std::endl;
     debugOutput();
@@ -238,11 +265,16 @@ namespace Script {
   }
 
   inline bool Environment::removeThing(Thing* thing) {
-    ObjectMap::right_iterator thing_iter = object_map.right.find(thing);
-    if(thing_iter == object_map.right.end()) {
+    // Runs for every destroyed thing, most were never seen by a script
+    if(thing->m_scriptSlot == 0) {
+      return false;
+    }
+    uint32_t slot = thing->m_scriptSlot - 1;
+    thing->m_scriptSlot = 0;
+    if(slot >= object_slots.size() || object_slots[slot].object != reinterpret_cast<void*>(thing)) {
       return false;
     }
-    object_map.right.erase(thing_iter);
+    eraseObject(slot);
 #ifdef __DEBUG_SCRIPT_ENVIRONMENT_OBJECTMAP__
     std::cout << "Removed Thing " << thing << std::endl;
     debugOutput();
@@ -252,11 +284,11 @@ namespace Script {
 
   inline void Environment::debugOutput() const {
 #ifdef __DEBUG_SCRIPT_ENVIRONMENT_OBJECTMAP__
-    ObjectMap::left_const_iterator debug_iter = object_map.left.begin();
-    std::cout << "Object map, counter is at " << objectID_counter << " :" << std::endl;
-    while(debug_iter != object_map.left.end()) {
-      std::cout << "\tID: " << debug_iter->first << " ptr: " << debug_iter->second << std::endl;
-      ++debug_iter;
+    std::cout << "Object map, " << object_count << " objects in " << object_slots.size() << " slots :" << std::endl;
+    for(uint32_t slot = 0; slot < object_slots.size(); ++slot) {
+      if(object_slots[slot].object) {
+        std::cout << "\tID: " << makeID(slot, object_slots[slot].generation) << " ptr: " << object_slots[slot].object << std::endl;
+      }
     }
 #endif
   }
@@ -46,7 +46,6 @@ Event::~Event() {
 bool Event::call(Manager& state, Environment& environment, Listener_ptr listener)
 {
   LuaThread_ptr thread = state.newThread(this->getName());
-  state.pop();
 
   // Stack is empty
   // Push callback
@@ -55,9 +54,18 @@ bool Event::call(Manager& state, Environment& environment, Listener_ptr listener
   if(thread->isNil()) {
     thread->HandleError("Attempt to call destroyed '" + getName() + "' listener.");
     thread->pop();
+    state.freeThread(thread);
     return false;
   }
 
+  Profiler& profiler = state.getProfiler();
+  if(profiler.isEnabled()){
+    ProfileEntry* entry = listener->getProfileEntry();
+    if(!entry)
+      entry = profiler.getEntry(*listener, thread->getFunctionSource(), getName());
+    thread->setProfileEntry(entry);
+  }
+
   // Push event
   thread->pushEvent(*this);
   thread->duplicate();
@@ -68,11 +76,10 @@ bool Event::call(Manager& state, Environment& environment, Listener_ptr listener
   int32_t ms = thread->run(1);
   if(ms > 0)
     state.scheduleThread(ms, thread);
-  else
-    state.freeThread(thread);
 
   if(thread->ok() == false) {
     reference = state.unReference(reference);
+    state.freeThread(thread);
     return false;
   }
 
@@ -100,6 +107,9 @@ bool Event::call(Manager& state, Environment& environment, Listener_ptr listener
   reference = state.unReference(reference);
   // removing everything from the stack, we're done
   thread->clearStack();
+  // A waiting thread is freed when it is done
+  if(ms <= 0)
+    state.freeThread(thread);
 
   return !propagate;
 }
@@ -211,7 +221,7 @@ bool OnSay::Event::check_match(const ScriptInformation& info)
 
 bool OnSay::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = speaker->getListeners(ON_SAY_LISTENER);
+  ListenerList_cptr list = speaker->getListeners(ON_SAY_LISTENER);
   if(dispatchEvent<OnSay::Event, ScriptInformation>
       (this, state, environment, list)
     )
@@ -269,6 +279,7 @@ void OnSay::Event::update_instance(Manager& state, Environment& environment, Lua
 // Triggered when a creature hears another creature speak
 
 OnHear::Event::Event(Creature* creature, Creature* talking_creature, const std::string& message, const SpeakClass& speak_class) :
+  hearers(NULL),
   creature(creature),
   talking_creature(talking_creature),
   message(message),
@@ -276,13 +287,40 @@ OnHear::Event::Event(Creature* creature, Creature* talking_creature, const std::
 {
 }
 
+OnHear::Event::Event(const std::list<Creature*>& hearers, Creature* talking_creature, const std::string& message, const SpeakClass& speak_class) :
+  hearers(&hearers),
+  creature(NULL),
+  talking_creature(talking_creature),
+  message(message),
+  speak_class(speak_class)
+{
+}
+
 OnHear::Event::~Event()
 {
 }
 
 bool OnHear::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = creature->getListeners(ON_HEAR_LISTENER);
+  if(!hearers)
+    return dispatchTo(creature, state, environment);
+
+  // Every hearer gets the message, handling it only stops that hearer's listeners
+  bool handled = false;
+  for(std::list<Creature*>::const_iterator it = hearers->begin(); it != hearers->end(); ++it){
+    // Listeners of a previous hearer may have removed this one
+    if(*it == talking_creature || (*it)->isRemoved())
+      continue;
+    if(dispatchTo(*it, state, environment))
+      handled = true;
+  }
+  return handled;
+}
+
+bool OnHear::Event::dispatchTo(Creature* hearer, Manager& state, Environment& environment)
+{
+  creature = hearer;
+  ListenerList_cptr list = creature->getListeners(ON_HEAR_LISTENER);
   if(dispatchEvent<OnHear::Event>(this, state, environment, list))
     return true;
   return false;
@@ -675,9 +713,46 @@ bool OnMoveCreature::Event::isMatch(const ScriptInformation& info, Tile* tile)
   return false;
 }
 
+// Collects the ids on the tile that scripts listen to, action ids are only
+// looked for on tiles flagged with TILEPROP_SCRIPT_HOOK
+static void fetchHookedActionIds(const Tile* tile, const ListenerMap& listeners, std::set<int32_t>& into)
+{
+  if(listeners.empty() || !tile->hasFlag(TILEPROP_SCRIPT_HOOK))
+    return;
+
+  const Item* ground = tile->getSharedGround();
+  if(ground && ground->getActionId() != 0 && listeners.find(ground->getActionId()) != listeners.end()){
+    into.insert(ground->getActionId());
+  }
+
+  for(TileItemConstIterator it = tile->items_begin(); it != tile->items_end(); ++it){
+    int32_t actionId = (*it)->getActionId();
+    if(actionId != 0 && listeners.find(actionId) != listeners.end()){
+      into.insert(actionId);
+    }
+  }
+}
+
+static void fetchHookedItemIds(const Tile* tile, const ListenerMap& listeners, std::set<int32_t>& into)
+{
+  if(listeners.empty())
+    return;
+
+  const Item* ground = tile->getSharedGround();
+  if(ground && listeners.find(ground->getID()) != listeners.end()){
+    into.insert(ground->getID());
+  }
+
+  for(TileItemConstIterator it = tile->items_begin(); it != tile->items_end(); ++it){
+    if(listeners.find((*it)->getID()) != listeners.end()){
+      into.insert((*it)->getID());
+    }
+  }
+}
+
 bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = moving_creature->getListeners(ON_MOVE_CREATURE_LISTENER);
+  ListenerList_cptr list = moving_creature->getListeners(ON_MOVE_CREATURE_LISTENER);
   if(dispatchEvent<OnMoveCreature::Event, ScriptInformation>
       (this, state, environment, list)
     )
@@ -693,7 +768,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
   {
     // Fetch action ids
     id_list.clear();
-    fromTile->items_fetchListWithActionId(id_list);
+    fetchHookedActionIds(fromTile, environment.Generic.OnMoveOutCreature.ActionId, id_list);
 
     // Check action ID matches
     if (!id_list.empty())
@@ -702,7 +777,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
       {
         list_iter = environment.Generic.OnMoveOutCreature.ActionId.find(*id);
         if(list_iter != environment.Generic.OnMoveOutCreature.ActionId.end()){
-          item = fromTile->items_getItemWithActionId(*id);
+          item = fromTile->getOwnItem(fromTile->items_getItemWithActionId(*id));
           if(dispatchEvent<OnMoveCreature::Event>
             (this, state, environment, list_iter->second)){
               return true;
@@ -714,7 +789,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
 
     // Fetch item ids
     id_list.clear();
-    fromTile->items_fetchListWithItemId(id_list);
+    fetchHookedItemIds(fromTile, environment.Generic.OnMoveOutCreature.ItemId, id_list);
 
     // Check item id matches
     if (!id_list.empty())
@@ -723,7 +798,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
       {
         list_iter = environment.Generic.OnMoveOutCreature.ItemId.find(*id);
         if(list_iter != environment.Generic.OnMoveOutCreature.ItemId.end()){
-          item = fromTile->items_getItemWithItemId(*id);
+          item = fromTile->getOwnItem(fromTile->items_getItemWithItemId(*id));
           if(dispatchEvent<OnMoveCreature::Event>
             (this, state, environment, list_iter->second)){
               return true;
@@ -745,7 +820,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
   {
     // Fetch action ids
     id_list.clear();
-    toTile->items_fetchListWithActionId(id_list);
+    fetchHookedActionIds(toTile, environment.Generic.OnMoveInCreature.ActionId, id_list);
 
     // Check action ID matches
     if (!id_list.empty())
@@ -754,7 +829,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
       {
         list_iter = environment.Generic.OnMoveInCreature.ActionId.find(*id);
         if(list_iter != environment.Generic.OnMoveInCreature.ActionId.end()){
-          item = toTile->items_getItemWithActionId(*id);
+          item = toTile->getOwnItem(toTile->items_getItemWithActionId(*id));
           if(dispatchEvent<OnMoveCreature::Event>
             (this, state, environment, list_iter->second)){
               return true;
@@ -766,7 +841,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
 
     // Fetch item ids
     id_list.clear();
-    toTile->items_fetchListWithItemId(id_list);;
+    fetchHookedItemIds(toTile, environment.Generic.OnMoveInCreature.ItemId, id_list);
 
     // Check item id matches
     if (!id_list.empty())
@@ -775,7 +850,7 @@ bool OnMoveCreature::Event::dispatch(Manager& state, Environment& environment)
       {
         list_iter = environment.Generic.OnMoveInCreature.ItemId.find(*id);
         if(list_iter != environment.Generic.OnMoveInCreature.ItemId.end()){
-          item = toTile->items_getItemWithItemId(*id);
+          item = toTile->getOwnItem(toTile->items_getItemWithItemId(*id));
           if(dispatchEvent<OnMoveCreature::Event>
             (this, state, environment, list_iter->second)){
               return true;
@@ -834,7 +909,7 @@ OnTurn::Event::~Event()
 
 bool OnTurn::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = creature->getListeners(ON_TURN_LISTENER);
+  ListenerList_cptr list = creature->getListeners(ON_TURN_LISTENER);
   if(dispatchEvent<OnTurn::Event>
       (this, state, environment, list)
     )
@@ -1007,7 +1082,7 @@ OnJoinChannel::Event::~Event()
 
 bool OnJoinChannel::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = chatter->getListeners(ON_OPEN_CHANNEL_LISTENER);
+  ListenerList_cptr list = chatter->getListeners(ON_OPEN_CHANNEL_LISTENER);
   if(dispatchEvent<OnJoinChannel::Event>
       (this, state, environment, list)
     )
@@ -1048,7 +1123,7 @@ OnLeaveChannel::Event::~Event() {
 
 bool OnLeaveChannel::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = chatter->getListeners(ON_CLOSE_CHANNEL_LISTENER);
+  ListenerList_cptr list = chatter->getListeners(ON_CLOSE_CHANNEL_LISTENER);
   if(dispatchEvent<OnLeaveChannel::Event>
       (this, state, environment, list)
     )
@@ -1269,7 +1344,7 @@ OnLogout::Event::~Event()
 
 bool OnLogout::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = player->getListeners(ON_LOGOUT_LISTENER);
+  ListenerList_cptr list = player->getListeners(ON_LOGOUT_LISTENER);
   if(dispatchEvent<OnLogout::Event>
       (this, state, environment, list)
     )
@@ -1311,7 +1386,7 @@ OnChangeOutfit::Event::~Event()
 
 bool OnChangeOutfit::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = player->getListeners(ON_CHANGE_OUTFIT_LISTENER);
+  ListenerList_cptr list = player->getListeners(ON_CHANGE_OUTFIT_LISTENER);
   if(dispatchEvent<OnChangeOutfit::Event>
       (this, state, environment, list)
     )
@@ -1416,7 +1491,7 @@ bool OnLook::Event::check_match(const ScriptInformation& info)
 
 bool OnLook::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = player->getListeners(ON_LOOK_LISTENER);
+  ListenerList_cptr list = player->getListeners(ON_LOOK_LISTENER);
   if(dispatchEvent<OnLook::Event>
       (this, state, environment, list)
     )
@@ -1499,7 +1574,7 @@ OnSpotCreature::Event::~Event()
 
 bool OnSpotCreature::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = creature->getListeners(ON_SPOT_CREATURE_LISTENER);
+  ListenerList_cptr list = creature->getListeners(ON_SPOT_CREATURE_LISTENER);
   if(dispatchEvent<OnSpotCreature::Event>
       (this, state, environment, list))
     return true;
@@ -1538,7 +1613,7 @@ OnLoseCreature::Event::~Event()
 
 bool OnLoseCreature::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = creature->getListeners(ON_LOSE_CREATURE_LISTENER);
+  ListenerList_cptr list = creature->getListeners(ON_LOSE_CREATURE_LISTENER);
   if(dispatchEvent<OnLoseCreature::Event>
       (this, state, environment, list))
     return true;
@@ -1618,7 +1693,7 @@ OnThink::Event::~Event()
 
 bool OnThink::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = creature->getListeners(ON_THINK_LISTENER);
+  ListenerList_cptr list = creature->getListeners(ON_THINK_LISTENER);
   if(dispatchEvent<OnThink::Event>
       (this, state, environment, list))
     return true;
@@ -1671,7 +1746,7 @@ bool OnAdvance::Event::check_match(const ScriptInformation& info)
 
 bool OnAdvance::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = player->getListeners(ON_ADVANCE_LISTENER);
+  ListenerList_cptr list = player->getListeners(ON_ADVANCE_LISTENER);
   if(dispatchEvent<OnAdvance::Event, ScriptInformation>
       (this, state, environment, list)
     )
@@ -1720,7 +1795,7 @@ OnShopPurchase::Event::~Event()
 
 bool OnShopPurchase::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = player->getListeners(ON_SHOP_PURCHASE_LISTENER);
+  ListenerList_cptr list = player->getListeners(ON_SHOP_PURCHASE_LISTENER);
   if(dispatchEvent<OnShopPurchase::Event>
       (this, state, environment, list)
     )
@@ -1773,7 +1848,7 @@ OnShopSell::Event::~Event()
 
 bool OnShopSell::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = player->getListeners(ON_SHOP_SELL_LISTENER);
+  ListenerList_cptr list = player->getListeners(ON_SHOP_SELL_LISTENER);
   if(dispatchEvent<OnShopSell::Event>
       (this, state, environment, list)
     )
@@ -1819,7 +1894,7 @@ OnShopClose::Event::~Event()
 
 bool OnShopClose::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list = player->getListeners(ON_SHOP_CLOSE_LISTENER);
+  ListenerList_cptr list = player->getListeners(ON_SHOP_CLOSE_LISTENER);
   if(dispatchEvent<OnShopClose::Event>
       (this, state, environment, list)
     )
@@ -1877,7 +1952,7 @@ bool OnTradeBegin::Event::check_match(const ScriptInformation& info)
 bool OnTradeBegin::Event::dispatch(Manager& state, Environment& environment)
 {
   if(player1){
-    ListenerList list = player1->getListeners(ON_TRADE_BEGIN_LISTENER);
+    ListenerList_cptr list = player1->getListeners(ON_TRADE_BEGIN_LISTENER);
     if(dispatchEvent<OnTradeBegin::Event, ScriptInformation>
         (this, state, environment, list)
       )
@@ -1885,7 +1960,7 @@ bool OnTradeBegin::Event::dispatch(Manager& state, Environment& environment)
   }
 
   if(player2){
-    ListenerList list = player2->getListeners(ON_TRADE_BEGIN_LISTENER);
+    ListenerList_cptr list = player2->getListeners(ON_TRADE_BEGIN_LISTENER);
     if(dispatchEvent<OnTradeBegin::Event, ScriptInformation>
         (this, state, environment, list)
       )
@@ -1951,7 +2026,7 @@ bool OnTradeEnd::Event::check_match(const ScriptInformation& info)
 bool OnTradeEnd::Event::dispatch(Manager& state, Environment& environment)
 {
   if(player1){
-    ListenerList list = player1->getListeners(ON_TRADE_END_LISTENER);
+    ListenerList_cptr list = player1->getListeners(ON_TRADE_END_LISTENER);
     if(dispatchEvent<OnTradeEnd::Event>
         (this, state, environment, list)
       )
@@ -1959,7 +2034,7 @@ bool OnTradeEnd::Event::dispatch(Manager& state, Environment& environment)
   }
 
   if(player2){
-    ListenerList list = player2->getListeners(ON_TRADE_END_LISTENER);
+    ListenerList_cptr list = player2->getListeners(ON_TRADE_END_LISTENER);
     if(dispatchEvent<OnTradeEnd::Event>
         (this, state, environment, list)
       )
@@ -2043,7 +2118,7 @@ bool OnConditionEffect::Event::check_match(const ScriptInformation& info)
 bool OnConditionEffect::Event::dispatch(Manager& state, Environment& environment)
 {
   if(creature){
-    ListenerList list = creature->getListeners(ON_CONDITION_LISTENER);
+    ListenerList_cptr list = creature->getListeners(ON_CONDITION_LISTENER);
     if(dispatchEvent<OnConditionEffect::Event, ScriptInformation>
         (this, state, environment, list))
       return true;
@@ -2133,7 +2208,7 @@ bool OnAttack::Event::check_match(const ScriptInformation& info)
 bool OnAttack::Event::dispatch(Manager& state, Environment& environment)
 {
   if(creature){
-    ListenerList list = creature->getListeners(ON_ATTACK_LISTENER);
+    ListenerList_cptr list = creature->getListeners(ON_ATTACK_LISTENER);
     if(dispatchEvent<OnAttack::Event, ScriptInformation>
         (this, state, environment, list))
       return true;
@@ -2214,7 +2289,7 @@ bool OnDamage::Event::check_match(const ScriptInformation& info)
 bool OnDamage::Event::dispatch(Manager& state, Environment& environment)
 {
   if(creature){
-    ListenerList list = creature->getListeners(ON_DAMAGE_LISTENER);
+    ListenerList_cptr list = creature->getListeners(ON_DAMAGE_LISTENER);
     if(dispatchEvent<OnDamage::Event, ScriptInformation>
         (this, state, environment, list))
       return true;
@@ -2319,7 +2394,7 @@ bool OnKill::Event::check_match(const ScriptInformation& info)
 
 bool OnKill::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list;
+  ListenerList_cptr list;
 
   // Tied to killer
   Creature* killer = combatSource.getSourceCreature();
@@ -2412,7 +2487,7 @@ bool OnDeath::Event::check_match(const ScriptInformation& info)
 
 bool OnDeath::Event::dispatch(Manager& state, Environment& environment)
 {
-  ListenerList list;
+  ListenerList_cptr list;
 
   // Tied to killer
   if(killer){
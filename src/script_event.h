@@ -36,9 +36,13 @@ typedef boost::shared_ptr<LuaThread> LuaThread_ptr;
 
 // These are actually defined in the .cpp file, so you CAN ONLY USE THEM IN script_event.cpp
 template<class T, class ScriptInformation>
-  bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, Script::ListenerList& specific_list);
+  bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList& specific_list);
 template<class T>
-  bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, Script::ListenerList& specific_list);
+  bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList& specific_list);
+template<class T, class ScriptInformation>
+  bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList_cptr& specific_list);
+template<class T>
+  bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList_cptr& specific_list);
 
 namespace Script {
 
@@ -184,6 +188,8 @@ namespace Script {
     class Event : public Script::Event {
     public:
       Event(Creature* creature, Creature* talking_creature, const std::string& message, const SpeakClass& speak_class);
+      // Delivers one say to all the hearers, the message is shared by every call
+      Event(const std::list<Creature*>& hearers, Creature* talking_creature, const std::string& message, const SpeakClass& speak_class);
       ~Event();
 
       std::string getName() const {return "OnHear";}
@@ -196,6 +202,9 @@ namespace Script {
       void update_instance(Manager& state, Script::Environment& environment, LuaThread_ptr thread);
 
     protected:
+      bool dispatchTo(Creature* hearer, Manager& state, Environment& environment);
+
+      const std::list<Creature*>* hearers;
       Creature* creature;
       Creature* talking_creature;
       const std::string& message;
@@ -1281,15 +1290,18 @@ namespace Script {
 // Implementation details
 
 template<class T, class ScriptInformation>
-bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, Script::Listener_ptr listener)
+bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::Listener_ptr& listener)
 {
   if(listener->isActive() == false)
     return false;
 
-  const ScriptInformation& info = boost::any_cast<const ScriptInformation>(listener->getData());
+  // Typed when the listener was registered, NULL if it has none
+  const ScriptInformation* info = listener->getInformation<ScriptInformation>();
+  if(!info)
+    return false;
 
   // Call handler
-  if(e->check_match(info)) {
+  if(e->check_match(*info)) {
     if(e->call(state, environment, listener) == true) {
       // Handled
       return true;
@@ -1299,7 +1311,7 @@ bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environmen
 }
 
 template<class T>
-bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, Script::Listener_ptr listener)
+bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::Listener_ptr& listener)
 {
   if(listener->isActive() == false)
     return false;
@@ -1313,12 +1325,12 @@ bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environmen
 }
 
 template<class T, class ScriptInformation>
-bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, Script::ListenerList& specific_list)
+bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList& specific_list)
 {
   if(specific_list.size() == 0)
     return false;
 
-  for(Script::ListenerList::iterator event_iter = specific_list.begin();
+  for(Script::ListenerList::const_iterator event_iter = specific_list.begin();
     event_iter != specific_list.end();
     ++event_iter)
   {
@@ -1329,12 +1341,12 @@ bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environmen
 }
 
 template<class T> // No script information!
-bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, Script::ListenerList& specific_list)
+bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList& specific_list)
 {
   if(specific_list.size() == 0)
     return false;
 
-  for(Script::ListenerList::iterator event_iter = specific_list.begin();
+  for(Script::ListenerList::const_iterator event_iter = specific_list.begin();
     event_iter != specific_list.end();
     ++event_iter)
   {
@@ -1344,4 +1356,20 @@ bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environmen
   return false;
 }
 
+template<class T, class ScriptInformation>
+bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList_cptr& specific_list)
+{
+  if(!specific_list)
+    return false;
+  return dispatchEvent<T, ScriptInformation>(e, state, environment, *specific_list);
+}
+
+template<class T> // No script information!
+bool dispatchEvent(T* e, Script::Manager& state, Script::Environment& environment, const Script::ListenerList_cptr& specific_list)
+{
+  if(!specific_list)
+    return false;
+  return dispatchEvent<T>(e, state, environment, *specific_list);
+}
+
 #endif // __OTSERV_SCRIPT_EVENT__
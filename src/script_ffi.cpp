@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// C functions called directly by scripts through the LuaJIT FFI
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#ifdef __USE_LUAJIT__
+
+#include "script_ffi.h"
+#include "script_environment.h"
+#include "creature.h"
+#include "item.h"
+#include "tile.h"
+#include "game.h"
+
+extern Game g_game;
+
+namespace {
+  Script::Environment* ffi_environment = NULL;
+
+  Thing* getThing(const uint64_t* object)
+  {
+    if(!object || !ffi_environment)
+      return NULL;
+    return ffi_environment->getThing(*object);
+  }
+
+  Creature* getCreature(const uint64_t* object)
+  {
+    Thing* thing = getThing(object);
+    return thing? thing->getCreature() : NULL;
+  }
+
+  Item* getItem(const uint64_t* object)
+  {
+    Thing* thing = getThing(object);
+    return thing? thing->getItem() : NULL;
+  }
+}
+
+void Script::setFFIEnvironment(Environment* environment)
+{
+  ffi_environment = environment;
+}
+
+int otserv_thing_get_position(const uint64_t* object, otserv_position* position)
+{
+  Thing* thing = getThing(object);
+  if(!thing || !thing->getParentTile())
+    return 0;
+
+  const Position& pos = thing->getParentTile()->getPosition();
+  position->x = pos.x;
+  position->y = pos.y;
+  position->z = pos.z;
+  return 1;
+}
+
+int otserv_creature_get_health(const uint64_t* object, int32_t* health)
+{
+  Creature* creature = getCreature(object);
+  if(!creature)
+    return 0;
+
+  *health = creature->getHealth();
+  return 1;
+}
+
+int otserv_item_get_id(const uint64_t* object, int32_t* id)
+{
+  Item* item = getItem(object);
+  if(!item)
+    return 0;
+
+  *id = item->getID();
+  return 1;
+}
+
+int otserv_item_get_count(const uint64_t* object, int32_t* count)
+{
+  Item* item = getItem(object);
+  if(!item)
+    return 0;
+
+  // Same as Item:getCount()
+  if(item->isStackable())
+    *count = item->getItemCount();
+  else if(item->isRune())
+    *count = item->getCharges();
+  else
+    *count = 1;
+  return 1;
+}
+
+int otserv_map_has_tile(int32_t x, int32_t y, int32_t z)
+{
+  return g_game.getParentTile(x, y, z) != NULL;
+}
+
+int otserv_creature_get_custom_value(const uint64_t* object,
+  const char* key, size_t key_length, const char** value, size_t* value_length)
+{
+  Creature* creature = getCreature(object);
+  if(!creature)
+    return 0;
+
+  const std::string* found = creature->findCustomValue(std::string(key, key_length));
+  if(found){
+    *value = found->data();
+    *value_length = found->size();
+  }
+  else{
+    *value = NULL;
+    *value_length = 0;
+  }
+  return 1;
+}
+
+#endif
@@ -0,0 +1,71 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// C functions called directly by scripts through the LuaJIT FFI
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_SCRIPT_FFI_H__
+#define __OTSERV_SCRIPT_FFI_H__
+
+#ifdef __USE_LUAJIT__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Script {
+  class Environment;
+
+  // Objects passed to the functions are looked up in this environment
+  void setFFIEnvironment(Environment* environment);
+}
+
+#ifdef __WINDOWS__
+#define OTSERV_FFI_EXPORT __declspec(dllexport)
+#else
+#define OTSERV_FFI_EXPORT __attribute__((visibility("default")))
+#endif
+
+/**
+ * The ABI below is declared again in data/scripts/otstd/ffi_bindings.lua,
+ * keep them in sync. Objects are the userdata of a class instance, which
+ * holds its ObjectID.
+ *
+ * Nothing here raises lua errors, a function returns 0 when the object is
+ * not valid for it and the script then falls back to the regular binding,
+ * which reports the error.
+ */
+extern "C" {
+  typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+  } otserv_position;
+
+  OTSERV_FFI_EXPORT int otserv_thing_get_position(const uint64_t* object, otserv_position* position);
+  OTSERV_FFI_EXPORT int otserv_creature_get_health(const uint64_t* object, int32_t* health);
+  OTSERV_FFI_EXPORT int otserv_item_get_id(const uint64_t* object, int32_t* id);
+  OTSERV_FFI_EXPORT int otserv_item_get_count(const uint64_t* object, int32_t* count);
+  // Returns 1 if there is a tile at the position
+  OTSERV_FFI_EXPORT int otserv_map_has_tile(int32_t x, int32_t y, int32_t z);
+  // The value stays valid until the creature's custom values change
+  OTSERV_FFI_EXPORT int otserv_creature_get_custom_value(const uint64_t* object,
+    const char* key, size_t key_length, const char** value, size_t* value_length);
+}
+
+#endif
+
+#endif
@@ -83,6 +83,15 @@ const luaL_Reg lua_BitReg[] =
   {NULL,NULL}
 };
 
+///////////////////////////////////////////////////////////////////////////////
+// Bound function declarations
+
+static Position Thing_getPosition(Thing* thing);
+static int32_t Thing_getX(Thing* thing);
+static int32_t Thing_getY(Thing* thing);
+static int32_t Thing_getZ(Thing* thing);
+static Tile* Thing_getParentTile(Thing* thing);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Function list
 
@@ -192,13 +201,13 @@ void Manager::registerClasses() {
   registerMemberFunction("Event", "propagate()", &Manager::lua_Event_propagate);
 
   // Game classes
-  registerMemberFunction("Thing", "getPosition()", &Manager::lua_Thing_getPosition);
-  registerMemberFunction("Thing", "getX()", &Manager::lua_Thing_getX);
-  registerMemberFunction("Thing", "getY()", &Manager::lua_Thing_getY);
-  registerMemberFunction("Thing", "getZ()", &Manager::lua_Thing_getZ);
-  registerMemberFunction("Thing", "getParentTile()", &Manager::lua_Thing_getParentTile);
+  bindMemberFunction("Thing", "getPosition", &Thing_getPosition);
+  bindMemberFunction("Thing", "getX", &Thing_getX);
+  bindMemberFunction("Thing", "getY", &Thing_getY);
+  bindMemberFunction("Thing", "getZ", &Thing_getZ);
+  bindMemberFunction("Thing", "getParentTile", &Thing_getParentTile);
   registerMemberFunction("Thing", "getParent()", &Manager::lua_Thing_getParent);
-  registerMemberFunction("Thing", "isMoveable()", &Manager::lua_Thing_isMoveable);
+  bindMemberFunction("Thing", "isMoveable", &Thing::isPushable);
   registerMemberFunction("Thing", "getName()", &Manager::lua_Thing_getName);
   registerMemberFunction("Thing", "getDescription([int lookdistance])", &Manager::lua_Thing_getDescription);
   registerMemberFunction("Thing", "moveTo(table pos)", &Manager::lua_Thing_moveToPosition);
@@ -257,22 +266,22 @@ void Manager::registerClasses() {
   registerMemberFunction("Creature", "addSummon(Actor other)", &Manager::lua_Creature_addSummon);
   registerMemberFunction("Creature", "getSummons()", &Manager::lua_Creature_getSummons);
   registerMemberFunction("Creature", "getMaster()", &Manager::lua_Creature_getMaster);
-  registerMemberFunction("Creature", "getHealth()", &Manager::lua_Creature_getHealth);
-  registerMemberFunction("Creature", "getHealthMax()", &Manager::lua_Creature_getHealthMax);
+  bindMemberFunction("Creature", "getHealth", &Creature::getHealth);
+  bindMemberFunction("Creature", "getHealthMax", &Creature::getMaxHealth);
   registerMemberFunction("Creature", "setHealth(integer newval)", &Manager::lua_Creature_setHealth);
-  registerMemberFunction("Creature", "getID()", &Manager::lua_Creature_getID);
+  bindMemberFunction("Creature", "getID", &Creature::getID);
   registerMemberFunction("Creature", "getOrientation()", &Manager::lua_Creature_getOrientation);
   registerMemberFunction("Creature", "getOutfit()", &Manager::lua_Creature_getOutfit);
   registerMemberFunction("Creature", "getZone()", &Manager::lua_Creature_getZone);
   registerMemberFunction("Creature", "say(string msg [, SpeakClass type])", &Manager::lua_Creature_say);
   registerMemberFunction("Creature", "setOutfit(table outfit)", &Manager::lua_Creature_setOutfit);
   registerMemberFunction("Creature", "walk(Direction direction [,bool force])", &Manager::lua_Creature_walk);
-  registerMemberFunction("Creature", "getSpeed()", &Manager::lua_Creature_getSpeed);
-  registerMemberFunction("Creature", "getArmor()", &Manager::lua_Creature_getArmor);
-  registerMemberFunction("Creature", "getDefense()", &Manager::lua_Creature_getDefense);
-  registerMemberFunction("Creature", "getBaseSpeed()", &Manager::lua_Creature_getBaseSpeed);
-  registerMemberFunction("Creature", "isPushable()", &Manager::lua_Creature_isPushable);
-  registerMemberFunction("Creature", "getTarget()", &Manager::lua_Creature_getTarget);
+  bindMemberFunction("Creature", "getSpeed", &Creature::getSpeed);
+  bindMemberFunction("Creature", "getArmor", &Creature::getArmor);
+  bindMemberFunction("Creature", "getDefense", &Creature::getDefense);
+  bindMemberFunction("Creature", "getBaseSpeed", &Creature::getBaseSpeed);
+  bindMemberFunction("Creature", "isPushable", &Creature::isPushable);
+  bindMemberFunction("Creature", "getTarget", &Creature::getAttackedCreature);
   registerMemberFunction("Creature", "getMasterPos()", &Manager::lua_Creature_getMasterPos);
   registerMemberFunction("Creature", "isImmuneToCombat(CombatType combattype)", &Manager::lua_Creature_isImmuneToCombat);
   registerMemberFunction("Creature", "isImmuneToMechanic(MechanicType conditiontype)", &Manager::lua_Creature_isImmuneToMechanic);
@@ -343,10 +352,10 @@ void Manager::registerClasses() {
   registerGlobalFunction("createActor(string name, position pos)", &Manager::lua_createActor);
 
   // Player
-  registerMemberFunction("Player", "getFood()", &Manager::lua_Player_getFood);
+  bindMemberFunction("Player", "getFood", &Player::getFood);
   registerMemberFunction("Player", "getMana()", &Manager::lua_Player_getMana);
-  registerMemberFunction("Player", "getLevel()", &Manager::lua_Player_getLevel);
-  registerMemberFunction("Player", "getMagicLevel()", &Manager::lua_Player_getMagicLevel);
+  bindMemberFunction("Player", "getLevel", &Player::getLevel);
+  bindMemberFunction("Player", "getMagicLevel", &Player::getMagicLevel);
   registerMemberFunction("Player", "getSkill(SkillType skill)", &Manager::lua_Player_getSkill);
   registerMemberFunction("Player", "advanceSkill(SkillType skill, int count)", &Manager::lua_Player_advanceSkill);
   registerMemberFunction("Player", "getAttackFactor()", &Manager::lua_Player_getAttackFactor);
@@ -354,7 +363,7 @@ void Manager::registerClasses() {
   registerMemberFunction("Player", "getLastAttackBlockType()", &Manager::lua_Player_getLastAttackBlockType);
   registerMemberFunction("Player", "isPremium()", &Manager::lua_Player_isPremium);
   registerMemberFunction("Player", "isAutoWalking()", &Manager::lua_Player_isAutoWalking);
-  registerMemberFunction("Player", "getManaMax()", &Manager::lua_Player_getManaMax);
+  bindMemberFunction("Player", "getManaMax", &Player::getMaxMana);
   registerMemberFunction("Player", "setMana(integer newval)", &Manager::lua_Player_setMana);
   registerMemberFunction("Player", "addManaSpent(integer howmuch)", &Manager::lua_Player_addManaSpent);
   registerMemberFunction("Player", "getSoulPoints()", &Manager::lua_Player_getSoulPoints);
@@ -365,7 +374,7 @@ void Manager::registerClasses() {
   registerMemberFunction("Player", "getAccess()", &Manager::lua_Player_getAccess);
   registerMemberFunction("Player", "getVocation()", &Manager::lua_Player_getVocation);
   registerMemberFunction("Player", "getTownID()", &Manager::lua_Player_getTownID);
-  registerMemberFunction("Player", "getGUID()", &Manager::lua_Player_getGUID);
+  bindMemberFunction("Player", "getGUID", &Player::getGUID);
   registerMemberFunction("Player", "getAccessGroup()", &Manager::lua_Player_getGroup);
   registerMemberFunction("Player", "getPremiumDays()", &Manager::lua_Player_getPremiumDays);
   registerMemberFunction("Player", "getSkull()", &Manager::lua_Player_getSkullType);
@@ -406,11 +415,11 @@ void Manager::registerClasses() {
 
   // Item
   registerGlobalFunction("createItem(int newid[, int count = nil])", &Manager::lua_createItem);
-  registerMemberFunction("Item", "getItemID()", &Manager::lua_Item_getItemID);
+  bindMemberFunction("Item", "getItemID", &Item::getID);
   registerMemberFunction("Item", "getLongName()", &Manager::lua_Item_getLongName);
   registerMemberFunction("Item", "getCount()", &Manager::lua_Item_getCount);
-  registerMemberFunction("Item", "getWeight()", &Manager::lua_Item_getWeight);
-  registerMemberFunction("Item", "isPickupable()", &Manager::lua_Item_isPickupable);
+  bindMemberFunction("Item", "getWeight", &Item::getWeight);
+  bindMemberFunction("Item", "isPickupable", &Item::isPickupable);
   registerMemberFunction("Item", "getSubtype()", &Manager::lua_Item_getSubtype);
 
   registerMemberFunction("Item", "setItemID(int newid [, int newtype])", &Manager::lua_Item_setItemID);
@@ -439,6 +448,7 @@ void Manager::registerClasses() {
   registerGlobalFunction("getItemType(int itemid)", &Manager::lua_getItemType);
   registerGlobalFunction("getMaxItemType()", &Manager::lua_getMaxItemType);
   registerGlobalFunction("getItemIDByName(string name)", &Manager::lua_getItemIDByName);
+  registerGlobalFunction("getItemIDsByName(string name)", &Manager::lua_getItemIDsByName);
   registerGlobalFunction("isValidItemID(int id)", &Manager::lua_isValidItemID);
 
   // Depot
@@ -515,6 +525,7 @@ void Manager::registerFunctions() {
   registerGlobalFunction("wait(int delay)", &Manager::lua_wait);
   registerGlobalFunction("stacktrace(thread thread)", &Manager::lua_stacktrace);
   registerGlobalFunction("scriptStatistics()", &Manager::lua_statistics);
+  registerGlobalFunction("getScriptProfile([int count = nil])", &Manager::lua_getScriptProfile);
   registerGlobalFunction("require_directory(string path)", &Manager::lua_require_directory);
   registerGlobalFunction("get_thread_id(thread t)", &Manager::lua_get_thread_id);
 
@@ -696,6 +707,58 @@ int LuaState::lua_statistics()
   setField(-1, "totalListeners", environment->countListeners());
   setField(-1, "genericListeners", environment->countListeners() - environment->countSpecificListeners());
   setField(-1, "specificListeners", environment->countSpecificListeners());
+  setField(-1, "luaHeapSize", manager->getHeapSize());
+  setField(-1, "luaHeapReserved", manager->getReservedHeapSize());
+  setField(-1, "gcTime", manager->getGCTime());
+  setField(-1, "gcMaxPause", manager->getGCMaxPause());
+  setField(-1, "gcCycles", manager->getGCCycles());
+
+  std::vector<ObjectPool*> pools;
+  ObjectPool::getPools(pools);
+  newTable();
+  for(std::vector<ObjectPool*>::const_iterator it = pools.begin(); it != pools.end(); ++it){
+    const ObjectPool* pool = *it;
+    newTable();
+    setField(-1, "objects", pool->getObjectCount());
+    setField(-1, "peakObjects", pool->getPeakObjectCount());
+    setField(-1, "allocations", pool->getAllocationCount());
+    setField(-1, "reserved", pool->getReservedBytes());
+    setField(-2, pool->getName());
+  }
+  setField(-2, "objectPools");
+
+  return 1;
+}
+
+int LuaState::lua_getScriptProfile()
+{
+  uint32_t count = 20;
+  if(getStackSize() > 0){
+    count = popUnsignedInteger();
+  }
+
+  std::vector<const Script::ProfileEntry*> list;
+  manager->getProfiler().getEntries(list, count);
+
+  newTable();
+  int n = 1;
+  for(std::vector<const Script::ProfileEntry*>::const_iterator iter = list.begin(); iter != list.end(); ++iter, ++n){
+    const Script::ProfileEntry* entry = *iter;
+    newTable();
+    setField(-1, "source", entry->source);
+    setField(-1, "event", entry->event_name);
+    setField(-1, "calls", entry->calls);
+    setField(-1, "totalTime", entry->total_time);
+    setField(-1, "averageTime", entry->averageTime());
+    setField(-1, "p99Time", entry->percentile(0.99));
+    setField(-1, "maxTime", entry->max_time);
+#ifndef __USE_LUAJIT__
+    // LuaJIT states keep their own allocator, nothing is counted there
+    setField(-1, "allocated", entry->allocated);
+#endif
+    setField(-1, "aborted", entry->aborted);
+    setField(-2, n);
+  }
 
   return 1;
 }
@@ -790,8 +853,7 @@ int LuaState::lua_registerGenericEvent_OnSay() {
   si_onsay.filter = filter;
   si_onsay.case_sensitive = case_sensitive;
 
-  boost::any p(si_onsay);
-  Listener_ptr listener(new Listener(ON_SAY_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_SAY_LISTENER, si_onsay, *manager));
 
   // OnSay event list is sorted by length, from longest to shortest
   if(si_onsay.method == OnSay::FILTER_EXACT){
@@ -812,7 +874,7 @@ int LuaState::lua_registerGenericEvent_OnSay() {
         end = environment->Generic.OnSay.end();
         listener_iter != end; ++listener_iter)
       {
-        OnSay::ScriptInformation info = boost::any_cast<OnSay::ScriptInformation>((*listener_iter)->getData());
+        const OnSay::ScriptInformation& info = *(*listener_iter)->getInformation<OnSay::ScriptInformation>();
 
         if(si_onsay.method == OnSay::FILTER_MATCH_BEGINNING){
           // We should be inserted before substrings...
@@ -889,9 +951,8 @@ int LuaState::lua_registerSpecificEvent_OnSay() {
   // This here explains why boost is so awesome, thanks to our custom
   // delete function, the listener is cleanly stopped when all references
   // to it is removed. :)
-  boost::any p(si_onsay);
   Listener_ptr listener(
-    new Listener(ON_SAY_LISTENER, p, *manager),
+    new Listener(ON_SAY_LISTENER, si_onsay, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -918,9 +979,8 @@ int LuaState::lua_registerSpecificEvent_OnHear() {
   // This here explains why boost is so awesome, thanks to our custom
   // delete function, the listener is cleanly stopped when all references
   // to it is removed. :)
-  boost::any p(si_onhear);
   Listener_ptr listener(
-    new Listener(ON_HEAR_LISTENER, p, *manager),
+    new Listener(ON_HEAR_LISTENER, si_onhear, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -953,8 +1013,7 @@ int LuaState::lua_registerGenericEvent_OnUseItem() {
   }
   si_onuse.id = id;
 
-  boost::any p(si_onuse);
-  Listener_ptr listener(new Listener(ON_USE_ITEM_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_USE_ITEM_LISTENER, si_onuse, *manager));
 
   ListenerList* list = NULL;
   switch(si_onuse.method){
@@ -1005,8 +1064,7 @@ int LuaState::lua_registerGenericEvent_OnUseWeapon()
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_onuseweapon);
-  Listener_ptr listener(new Listener(ON_USE_WEAPON_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_USE_WEAPON_LISTENER, si_onuseweapon, *manager));
 
   ListenerList* list = NULL;
   switch(si_onuseweapon.method){
@@ -1203,8 +1261,7 @@ int LuaState::lua_registerGenericEvent_OnLookAtItem() {
   }
   si_onlook.id = id;
 
-  boost::any p(si_onlook);
-  Listener_ptr listener(new Listener(ON_LOOK_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_LOOK_LISTENER, si_onlook, *manager));
 
   ListenerList* list = NULL;
   switch(si_onlook.method){
@@ -1233,9 +1290,8 @@ int LuaState::lua_registerSpecificEvent_OnLookAtCreature() {
   si_onlook.id = 0;
 
   // Listener is unbound automatically
-  boost::any p(si_onlook);
   Listener_ptr listener(
-    new Listener(ON_LOOKED_AT_LISTENER, p, *manager),
+    new Listener(ON_LOOKED_AT_LISTENER, si_onlook, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -1262,9 +1318,8 @@ int LuaState::lua_registerSpecificEvent_OnLook() {
   // This here explains why boost is so awesome, thanks to our custom
   // delete function, the listener is cleanly stopped when all references
   // to it is removed. :)
-  boost::any p(si_onlook);
   Listener_ptr listener(
-    new Listener(ON_LOOK_LISTENER, p, *manager),
+    new Listener(ON_LOOK_LISTENER, si_onlook, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -1321,8 +1376,7 @@ int LuaState::lua_registerGenericEvent_OnEquipItem() {
   si_onequip.equip = true;
   si_onequip.postEvent = postEvent;
 
-  boost::any p(si_onequip);
-  Listener_ptr listener(new Listener(ON_EQUIP_ITEM_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_EQUIP_ITEM_LISTENER, si_onequip, *manager));
 
   environment->Generic.OnEquipItem.push_back(listener);
 
@@ -1377,8 +1431,7 @@ int LuaState::lua_registerGenericEvent_OnDeEquipItem() {
   si_ondeequip.equip = false;
   si_ondeequip.postEvent = postEvent;
 
-  boost::any p(si_ondeequip);
-  Listener_ptr listener(new Listener(ON_EQUIP_ITEM_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_EQUIP_ITEM_LISTENER, si_ondeequip, *manager));
 
   environment->Generic.OnEquipItem.push_back(listener);
 
@@ -1402,9 +1455,8 @@ int LuaState::lua_registerSpecificEvent_CreatureMove() {
   si_onmovecreature.slot = 0;
   si_onmovecreature.moveType = OnMoveCreature::TYPE_MOVE;
 
-  boost::any p(si_onmovecreature);
   Listener_ptr listener(
-    new Listener(ON_MOVE_CREATURE_LISTENER, p, *manager),
+    new Listener(ON_MOVE_CREATURE_LISTENER, si_onmovecreature, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -1440,9 +1492,8 @@ int LuaState::lua_registerSpecificEvent_CreatureMoveIn() {
   si_onmovecreature.id = id;
   si_onmovecreature.moveType = OnMoveCreature::TYPE_STEPIN;
 
-  boost::any p(si_onmovecreature);
   Listener_ptr listener(
-    new Listener(ON_MOVE_CREATURE_LISTENER, p, *manager),
+    new Listener(ON_MOVE_CREATURE_LISTENER, si_onmovecreature, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -1478,9 +1529,8 @@ int LuaState::lua_registerSpecificEvent_CreatureMoveOut() {
   si_onmovecreature.id = id;
   si_onmovecreature.moveType = OnMoveCreature::TYPE_STEPOUT;
 
-  boost::any p(si_onmovecreature);
   Listener_ptr listener(
-    new Listener(ON_MOVE_CREATURE_LISTENER, p, *manager),
+    new Listener(ON_MOVE_CREATURE_LISTENER, si_onmovecreature, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -1515,8 +1565,7 @@ int LuaState::lua_registerGenericEvent_CreatureMoveIn() {
   si_onmovecreature.id = id;
   si_onmovecreature.moveType = OnMoveCreature::TYPE_STEPIN;
 
-  boost::any p(si_onmovecreature);
-  Listener_ptr listener(new Listener(ON_MOVE_CREATURE_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_MOVE_CREATURE_LISTENER, si_onmovecreature, *manager));
 
   if (si_onmovecreature.method == OnMoveCreature::FILTER_ACTIONID)
     environment->Generic.OnMoveInCreature.ActionId[si_onmovecreature.id].push_back(listener);
@@ -1552,8 +1601,7 @@ int LuaState::lua_registerGenericEvent_CreatureMoveOut() {
   si_onmovecreature.id = id;
   si_onmovecreature.moveType = OnMoveCreature::TYPE_STEPOUT;
 
-  boost::any p(si_onmovecreature);
-  Listener_ptr listener(new Listener(ON_MOVE_CREATURE_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_MOVE_CREATURE_LISTENER, si_onmovecreature, *manager));
 
   if (si_onmovecreature.method == OnMoveCreature::FILTER_ACTIONID)
     environment->Generic.OnMoveOutCreature.ActionId[si_onmovecreature.id].push_back(listener);
@@ -1668,8 +1716,7 @@ int LuaState::lua_registerGenericEvent_OnMoveItem() {
   si_onmoveitem.addItem = isAddItem;
   si_onmoveitem.isItemOnTile = isItemOnTile;
 
-  boost::any p(si_onmoveitem);
-  Listener_ptr listener(new Listener(ON_MOVE_ITEM_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_MOVE_ITEM_LISTENER, si_onmoveitem, *manager));
 
   ListenerList* list = NULL;
   if(isItemOnTile){
@@ -1773,8 +1820,7 @@ int LuaState::lua_registerGenericEvent_OnAdvance() {
     si_onadvance.skill = popEnum<LevelType>();
   }
 
-  boost::any p(si_onadvance);
-  Listener_ptr listener(new Listener(ON_ADVANCE_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_ADVANCE_LISTENER, si_onadvance, *manager));
 
   // Add it to the listener list
   environment->Generic.OnAdvance.push_back(listener);
@@ -1808,9 +1854,8 @@ int LuaState::lua_registerSpecificEvent_OnAdvance() {
   Player* who = popPlayer();
 
   // Callback is now the top of the stack
-  boost::any p(si_onadvance);
   Listener_ptr listener(
-    new Listener(ON_ADVANCE_LISTENER, p, *manager),
+    new Listener(ON_ADVANCE_LISTENER, si_onadvance, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -1893,8 +1938,7 @@ int LuaState::lua_registerGenericEvent_OnTradeBegin() {
     throw Error("Invalid argument (1) 'method'");
   }
 
-  boost::any p(si_ontrade);
-  Listener_ptr listener(new Listener(ON_TRADE_BEGIN_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_TRADE_BEGIN_LISTENER, si_ontrade, *manager));
 
   environment->Generic.OnTradeBegin.push_back(listener);
 
@@ -1935,9 +1979,8 @@ int LuaState::lua_registerSpecificEvent_OnTradeBegin() {
 
   Player* who = popPlayer();
 
-  boost::any p(si_ontrade);
   Listener_ptr listener(
-    new Listener(ON_TRADE_BEGIN_LISTENER, p, *manager),
+    new Listener(ON_TRADE_BEGIN_LISTENER, si_ontrade, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -1978,8 +2021,7 @@ int LuaState::lua_registerGenericEvent_OnTradeEnd() {
     throw Error("Invalid argument (1) 'method'");
   }
 
-  boost::any p(si_ontrade);
-  Listener_ptr listener(new Listener(ON_TRADE_END_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_TRADE_END_LISTENER, si_ontrade, *manager));
 
   environment->Generic.OnTradeEnd.push_back(listener);
 
@@ -2020,9 +2062,8 @@ int LuaState::lua_registerSpecificEvent_OnTradeEnd() {
 
   Player* who = popPlayer();
 
-  boost::any p(si_ontrade);
   Listener_ptr listener(
-    new Listener(ON_TRADE_BEGIN_LISTENER, p, *manager),
+    new Listener(ON_TRADE_BEGIN_LISTENER, si_ontrade, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -2061,8 +2102,7 @@ int LuaState::lua_registerGenericEvent_OnConditionEffect() {
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_onconditioneffect);
-  Listener_ptr listener(new Listener(ON_CONDITION_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_CONDITION_LISTENER, si_onconditioneffect, *manager));
 
   environment->Generic.OnConditionEffect.push_back(listener);
 
@@ -2126,8 +2166,7 @@ int LuaState::lua_registerGenericEvent_OnAttack() {
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_onattack);
-  Listener_ptr listener(new Listener(ON_ATTACK_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_ATTACK_LISTENER, si_onattack, *manager));
 
   environment->Generic.OnAttack.push_back(listener);
 
@@ -2178,9 +2217,8 @@ int LuaState::lua_registerSpecificEvent_OnAttack() {
     throw Error("Invalid argument (3) 'method'");
   }
 
-  boost::any p(si_onattack);
   Listener_ptr listener(
-    new Listener(ON_ATTACK_LISTENER, p, *manager),
+    new Listener(ON_ATTACK_LISTENER, si_onattack, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -2259,8 +2297,7 @@ int LuaState::lua_registerGenericEvent_OnDamage() {
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_ondamage);
-  Listener_ptr listener(new Listener(ON_DAMAGE_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_DAMAGE_LISTENER, si_ondamage, *manager));
 
   environment->Generic.OnDamage.push_back(listener);
 
@@ -2320,9 +2357,8 @@ int LuaState::lua_registerSpecificEvent_OnDamage() {
     throw Error("Invalid argument (3) 'method'");
   }
 
-  boost::any p(si_ondamage);
   Listener_ptr listener(
-    new Listener(ON_DAMAGE_LISTENER, p, *manager),
+    new Listener(ON_DAMAGE_LISTENER, si_ondamage, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -2388,8 +2424,7 @@ int LuaState::lua_registerGenericEvent_OnKill() {
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_onkill);
-  Listener_ptr listener(new Listener(ON_KILL_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_KILL_LISTENER, si_onkill, *manager));
 
   environment->Generic.OnKill.push_back(listener);
 
@@ -2437,9 +2472,8 @@ int LuaState::lua_registerSpecificEvent_OnKill() {
     throw Error("Invalid argument (3) 'method'");
   }
 
-  boost::any p(si_onkill);
   Listener_ptr listener(
-    new Listener(ON_KILL_LISTENER, p, *manager),
+    new Listener(ON_KILL_LISTENER, si_onkill, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -2505,8 +2539,7 @@ int LuaState::lua_registerGenericEvent_OnKilled() {
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_onkill);
-  Listener_ptr listener(new Listener(ON_KILLED_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_KILLED_LISTENER, si_onkill, *manager));
 
   environment->Generic.OnKilled.push_back(listener);
 
@@ -2554,9 +2587,8 @@ int LuaState::lua_registerSpecificEvent_OnKilled() {
     throw Error("Invalid argument (3) 'method'");
   }
 
-  boost::any p(si_onkill);
   Listener_ptr listener(
-    new Listener(ON_KILLED_LISTENER, p, *manager),
+    new Listener(ON_KILLED_LISTENER, si_onkill, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -2621,8 +2653,7 @@ int LuaState::lua_registerGenericEvent_OnDeathBy() {
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_ondeath);
-  Listener_ptr listener(new Listener(ON_DEATH_BY_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_DEATH_BY_LISTENER, si_ondeath, *manager));
 
   environment->Generic.OnDeathBy.push_back(listener);
 
@@ -2669,9 +2700,8 @@ int LuaState::lua_registerSpecificEvent_OnDeathBy() {
     throw Error("Invalid argument (3) 'method'");
   }
 
-  boost::any p(si_ondeath);
   Listener_ptr listener(
-    new Listener(ON_DEATH_BY_LISTENER, p, *manager),
+    new Listener(ON_DEATH_BY_LISTENER, si_ondeath, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -2736,8 +2766,7 @@ int LuaState::lua_registerGenericEvent_OnDeath() {
     throw Error("Invalid argument (2) 'method'");
   }
 
-  boost::any p(si_ondeath);
-  Listener_ptr listener(new Listener(ON_DEATH_LISTENER, p, *manager));
+  Listener_ptr listener(new Listener(ON_DEATH_LISTENER, si_ondeath, *manager));
 
   environment->Generic.OnDeath.push_back(listener);
 
@@ -2784,9 +2813,8 @@ int LuaState::lua_registerSpecificEvent_OnDeath() {
     throw Error("Invalid argument (3) 'method'");
   }
 
-  boost::any p(si_ondeath);
   Listener_ptr listener(
-    new Listener(ON_DEATH_LISTENER, p, *manager),
+    new Listener(ON_DEATH_LISTENER, si_ondeath, *manager),
     boost::bind(&Listener::deactivate, _1));
 
   environment->registerSpecificListener(listener);
@@ -2886,61 +2914,43 @@ int LuaState::lua_Event_propagate() {
 ///////////////////////////////////////////////////////////////////////////////
 // Class Thing
 
-int LuaState::lua_Thing_getPosition()
+static Position getMapPosition(Thing* thing)
 {
-  Thing* thing = popThing();
   if (!thing->getParentTile())
     throw Error("This Thing is not placed on a tile");
-  else
-    pushPosition(thing->getPosition());
-  return 1;
+  return thing->getParentTile()->getPosition();
 }
 
-int LuaState::lua_Thing_getX()
+static Position Thing_getPosition(Thing* thing)
 {
-  Thing* thing = popThing();
-  if (!thing->getParentTile())
-    throw Error("This Thing is not placed on a tile");
-  else
-    pushInteger(thing->getPosition().x);
-  return 1;
+  return getMapPosition(thing);
 }
 
-int LuaState::lua_Thing_getY()
+static int32_t Thing_getX(Thing* thing)
 {
-  Thing* thing = popThing();
-  if (!thing->getParentTile())
-    throw Error("This Thing is not placed on a tile");
-  else
-    pushInteger(thing->getPosition().y);
-  return 1;
+  return getMapPosition(thing).x;
 }
 
-int LuaState::lua_Thing_getZ()
+static int32_t Thing_getY(Thing* thing)
 {
-  Thing* thing = popThing();
-  if (!thing->getParentTile())
-    throw Error("This Thing is not placed on a tile");
-  else
-    pushInteger(thing->getPosition().z);
-  return 1;
+  return getMapPosition(thing).y;
 }
 
-int LuaState::lua_Thing_getParentTile()
+static int32_t Thing_getZ(Thing* thing)
+{
+  return getMapPosition(thing).z;
+}
+
+static Tile* Thing_getParentTile(Thing* thing)
 {
-  Thing* thing = popThing();
   Tile* parent = thing->getParentTile();
 
-  if (parent != NULL) {
-    // Creatures are removed from the map, but parent pointer still remains on tile
-    // This should be fixed, but is a lot of work so this is a simpler solution for now.
-    if (parent->__getIndexOfThing(thing) != -1) {
-      pushTile(parent);
-      return 1;
-    }
+  // Creatures are removed from the map, but parent pointer still remains on tile
+  // This should be fixed, but is a lot of work so this is a simpler solution for now.
+  if (parent != NULL && parent->__getIndexOfThing(thing) != -1) {
+    return parent;
   }
-  pushNil();
-  return 1;
+  return NULL;
 }
 
 int LuaState::lua_Thing_getParent()
@@ -2977,13 +2987,6 @@ int LuaState::lua_Thing_moveToPosition()
   return 1;
 }
 
-int LuaState::lua_Thing_isMoveable()
-{
-  Thing* thing = popThing();
-  pushBoolean(thing->isPushable());
-  return 1;
-}
-
 int LuaState::lua_Thing_getName() {
   Thing* t = popThing();
   if(Creature* c = t->getCreature()) {
@@ -3049,7 +3052,7 @@ int LuaState::lua_Tile_getThing()
     throw Error("Tile:getThing : Index out of range!");
   }
 
-  pushThing(tile->__getThing(index));
+  pushThing(tile->getThing(index));
   return 1;
 }
 
@@ -3093,8 +3096,8 @@ int LuaState::lua_Tile_getItems()
 
   newTable();
   int n = 1;
-  if(tile->ground) {
-    pushThing(tile->ground);
+  if(tile->hasGround()) {
+    pushThing(tile->getGround());
     setField(-2, n++);
   }
 
@@ -3112,7 +3115,7 @@ int LuaState::lua_Tile_getItem()
   Tile* tile = popTile();
 
   // -1 is top item
-  int lastindex = tile->items_count() + (tile->ground != NULL ? 1 : 0);
+  int lastindex = tile->items_count() + (tile->hasGround() ? 1 : 0);
   if(index < 0) {
     index = lastindex + index;
   }
@@ -3121,9 +3124,9 @@ int LuaState::lua_Tile_getItem()
   }
   assert(index >= 0);
 
-  if(tile->ground){
+  if(tile->hasGround()){
     if(index == 0){
-      pushThing(tile->ground);
+      pushThing(tile->getGround());
       return 1;
     }
 
@@ -3182,7 +3185,7 @@ int LuaState::lua_Tile_getItemsWithActionID()
   int n = 1;
   ItemVector v = tile->items_getListWithActionId(aid);
   for(ItemVector::iterator iter = v.begin(), end_iter = v.end(); iter != end_iter; ++iter, ++n){
-    pushThing(*iter);
+    pushThing(tile->getOwnItem(*iter));
     setField(-2, n);
   }
 
@@ -3198,7 +3201,7 @@ int LuaState::lua_Tile_getItemsWithItemID()
   int n = 1;
   ItemVector v = tile->items_getListWithItemId(id);
   for(ItemVector::iterator iter = v.begin(), end_iter = v.end(); iter != end_iter; ++iter, ++n){
-    pushThing(*iter);
+    pushThing(tile->getOwnItem(*iter));
     setField(-2, n);
   }
 
@@ -3210,7 +3213,7 @@ int LuaState::lua_Tile_getItemWithActionID()
   int32_t aid = popInteger();
   Tile* tile = popTile();
 
-  pushThing(tile->items_getItemWithActionId(aid));
+  pushThing(tile->getOwnItem(tile->items_getItemWithActionId(aid)));
   return 1;
 }
 
@@ -3219,7 +3222,7 @@ int LuaState::lua_Tile_getItemWithItemID()
   int32_t id = popInteger();
   Tile* tile = popTile();
 
-  pushThing(tile->items_getItemWithItemId(id));
+  pushThing(tile->getOwnItem(tile->items_getItemWithItemId(id)));
   return 1;
 }
 
@@ -3620,27 +3623,6 @@ int LuaState::lua_Vocation_getArmorDefense()
 ///////////////////////////////////////////////////////////////////////////////
 // Class Creature
 
-int LuaState::lua_Creature_getID()
-{
-  Creature* creature = popCreature();
-  pushUnsignedInteger(creature->getID());
-  return 1;
-}
-
-int LuaState::lua_Creature_getHealth()
-{
-  Creature* creature = popCreature();
-  pushInteger(creature->getHealth());
-  return 1;
-}
-
-int LuaState::lua_Creature_getHealthMax()
-{
-  Creature* creature = popCreature();
-  pushInteger(creature->getMaxHealth());
-  return 1;
-}
-
 int LuaState::lua_Creature_setHealth()
 {
   int32_t newval = popInteger();
@@ -3740,48 +3722,6 @@ int LuaState::lua_Creature_walk()
   return 1;
 }
 
-int LuaState::lua_Creature_getSpeed()
-{
-  Creature* creature = popCreature();
-  pushInteger(creature->getSpeed());
-  return 1;
-}
-
-int LuaState::lua_Creature_getArmor()
-{
-  Creature* creature = popCreature();
-  pushInteger(creature->getArmor());
-  return 1;
-}
-
-int LuaState::lua_Creature_getDefense()
-{
-  Creature* creature = popCreature();
-  pushInteger(creature->getDefense());
-  return 1;
-}
-
-int LuaState::lua_Creature_getBaseSpeed()
-{
-  Creature* creature = popCreature();
-  pushInteger(creature->getBaseSpeed());
-  return 1;
-}
-
-int LuaState::lua_Creature_isPushable()
-{
-  Creature* creature = popCreature();
-  pushBoolean(creature->isPushable());
-  return 1;
-}
-
-int LuaState::lua_Creature_getTarget()
-{
-  Creature* creature = popCreature();
-  pushThing(creature->getAttackedCreature());
-  return 1;
-}
-
 int LuaState::lua_Creature_getMasterPos()
 {
   Creature* creature = popCreature();
@@ -4445,27 +4385,6 @@ int LuaState::lua_Actor_setTarget()
 ///////////////////////////////////////////////////////////////////////////////
 // Class Player
 
-int LuaState::lua_Player_getFood()
-{
-  Player* p = popPlayer();
-  pushInteger(p->getFood());
-  return 1;
-}
-
-int LuaState::lua_Player_getLevel()
-{
-  Player* p = popPlayer();
-  push(p->getLevel());
-  return 1;
-}
-
-int LuaState::lua_Player_getMagicLevel()
-{
-  Player* p = popPlayer();
-  push(p->getMagicLevel());
-  return 1;
-}
-
 int LuaState::lua_Player_getSkill()
 {
   SkillType skill = popEnum<SkillType>();
@@ -4533,13 +4452,6 @@ int LuaState::lua_Player_getMana()
   return 1;
 }
 
-int LuaState::lua_Player_getManaMax()
-{
-  Player* p = popPlayer();
-  push(p->getMaxMana());
-  return 1;
-}
-
 int LuaState::lua_Player_setMana()
 {
   int32_t newval = popInteger();
@@ -4637,13 +4549,6 @@ int LuaState::lua_Player_getTownID()
   return 1;
 }
 
-int LuaState::lua_Player_getGUID()
-{
-  Player* p = popPlayer();
-  push(p->getGUID());
-  return 1;
-}
-
 int LuaState::lua_Player_getGroup()
 {
   Player* p = popPlayer();
@@ -5019,13 +4924,6 @@ int LuaState::lua_createItem()
   return 1;
 }
 
-int LuaState::lua_Item_getItemID()
-{
-  Item* item = popItem();
-  pushInteger(item->getID());
-  return 1;
-}
-
 int LuaState::lua_Item_getLongName()
 {
   Item* item = popItem();
@@ -5055,20 +4953,6 @@ int LuaState::lua_Item_getSubtype()
   return 1;
 }
 
-int LuaState::lua_Item_getWeight()
-{
-  Item* item = popItem();
-  pushFloat(item->getWeight());
-  return 1;
-}
-
-int LuaState::lua_Item_isPickupable()
-{
-  Item* item = popItem();
-  pushBoolean(item->isPickupable());
-  return 1;
-}
-
 // Attributes!
 
 // Template function to prevent code duplication
@@ -5088,9 +4972,11 @@ int setItemAttribute(LuaState* state)
   std::string key = state->popString();
   Item* item = state->popItem();
 
-  item->setAttribute(key, value);
+  if(!item->setAttribute(key, value))
+    throw Script::Error("Can't set item attribute '" + key + "', there are too many attribute names.");
   // Update any intrinistic attributes
   updateActionID<T>(key, item, value);
+  Houses::getInstance()->onItemChanged(item);
 
   state->pushBoolean(true);
   return 1;
@@ -5113,6 +4999,8 @@ int LuaState::lua_Item_getRawAttribute()
   std::string key = popString();
   Item* item = popItem();
 
+  // Scripts see the time a decaying item has left
+  g_game.updateDecayDuration(item);
   boost::any value = item->getAttribute(key);
 
   if(value.empty())
@@ -5136,6 +5024,7 @@ int LuaState::lua_Item_eraseAttribute()
   Item* item = popItem();
 
   item->eraseAttribute(key);
+  Houses::getInstance()->onItemChanged(item);
 
   pushBoolean(true);
   return 1;
@@ -5288,6 +5177,20 @@ int LuaState::lua_getItemIDByName()
   return 1;
 }
 
+int LuaState::lua_getItemIDsByName()
+{
+  std::string name = popString();
+  const std::vector<int32_t>& ids = Item::items.getItemIdsByName(name);
+
+  int n = 1;
+  newTable();
+  for(std::vector<int32_t>::const_iterator i = ids.begin(); i != ids.end(); ++i){
+    pushUnsignedInteger(*i);
+    setField(-2, n++);
+  }
+  return 1;
+}
+
 int LuaState::lua_getItemType()
 {
   int32_t itemid = popInteger();
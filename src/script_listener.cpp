@@ -29,11 +29,23 @@ Listener::Listener(ListenerType t, const boost::any& data, Manager& manager) :
   active(true),
   type_(t),
   data(data),
-  manager(manager)
+  information(NULL),
+  manager(manager),
+  profile_entry(NULL)
 {
+#ifdef __DEBUG__
+  information_type = NULL;
+#endif
+  init();
+}
+
+void Listener::init() {
   std::ostringstream os;
   os << "Listener_" << type_.value() << "_" << ID;
   datatag = os.str();
+
+  // Owned by the module being loaded, if any
+  manager.getModules().addListener(type_, ID);
 }
 
 Listener::~Listener() {
@@ -22,10 +22,12 @@
 #include <boost/any.hpp>
 #include <boost/weak_ptr.hpp>
 #include <stdint.h>
+#include <typeinfo>
 #include "enums.h"
 
 namespace Script {
   class Manager;
+  class ProfileEntry;
 
   ///////////////////////////////////////////////////////////////////////////////
   // Event Listener
@@ -36,12 +38,19 @@ namespace Script {
   public:
     // Listener MUST be destroyed before the manager
     Listener(ListenerType type, const boost::any& data, Manager& manager);
+    // Keeps the script information of the event typed, see getInformation
+    template<class T>
+    Listener(ListenerType type, const T& information, Manager& manager);
     ~Listener();
 
     uint32_t getID() const {return ID;}
 
     std::string getLuaTag() const;
     const boost::any& getData() const;
+    // The information the listener was created with, NULL if it was
+    // created without typed information
+    template<class T>
+    const T* getInformation() const;
 
     bool isActive() const {return active;}
     void deactivate();
@@ -49,19 +58,32 @@ namespace Script {
     ListenerType type() const {return type_;}
     static std::string type2name();
     static ListenerType name2type();
+
+    // Set by the profiler the first time the listener is called
+    ProfileEntry* getProfileEntry() const {return profile_entry;}
+    void setProfileEntry(ProfileEntry* entry) {profile_entry = entry;}
   protected:
+    void init();
+
     static uint32_t ID_counter;
     uint32_t ID;
     bool active;
     ListenerType type_;
     std::string datatag;
     boost::any data;
+    // Points into data, so dispatching needs no any_cast
+    const void* information;
+#ifdef __DEBUG__
+    const std::type_info* information_type;
+#endif
     Manager& manager;
+    ProfileEntry* profile_entry;
   };
 
   typedef boost::shared_ptr<Listener> Listener_ptr;
   typedef boost::weak_ptr<Listener> Listener_wptr;
   typedef std::vector<Listener_ptr> ListenerList;
+  typedef boost::shared_ptr<const ListenerList> ListenerList_cptr;
 
   inline std::string Listener::getLuaTag() const {
     return datatag;
@@ -70,6 +92,30 @@ namespace Script {
   inline const boost::any& Listener::getData() const {
     return data;
   }
+
+  template<class T>
+  Listener::Listener(ListenerType t, const T& information, Manager& manager) :
+    ID(++ID_counter),
+    active(true),
+    type_(t),
+    data(information),
+    manager(manager),
+    profile_entry(NULL)
+  {
+    this->information = boost::any_cast<T>(&data);
+#ifdef __DEBUG__
+    information_type = &typeid(T);
+#endif
+    init();
+  }
+
+  template<class T>
+  inline const T* Listener::getInformation() const {
+#ifdef __DEBUG__
+    assert(!information || *information_type == typeid(T));
+#endif
+    return static_cast<const T*>(information);
+  }
 }
 
 #endif // __OTSERV_SCRIPT_EVENT_LISTENER_H__
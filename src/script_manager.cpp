@@ -21,6 +21,7 @@
 #include "script_event.h"
 #include "script_environment.h"
 #include "configmanager.h"
+#include "script_ffi.h"
 
 extern ConfigManager g_config;
 
@@ -40,10 +41,102 @@ Manager::Manager(Script::Environment& e) : LuaStateManager(NULL),
 
   registerClasses();
   registerFunctions();
+
+#ifdef __USE_LUAJIT__
+  setFFIEnvironment(environment);
+#endif
 }
 
 Manager::~Manager()
 {
+#ifdef __USE_LUAJIT__
+  setFFIEnvironment(NULL);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reload modules
+
+namespace {
+  // The listeners in the list that have one of the keys
+  void selectListeners(const ListenerList& list, const std::vector<ListenerKey>& keys, ListenerList& selected)
+  {
+    for(ListenerList::const_iterator listener = list.begin(); listener != list.end(); ++listener){
+      for(std::vector<ListenerKey>::const_iterator key = keys.begin(); key != keys.end(); ++key){
+        if(key->second == (*listener)->getID()){
+          selected.push_back(*listener);
+          break;
+        }
+      }
+    }
+  }
+}
+
+int32_t Manager::reloadModules(const std::vector<CompiledModule>& compiled, std::ostream& report)
+{
+  int32_t reloaded = 0;
+  modules.setReloading(true);
+
+  for(std::vector<CompiledModule>::const_iterator iter = compiled.begin(); iter != compiled.end(); ++iter){
+    if(!iter->error.empty()){
+      report << iter->error << std::endl;
+      continue;
+    }
+
+    Module* module = modules.getModule(iter->path);
+    if(!module)
+      continue;
+
+    std::vector<ListenerKey> old_listeners;
+    old_listeners.swap(module->listeners);
+    std::set<std::string> old_dependencies;
+    old_dependencies.swap(module->dependencies);
+    bool old_includes = module->includes;
+    module->includes = false;
+
+    try {
+      bool use_error_handler = pushErrorHandler();
+      if(luaL_loadbuffer(state, iter->bytecode.data(), iter->bytecode.size(), ("@" + iter->path).c_str()) != 0){
+        std::string error = popString();
+        if(use_error_handler)
+          pop(); // pop error handler
+        throw Script::Error(error);
+      }
+      runModule(iter->path, iter->name, use_error_handler);
+    } catch(Script::Error& err) {
+      report << err.what() << std::endl;
+
+      // Keep the old version running
+      for(std::vector<ListenerKey>::const_iterator key = module->listeners.begin(); key != module->listeners.end(); ++key)
+        environment->stopListener(key->first, key->second);
+      module->listeners.swap(old_listeners);
+      module->dependencies.swap(old_dependencies);
+      module->includes = old_includes;
+      continue;
+    }
+
+    module->modified = iter->modified;
+
+    // Both versions are registered now, the old one is told it is unloaded
+    // and stopped, then the new one is told it was loaded
+    ListenerList unload_listeners;
+    selectListeners(environment->Generic.OnUnload, old_listeners, unload_listeners);
+    OnServerUnload::Event unload_event(false);
+    ::dispatchEvent<OnServerUnload::Event>(&unload_event, *this, *environment, unload_listeners);
+
+    for(std::vector<ListenerKey>::const_iterator key = old_listeners.begin(); key != old_listeners.end(); ++key)
+      environment->stopListener(key->first, key->second);
+
+    ListenerList load_listeners;
+    selectListeners(environment->Generic.OnLoad, module->listeners, load_listeners);
+    OnServerLoad::Event load_event(false);
+    ::dispatchEvent<OnServerLoad::Event>(&load_event, *this, *environment, load_listeners);
+
+    ++reloaded;
+  }
+
+  modules.setReloading(false);
+  return reloaded;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -272,6 +365,63 @@ int Manager::luaCreateEnum(lua_State* L)
   }
 }
 
+LuaState* Manager::getCallingState(Manager* manager, lua_State* L, unsigned char* threadmem, LuaThread*& private_thread)
+{
+  if(L == manager->state) {
+    return manager;
+  }
+
+  ThreadMap::iterator finder = manager->threads.find(L);
+  if(finder != manager->threads.end())
+    return (finder->second).get();
+
+  private_thread = new(threadmem) LuaThread(manager, L);
+  return private_thread;
+}
+
+std::string Manager::formatError(lua_State* L, const std::string& function_name, const Script::Error& err)
+{
+  std::ostringstream os;
+
+  bool detailed = g_config.getNumber(ConfigManager::DETAIL_SCRIPT_ERRORS) != 0;
+
+  if (detailed){
+    os << "\n";
+    os << "                                   Lua Error\n";
+    os << "==============================================================================\n";
+    os << "\tDescription: " << err.what() << "\n";
+    os << "\tLast Source function: " << function_name << "\n";
+    os << "\n";
+    os << "   Lua Stack\n";
+    os << "==============\n";
+    for(int i = 1; i <= lua_gettop(L); ++i){
+      os << "\t" << i << "\t" << luaL_typename(L, i) << " = ";
+      switch(lua_type(L, i)){
+        case LUA_TNIL:
+          os << "nil";
+          break;
+        case LUA_TNUMBER:
+          os << lua_tonumber(L, i);
+          break;
+        case LUA_TBOOLEAN:
+          os << (lua_toboolean(L, i) == 1 ? "true" : "false");
+          break;
+        case LUA_TSTRING:
+          os << lua_tostring(L, i);
+          break;
+        default:
+          os << lua_topointer(L, i);
+          break;
+      }
+      os << "\n";
+    }
+  }
+  else{
+    os << "Lua Error: " << err.what();
+  }
+  return os.str();
+}
+
 int Manager::luaFunctionCallback(lua_State* L) {
   // Do NOT allocate complex types here, lua_error is called, which causes a longjump,
   // so complex destructors won't be called.
@@ -284,18 +434,7 @@ int Manager::luaFunctionCallback(lua_State* L) {
   LuaThread* private_thread = NULL;
   // REMEMBER TO EXPLICITLY CALL private_thread->~LuaThread
 
-  if(L == manager->state) {
-    state = manager;
-  }
-  else {
-    ThreadMap::iterator finder = manager->threads.find(L);
-    if(finder != manager->threads.end())
-      state = (finder->second).get();
-    else{
-      private_thread = new(threadmem) LuaThread(manager, L);
-      state = private_thread;
-    }
-  }
+  state = getCallingState(manager, L, threadmem, private_thread);
   
   // Keep track of the statistics!
   ++manager->functions_called;
@@ -444,57 +583,57 @@ int Manager::luaFunctionCallback(lua_State* L) {
       return ret;
     } catch(Script::Error& err) {
       // We can't use lua_error in the C++ function as it doesn't call destructors properly.
-      std::ostringstream os;
-      
-      bool detailed = g_config.getNumber(ConfigManager::DETAIL_SCRIPT_ERRORS) != 0;
-      
-      if (detailed){
-        os << "\n";
-        os << "                                   Lua Error\n";
-        os << "==============================================================================\n";
-        os << "\tDescription: " << err.what() << "\n";
-        os << "\tLast Source function: " << cc->name << "\n";
-        os << "\n";
-        os << "   Lua Stack\n";
-        os << "==============\n";
-        for(int i = 1; i <= lua_gettop(L); ++i){
-          os << "\t" << i << "\t" << luaL_typename(L, i) << " = ";
-          switch(lua_type(L, i)){
-            case LUA_TNIL:
-              os << "nil";
-              break;
-            case LUA_TNUMBER:
-              os << lua_tonumber(L, i);
-              break;
-            case LUA_TBOOLEAN:
-              os << (lua_toboolean(L, i) == 1 ? "true" : "false");
-              break;
-            case LUA_TSTRING:
-              os << lua_tostring(L, i);
-              break;
-            default:
-              os << lua_topointer(L, i);
-              break;
-          }
-          os << "\n";
-        }
+      std::string error = formatError(L, cc->name, err);
+      state->clearStack();
+      state->pushString(error.c_str());
+    }
+  }
+
+  if(private_thread)
+    private_thread->~LuaThread();
+
+  // Can't be done in handler, since then the destructor of Script::Error
+  // won't be called, which in turn won't call the destructor of the
+  // std::string object it owns
+  return lua_error(state->state);
+}
+
+int Manager::luaTypedFunctionCallback(lua_State* L) {
+  // Same rules as luaFunctionCallback, nothing complex may live outside the try block
+  TypedCallback* callback = (TypedCallback*)(lua_touserdata(L, lua_upvalueindex(2)));
+  Manager* manager = (Manager*)(lua_touserdata(L, lua_upvalueindex(1)));
+
+  unsigned char threadmem[sizeof(LuaThread)];
+  LuaThread* private_thread = NULL;
+  LuaState* state = getCallingState(manager, L, threadmem, private_thread);
+
+  ++manager->functions_called;
+
+  {
+    try {
+      int32_t argument_count = state->getStackSize();
+      if(argument_count > callback->argument_count) {
+        throw Script::Error("Too many arguments passed to function " + callback->name);
       }
-      else{
-        os << "Lua Error: " << err.what();
+      else if(argument_count < callback->argument_count) {
+        throw Script::Error("Too few arguments passed to function " + callback->name);
       }
 
+      int32_t ret = callback->call(*state);
 
+      if(private_thread)
+        private_thread->~LuaThread();
+      return ret;
+    } catch(Script::Error& err) {
+      std::string error = formatError(L, callback->name, err);
       state->clearStack();
-      state->pushString(os.str().c_str());
+      state->pushString(error.c_str());
     }
   }
 
   if(private_thread)
     private_thread->~LuaThread();
 
-  // Can't be done in handler, since then the destructor of Script::Error
-  // won't be called, which in turn won't call the destructor of the
-  // std::string object it owns
   return lua_error(state->state);
 }
 
@@ -905,3 +1044,29 @@ void Manager::registerMemberFunction(const std::string& cname, const std::string
   // Remove the class table
   lua_pop(state, 1);
 }
+
+void Manager::registerTypedCallback(const std::string& cname, const std::string& fname, TypedCallback* callback) {
+  // The manager owns the callback, lua only gets a pointer to it
+  typed_callbacks.push_back(TypedCallback_ptr(callback));
+
+  if(!cname.empty()) {
+    // Push the class table
+    lua_getfield(state, LUA_GLOBALSINDEX, cname.c_str());
+  }
+
+  // Push this manager (pointer cast is important!)
+  lua_pushlightuserdata(state, (Manager*)this);
+  // Push the callback, it already knows its argument types
+  lua_pushlightuserdata(state, callback);
+  lua_pushcclosure(state, luaTypedFunctionCallback, 2);
+
+  if(!cname.empty()) {
+    // Store the function at the class field fname
+    lua_setfield(state, -2, fname.c_str());
+    // Remove the class table
+    lua_pop(state, 1);
+  }
+  else {
+    lua_setfield(state, LUA_GLOBALSINDEX, fname.c_str());
+  }
+}
@@ -23,6 +23,8 @@
 #include <set>
 #include <boost/any.hpp>
 #include "lua_manager.h"
+#include "script_binding.h"
+#include "script_profiler.h"
 #include "boost_common.h"
 
 namespace Script {
@@ -45,6 +47,15 @@ namespace Script {
     int32_t eventsDiscarded() const;
     int32_t functionsCalled() const;
 
+    Profiler& getProfiler() {return profiler;}
+
+    /** Runs the modules again, on the dispatcher
+      * Listeners of a module are only replaced once its new version ran
+      * without errors, errors are written to the report.
+      * \returns The number of modules that were reloaded
+    */
+    int32_t reloadModules(const std::vector<CompiledModule>& compiled, std::ostream& report);
+
   protected:
     // This actually registers functions!
     // Defined in script functions.cpp
@@ -83,6 +94,7 @@ namespace Script {
     int32_t event_handlers_called;
     int32_t events_discarded;
     int32_t functions_called;
+    Profiler profiler;
 
     // Expose functions/classes to lua
     void registerClass(const std::string& cname);
@@ -91,11 +103,26 @@ namespace Script {
     void registerGlobalFunction(const std::string& fdecl, CallbackFunctionType cfunc);
     void registerMemberFunction(const std::string& cname, const std::string& fdecl, CallbackFunctionType cfunc);
 
+    // Binds a C++ function, argument and return types are taken from its
+    // signature. Member functions of game classes take self as only argument,
+    // free functions bound to a class take it as first argument.
+    template <class F>
+    void bindGlobalFunction(const std::string& fname, F func);
+    template <class F>
+    void bindMemberFunction(const std::string& cname, const std::string& fname, F func);
+    void registerTypedCallback(const std::string& cname, const std::string& fname, TypedCallback* callback);
+
+    typedef shared_ptr<TypedCallback> TypedCallback_ptr;
+    std::vector<TypedCallback_ptr> typed_callbacks;
+
     template <class ET>
     void registerEnum();
 
     // Callback from lua
     static int luaFunctionCallback(lua_State* L);
+    static int luaTypedFunctionCallback(lua_State* L);
+    static LuaState* getCallingState(Manager* manager, lua_State* L, unsigned char* threadmem, LuaThread*& private_thread);
+    static std::string formatError(lua_State* L, const std::string& function_name, const Script::Error& err);
     static int luaCompareClassInstances(lua_State* L);
     static int luaGetClassInstanceID(lua_State* L);
     static int luaCreateEnum(lua_State* L);
@@ -124,6 +151,18 @@ namespace Script {
   };
 }
 
+template<class F>
+inline void Script::Manager::bindGlobalFunction(const std::string& fname, F func)
+{
+  registerTypedCallback("", fname, makeCallback(fname, func));
+}
+
+template<class F>
+inline void Script::Manager::bindMemberFunction(const std::string& cname, const std::string& fname, F func)
+{
+  registerTypedCallback(cname, fname, makeCallback(cname + ":" + fname, func));
+}
+
 // Must be done here since it's a templated function
 template<class ET>
 inline void Script::Manager::registerEnum()
@@ -0,0 +1,191 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Tracks the lua files that were run, for incremental reloads
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <boost/filesystem.hpp>
+#include "lua.hpp"
+#include "script_module.h"
+#include "tasks.h"
+
+using namespace Script;
+
+namespace {
+  std::time_t getModifiedTime(const std::string& path)
+  {
+    try {
+      return boost::filesystem::last_write_time(path);
+    } catch(boost::filesystem::filesystem_error&) {
+      return 0;
+    }
+  }
+
+  bool compareOrder(const Module* a, const Module* b)
+  {
+    return a->order < b->order;
+  }
+
+  int writeChunk(lua_State* L, const void* p, size_t sz, void* ud)
+  {
+    ((std::string*)ud)->append((const char*)p, sz);
+    return 0;
+  }
+}
+
+ModuleTracker::ModuleTracker() :
+  next_order(1),
+  reloading(false)
+{
+}
+
+void ModuleTracker::beginLoad(const std::string& path, const std::string& name)
+{
+  Module& module = modules[path];
+  if(module.path.empty()){
+    module.path = path;
+    module.name = name;
+    module.modified = getModifiedTime(path);
+  }
+  loading.push_back(&module);
+}
+
+void ModuleTracker::endLoad(bool success)
+{
+  Module* module = loading.back();
+  loading.pop_back();
+
+  if(success && module->order == 0)
+    module->order = next_order++;
+}
+
+void ModuleTracker::addDependency(const std::string& path)
+{
+  if(!loading.empty() && loading.back()->path != path)
+    loading.back()->dependencies.insert(path);
+}
+
+void ModuleTracker::addInclude(const std::string& path)
+{
+  if(!loading.empty() && loading.back()->path != path)
+    loading.back()->includes = true;
+}
+
+void ModuleTracker::addListener(ListenerType type, uint32_t id)
+{
+  if(!loading.empty())
+    loading.back()->listeners.push_back(ListenerKey(type, id));
+}
+
+bool ModuleTracker::isLoaded(const std::string& path) const
+{
+  ModuleMap::const_iterator iter = modules.find(path);
+  return iter != modules.end() && iter->second.order != 0;
+}
+
+Module* ModuleTracker::getModule(const std::string& path)
+{
+  ModuleMap::iterator iter = modules.find(path);
+  if(iter == modules.end())
+    return NULL;
+  return &iter->second;
+}
+
+void ModuleTracker::getModules(std::vector<Module>& list) const
+{
+  list.reserve(modules.size());
+  for(ModuleMap::const_iterator iter = modules.begin(); iter != modules.end(); ++iter){
+    if(iter->second.order != 0)
+      list.push_back(iter->second);
+  }
+}
+
+void ModuleTracker::compileChanged(ReloadJob_ptr job)
+{
+  std::vector<Module*> reload;
+  std::set<std::string> reload_paths;
+
+  for(std::vector<Module>::iterator iter = job->modules.begin(); iter != job->modules.end(); ++iter){
+    std::time_t modified = getModifiedTime(iter->path);
+    // Removed files are left as they are
+    if(modified != 0 && modified != iter->modified){
+      iter->modified = modified;
+      reload.push_back(&*iter);
+      reload_paths.insert(iter->path);
+    }
+  }
+
+  // Modules that received the return value of a reloaded one are run again
+  // as well, they may have kept it. Modules that also include others are
+  // left alone, running them again would reset what the included modules
+  // added to them without running those.
+  bool added = !reload.empty();
+  while(added){
+    added = false;
+    for(std::vector<Module>::iterator iter = job->modules.begin(); iter != job->modules.end(); ++iter){
+      if(iter->includes || reload_paths.find(iter->path) != reload_paths.end())
+        continue;
+
+      for(std::set<std::string>::const_iterator dep = iter->dependencies.begin(); dep != iter->dependencies.end(); ++dep){
+        if(reload_paths.find(*dep) != reload_paths.end()){
+          reload.push_back(&*iter);
+          reload_paths.insert(iter->path);
+          added = true;
+          break;
+        }
+      }
+    }
+  }
+
+  std::sort(reload.begin(), reload.end(), compareOrder);
+
+  // Only used for parsing, nothing is run in it
+  lua_State* L = luaL_newstate();
+  if(L){
+    for(std::vector<Module*>::iterator iter = reload.begin(); iter != reload.end(); ++iter){
+      Module* module = *iter;
+      job->compiled.push_back(CompiledModule());
+      CompiledModule& compiled = job->compiled.back();
+      compiled.path = module->path;
+      compiled.name = module->name;
+      compiled.modified = module->modified;
+
+      std::ifstream file(module->path.c_str(), std::ios::in | std::ios::binary);
+      if(!file.is_open()){
+        compiled.error = "Could not open " + module->path;
+        continue;
+      }
+      std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+      // Same chunk name as luaL_loadfile, so errors point at the file
+      if(luaL_loadbuffer(L, source.data(), source.size(), ("@" + module->path).c_str()) != 0){
+        compiled.error = lua_tostring(L, -1);
+      }
+      else{
+        lua_dump(L, writeChunk, &compiled.bytecode);
+      }
+      lua_pop(L, 1);
+    }
+    lua_close(L);
+  }
+
+  g_dispatcher.addTask(createTask(boost::bind(job->callback, job)));
+}
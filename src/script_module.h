@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Tracks the lua files that were run, for incremental reloads
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_SCRIPT_MODULE_H__
+#define __OTSERV_SCRIPT_MODULE_H__
+
+#include <stdint.h>
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include "enums.h"
+
+namespace Script {
+
+  ///////////////////////////////////////////////////////////////////////////////
+  // Module
+  //
+  // A lua file run by loadFile or require. Listeners registered while its
+  // top level runs belong to it and are replaced when it is run again.
+
+  typedef std::pair<ListenerType, uint32_t> ListenerKey;
+
+  struct Module {
+    Module() : modified(0), order(0), includes(false) {}
+
+    std::string path;
+    // The name it was required by, empty for files run by loadFile
+    std::string name;
+    std::time_t modified;
+    // Position in the order loads finished, dependencies come first
+    uint32_t order;
+    // Paths of the required modules whose return value it received
+    std::set<std::string> dependencies;
+    // Ran other modules for their side effects only, such a module is not
+    // run again unless its own source changed
+    bool includes;
+    std::vector<ListenerKey> listeners;
+  };
+
+  // A module compiled again by the reload thread
+  struct CompiledModule {
+    std::string path;
+    std::string name;
+    std::time_t modified;
+    // Binary chunk, empty if it failed to compile
+    std::string bytecode;
+    std::string error;
+  };
+
+  struct ReloadJob;
+  typedef boost::shared_ptr<ReloadJob> ReloadJob_ptr;
+
+  struct ReloadJob {
+    ReloadJob() : generation(0), player_id(0) {}
+
+    // Copy of the modules when the reload was requested
+    std::vector<Module> modules;
+    // Changed modules and the ones using their return value, in load order
+    std::vector<CompiledModule> compiled;
+
+    // Set by the requester, compiled modules are discarded if the scripts
+    // were loaded again in the meantime
+    uint32_t generation;
+    uint32_t player_id;
+    // Run on the dispatcher when compiling is done
+    boost::function<void (ReloadJob_ptr)> callback;
+  };
+
+  class ModuleTracker {
+  public:
+    ModuleTracker();
+
+    // The module stays the current one until endLoad
+    void beginLoad(const std::string& path, const std::string& name);
+    void endLoad(bool success);
+    // Modules being loaded, a failed load ends all loads started inside it
+    size_t loadDepth() const {return loading.size();}
+    Module* getCurrent() const {return loading.empty()? NULL : loading.back();}
+
+    // The current module received the return value of the module
+    void addDependency(const std::string& path);
+    // The current module ran the module, ignoring what it returned
+    void addInclude(const std::string& path);
+    // Listener registered by the current module
+    void addListener(ListenerType type, uint32_t id);
+
+    bool isLoaded(const std::string& path) const;
+    Module* getModule(const std::string& path);
+
+    // While set, loaded modules are not run again by loadFile and require,
+    // the reload runs the changed ones itself
+    bool isReloading() const {return reloading;}
+    void setReloading(bool r) {reloading = r;}
+
+    void getModules(std::vector<Module>& list) const;
+
+    // Runs on a thread of its own, finds the modules that changed on disk
+    // and compiles them in a separate lua state
+    static void compileChanged(ReloadJob_ptr job);
+
+  protected:
+    typedef std::map<std::string, Module> ModuleMap;
+    ModuleMap modules;
+    std::vector<Module*> loading;
+    uint32_t next_order;
+    bool reloading;
+  };
+}
+
+#endif // __OTSERV_SCRIPT_MODULE_H__
@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+#include "otpch.h"
+
+#include <algorithm>
+#include "script_profiler.h"
+#include "script_listener.h"
+#include "configmanager.h"
+
+extern ConfigManager g_config;
+
+using namespace Script;
+
+///////////////////////////////////////////////////////////////////////////////
+// Listener profile
+
+ProfileEntry::ProfileEntry(const std::string& source, const std::string& event_name) :
+  source(source),
+  event_name(event_name),
+  calls(0),
+  total_time(0),
+  max_time(0),
+  allocated(0),
+  aborted(0)
+{
+  std::fill(histogram, histogram + HISTOGRAM_SIZE, 0);
+}
+
+void ProfileEntry::record(int64_t time, uint64_t bytes)
+{
+  ++calls;
+  total_time += time;
+  max_time = std::max(max_time, time);
+  allocated += bytes;
+
+  int32_t bucket = 0;
+  while(bucket < HISTOGRAM_SIZE - 1 && (time >> bucket) != 0)
+    ++bucket;
+  ++histogram[bucket];
+}
+
+int64_t ProfileEntry::percentile(double p) const
+{
+  // Runs allowed to be slower than the result
+  uint64_t above = (uint64_t)(calls * (1.0 - p));
+  uint64_t count = 0;
+  for(int32_t bucket = HISTOGRAM_SIZE - 1; bucket > 0; --bucket){
+    count += histogram[bucket];
+    if(count > above)
+      return std::min((int64_t)1 << bucket, max_time);
+  }
+  return 0;
+}
+
+int64_t ProfileEntry::averageTime() const
+{
+  if(calls == 0)
+    return 0;
+  return total_time / (int64_t)calls;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Profiler
+
+Profiler::Profiler() :
+  enabled(g_config.getNumber(ConfigManager::SCRIPT_PROFILER) != 0)
+{
+}
+
+Profiler::~Profiler()
+{
+  for(EntryMap::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+    delete iter->second;
+}
+
+ProfileEntry* Profiler::getEntry(Listener& listener, const std::string& source, const std::string& event_name)
+{
+  std::string key = source + " " + event_name;
+  EntryMap::iterator iter = entries.find(key);
+  if(iter == entries.end())
+    iter = entries.insert(std::make_pair(key, new ProfileEntry(source, event_name))).first;
+
+  listener.setProfileEntry(iter->second);
+  return iter->second;
+}
+
+namespace {
+  bool compareTotalTime(const ProfileEntry* a, const ProfileEntry* b)
+  {
+    return a->total_time > b->total_time;
+  }
+}
+
+void Profiler::getEntries(std::vector<const ProfileEntry*>& list, size_t count) const
+{
+  list.clear();
+  for(EntryMap::const_iterator iter = entries.begin(); iter != entries.end(); ++iter)
+    list.push_back(iter->second);
+
+  count = std::min(count, list.size());
+  std::partial_sort(list.begin(), list.begin() + count, list.end(), compareTotalTime);
+  list.resize(count);
+}
+
+void Profiler::log(std::ostream& os, size_t count) const
+{
+  std::vector<const ProfileEntry*> list;
+  getEntries(list, count);
+  if(list.empty())
+    return;
+
+  os << "Script profile (time in microseconds):" << std::endl;
+  os << "Calls\tTotal\tAvg\tP99\tMax\tAlloc\tAborted\tListener" << std::endl;
+  for(std::vector<const ProfileEntry*>::const_iterator iter = list.begin(); iter != list.end(); ++iter){
+    const ProfileEntry* entry = *iter;
+    os << entry->calls << "\t" <<
+      entry->total_time << "\t" <<
+      entry->averageTime() << "\t" <<
+      entry->percentile(0.99) << "\t" <<
+      entry->max_time << "\t" <<
+      entry->allocated << "\t" <<
+      entry->aborted << "\t" <<
+      entry->source << " " << entry->event_name << std::endl;
+  }
+}
@@ -0,0 +1,88 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+#ifndef __OTSERV_SCRIPT_PROFILER_H__
+#define __OTSERV_SCRIPT_PROFILER_H__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace Script {
+  class Listener;
+
+  ///////////////////////////////////////////////////////////////////////////////
+  // Listener profile
+  //
+  // Listeners defined by the same function for the same event share an entry.
+  // Times are wall time in microseconds and include the events the listener
+  // dispatches itself.
+
+  class ProfileEntry {
+  public:
+    ProfileEntry(const std::string& source, const std::string& event_name);
+
+    void record(int64_t time, uint64_t allocated);
+
+    // Upper bound of the power of two bucket the percentile falls in
+    int64_t percentile(double p) const;
+    int64_t averageTime() const;
+
+    std::string source;
+    std::string event_name;
+
+    uint64_t calls;
+    int64_t total_time;
+    int64_t max_time;
+    uint64_t allocated;
+    uint32_t aborted;
+
+  protected:
+    enum {HISTOGRAM_SIZE = 32};
+    // Bucket i counts the runs taking less than 2^i microseconds
+    uint32_t histogram[HISTOGRAM_SIZE];
+  };
+
+  class Profiler {
+  public:
+    Profiler();
+    ~Profiler();
+
+    bool isEnabled() const {return enabled;}
+
+    /** Finds or adds the entry and stores it in the listener
+      * \param source The "file:line" the listener function was defined at
+    */
+    ProfileEntry* getEntry(Listener& listener, const std::string& source, const std::string& event_name);
+
+    // Entries with the most time spent first
+    void getEntries(std::vector<const ProfileEntry*>& list, size_t count) const;
+
+    void log(std::ostream& os, size_t count) const;
+
+  protected:
+    bool enabled;
+
+    typedef std::map<std::string, ProfileEntry*> EntryMap;
+    EntryMap entries;
+  };
+}
+
+#endif // __OTSERV_SCRIPT_PROFILER_H__
@@ -84,6 +84,7 @@ bool Spawns::loadFromXml(const std::string& _filename)
           centerPos.x = intValue;
         }
         else{
+          createSpawns();
           xmlFreeDoc(doc);
           return false;
         }
@@ -92,6 +93,7 @@ bool Spawns::loadFromXml(const std::string& _filename)
           centerPos.y = intValue;
         }
         else{
+          createSpawns();
           xmlFreeDoc(doc);
           return false;
         }
@@ -100,6 +102,7 @@ bool Spawns::loadFromXml(const std::string& _filename)
           centerPos.z = intValue;
         }
         else{
+          createSpawns();
           xmlFreeDoc(doc);
           return false;
         }
@@ -108,12 +111,15 @@ bool Spawns::loadFromXml(const std::string& _filename)
           radius = intValue;
         }
         else{
+          createSpawns();
           xmlFreeDoc(doc);
           return false;
         }
 
-        Spawn* spawn = new Spawn(centerPos, radius);
-        spawnList.push_back(spawn);
+        definitions.push_back(SpawnDefinition());
+        SpawnDefinition& definition = definitions.back();
+        definition.centerPos = centerPos;
+        definition.radius = radius;
 
         xmlNodePtr tmpNode = spawnNode->children;
         while(tmpNode){
@@ -166,7 +172,13 @@ bool Spawns::loadFromXml(const std::string& _filename)
             }
 
             if(interval >= MINSPAWN_INTERVAL){
-              spawn->addMonster(name, pos, dir, interval);
+              SpawnCreature creature;
+              creature.name = name;
+              creature.pos = pos;
+              creature.direction = dir;
+              creature.interval = interval;
+              creature.npc = false;
+              definition.creatures.push_back(creature);
             }
             else{
               std::cout << "[Warning] Spawns::loadFromXml " << name << " " << pos << " spawntime can not be less than " << MINSPAWN_INTERVAL / 1000 << " seconds." << std::endl;
@@ -207,7 +219,13 @@ bool Spawns::loadFromXml(const std::string& _filename)
               continue;
             }
 
-            spawn->addNPC(name, pos, direction);
+            SpawnCreature creature;
+            creature.name = name;
+            creature.pos = pos;
+            creature.direction = direction;
+            creature.interval = 0;
+            creature.npc = true;
+            definition.creatures.push_back(creature);
           }
 
           tmpNode = tmpNode->next;
@@ -218,6 +236,7 @@ bool Spawns::loadFromXml(const std::string& _filename)
     }
 
     xmlFreeDoc(doc);
+    createSpawns();
     loaded = true;
     return true;
   }
@@ -225,6 +244,36 @@ bool Spawns::loadFromXml(const std::string& _filename)
   return false;
 }
 
+bool Spawns::loadFromDefinitions(const std::string& _filename, const SpawnDefinitionList& list)
+{
+  if(isLoaded()){
+    return true;
+  }
+
+  filename = _filename;
+  definitions = list;
+  createSpawns();
+  loaded = true;
+  return true;
+}
+
+void Spawns::createSpawns()
+{
+  for(SpawnDefinitionList::const_iterator it = definitions.begin(); it != definitions.end(); ++it){
+    Spawn* spawn = new Spawn(it->centerPos, it->radius);
+    spawnList.push_back(spawn);
+
+    for(std::vector<SpawnCreature>::const_iterator cit = it->creatures.begin(); cit != it->creatures.end(); ++cit){
+      if(cit->npc){
+        spawn->addNPC(cit->name, cit->pos, cit->direction);
+      }
+      else{
+        spawn->addMonster(cit->name, cit->pos, cit->direction, cit->interval);
+      }
+    }
+  }
+}
+
 void Spawns::startup()
 {
   if(!isLoaded() || isStarted())
@@ -244,6 +293,7 @@ void Spawns::clear()
   }
 
   spawnList.clear();
+  definitions.clear();
 
   loaded = false;
   started = false;
@@ -24,6 +24,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 #include <stdint.h>
 #include "enums.h"
 #include "position.h"
@@ -43,6 +44,23 @@ struct spawnBlock_t{
   int64_t lastSpawn;
 };
 
+// A monster or npc as it is listed in the spawn file
+struct SpawnCreature{
+  std::string name;
+  Position pos;
+  Direction direction;
+  uint32_t interval;
+  bool npc;
+};
+
+struct SpawnDefinition{
+  Position centerPos;
+  int32_t radius;
+  std::vector<SpawnCreature> creatures;
+};
+
+typedef std::vector<SpawnDefinition> SpawnDefinitionList;
+
 class Spawns{
 public:
   Spawns();
@@ -53,6 +71,9 @@ public:
   bool isInZone(const Position& centerPos, int32_t radius, const Position& pos);
 
   bool loadFromXml(const std::string& datadir);
+  // Creates the spawns without reading the file, used by the world image
+  bool loadFromDefinitions(const std::string& _filename, const SpawnDefinitionList& list);
+  const SpawnDefinitionList& getDefinitions() const {return definitions;}
   void startup();
   void clear();
 
@@ -60,7 +81,10 @@ public:
   bool isStarted() const;
 
 private:
+  void createSpawns();
+
   SpawnList spawnList;
+  SpawnDefinitionList definitions;
 
   bool loaded;
   bool started;
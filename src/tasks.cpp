@@ -71,6 +71,13 @@ void Dispatcher::dispatcherThread(void* p)
     // check if there are tasks waiting
     taskLockUnique.lock(); //getDispatcher().m_taskLock.lock();
 
+    if(dispatcher->m_taskList.empty() && dispatcher->m_threadState == STATE_RUNNING){
+      // nothing to do, give the time to the script garbage collector
+      taskLockUnique.unlock();
+      g_game.collectScriptGarbage();
+      taskLockUnique.lock();
+    }
+
     if(dispatcher->m_taskList.empty()){
       //if the list is empty wait for signal
       #ifdef __DEBUG_SCHEDULER__
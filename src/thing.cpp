@@ -29,7 +29,8 @@ extern void g_gameUnscriptThing(Thing* thing);
 
 Thing::Thing() :
   parent(NULL),
-  m_refCount(0)
+  m_refCount(0),
+  m_scriptSlot(0)
 {
   //
 }
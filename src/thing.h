@@ -30,6 +30,9 @@ class Tile;
 class Position;
 class Creature;
 class Item;
+namespace Script {
+  class Environment;
+}
 
 class Thing {
 protected:
@@ -40,6 +43,7 @@ public:
 
   void addRef();
   void unRef();
+  int32_t getRefCount() const {return m_refCount;}
 
   virtual std::string getDescription(int32_t lookDistance) const = 0;
 
@@ -70,6 +74,10 @@ public:
 private:
   Cylinder* parent;
   int32_t m_refCount;
+
+  // Slot in the script object table + 1, 0 if scripts don't know this thing
+  uint32_t m_scriptSlot;
+  friend class Script::Environment;
 };
 
 #endif //__THING_H__
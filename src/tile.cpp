@@ -177,7 +177,7 @@ Item* Tile::getItemByTopOrder(uint32_t topOrder)
 
   for(TileItemIterator reverse_it = items_topEnd(); reverse_it != items_topBegin();){
     --reverse_it;
-    if(Item::items[(*reverse_it)->getID()].alwaysOnTopOrder == (int32_t)topOrder){
+    if(Item::items.getHot((*reverse_it)->getID()).alwaysOnTopOrder == topOrder){
       return (*reverse_it);
     }
   }
@@ -185,6 +185,29 @@ Item* Tile::getItemByTopOrder(uint32_t topOrder)
   return NULL;
 }
 
+Item* Tile::getGround()
+{
+  if(ground && ground->isShared()){
+    Item* item = ground->clone();
+    item->setParent(this);
+
+    Item* shared = ground;
+    ground = item;
+    Item::releaseSharedItem(shared);
+  }
+
+  return ground;
+}
+
+Thing* Tile::getThing(uint32_t index)
+{
+  if(ground && index == 0){
+    return getGround();
+  }
+
+  return __getThing(index);
+}
+
 Thing* Tile::getTopVisibleThing(const Creature* creature)
 {
   for(CreatureConstIterator cit = creatures_begin(); cit != creatures_end(); ++cit){
@@ -194,22 +217,20 @@ Thing* Tile::getTopVisibleThing(const Creature* creature)
   }
 
   for(TileItemIterator it = items_downBegin(); it != items_downEnd(); ++it){
-    const ItemType& iit = Item::items[(*it)->getID()];
-    if(!iit.lookThrough){
+    if(!Item::items.getHot((*it)->getID()).hasProperty(ITEMPROP_LOOKTHROUGH)){
       return (*it);
     }
   }
 
   for(TileItemIterator reverse_it = items_topEnd(); reverse_it != items_topBegin();){
     --reverse_it;
-    const ItemType& iit = Item::items[(*reverse_it)->getID()];
-    if(!iit.lookThrough){
+    if(!Item::items.getHot((*reverse_it)->getID()).hasProperty(ITEMPROP_LOOKTHROUGH)){
       return (*reverse_it);
     }
   }
 
   if(ground)
-    return ground;
+    return getGround();
 
   return NULL;
 }
@@ -568,12 +589,12 @@ ReturnValue Tile::__queryAdd(int32_t index, const Thing* thing, uint32_t count,
       if(item->isPickupable()){
         ItemVector vector = items_getListWithProps(ITEMPROP_BLOCKSOLID);
         for(ItemVector::iterator it = vector.begin(); it != vector.end(); ++it){
-          const ItemType& iType = Item::items[(*it)->getID()];
-          if(iType.allowPickupable){
+          const ItemTypeHot& iType = Item::items.getHot((*it)->getID());
+          if(iType.hasProperty(ITEMPROP_ALLOWPICKUPABLE)){
             continue;
           }
 
-          if(!iType.hasHeight || iType.pickupable || iType.isBed()){
+          if(!iType.hasProperty(ITEMPROP_HASHEIGHT) || iType.hasProperty(ITEMPROP_PICKUPABLE) || iType.type == ITEM_TYPE_BED){
             return RET_NOTENOUGHROOM;
           }
         }
@@ -714,8 +735,10 @@ void Tile::__addThing(Creature* actor, int32_t index, Thing* thing)
         const ItemType& oldType = Item::items[ground->getID()];
         const ItemType& newType = Item::items[item->getID()];
 
+        // Scripts get to see the removed ground
+        Item* oldGround = getGround();
         int32_t oldGroundIndex = __getIndexOfThing(ground);
-        Item* oldGround = ground;
+        g_game.stopDecay(ground);
         ground->setParent(NULL);
         g_game.FreeThing(ground);
         ground = item;
@@ -734,6 +757,7 @@ void Tile::__addThing(Creature* actor, int32_t index, Thing* thing)
             int32_t oldSplashIndex = __getIndexOfThing(*it);
             Item* oldSplash = *it;
             __removeThing(actor, oldSplash, 1);
+            g_game.stopDecay(oldSplash);
             oldSplash->setParent(NULL);
             g_game.FreeThing(oldSplash);
             postRemoveNotification(actor, oldSplash, NULL, oldSplashIndex, true);
@@ -746,7 +770,7 @@ void Tile::__addThing(Creature* actor, int32_t index, Thing* thing)
 
       for(TileItemIterator it = items_topBegin(); it != items_topEnd(); ++it){
         //Note: this is different from internalAddThing
-        if(Item::items[item->getID()].alwaysOnTopOrder <= Item::items[(*it)->getID()].alwaysOnTopOrder){
+        if(Item::items.getHot(item->getID()).alwaysOnTopOrder <= Item::items.getHot((*it)->getID()).alwaysOnTopOrder){
           items_insert(it, item);
           isInserted = true;
           break;
@@ -768,6 +792,7 @@ void Tile::__addThing(Creature* actor, int32_t index, Thing* thing)
             int32_t oldFieldIndex = __getIndexOfThing(oldField);
             __removeThing(actor, oldField, 1);
 
+            g_game.stopDecay(oldField);
             oldField->setParent(NULL);
             g_game.FreeThing(oldField);
             postRemoveNotification(actor, oldField, NULL, oldFieldIndex, true);
@@ -1279,7 +1304,7 @@ void Tile::__internalAddThing(uint32_t index, Thing* thing)
     else if(item->isAlwaysOnTop()){
       bool isInserted = false;
       for(TileItemIterator it = items_topBegin(); it != items_topEnd(); ++it){
-        if(Item::items[(*it)->getID()].alwaysOnTopOrder > Item::items[item->getID()].alwaysOnTopOrder){
+        if(Item::items.getHot((*it)->getID()).alwaysOnTopOrder > Item::items.getHot(item->getID()).alwaysOnTopOrder){
           items_insert(it, item);
           isInserted = true;
           break;
@@ -1329,6 +1354,21 @@ bool Tile::hasItemWithProperty(Item* exclude, uint32_t props) const
   return false;
 }
 
+bool Tile::hasItemWithActionId(Item* exclude) const
+{
+  if(ground && exclude != ground && ground->getActionId() != 0){
+    return true;
+  }
+
+  for(TileItemConstIterator it = items_begin(); it != items_end(); ++it){
+    const Item* item = *it;
+    if(item != exclude && item->getActionId() != 0)
+      return true;
+  }
+
+  return false;
+}
+
 void Tile::updateTileFlags(Item* item, bool removed)
 {
   if(!removed){
@@ -1385,6 +1425,9 @@ void Tile::updateTileFlags(Item* item, bool removed)
     if(item->getTeleport()){
       setFlag(TILEPROP_POSITIONCHANGE);
     }
+    if(item->getActionId() != 0){
+      setFlag(TILEPROP_SCRIPT_HOOK);
+    }
   }
   else{
     if(item->hasProperty(ITEMPROP_FLOORCHANGEDOWN) && !hasItemWithProperty(item, ITEMPROP_FLOORCHANGEDOWN) ){
@@ -1438,5 +1481,8 @@ void Tile::updateTileFlags(Item* item, bool removed)
     if(item->getTeleport()){
       resetFlag(TILEPROP_POSITIONCHANGE);
     }
+    if(item->getActionId() != 0 && !hasItemWithActionId(item)){
+      resetFlag(TILEPROP_SCRIPT_HOOK);
+    }
   }
 }
@@ -348,12 +348,23 @@ public:
   Creature* getTopVisibleCreature(const Creature* creature);
   const Creature* getTopVisibleCreature(const Creature* creature) const;
   Item* getItemByTopOrder(uint32_t topOrder);
+  // The ground member may be shared with other tiles and must only be read,
+  // this gives the tile a ground of its own that can be handed out
+  Item* getGround();
+  // The const lookups return the shared ground as it is, callers that keep or
+  // change what they found get the tile's own ground through these
+  Item* getOwnItem(Item* item) {return (item && item->isShared()? getGround() : item);}
+  // The ground as it is, for reading, it may be shared with other tiles
+  const Item* getSharedGround() const {return ground;}
+  bool hasGround() const {return ground != NULL;}
+  Thing* getThing(uint32_t index);
 
   uint32_t getThingCount() const {return (ground ? 1 : 0) + items_count() + creatures_count();}
   uint32_t getCreatureCount() const;
 
   bool hasItemWithProperty(uint32_t props) const;
   bool hasItemWithProperty(Item* exclude, uint32_t props) const;
+  bool hasItemWithActionId(Item* exclude) const;
 
   bool blockSolid() const {return hasFlag(TILEPROP_BLOCKSOLID);}
   bool blockPathFind() const {return hasFlag(TILEPROP_BLOCKPATH);}
@@ -440,14 +451,16 @@ private:
 
 public:
   QTreeLeafNode*  qt_node;
-  Item* ground;
 
 protected:
+  // Only read through getSharedGround, getGround gives the tile its own
+  Item* ground;
   uint16_t downItemCount;
   Position tilePos;
   uint32_t m_flags;
 
   friend class Map;
+  friend class IOMapImage;
 };
 
 // Used for walkable tiles, where there is high likeliness of
@@ -1202,6 +1215,10 @@ inline TileItemIterator Tile::items_erase(TileItemIterator _pos)
 
 inline void Tile::items_onItemModified(Item* item)
 {
+  if(item->getParent() == this && item->getActionId() != 0){
+    setFlag(TILEPROP_SCRIPT_HOOK);
+  }
+
   if(is_dynamic())
     return static_cast<DynamicTile*>(this)->DynamicTile::items_onItemModified(item);
   else if(is_indexed())
@@ -21,6 +21,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <libxml/encoding.h>
 #include <libxml/tree.h>
 #include "tools.h"
@@ -515,3 +516,28 @@ uint32_t adlerChecksum(uint8_t *data, int32_t len)
 
   return (b << 16) | a;
 }
+
+bool hashFile(const std::string& file, uint64_t& hash)
+{
+  std::ifstream in(file.c_str(), std::ios::in | std::ios::binary);
+  if(!in.is_open()){
+    return false;
+  }
+
+  char buffer[0x10000];
+  uint64_t length = 0;
+  while(in){
+    in.read(buffer, sizeof(buffer));
+    for(std::streamsize i = 0; i < in.gcount(); ++i){
+      hash ^= (uint8_t)buffer[i];
+      hash *= 0x100000001B3ULL;
+    }
+    length += in.gcount();
+  }
+
+  for(size_t i = 0; i < sizeof(length); ++i){
+    hash ^= (uint8_t)(length >> (i * 8));
+    hash *= 0x100000001B3ULL;
+  }
+  return !in.bad();
+}
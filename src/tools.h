@@ -100,4 +100,6 @@ std::string playerSexAdjectiveString(PlayerSex sex);
 std::string playerSexSubjectString(PlayerSex sex);
 std::string combatTypeToString(CombatType type);
 uint32_t adlerChecksum(uint8_t *data, int32_t len);
+// FNV-1a over the contents and length of the file, chained onto hash
+bool hashFile(const std::string& file, uint64_t& hash);
 #endif
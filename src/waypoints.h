@@ -39,6 +39,7 @@ public:
 
   void addWaypoint(Waypoint_ptr wp);
   Waypoint_ptr getWaypointByName(const std::string& name) const;
+  void getWaypoints(std::vector<Waypoint_ptr>& list) const;
 
 protected:
   typedef std::map<std::string, Waypoint_ptr> WaypointMap;
@@ -61,4 +62,11 @@ inline Waypoint_ptr Waypoints::getWaypointByName(const std::string& name) const
   return f->second;
 }
 
+inline void Waypoints::getWaypoints(std::vector<Waypoint_ptr>& list) const
+{
+  for(WaypointMap::const_iterator it = waypoints.begin(); it != waypoints.end(); ++it){
+    list.push_back(it->second);
+  }
+}
+
 #endif
@@ -0,0 +1,286 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Lua binding dispatch benchmark
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+// Calls a getter on a userdata object from a Lua loop through copies of
+// the two dispatchers of Script::Manager:
+// - declared: luaFunctionCallback, which looks the declaration up in the
+//   function map and walks its argument list and type names on every call
+// - typed: luaTypedFunctionCallback, which checks the argument count and
+//   makes one virtual call
+// The calling state lookup and the class check of the pop functions are
+// the same for both and left out, the numbers are the dispatch only.
+// Methods are found through the metatable of the object, the same way
+// scripts find them in the server. Build from the repository root:
+//
+//   g++ -O2 -Isrc -I/usr/include/libxml2 -I<lua include dir> \
+//     tools/bench/binding_bench.cpp -llua5.1 -o binding_bench
+//
+// Usage: binding_bench [calls]
+
+#include "otpch.h"
+#include "otsystem.h"
+#include "lua.hpp"
+
+#include <stdlib.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/any.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace {
+  struct BenchPlayer {
+    uint32_t level;
+    uint32_t getLevel() const {return level;}
+  };
+
+  BenchPlayer* popPlayer(lua_State* L)
+  {
+    BenchPlayer* player = *(BenchPlayer**)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    return player;
+  }
+
+  // Declared path, the function map and the argument walk
+  struct ArgumentDeclaration {
+    std::string name;
+    std::vector<std::string> types;
+    boost::any default_value;
+    int32_t optional_level;
+  };
+
+  struct Declaration {
+    int (*func)(lua_State* L);
+    std::string name;
+    std::vector<ArgumentDeclaration> parameters;
+  };
+
+  typedef boost::shared_ptr<Declaration> Declaration_ptr;
+  std::map<uint32_t, Declaration_ptr> function_map;
+
+  int lua_Player_getLevel(lua_State* L)
+  {
+    lua_pushnumber(L, popPlayer(L)->getLevel());
+    return 1;
+  }
+
+  int declaredCallback(lua_State* L)
+  {
+    uint32_t callbackID = uint32_t(lua_tonumber(L, lua_upvalueindex(1)));
+    Declaration_ptr cc = function_map[callbackID];
+
+    int32_t argument_count = lua_gettop(L);
+    if((unsigned int)argument_count > cc->parameters.size())
+      return luaL_error(L, "Too many arguments");
+
+    int32_t required_arguments = 0;
+    for(std::vector<ArgumentDeclaration>::const_iterator it = cc->parameters.begin(); it != cc->parameters.end(); ++it){
+      if(it->optional_level == 0)
+        required_arguments += 1;
+    }
+    if(argument_count < required_arguments)
+      return luaL_error(L, "Too few arguments");
+
+    int32_t parsed_argument_count = 0;
+    for(std::vector<ArgumentDeclaration>::const_iterator it = cc->parameters.begin(); it != cc->parameters.end(); ++it){
+      if(parsed_argument_count >= required_arguments)
+        break;
+      parsed_argument_count += 1;
+
+      std::string expected_type = "";
+      for(std::vector<std::string>::const_iterator type = it->types.begin(); type != it->types.end(); ++type){
+        if(*type == "mixed"){
+          expected_type = "";
+          break;
+        }
+        else if(*type == "boolean"){
+          if(lua_isboolean(L, parsed_argument_count)){
+            expected_type = "";
+            break;
+          }
+          expected_type = "boolean";
+        }
+        else if(*type == "number"){
+          if(lua_isnumber(L, parsed_argument_count)){
+            expected_type = "";
+            break;
+          }
+          expected_type = "number";
+        }
+        else if(*type == "string"){
+          if(lua_isstring(L, parsed_argument_count)){
+            expected_type = "";
+            break;
+          }
+          expected_type = "string";
+        }
+        else if(*type == "function"){
+          if(lua_isfunction(L, parsed_argument_count)){
+            expected_type = "";
+            break;
+          }
+          expected_type = "function";
+        }
+        else if(*type == "userdata"){
+          if(lua_isuserdata(L, parsed_argument_count)){
+            expected_type = "";
+            break;
+          }
+          expected_type = "userdata";
+        }
+        else if(*type == "thread"){
+          if(lua_isthread(L, parsed_argument_count)){
+            expected_type = "";
+            break;
+          }
+          expected_type = "thread";
+        }
+        else if(*type == "table"){
+          if(lua_istable(L, parsed_argument_count)){
+            expected_type = "";
+            break;
+          }
+          expected_type = "table";
+        }
+      }
+      if(expected_type != "")
+        return luaL_error(L, "Wrong argument type");
+    }
+
+    return cc->func(L);
+  }
+
+  // Typed path, what ConstMemberCallback does
+  class TypedCallback {
+  public:
+    TypedCallback(const std::string& name, int32_t argument_count) : name(name), argument_count(argument_count) {}
+    virtual ~TypedCallback() {}
+    virtual int call(lua_State* L) = 0;
+
+    std::string name;
+    int32_t argument_count;
+  };
+
+  template<class R, class C>
+  class ConstMemberCallback : public TypedCallback {
+  public:
+    typedef R (C::*Function)() const;
+    ConstMemberCallback(const std::string& name, Function func) : TypedCallback(name, 1), func(func) {}
+    virtual int call(lua_State* L) {
+      C* self = popPlayer(L);
+      lua_pushnumber(L, (self->*func)());
+      return 1;
+    }
+
+    Function func;
+  };
+
+  int typedCallback(lua_State* L)
+  {
+    TypedCallback* callback = (TypedCallback*)lua_touserdata(L, lua_upvalueindex(1));
+
+    int32_t argument_count = lua_gettop(L);
+    if(argument_count != callback->argument_count)
+      return luaL_error(L, "Wrong number of arguments");
+
+    return callback->call(L);
+  }
+
+  void registerMethods(lua_State* L, TypedCallback* typed)
+  {
+    // Player metatable with both versions of the getter
+    lua_newtable(L);
+    lua_newtable(L);
+
+    Declaration_ptr cc(new Declaration());
+    cc->func = &lua_Player_getLevel;
+    cc->name = "getLevel";
+    ArgumentDeclaration self;
+    self.name = "self";
+    self.types.push_back("Player");
+    self.optional_level = 0;
+    cc->parameters.push_back(self);
+    function_map[1] = cc;
+
+    lua_pushnumber(L, 1);
+    lua_pushcclosure(L, &declaredCallback, 1);
+    lua_setfield(L, -2, "getLevelDeclared");
+
+    lua_pushlightuserdata(L, typed);
+    lua_pushcclosure(L, &typedCallback, 1);
+    lua_setfield(L, -2, "getLevelTyped");
+
+    lua_setfield(L, -2, "__index");
+  }
+
+  double run(lua_State* L, const char* method, int calls)
+  {
+    std::string chunk = std::string("local player, calls = ... for i = 1, calls do player:") + method + "() end";
+    if(luaL_loadstring(L, chunk.c_str()) != 0){
+      std::cout << lua_tostring(L, -1) << std::endl;
+      exit(1);
+    }
+    lua_pushvalue(L, 1);
+    lua_pushnumber(L, calls);
+
+    int64_t start = OTSYS_TIME_MICRO();
+    if(lua_pcall(L, 2, 0, 0) != 0){
+      std::cout << lua_tostring(L, -1) << std::endl;
+      exit(1);
+    }
+    int64_t elapsed = OTSYS_TIME_MICRO() - start;
+    return calls * 1000000. / (elapsed > 0 ? elapsed : 1);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int calls = (argc > 1 ? atoi(argv[1]) : 10000000);
+
+  lua_State* L = luaL_newstate();
+  luaL_openlibs(L);
+
+  ConstMemberCallback<uint32_t, BenchPlayer> typed("getLevel", &BenchPlayer::getLevel);
+  BenchPlayer player;
+  player.level = 100;
+
+  // The player userdata at index 1, like a class instance in the server
+  *(BenchPlayer**)lua_newuserdata(L, sizeof(BenchPlayer*)) = &player;
+  registerMethods(L, &typed);
+  lua_setmetatable(L, 1);
+
+  // Warm up, then measure each twice in turns
+  run(L, "getLevelDeclared", calls / 10);
+  run(L, "getLevelTyped", calls / 10);
+
+  double declared = 0, typedCalls = 0;
+  for(int i = 0; i < 2; ++i){
+    declared += run(L, "getLevelDeclared", calls) / 2;
+    typedCalls += run(L, "getLevelTyped", calls) / 2;
+  }
+
+  std::cout << calls << " calls of getLevel" << std::endl;
+  std::cout << "declared: " << (int64_t)declared << " calls/s" << std::endl;
+  std::cout << "typed: " << (int64_t)typedCalls << " calls/s" << std::endl;
+
+  lua_close(L);
+  return 0;
+}
@@ -0,0 +1,185 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// LuaJIT FFI fast path benchmark
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+// Calls creature:getHealth() from a Lua loop, once through a regular
+// binding and once through the fast path of
+// data/scripts/otstd/ffi_bindings.lua. Both find the creature the same way
+// as the server, by the ObjectID in the userdata, looked up in a copy of
+// the slot table of Script::Environment. The regular binding is the
+// typed callback path without the calling state lookup.
+//
+// With Lua 5.1 the fast path is not installed, the same as in the server,
+// so both loops call the regular binding. Build from the repository root
+// against the interpreter to measure, -rdynamic lets ffi.C find the
+// otserv_ functions in the executable:
+//
+//   g++ -O2 -rdynamic -Isrc -I<lua include dir> tools/bench/ffi_bench.cpp \
+//     -lluajit-5.1 -o ffi_bench
+//
+// Usage: ffi_bench [calls]
+
+#include "lua.hpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/time.h>
+
+namespace {
+  int64_t timeMicro()
+  {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+  }
+
+  struct Creature {
+    int32_t health;
+  };
+
+  // Script::Environment::findSlot and getThing
+  struct ObjectSlot {
+    void* object;
+    uint32_t generation;
+  };
+  std::vector<ObjectSlot> object_slots;
+
+  Creature* getCreature(uint64_t id)
+  {
+    uint32_t slot = (uint32_t)(id & 0xFFFFFFFF) - 1;
+    if(slot >= object_slots.size() || object_slots[slot].generation != (uint32_t)(id >> 32))
+      return NULL;
+    return (Creature*)object_slots[slot].object;
+  }
+
+  int lua_Creature_getHealth(lua_State* L)
+  {
+    if(lua_gettop(L) != 1)
+      return luaL_error(L, "Wrong number of arguments");
+
+    if(!lua_isuserdata(L, -1))
+      return luaL_error(L, "Couldn't pop thing");
+    Creature* creature = getCreature(*(uint64_t*)lua_touserdata(L, -1));
+    lua_pop(L, 1);
+    if(!creature)
+      return luaL_error(L, "Object does not exist in object list.");
+
+    lua_pushnumber(L, creature->health);
+    return 1;
+  }
+
+  // The fast path as ffi_bindings.lua installs it
+  const char* ffi_bindings =
+    "if jit == nil then return end\n"
+    "local ffi = require('ffi')\n"
+    "ffi.cdef[[ int otserv_creature_get_health(const void* object, int32_t* health); ]]\n"
+    "local C = ffi.C\n"
+    "local number = ffi.new('int32_t[1]')\n"
+    "local function isObject(self) return type(self) == 'userdata' end\n"
+    "local getHealth = Creature.getHealth\n"
+    "function Creature:getHealth()\n"
+    "  if isObject(self) and C.otserv_creature_get_health(self, number) ~= 0 then\n"
+    "    return number[0]\n"
+    "  end\n"
+    "  return getHealth(self)\n"
+    "end\n";
+
+  double run(lua_State* L, int calls)
+  {
+    const char* chunk =
+      "local creature, calls = ...\n"
+      "local sum = 0\n"
+      "for i = 1, calls do sum = sum + creature:getHealth() end\n"
+      "return sum\n";
+    if(luaL_loadstring(L, chunk) != 0){
+      std::cout << lua_tostring(L, -1) << std::endl;
+      exit(1);
+    }
+    lua_pushvalue(L, 1);
+    lua_pushnumber(L, calls);
+
+    int64_t start = timeMicro();
+    if(lua_pcall(L, 2, 1, 0) != 0){
+      std::cout << lua_tostring(L, -1) << std::endl;
+      exit(1);
+    }
+    int64_t elapsed = timeMicro() - start;
+    lua_pop(L, 1);
+    return calls * 1000000. / (elapsed > 0 ? elapsed : 1);
+  }
+}
+
+extern "C" int otserv_creature_get_health(const uint64_t* object, int32_t* health)
+{
+  Creature* creature = (object? getCreature(*object) : NULL);
+  if(!creature)
+    return 0;
+
+  *health = creature->health;
+  return 1;
+}
+
+int main(int argc, char* argv[])
+{
+  int calls = (argc > 1 ? atoi(argv[1]) : 10000000);
+
+  lua_State* L = luaL_newstate();
+  luaL_openlibs(L);
+
+  Creature creature;
+  creature.health = 150;
+  object_slots.resize(1000);
+  object_slots[41].object = &creature;
+  object_slots[41].generation = 7;
+
+  // The creature userdata at index 1, with Creature as its method table
+  *(uint64_t*)lua_newuserdata(L, sizeof(uint64_t)) = ((uint64_t)7 << 32) | 42;
+  lua_newtable(L);
+  lua_newtable(L);
+  lua_pushcfunction(L, &lua_Creature_getHealth);
+  lua_setfield(L, -2, "getHealth");
+  lua_pushvalue(L, -1);
+  lua_setglobal(L, "Creature");
+  lua_setfield(L, -2, "__index");
+  lua_setmetatable(L, 1);
+
+  lua_getglobal(L, "jit");
+  bool luajit = !lua_isnil(L, -1);
+  lua_pop(L, 1);
+  std::cout << (luajit ? "LuaJIT" : "Lua 5.1") << ", " << calls << " calls of getHealth" << std::endl;
+
+  run(L, calls / 10);
+  double regular = run(L, calls);
+
+  if(luaL_dostring(L, ffi_bindings) != 0){
+    std::cout << lua_tostring(L, -1) << std::endl;
+    return 1;
+  }
+  run(L, calls / 10);
+  double fast = run(L, calls);
+
+  std::cout << "binding: " << (int64_t)regular << " calls/s" << std::endl;
+  std::cout << "with ffi_bindings.lua: " << (int64_t)fast << " calls/s" << std::endl;
+
+  lua_close(L);
+  return 0;
+}
@@ -0,0 +1,183 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Local storage against SQLite benchmark
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+// Stores the same blobs in LocalStorage and in an SQLite table, the way a
+// server save stores players and houses: every blob of a save is written,
+// then made durable once. Build from the repository root:
+//
+//   g++ -O2 -D__USE_LOCAL_STORAGE__ -Isrc -I/usr/include/libxml2 -I<lua include dir> \
+//     tools/bench/local_storage_bench.cpp src/local_storage.cpp \
+//     -lsqlite3 -lboost_thread -lboost_system -o local_storage_bench
+//
+// Usage: local_storage_bench [blobs] [blob size] [saves]
+
+#include "otpch.h"
+#include "local_storage.h"
+#include "otsystem.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <sstream>
+#include <sqlite3.h>
+
+// tools.cpp would pull in the config manager and the rest of the server
+uint32_t adlerChecksum(uint8_t *data, int32_t len)
+{
+  uint32_t a = 1, b = 0;
+  while(len > 0){
+    int32_t tlen = len > 5552 ? 5552 : len;
+    len -= tlen;
+    do{
+      a += *data++;
+      b += a;
+    } while(--tlen);
+
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+namespace {
+  struct Result {
+    Result() : save(0), read(0) {}
+    // Microseconds for all the saves and for all the reads
+    int64_t save;
+    int64_t read;
+  };
+
+  std::string makeKey(int i)
+  {
+    std::ostringstream key;
+    key << "player/" << i;
+    return key.str();
+  }
+
+  std::string makeBlob(int i, int save, int size)
+  {
+    std::string blob(size, '\0');
+    for(int j = 0; j < size; ++j)
+      blob[j] = (char)(i * 31 + save * 7 + j);
+    return blob;
+  }
+
+  Result runLocalStorage(const std::string& filename, int blobs, int size, int saves)
+  {
+    remove(filename.c_str());
+    Result result;
+
+    LocalStorage storage;
+    if(!storage.open(filename)){
+      exit(1);
+    }
+
+    for(int save = 0; save < saves; ++save){
+      int64_t start = OTSYS_TIME_MICRO();
+      for(int i = 0; i < blobs; ++i){
+        storage.put(makeKey(i), makeBlob(i, save, size));
+      }
+      storage.sync();
+      result.save += OTSYS_TIME_MICRO() - start;
+    }
+
+    std::string value;
+    int64_t start = OTSYS_TIME_MICRO();
+    for(int i = 0; i < blobs; ++i){
+      storage.get(makeKey((i * 7919) % blobs), value);
+    }
+    result.read = OTSYS_TIME_MICRO() - start;
+
+    storage.close();
+    remove(filename.c_str());
+    return result;
+  }
+
+  Result runSQLite(const std::string& filename, int blobs, int size, int saves)
+  {
+    remove(filename.c_str());
+    Result result;
+
+    sqlite3* db = NULL;
+    if(sqlite3_open(filename.c_str(), &db) != SQLITE_OK){
+      std::cout << "Could not open " << filename << std::endl;
+      exit(1);
+    }
+    sqlite3_exec(db, "CREATE TABLE `blobs` (`key` VARCHAR(255) PRIMARY KEY, `value` BLOB NOT NULL)", NULL, NULL, NULL);
+
+    sqlite3_stmt* insert = NULL;
+    sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO `blobs` (`key`, `value`) VALUES (?, ?)", -1, &insert, NULL);
+
+    for(int save = 0; save < saves; ++save){
+      int64_t start = OTSYS_TIME_MICRO();
+      sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+      for(int i = 0; i < blobs; ++i){
+        std::string key = makeKey(i);
+        std::string blob = makeBlob(i, save, size);
+        sqlite3_bind_text(insert, 1, key.data(), key.size(), SQLITE_TRANSIENT);
+        sqlite3_bind_blob(insert, 2, blob.data(), blob.size(), SQLITE_TRANSIENT);
+        sqlite3_step(insert);
+        sqlite3_reset(insert);
+      }
+      sqlite3_exec(db, "COMMIT", NULL, NULL, NULL);
+      result.save += OTSYS_TIME_MICRO() - start;
+    }
+    sqlite3_finalize(insert);
+
+    sqlite3_stmt* select = NULL;
+    sqlite3_prepare_v2(db, "SELECT `value` FROM `blobs` WHERE `key` = ?", -1, &select, NULL);
+
+    std::string value;
+    int64_t start = OTSYS_TIME_MICRO();
+    for(int i = 0; i < blobs; ++i){
+      std::string key = makeKey((i * 7919) % blobs);
+      sqlite3_bind_text(select, 1, key.data(), key.size(), SQLITE_TRANSIENT);
+      if(sqlite3_step(select) == SQLITE_ROW){
+        value.assign((const char*)sqlite3_column_blob(select, 0), sqlite3_column_bytes(select, 0));
+      }
+      sqlite3_reset(select);
+    }
+    result.read = OTSYS_TIME_MICRO() - start;
+
+    sqlite3_finalize(select);
+    sqlite3_close(db);
+    remove(filename.c_str());
+    return result;
+  }
+
+  void print(const char* name, const Result& result, int blobs, int saves)
+  {
+    std::cout << name << ": "
+      << (result.save / 1000.) / saves << " ms per save of " << blobs << " blobs, "
+      << (int64_t)(blobs * 1000000. / (result.read > 0 ? result.read : 1)) << " reads/s" << std::endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int blobs = (argc > 1 ? atoi(argv[1]) : 5000);
+  int size = (argc > 2 ? atoi(argv[2]) : 4096);
+  int saves = (argc > 3 ? atoi(argv[3]) : 10);
+
+  std::cout << blobs << " blobs of " << size << " bytes, " << saves << " saves" << std::endl;
+  print("LocalStorage", runLocalStorage("bench_local_storage.dat", blobs, size, saves), blobs, saves);
+  print("SQLite", runSQLite("bench_sqlite.db", blobs, size, saves), blobs, saves);
+  return 0;
+}
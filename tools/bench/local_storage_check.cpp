@@ -0,0 +1,183 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Offline check of the embedded local storage
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+// Runs LocalStorage against a scratch file, no server or database needed.
+// Build from the repository root:
+//
+//   g++ -O2 -D__USE_LOCAL_STORAGE__ -Isrc -I/usr/include/libxml2 -I<lua include dir> \
+//     tools/bench/local_storage_check.cpp src/local_storage.cpp \
+//     -lboost_thread -lboost_system -o local_storage_check
+//
+// Exits with 0 when every check passed.
+
+#include "otpch.h"
+#include "local_storage.h"
+
+#include <stdio.h>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+// tools.cpp would pull in the config manager and the rest of the server
+uint32_t adlerChecksum(uint8_t *data, int32_t len)
+{
+  uint32_t a = 1, b = 0;
+  while(len > 0){
+    int32_t tlen = len > 5552 ? 5552 : len;
+    len -= tlen;
+    do{
+      a += *data++;
+      b += a;
+    } while(--tlen);
+
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+namespace {
+  int failures = 0;
+
+  void check(bool condition, const char* what)
+  {
+    if(!condition){
+      std::cout << "FAILED: " << what << std::endl;
+      ++failures;
+    }
+  }
+
+  std::string value(const std::string& key, size_t size)
+  {
+    std::string v;
+    while(v.size() < size)
+      v += key;
+    v.resize(size);
+    return v;
+  }
+
+  bool hasValue(LocalStorage& storage, const std::string& key, const std::string& expected)
+  {
+    std::string v;
+    return storage.get(key, v) && v == expected;
+  }
+
+  long fileSize(const std::string& filename)
+  {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(!f)
+      return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::string filename = (argc > 1 ? argv[1] : "local_storage_check.dat");
+  remove(filename.c_str());
+
+  LocalStorage storage;
+  check(storage.open(filename), "create a new file");
+
+  // Buffered records are readable before they are written
+  storage.put("player/1", "first");
+  storage.put("player/2", "second");
+  storage.put("house/1", "");
+  check(hasValue(storage, "player/1", "first"), "read a buffered record");
+  check(hasValue(storage, "house/1", ""), "read an empty value");
+
+  storage.put("player/1", "changed");
+  check(hasValue(storage, "player/1", "changed"), "newest record wins");
+
+  storage.erase("player/2");
+  std::string v;
+  check(!storage.get("player/2", v), "erased key is gone");
+
+  std::vector<std::string> keys;
+  storage.getKeys("player/", keys);
+  check(keys.size() == 1 && keys[0] == "player/1", "keys by prefix");
+
+  // Enough data to go past the write buffer, every value has to be read
+  // back through the mapping right after it was written
+  for(int i = 0; i < 64; ++i){
+    std::ostringstream key;
+    key << "blob/" << i;
+    storage.put(key.str(), value(key.str(), 128*1024));
+
+    bool readable = true;
+    for(int j = 0; j <= i; ++j){
+      std::ostringstream other;
+      other << "blob/" << j;
+      readable = readable && hasValue(storage, other.str(), value(other.str(), 128*1024));
+    }
+    check(readable, "read records written past the buffer size");
+  }
+
+  check(storage.sync(), "sync");
+  storage.close();
+
+  check(storage.open(filename), "reopen");
+  check(hasValue(storage, "player/1", "changed"), "record survives reopen");
+  check(!storage.get("player/2", v), "erase survives reopen");
+  check(hasValue(storage, "blob/63", value("blob/63", 128*1024)), "large record survives reopen");
+
+  // A record cut short by a crash is dropped, the ones before it are kept
+  storage.put("torn", value("torn", 1000));
+  storage.sync();
+  storage.close();
+  long size = fileSize(filename);
+  check(size > 0 && truncate(filename.c_str(), size - 10) == 0, "cut the last record");
+
+  check(storage.open(filename), "reopen after a torn write");
+  check(!storage.get("torn", v), "torn record is dropped");
+  check(hasValue(storage, "player/1", "changed"), "records before a torn write are kept");
+  storage.put("after", "torn");
+  storage.sync();
+  storage.close();
+  check(storage.open(filename) && hasValue(storage, "after", "torn"), "append after dropping a torn record");
+
+  // Overwrite most of the data, then compact
+  for(int i = 0; i < 64; ++i){
+    std::ostringstream key;
+    key << "blob/" << i;
+    storage.erase(key.str());
+  }
+  storage.sync();
+  long before = fileSize(filename);
+  // Not synced, compaction writes it to the old file before replacing it
+  storage.put("unsynced", "kept");
+  check(storage.compact(true), "compact");
+  check(hasValue(storage, "unsynced", "kept"), "unsynced records survive compaction");
+  check(fileSize(filename) < before, "compact shrinks the file");
+  check(hasValue(storage, "player/1", "changed"), "live records survive compaction");
+  check(!storage.get("blob/0", v), "erased records are gone after compaction");
+  storage.close();
+  check(storage.open(filename) && hasValue(storage, "unsynced", "kept"), "compacted file holds unsynced records");
+  storage.close();
+
+  remove(filename.c_str());
+
+  if(failures == 0)
+    std::cout << "All local storage checks passed." << std::endl;
+  return failures == 0 ? 0 : 1;
+}
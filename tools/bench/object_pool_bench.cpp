@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Object pool allocation benchmark
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+// Allocates and frees objects of one size from a number of threads at
+// once, through an ObjectPool shared by all of them and through the global
+// operator new. Every thread keeps a window of live objects and replaces a
+// random one in each step, so blocks are freed out of order like items on
+// the map. The same steps also run taking a boost::mutex twice, the
+// lock the pool used to take for every allocation and release. Build
+// from the repository root:
+//
+//   g++ -O2 -Isrc -I/usr/include/libxml2 -I<lua include dir> \
+//     tools/bench/object_pool_bench.cpp src/object_pool.cpp \
+//     -lboost_thread -lboost_system -o object_pool_bench
+//
+// Usage: object_pool_bench [threads] [steps per thread] [object size] [live objects per thread]
+
+#include "otpch.h"
+#include "object_pool.h"
+#include "otsystem.h"
+
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace {
+  enum Mode {
+    MODE_POOL,
+    MODE_GLOBAL,
+    MODE_LOCK
+  };
+
+  struct Run {
+    Mode mode;
+    ObjectPool* pool;
+    boost::mutex* lock;
+    size_t size;
+    int steps;
+    int live;
+  };
+
+  // Small and the same for every thread, rand() takes a lock of its own
+  uint32_t nextRandom(uint32_t& seed)
+  {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+  }
+
+  void* allocate(const Run& run)
+  {
+    if(run.mode == MODE_POOL){
+      return run.pool->allocate(run.size);
+    }
+    return ::operator new(run.size);
+  }
+
+  void release(const Run& run, void* p)
+  {
+    if(run.mode == MODE_POOL){
+      run.pool->release(p, run.size);
+    }
+    else{
+      ::operator delete(p);
+    }
+  }
+
+  void runThread(const Run* run, uint32_t seed)
+  {
+    std::vector<void*> objects(run->live);
+    for(int i = 0; i < run->live; ++i){
+      objects[i] = allocate(*run);
+    }
+
+    for(int i = 0; i < run->steps; ++i){
+      void*& object = objects[nextRandom(seed) % run->live];
+      if(run->mode == MODE_LOCK){
+        run->lock->lock();
+        run->lock->unlock();
+        run->lock->lock();
+        run->lock->unlock();
+        continue;
+      }
+      release(*run, object);
+      object = allocate(*run);
+      // Touch it, as a constructor would
+      *(volatile char*)object = 0;
+    }
+
+    for(int i = 0; i < run->live; ++i){
+      release(*run, objects[i]);
+    }
+  }
+
+  // Million alloc and free pairs per second, over all threads
+  double measure(Run run, int threads)
+  {
+    int64_t start = OTSYS_TIME_MICRO();
+    boost::thread_group workers;
+    for(int i = 0; i < threads; ++i){
+      workers.create_thread(boost::bind(&runThread, &run, 1 + i));
+    }
+    workers.join_all();
+    int64_t elapsed = OTSYS_TIME_MICRO() - start;
+    return (double)run.steps * threads / (elapsed > 0 ? elapsed : 1);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int threads = (argc > 1 ? atoi(argv[1]) : 8);
+  int steps = (argc > 2 ? atoi(argv[2]) : 2000000);
+  size_t size = (argc > 3 ? atoi(argv[3]) : 88);
+  int live = (argc > 4 ? atoi(argv[4]) : 10000);
+
+  ObjectPool pool("Bench", size);
+  boost::mutex lock;
+
+  Run run;
+  run.pool = &pool;
+  run.lock = &lock;
+  run.size = size;
+  run.steps = steps;
+  run.live = live;
+
+  std::cout << steps << " steps per thread, " << size << " byte objects, "
+    << live << " live per thread, " << boost::thread::hardware_concurrency() << " cores" << std::endl;
+
+  for(int n = 1; n <= threads; n *= 2){
+    run.mode = MODE_POOL;
+    double pooled = measure(run, n);
+    run.mode = MODE_GLOBAL;
+    double global = measure(run, n);
+    run.mode = MODE_LOCK;
+    double locked = measure(run, n);
+
+    std::cout << n << " threads: pool " << pooled << "M/s, global new " << global
+      << "M/s, mutex only " << locked << "M/s" << std::endl;
+  }
+  return 0;
+}
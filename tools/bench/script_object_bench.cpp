@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////////
+// OpenTibia - an opensource roleplaying game
+//////////////////////////////////////////////////////////////////////
+// Script object table benchmark
+//////////////////////////////////////////////////////////////////////
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//////////////////////////////////////////////////////////////////////
+
+// Replays the object table traffic of the otstd food and door actions on
+// Script::Environment and on a copy of the boost::bimap it replaced.
+// - food: the player and the food are pushed, the script reads the player
+//   twice and the food once, then the food is eaten and destroyed
+// - door: the player and the door are pushed, the script reads the door
+//   four times and pushes and reads its tile
+// Every action also destroys things scripts never saw, as decaying and
+// moved items are, which is what g_gameUnscriptThing does most of the time.
+// The table starts out holding the things of a busy server. Build from the
+// repository root:
+//
+//   g++ -O2 -Isrc -I/usr/include/libxml2 -I<lua include dir> \
+//     tools/bench/script_object_bench.cpp src/script_environment.cpp src/position.cpp \
+//     -o script_object_bench
+//
+// Usage: script_object_bench [actions] [things known to scripts] [unscripted destroys per action]
+
+#include "otpch.h"
+#include "script_environment.h"
+#include "script_listener.h"
+#include "position.h"
+#include "otsystem.h"
+
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+#include <boost/bimap.hpp>
+
+// thing.cpp and script_listener.cpp would pull in the map and the script
+// manager, the table only needs this much of them
+Thing::Thing() : parent(NULL), m_refCount(0), m_scriptSlot(0) {}
+Thing::~Thing() {}
+void Thing::setParent(Cylinder* cylinder) {parent = cylinder;}
+Tile* Thing::getParentTile() {return NULL;}
+const Tile* Thing::getParentTile() const {return NULL;}
+Position Thing::getPosition() const {return Position();}
+Item* Thing::getItem() {return NULL;}
+const Item* Thing::getItem() const {return NULL;}
+Tile* Thing::getTile() {return NULL;}
+const Tile* Thing::getTile() const {return NULL;}
+Creature* Thing::getCreature() {return NULL;}
+const Creature* Thing::getCreature() const {return NULL;}
+bool Thing::isRemoved() const {return false;}
+void Script::Listener::deactivate() {}
+
+namespace {
+  class BenchThing : public Thing {
+  public:
+    virtual std::string getDescription(int32_t lookDistance) const {return "";}
+    virtual int getThrowRange() const {return 1;}
+    virtual bool isPushable() const {return true;}
+  };
+
+  // The object map of Script::Environment before the slot table
+  class BimapObjects {
+  public:
+    BimapObjects() : objectID_counter(0) {}
+
+    typedef boost::bimap<Script::ObjectID, void*> ObjectMap;
+
+    Script::ObjectID addThing(Thing* thing) {
+      ObjectMap::right_iterator thing_iter = object_map.right.find(thing);
+      if(thing_iter == object_map.right.end()) {
+        Script::ObjectID id = ++objectID_counter;
+        object_map.left.insert(std::make_pair(id, reinterpret_cast<void*>(thing)));
+        return id;
+      }
+      return thing_iter->second;
+    }
+
+    Thing* getThing(Script::ObjectID id) {
+      ObjectMap::left_iterator id_iter = object_map.left.find(id);
+      if(id_iter == object_map.left.end()) {
+        return NULL;
+      }
+      return reinterpret_cast<Thing*>(id_iter->second);
+    }
+
+    bool removeThing(Thing* thing) {
+      ObjectMap::right_iterator thing_iter = object_map.right.find(thing);
+      if(thing_iter == object_map.right.end()) {
+        return false;
+      }
+      object_map.right.erase(thing_iter);
+      return true;
+    }
+
+  protected:
+    Script::ObjectID objectID_counter;
+    ObjectMap object_map;
+  };
+
+  struct Workload {
+    int actions;
+    int known;
+    int unscripted;
+  };
+
+  // Small and the same for both tables
+  uint32_t nextRandom(uint32_t& seed)
+  {
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+  }
+
+  // Checked, so the compiler can't drop the lookups
+  uint64_t found = 0;
+
+  template<class Table>
+  int64_t run(Table& table, const Workload& work)
+  {
+    std::vector<BenchThing*> known(work.known);
+    for(int i = 0; i < work.known; ++i){
+      known[i] = new BenchThing();
+      table.addThing(known[i]);
+    }
+    std::vector<BenchThing*> players(known.begin(), known.begin() + std::min(work.known, 500));
+    std::vector<BenchThing*> unscripted(work.unscripted);
+    for(int i = 0; i < work.unscripted; ++i){
+      unscripted[i] = new BenchThing();
+    }
+
+    uint32_t seed = 1;
+    int64_t start = OTSYS_TIME_MICRO();
+    for(int i = 0; i < work.actions; ++i){
+      Thing* player = players[nextRandom(seed) % players.size()];
+      Script::ObjectID playerID = table.addThing(player);
+
+      if(i % 2 == 0){
+        // Food, a new item every time
+        BenchThing* food = new BenchThing();
+        Script::ObjectID foodID = table.addThing(food);
+        found += (table.getThing(playerID) != NULL);
+        found += (table.getThing(playerID) != NULL);
+        found += (table.getThing(foodID) != NULL);
+        table.removeThing(food);
+        delete food;
+      }
+      else{
+        // Door, one already known to scripts, and its tile
+        Thing* door = known[nextRandom(seed) % known.size()];
+        Thing* tile = known[nextRandom(seed) % known.size()];
+        Script::ObjectID doorID = table.addThing(door);
+        for(int n = 0; n < 4; ++n){
+          found += (table.getThing(doorID) != NULL);
+        }
+        Script::ObjectID tileID = table.addThing(tile);
+        found += (table.getThing(tileID) != NULL);
+      }
+
+      for(int n = 0; n < work.unscripted; ++n){
+        table.removeThing(unscripted[n]);
+      }
+    }
+    int64_t elapsed = OTSYS_TIME_MICRO() - start;
+
+    for(int i = 0; i < work.known; ++i){
+      table.removeThing(known[i]);
+      delete known[i];
+    }
+    for(int i = 0; i < work.unscripted; ++i){
+      delete unscripted[i];
+    }
+    return elapsed;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  Workload work;
+  work.actions = (argc > 1 ? atoi(argv[1]) : 1000000);
+  work.known = (argc > 2 ? atoi(argv[2]) : 50000);
+  work.unscripted = (argc > 3 ? atoi(argv[3]) : 10);
+
+  std::cout << work.actions << " actions, " << work.known << " things known to scripts, "
+    << work.unscripted << " unscripted things destroyed per action" << std::endl;
+
+  Script::Environment environment;
+  int64_t slots = run(environment, work);
+  BimapObjects bimap;
+  int64_t bimapTime = run(bimap, work);
+
+  std::cout << "slot table: " << (int64_t)(work.actions * 1000000. / (slots > 0 ? slots : 1)) << " actions/s" << std::endl;
+  std::cout << "bimap: " << (int64_t)(work.actions * 1000000. / (bimapTime > 0 ? bimapTime : 1)) << " actions/s" << std::endl;
+  return (found > 0 ? 0 : 1);
+}
@@ -209,7 +209,8 @@ enum ({name="TileProp", bitmask=true},
 	{"TILEPROP_BLOCKPATHNOTFIELD"},
 	{"TILEPROP_HOUSE_TILE"},
 	{"TILEPROP_DYNAMIC_TILE"},
-	{"TILEPROP_INDEXED_TILE"}
+	{"TILEPROP_INDEXED_TILE"},
+	{"TILEPROP_SCRIPT_HOOK"}
 )
 
 enum ("ZoneType",